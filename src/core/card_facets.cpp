@@ -0,0 +1,381 @@
+#include "card_facets.h"
+#include <map>
+#include <algorithm>
+
+struct FacetValue {
+  String value;
+  CardBits cards;
+};
+
+// Per-value bitsets of the loaded index (large ones land in PSRAM through malloc)
+static std::vector<FacetValue> categoryFacets;
+static std::vector<FacetValue> tagFacets;
+static std::vector<FacetValue> languageFacets;
+static CardBits difficultyFacets[FACET_MAX_DIFFICULTY + 1];
+static CardBits unlistedLanguageCards;  // Index entries without a languages array: treated as having every language
+static CardBits allCards;
+static int facetCardCount = 0;
+static uint32_t facetBuildMs = 0;
+
+static int wordCount(int cards) {
+  return (cards + 31) / 32;
+}
+
+static void setBit(CardBits& cards, int index) {
+  cards[index >> 5] |= 1u << (index & 31);
+}
+
+static void clearBit(CardBits& cards, int index) {
+  cards[index >> 5] &= ~(1u << (index & 31));
+}
+
+// Function to drop bit `index` from a set, moving every later card down by one
+static void removeBit(CardBits& cards, int index) {
+  int first = index >> 5;
+  uint32_t below = (1u << (index & 31)) - 1;
+  for (int w = first; w < (int)cards.size(); w++) {
+    uint32_t word = cards[w];
+    word = (w == first) ? (word & below) | ((word >> 1) & ~below) : word >> 1;
+    uint32_t next = w + 1 < (int)cards.size() ? cards[w + 1] : 0;
+    cards[w] = word | (next << 31);
+  }
+}
+
+// Function to add a card to the bitset of one facet value, creating it on first use
+static void addToFacet(std::vector<FacetValue>& facets, std::map<String, int>& positions, const String& value, int cardIndex) {
+  auto it = positions.find(value);
+  int position;
+  if (it == positions.end()) {
+    position = facets.size();
+    positions[value] = position;
+    facets.push_back({value, CardBits(wordCount(facetCardCount), 0)});
+  } else {
+    position = it->second;
+  }
+  setBit(facets[position].cards, cardIndex);
+}
+
+static const CardBits* findFacet(const std::vector<FacetValue>& facets, const String& value) {
+  for (const FacetValue& facet : facets) {
+    if (facet.value == value) {
+      return &facet.cards;
+    }
+  }
+  return nullptr;
+}
+
+// Function to size every set for facetCardCount cards (new bits clear, allCards full)
+static void resizeFacets() {
+  int words = wordCount(facetCardCount);
+  for (std::vector<FacetValue>* facets : {&categoryFacets, &tagFacets, &languageFacets}) {
+    for (FacetValue& facet : *facets) {
+      facet.cards.resize(words, 0);
+    }
+  }
+  for (int level = 0; level <= FACET_MAX_DIFFICULTY; level++) {
+    difficultyFacets[level].resize(words, 0);
+  }
+  unlistedLanguageCards.resize(words, 0);
+  allCards.assign(words, 0xFFFFFFFF);
+  if (facetCardCount % 32) {
+    allCards[words - 1] = (1u << (facetCardCount % 32)) - 1;
+  }
+}
+
+// Function to set the bits of one index entry in every facet it belongs to
+static void addCardToFacets(JsonObject card, int index, std::map<String, int>& categoryPositions,
+                            std::map<String, int>& tagPositions, std::map<String, int>& languagePositions) {
+  addToFacet(categoryFacets, categoryPositions, card["category"] | "uncategorized", index);
+  int difficulty = constrain(card["difficulty"] | FACET_MIN_DIFFICULTY, FACET_MIN_DIFFICULTY, FACET_MAX_DIFFICULTY);
+  setBit(difficultyFacets[difficulty], index);
+  for (JsonVariant tag : card["tags"].as<JsonArray>()) {
+    addToFacet(tagFacets, tagPositions, tag.as<String>(), index);
+  }
+  JsonArray languages = card["languages"];
+  if (languages.isNull()) {
+    setBit(unlistedLanguageCards, index);
+  }
+  for (JsonVariant language : languages) {
+    addToFacet(languageFacets, languagePositions, language.as<String>(), index);
+  }
+}
+
+static void mapFacetPositions(const std::vector<FacetValue>& facets, std::map<String, int>& positions) {
+  for (int i = 0; i < (int)facets.size(); i++) {
+    positions[facets[i].value] = i;
+  }
+}
+
+// Function to drop values no card has any more (e.g. a category whose last card moved)
+static void pruneEmptyFacets(std::vector<FacetValue>& facets) {
+  facets.erase(std::remove_if(facets.begin(), facets.end(),
+                              [](const FacetValue& facet) { return countCards(facet.cards) == 0; }),
+               facets.end());
+}
+
+void buildCardFacets(JsonDocument& indexDoc) {
+  uint32_t start = millis();
+  JsonArray cards = indexDoc["cards"];
+  facetCardCount = cards.size();
+
+  categoryFacets.clear();
+  tagFacets.clear();
+  languageFacets.clear();
+  for (int level = 0; level <= FACET_MAX_DIFFICULTY; level++) {
+    difficultyFacets[level].clear();
+  }
+  unlistedLanguageCards.clear();
+  resizeFacets();
+
+  std::map<String, int> categoryPositions, tagPositions, languagePositions;
+  int index = 0;
+  for (JsonObject card : cards) {
+    addCardToFacets(card, index, categoryPositions, tagPositions, languagePositions);
+    index++;
+  }
+
+  facetBuildMs = millis() - start;
+  printCardFacetStats();
+}
+
+void updateCardFacets(JsonDocument& indexDoc, const std::vector<int>& removedCards, const std::vector<int>& updatedCards) {
+  uint32_t start = millis();
+  JsonArray cards = indexDoc["cards"];
+
+  // Removed cards first (highest first), so the positions below stay valid
+  for (int index : removedCards) {
+    if (index < 0 || index >= facetCardCount) {
+      continue;
+    }
+    for (std::vector<FacetValue>* facets : {&categoryFacets, &tagFacets, &languageFacets}) {
+      for (FacetValue& facet : *facets) {
+        removeBit(facet.cards, index);
+      }
+    }
+    for (int level = 0; level <= FACET_MAX_DIFFICULTY; level++) {
+      removeBit(difficultyFacets[level], index);
+    }
+    removeBit(unlistedLanguageCards, index);
+    facetCardCount--;
+  }
+
+  // Added cards are at the end of the index
+  facetCardCount = cards.size();
+  resizeFacets();
+
+  std::map<String, int> categoryPositions, tagPositions, languagePositions;
+  mapFacetPositions(categoryFacets, categoryPositions);
+  mapFacetPositions(tagFacets, tagPositions);
+  mapFacetPositions(languageFacets, languagePositions);
+  for (int index : updatedCards) {
+    if (index < 0 || index >= facetCardCount) {
+      continue;
+    }
+    for (std::vector<FacetValue>* facets : {&categoryFacets, &tagFacets, &languageFacets}) {
+      for (FacetValue& facet : *facets) {
+        clearBit(facet.cards, index);
+      }
+    }
+    for (int level = 0; level <= FACET_MAX_DIFFICULTY; level++) {
+      clearBit(difficultyFacets[level], index);
+    }
+    clearBit(unlistedLanguageCards, index);
+    addCardToFacets(cards[index].as<JsonObject>(), index, categoryPositions, tagPositions, languagePositions);
+  }
+
+  pruneEmptyFacets(categoryFacets);
+  pruneEmptyFacets(tagFacets);
+  pruneEmptyFacets(languageFacets);
+
+  facetBuildMs = millis() - start;
+  Serial.printf("[Facets] Updated %d cards, removed %d, in %lu ms\n", updatedCards.size(), removedCards.size(),
+                (unsigned long)facetBuildMs);
+}
+
+int categoryCardCount(const String& category) {
+  const CardBits* cards = findFacet(categoryFacets, category);
+  return cards ? countCards(*cards) : 0;
+}
+
+bool cardFilterNarrows(const CardFilter& filter) {
+  return filter.category != "" || filter.minDifficulty > FACET_MIN_DIFFICULTY ||
+         filter.maxDifficulty < FACET_MAX_DIFFICULTY || !filter.tags.empty() || !filter.languages.empty();
+}
+
+void matchCards(const CardFilter& filter, CardBits& out) {
+  int words = allCards.size();
+  out.assign(words, 0);
+
+  // Resolve the values once; an unknown category or language matches nothing
+  const CardBits* category = nullptr;
+  if (filter.category != "") {
+    category = findFacet(categoryFacets, filter.category);
+    if (!category) {
+      return;
+    }
+  }
+  // A language no card lists still matches the cards without a list
+  static const CardBits noCards;
+  std::vector<const CardBits*> languages;
+  for (const String& language : filter.languages) {
+    const CardBits* cards = findFacet(languageFacets, language);
+    languages.push_back(cards ? cards : &noCards);
+  }
+  std::vector<const CardBits*> tags;
+  for (const String& tag : filter.tags) {
+    const CardBits* cards = findFacet(tagFacets, tag);
+    if (cards) {
+      tags.push_back(cards);
+    }
+  }
+  if (!filter.tags.empty() && tags.empty()) {
+    return;
+  }
+  int minDifficulty = max(filter.minDifficulty, FACET_MIN_DIFFICULTY);
+  int maxDifficulty = min(filter.maxDifficulty, FACET_MAX_DIFFICULTY);
+  bool difficultyRange = minDifficulty > FACET_MIN_DIFFICULTY || maxDifficulty < FACET_MAX_DIFFICULTY;
+
+  for (int w = 0; w < words; w++) {
+    uint32_t word = allCards[w];
+    if (category) {
+      word &= (*category)[w];
+    }
+    if (difficultyRange) {
+      uint32_t levels = 0;
+      for (int level = minDifficulty; level <= maxDifficulty; level++) {
+        levels |= difficultyFacets[level][w];
+      }
+      word &= levels;
+    }
+    if (!tags.empty()) {
+      uint32_t anyTag = 0;
+      for (const CardBits* cards : tags) {
+        anyTag |= (*cards)[w];
+      }
+      word &= anyTag;
+    }
+    for (const CardBits* cards : languages) {
+      uint32_t listed = w < (int)cards->size() ? (*cards)[w] : 0;
+      word &= listed | unlistedLanguageCards[w];
+    }
+    out[w] = word;
+  }
+}
+
+int countCards(const CardBits& cards) {
+  int count = 0;
+  for (uint32_t word : cards) {
+    count += __builtin_popcount(word);
+  }
+  return count;
+}
+
+bool containsCard(const CardBits& cards, int cardIndex) {
+  if (cardIndex < 0 || (cardIndex >> 5) >= (int)cards.size()) {
+    return false;
+  }
+  return cards[cardIndex >> 5] & (1u << (cardIndex & 31));
+}
+
+int nthCard(const CardBits& cards, int n) {
+  if (n < 0) {
+    return -1;
+  }
+  for (int w = 0; w < (int)cards.size(); w++) {
+    uint32_t word = cards[w];
+    int inWord = __builtin_popcount(word);
+    if (n >= inWord) {
+      n -= inWord;
+      continue;
+    }
+    // Drop the n lowest set bits; the lowest remaining one is the card
+    while (n-- > 0) {
+      word &= word - 1;
+    }
+    return w * 32 + __builtin_ctz(word);
+  }
+  return -1;
+}
+
+int cardRank(const CardBits& cards, int cardIndex) {
+  if (!containsCard(cards, cardIndex)) {
+    return -1;
+  }
+  int rank = 0;
+  for (int w = 0; w < (cardIndex >> 5); w++) {
+    rank += __builtin_popcount(cards[w]);
+  }
+  uint32_t below = (1u << (cardIndex & 31)) - 1;
+  return rank + __builtin_popcount(cards[cardIndex >> 5] & below);
+}
+
+int randomCard(const CardBits& cards, int excludeIndex) {
+  int count = countCards(cards);
+  int excludedRank = cardRank(cards, excludeIndex);
+  int choices = count - (excludedRank >= 0 ? 1 : 0);
+  if (choices <= 0) {
+    return -1;
+  }
+  int pick = random(choices);
+  if (excludedRank >= 0 && pick >= excludedRank) {
+    pick++;
+  }
+  return nthCard(cards, pick);
+}
+
+bool cardHasLanguage(int cardIndex, const String& language) {
+  if (cardIndex < 0 || cardIndex >= facetCardCount) {
+    return true;
+  }
+  if (containsCard(unlistedLanguageCards, cardIndex)) {
+    return true;
+  }
+  const CardBits* cards = findFacet(languageFacets, language);
+  return cards && containsCard(*cards, cardIndex);
+}
+
+String describeCardFilter(const CardFilter& filter) {
+  String text;
+  if (filter.category != "") {
+    text += " category=" + filter.category;
+  }
+  if (filter.minDifficulty > FACET_MIN_DIFFICULTY || filter.maxDifficulty < FACET_MAX_DIFFICULTY) {
+    text += " difficulty=" + String(filter.minDifficulty) + "-" + String(filter.maxDifficulty);
+  }
+  for (int i = 0; i < (int)filter.tags.size(); i++) {
+    text += (i == 0 ? " tag=" : "|") + filter.tags[i];
+  }
+  for (const String& language : filter.languages) {
+    text += " language=" + language;
+  }
+  if (text.length() == 0) {
+    return "all cards";
+  }
+  return text.substring(1);
+}
+
+static void printFacetValues(const char* kind, const std::vector<FacetValue>& facets) {
+  Serial.printf("[Facets] %d %s:", facets.size(), kind);
+  for (const FacetValue& facet : facets) {
+    Serial.printf(" %s(%d)", facet.value.c_str(), countCards(facet.cards));
+  }
+  Serial.println();
+}
+
+void printCardFacetStats() {
+  int bitsets = categoryFacets.size() + tagFacets.size() + languageFacets.size() + FACET_MAX_DIFFICULTY + 3;
+  Serial.printf("[Facets] %d cards, %d bitsets, %d KB, built in %lu ms\n", facetCardCount, bitsets,
+                (int)(bitsets * allCards.size() * sizeof(uint32_t) / 1024), (unsigned long)facetBuildMs);
+  printFacetValues("categories", categoryFacets);
+  printFacetValues("languages", languageFacets);
+  int unlisted = countCards(unlistedLanguageCards);
+  if (unlisted > 0) {
+    Serial.printf("[Facets] %d cards without a languages list (match every language)\n", unlisted);
+  }
+  printFacetValues("tags", tagFacets);
+  Serial.print("[Facets] difficulty:");
+  for (int level = FACET_MIN_DIFFICULTY; level <= FACET_MAX_DIFFICULTY; level++) {
+    Serial.printf(" %d(%d)", level, countCards(difficultyFacets[level]));
+  }
+  Serial.println();
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+
+// A set of cards of the loaded index: bit i is cards[i], 32 cards per word
+typedef std::vector<uint32_t> CardBits;
+
+// Difficulty levels with their own bitset; other values are clamped into the range
+#define FACET_MIN_DIFFICULTY 1
+#define FACET_MAX_DIFFICULTY 5
+
+// A combination of facets; every part that is set must match (AND).
+// Within tags any one is enough (OR); every listed language is required.
+struct CardFilter {
+    String category;                     // Category id, "" = any
+    int minDifficulty = FACET_MIN_DIFFICULTY;
+    int maxDifficulty = FACET_MAX_DIFFICULTY;
+    std::vector<String> tags;            // Any of these tags, empty = any
+    std::vector<String> languages;       // All of these languages (cards without a list have every language)
+};
+
+// Build one bitset per category, difficulty, tag and language of indexDoc.
+// Called once per loaded or updated index; everything below reads the bitsets.
+void buildCardFacets(JsonDocument& indexDoc);
+
+// Bring the bitsets in line after an incremental index update: drop the removed
+// positions (previous index, highest first), then re-read only the updated
+// entries (positions in indexDoc, added cards at the end).
+void updateCardFacets(JsonDocument& indexDoc, const std::vector<int>& removedCards, const std::vector<int>& updatedCards);
+
+// True when the filter can exclude cards (anything besides the defaults)
+bool cardFilterNarrows(const CardFilter& filter);
+
+// Cards matching the filter, computed a word (32 cards) at a time
+void matchCards(const CardFilter& filter, CardBits& out);
+
+// Popcount-based queries on a set
+int countCards(const CardBits& cards);
+bool containsCard(const CardBits& cards, int cardIndex);
+int nthCard(const CardBits& cards, int n);           // Index of the n-th card in the set, -1 past the end
+int cardRank(const CardBits& cards, int cardIndex);  // Position of a card in the set, -1 if absent
+int randomCard(const CardBits& cards, int excludeIndex = -1);  // -1 if nothing else is in the set
+
+// Cards in a category, from its bitset (0 for categories without cards)
+int categoryCardCount(const String& category);
+
+// From the index's per-card languages, no card.json or image lookups.
+// Cards without a languages list, or beyond the facets (e.g. no index
+// loaded), report every language.
+bool cardHasLanguage(int cardIndex, const String& language);
+
+// "category=transport difficulty=1-2 language=japanese", for logs and the console
+String describeCardFilter(const CardFilter& filter);
+
+// Facet values, cards per value and bitset memory
+void printCardFacetStats();
@@ -0,0 +1,351 @@
+#include "control.h"
+#include "serial_console.h"
+#include "gesture.h"
+#include "touch_trace.h"
+#include "energy.h"
+#include "sd_stream.h"
+#include "thumbnail_cache.h"
+#include "png_fast.h"
+#include "page_router.h"
+#include "deck_sync.h"
+#include "json_arena.h"
+#include <M5Unified.h>
+#include <esp_heap_caps.h>
+#include <vector>
+
+// Injected gestures (offsets in ms from the touch-down)
+#define CONTROL_TAP_MS 60
+#define CONTROL_SWIPE_STEPS 5
+#define CONTROL_SWIPE_STEP_MS 20
+#define CONTROL_TWO_FINGER_MS 120
+
+static ControlNavigate navigateUi = nullptr;
+static ControlDescribe describeUi = nullptr;
+
+// Touch samples still to be fed, with their due millis()
+static std::vector<TouchSample> injectSamples;
+static size_t injectNext = 0;
+
+// The action waiting for its refresh
+static bool actionPending = false;
+static String actionCommand;
+static uint32_t actionStartMs = 0;    // Gesture recognized (touches) or command received (go)
+static uint32_t actionHandledMs = 0;
+static bool actionGesture = false;    // Touch action: the times come from the gesture
+static const char* gestureSeen = nullptr;
+
+// Longest time between two loop() passes, and passes since boot
+static uint32_t loopCount = 0;
+static uint32_t loopMaxMs = 0;
+static uint32_t lastTickMs = 0;
+
+static void sendReply(JsonDocument& reply) {
+  Serial.print("CTL ");
+  serializeJson(reply, Serial);
+  Serial.println();
+}
+
+static void sendError(const String& command, const char* error) {
+  JsonDocument reply;
+  reply["ok"] = false;
+  reply["cmd"] = command;
+  reply["error"] = error;
+  sendReply(reply);
+}
+
+// Runs after the page handlers (subscribed later), so the handler has returned
+static void onGesture(const GestureEvent& event) {
+  if (!actionPending || !actionGesture || gestureSeen) {
+    return;
+  }
+  gestureSeen = gestureName(event.type);
+  actionStartMs = event.timeMs;
+  actionHandledMs = millis();
+}
+
+static void finishAction(bool timedOut) {
+  actionPending = false;
+  uint32_t now = millis();
+  JsonDocument reply;
+  reply["ok"] = true;
+  reply["cmd"] = actionCommand;
+  if (actionGesture) {
+    if (gestureSeen) {
+      reply["gesture"] = gestureSeen;
+    } else {
+      reply["gesture"] = nullptr;  // The samples did not form a gesture
+    }
+  }
+  reply["handled_ms"] = actionHandledMs - actionStartMs;
+  reply["ink_ms"] = now - actionStartMs;
+  if (timedOut) {
+    reply["timeout"] = true;
+  }
+  JsonObject state = reply["state"].to<JsonObject>();
+  if (describeUi) {
+    describeUi(state);
+  }
+  sendReply(reply);
+}
+
+static void addSample(uint32_t dueMs, int x, int y, int fingers) {
+  injectSamples.push_back({dueMs, (int16_t)x, (int16_t)y, (uint8_t)fingers});
+}
+
+// Function to queue the samples of a tap, long-press or two-finger tap at x y
+static void queueGesture(const String& kind, String& args) {
+  uint32_t now = millis();
+  int x = consoleNextWord(args).toInt();
+  int y = consoleNextWord(args).toInt();
+  injectSamples.clear();
+  injectNext = 0;
+
+  if (kind == "tap") {
+    addSample(now, x, y, 1);
+    addSample(now + CONTROL_TAP_MS, x, y, 0);
+  } else if (kind == "long") {
+    addSample(now, x, y, 1);
+    addSample(now + GESTURE_LONG_PRESS_MS + CONTROL_TAP_MS, x, y, 0);
+  } else if (kind == "twofinger") {
+    addSample(now, x, y, 1);
+    addSample(now + CONTROL_TAP_MS / 2, x, y, 2);
+    addSample(now + CONTROL_TWO_FINGER_MS, x, y, 0);
+  }
+}
+
+// Function to queue a swipe across the middle half of the screen at height y
+static void queueSwipe(bool left, int y) {
+  uint32_t now = millis();
+  int width = M5.Display.width();
+  int fromX = left ? width * 3 / 4 : width / 4;
+  int toX = left ? width / 4 : width * 3 / 4;
+  injectSamples.clear();
+  injectNext = 0;
+  for (int step = 0; step <= CONTROL_SWIPE_STEPS; step++) {
+    int x = fromX + (toX - fromX) * step / CONTROL_SWIPE_STEPS;
+    addSample(now + step * CONTROL_SWIPE_STEP_MS, x, y, 1);
+  }
+  addSample(now + (CONTROL_SWIPE_STEPS + 1) * CONTROL_SWIPE_STEP_MS, toX, y, 0);
+}
+
+static void startAction(const String& command, bool gesture) {
+  actionPending = true;
+  actionCommand = command;
+  actionGesture = gesture;
+  gestureSeen = nullptr;
+  actionStartMs = millis();
+  actionHandledMs = actionStartMs;
+}
+
+static void addMemory(JsonObject memory, const char* prefix, uint32_t caps) {
+  memory[String(prefix) + "_free"] = heap_caps_get_free_size(caps);
+  memory[String(prefix) + "_min"] = heap_caps_get_minimum_free_size(caps);
+  memory[String(prefix) + "_largest"] = heap_caps_get_largest_free_block(caps);
+}
+
+static void sendCounters() {
+  JsonDocument reply;
+  reply["ok"] = true;
+  reply["cmd"] = "counters";
+  reply["uptime_ms"] = millis();
+
+  JsonObject memory = reply["memory"].to<JsonObject>();
+  addMemory(memory, "heap", MALLOC_CAP_INTERNAL);
+  addMemory(memory, "psram", MALLOC_CAP_SPIRAM);
+
+  JsonObject loop = reply["loop"].to<JsonObject>();
+  loop["count"] = loopCount;
+  loop["max_ms"] = loopMaxMs;
+
+  JsonObject sd = reply["sd"].to<JsonObject>();
+  sd["opens"] = sdStreamStats.opens;
+  sd["syscalls"] = sdStreamStats.syscalls;
+  sd["bytes_read"] = sdStreamStats.bytesRead;
+  sd["wait_us"] = sdStreamStats.waitMicros;
+  sd["prefetch_hits"] = sdStreamStats.prefetchHits;
+
+  JsonObject thumbnails = reply["thumbnails"].to<JsonObject>();
+  thumbnails["hits"] = thumbnailCacheStats.hits;
+  thumbnails["misses"] = thumbnailCacheStats.misses;
+  thumbnails["prefetched"] = thumbnailCacheStats.prefetched;
+  thumbnails["evictions"] = thumbnailCacheStats.evictions;
+  thumbnails["cancelled"] = thumbnailCacheStats.cancelled;
+
+  JsonObject png = reply["png"].to<JsonObject>();
+  png["fast"] = pngFastStats.fastDecodes;
+  png["fallbacks"] = pngFastStats.fallbacks;
+  png["fast_us"] = pngFastStats.fastMicros;
+  png["fast_pixels"] = pngFastStats.fastPixels;
+
+  // JSON document arenas (bytes)
+  JsonObject json = reply["json"].to<JsonObject>();
+  for (int index = 0; index < jsonArenaCount(); index++) {
+    const JsonArena* arena = jsonArena(index);
+    JsonObject row = json[arena->name()].to<JsonObject>();
+    row["used"] = arena->used();
+    row["high_water"] = arena->highWater();
+    row["reserved"] = arena->reserved();
+    row["resets"] = arena->resets();
+    row["psram"] = arena->inPsram();
+  }
+
+  JsonObject router = reply["router"].to<JsonObject>();
+  router["snapshots"] = routerStats.snapshots;
+  router["restores"] = routerStats.restores;
+  router["redraws"] = routerStats.redraws;
+  router["evictions"] = routerStats.evictions;
+  router["snapshot_bytes"] = routerStats.snapshotBytes;
+
+  // Per operation: count and ms in each CPU state plus panel refresh
+  const EnergyReport& report = getEnergyReport();
+  JsonObject energy = reply["energy"].to<JsonObject>();
+  for (int operation = 0; operation < ENERGY_OP_COUNT; operation++) {
+    const EnergyOperationTotals& totals = report.operations[operation];
+    JsonObject row = energy[energyOperationName(operation)].to<JsonObject>();
+    row["count"] = totals.count;
+    for (int state = 0; state < ENERGY_STATE_COUNT; state++) {
+      row[String(energyStateName(state)) + "_ms"] = (uint32_t)(totals.micros[state] / 1000);
+    }
+  }
+
+  // Gesture-to-ink latency per interaction (touch trace)
+  JsonObject latency = reply["latency"].to<JsonObject>();
+  for (int kind = 0; kind < TRACE_INTERACTION_COUNT; kind++) {
+    uint32_t count;
+    uint16_t p50, p90, maxMs;
+    if (traceLatency(kind, count, p50, p90, maxMs)) {
+      JsonObject row = latency[traceInteractionName(kind)].to<JsonObject>();
+      row["n"] = count;
+      row["p50"] = p50;
+      row["p90"] = p90;
+      row["max"] = maxMs;
+    }
+  }
+  sendReply(reply);
+}
+
+static void resetCounters() {
+  resetSdStreamStats();
+  thumbnailCacheStats = ThumbnailCacheStats();
+  pngFastStats = PngFastStats();
+  uint32_t snapshotBytes = routerStats.snapshotBytes;  // Held now, not a counter
+  routerStats = RouterStats();
+  routerStats.snapshotBytes = snapshotBytes;
+  traceResetStats();
+  loopMaxMs = 0;
+}
+
+// "ctl ping|state|counters|reset|go ...|tap|long|twofinger|swipe ..."
+static void controlCommand(const String& line) {
+  String args = line;
+  String action = consoleNextWord(args);
+  String command = line;
+
+  if (actionPending || controlInjecting()) {
+    sendError(command, "busy");
+    return;
+  }
+  if (traceReplaying() || syncActive()) {
+    sendError(command, "trace replay or sync running");
+    return;
+  }
+
+  if (action == "ping") {
+    JsonDocument reply;
+    reply["ok"] = true;
+    reply["cmd"] = command;
+    reply["version"] = CONTROL_PROTOCOL_VERSION;
+    sendReply(reply);
+  } else if (action == "state") {
+    JsonDocument reply;
+    reply["ok"] = true;
+    reply["cmd"] = command;
+    JsonObject state = reply["state"].to<JsonObject>();
+    if (describeUi) {
+      describeUi(state);
+    }
+    sendReply(reply);
+  } else if (action == "counters") {
+    sendCounters();
+  } else if (action == "reset") {
+    resetCounters();
+    JsonDocument reply;
+    reply["ok"] = true;
+    reply["cmd"] = command;
+    sendReply(reply);
+  } else if (action == "go") {
+    String target = consoleNextWord(args);
+    if (!navigateUi || target.length() == 0) {
+      sendError(command, "usage: go <target>");
+      return;
+    }
+    startAction(command, false);
+    const char* error = navigateUi(target, args);
+    if (error) {
+      actionPending = false;
+      sendError(command, error);
+      return;
+    }
+    actionHandledMs = millis();
+  } else if (action == "swipe") {
+    String direction = consoleNextWord(args);
+    if (direction != "left" && direction != "right") {
+      sendError(command, "usage: swipe left|right [y]");
+      return;
+    }
+    queueSwipe(direction == "left", args.length() > 0 ? args.toInt() : M5.Display.height() / 2);
+    startAction(command, true);
+  } else if (action == "tap" || action == "long" || action == "twofinger") {
+    queueGesture(action, args);
+    startAction(command, true);
+  } else {
+    sendError(command, "usage: ctl ping|state|counters|reset|go <target>|tap x y|long x y|twofinger x y|swipe left|right [y]");
+  }
+}
+
+bool controlInjecting() {
+  return injectNext < injectSamples.size();
+}
+
+void controlPoll() {
+  uint32_t now = millis();
+  while (injectNext < injectSamples.size() && (int32_t)(now - injectSamples[injectNext].timeMs) >= 0) {
+    gesturePushSample(injectSamples[injectNext]);
+    injectNext++;
+  }
+  if (injectNext == injectSamples.size()) {
+    injectSamples.clear();
+    injectNext = 0;
+  }
+}
+
+void controlTick() {
+  uint32_t now = millis();
+  if (loopCount > 0 && now - lastTickMs > loopMaxMs) {
+    loopMaxMs = now - lastTickMs;
+  }
+  lastTickMs = now;
+  loopCount++;
+
+  if (!actionPending || controlInjecting() || gestureTouchActive()) {
+    return;
+  }
+  if (!M5.Display.displayBusy()) {
+    finishAction(false);
+  } else if (now - actionStartMs > CONTROL_INK_TIMEOUT_MS) {
+    finishAction(true);
+  }
+}
+
+bool controlBusy() {
+  return actionPending || controlInjecting();
+}
+
+void controlInit(ControlNavigate navigate, ControlDescribe describe) {
+  navigateUi = navigate;
+  describeUi = describe;
+  for (int type = 0; type < GESTURE_TYPE_COUNT; type++) {
+    gestureSubscribe((GestureType)type, onGesture);
+  }
+  consoleRegister("ctl", controlCommand, "Scripted control (tools/device_bench.py): ping, state, counters, reset, go, tap, swipe");
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Scripted control over the serial console for automated runs on the device
+// (tools/device_bench.py): navigate, inject touches, read state and counters.
+
+#define CONTROL_PROTOCOL_VERSION 1
+
+// Longest wait for the refresh an action caused before replying anyway
+#define CONTROL_INK_TIMEOUT_MS 15000
+
+// Commands ("ctl <command>"); every command gets one "CTL {json}" reply
+// with "ok" and "cmd", plus "error" when ok is false:
+//   ping                       version
+//   state                      page, category, grid page, card, language, filter...
+//   counters                   memory, loop, SD, thumbnail, PNG, JSON arenas, router,
+//                              energy, latency
+//   reset                      zero the counters that can be reset (not energy)
+//   go <target>                navigate (targets are handled by main.cpp)
+//   tap x y | long x y | twofinger x y | swipe left|right [y]
+// Actions (go and touches) reply once the refresh they caused has finished,
+// with "handled_ms" (handler returned) and "ink_ms" (panel refresh done),
+// both counted from the gesture (touches) or the command (go).
+
+// Navigate for "go": args holds the words after the target. Returns nullptr
+// on success or the error for the reply.
+typedef const char* (*ControlNavigate)(const String& target, String& args);
+
+// Fill the "state" reply with the UI state
+typedef void (*ControlDescribe)(JsonObject state);
+
+// Register the "ctl" serial command
+void controlInit(ControlNavigate navigate, ControlDescribe describe);
+
+// True while injected touch samples are being played; real touches are ignored
+bool controlInjecting();
+
+// Feed due injected samples into the gesture queue (instead of gesturePoll)
+void controlPoll();
+
+// Once per loop(): replies to an action whose refresh has finished
+void controlTick();
+
+// True while an action waits for its reply
+bool controlBusy();
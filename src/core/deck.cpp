@@ -0,0 +1,127 @@
+#include "deck.h"
+#include <SD.h>
+#include <ArduinoJson.h>
+
+static String deckRoot = DECK_DEFAULT_ROOT;
+
+const String& getDeckRoot() {
+  return deckRoot;
+}
+
+void setDeckRoot(const String& root) {
+  deckRoot = root;
+  while (deckRoot.length() > 1 && deckRoot.endsWith("/")) {
+    deckRoot.remove(deckRoot.length() - 1);
+  }
+  Serial.printf("[Deck] Active collection: %s\n", deckRoot.c_str());
+}
+
+String deckPath(const String& relativePath) {
+  return deckRoot + "/" + relativePath;
+}
+
+// Find `"key": { ... }` in a JSON prefix and return the object text.
+// Fails if the object is not complete within the buffer.
+static bool extractObject(const char* buffer, int length, const char* key, int& start, int& end) {
+  String needle = String("\"") + key + "\"";
+  const char* found = strstr(buffer, needle.c_str());
+  if (!found) {
+    return false;
+  }
+  int i = (found - buffer) + needle.length();
+  while (i < length && buffer[i] != '{') {
+    if (buffer[i] != ' ' && buffer[i] != ':' && buffer[i] != '\n' && buffer[i] != '\r' && buffer[i] != '\t') {
+      return false;
+    }
+    i++;
+  }
+  start = i;
+
+  int depth = 0;
+  bool inString = false;
+  for (; i < length; i++) {
+    char c = buffer[i];
+    if (inString) {
+      if (c == '\\') {
+        i++;
+      } else if (c == '"') {
+        inString = false;
+      }
+    } else if (c == '"') {
+      inString = true;
+    } else if (c == '{') {
+      depth++;
+    } else if (c == '}' && --depth == 0) {
+      end = i + 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Function to read a collection's metadata without parsing its card list
+static bool readDeckMetadata(const String& root, JsonDocument& metadata) {
+  File file = SD.open(root + "/index.json", FILE_READ);
+  if (!file) {
+    return false;
+  }
+
+  static char buffer[DECK_HEADER_READ_BYTES + 1];  // Off the loop task stack
+  int length = file.read((uint8_t*)buffer, DECK_HEADER_READ_BYTES);
+  buffer[max(length, 0)] = 0;
+
+  int start, end;
+  bool ok;
+  if (length > 0 && extractObject(buffer, length, "metadata", start, end)) {
+    ok = !deserializeJson(metadata, buffer + start, end - start);
+  } else {
+    // Metadata is not at the top of the file: filtered parse of the whole index
+    JsonDocument filter;
+    filter["metadata"] = true;
+    JsonDocument header;
+    file.seek(0);
+    ok = !deserializeJson(header, file, DeserializationOption::Filter(filter));
+    if (ok) {
+      metadata.set(header["metadata"]);
+    }
+  }
+  file.close();
+  return ok;
+}
+
+std::vector<DeckInfo> listDecks() {
+  std::vector<DeckInfo> decks;
+  uint32_t start = millis();
+
+  File root = SD.open("/");
+  if (!root) {
+    Serial.println("[Deck] Cannot open SD root");
+    return decks;
+  }
+
+  File entry = root.openNextFile();
+  while (entry) {
+    if (entry.isDirectory()) {
+      String name = entry.name();
+      if (name.startsWith("/")) {
+        name = name.substring(1);
+      }
+      String path = "/" + name;
+      JsonDocument metadata;
+      if (!name.startsWith(".") && readDeckMetadata(path, metadata)) {
+        DeckInfo info;
+        info.root = path;
+        info.name = metadata["name"] | name;
+        info.description = metadata["description"] | "";
+        info.totalCards = metadata["total_cards"] | 0;
+        decks.push_back(info);
+      }
+    }
+    entry.close();
+    entry = root.openNextFile();
+  }
+  root.close();
+
+  Serial.printf("[Deck] Found %d collections in %lu ms\n", decks.size(), (unsigned long)(millis() - start));
+  return decks;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <Arduino.h>
+#include <vector>
+
+// Collection shipped with the device; also holds config.json and the UI assets
+#define DECK_DEFAULT_ROOT "/flipcard"
+
+// Bytes read from the start of index.json when listing collections
+#define DECK_HEADER_READ_BYTES 2048
+
+// A deck collection: any SD root directory containing index.json
+struct DeckInfo {
+    String root;          // "/flipcard", "/collection-01"
+    String name;          // metadata.name, else the directory name
+    String description;   // metadata.description
+    int totalCards;       // metadata.total_cards
+};
+
+// Active collection root; card folders, index.json and the deck font live under it
+const String& getDeckRoot();
+void setDeckRoot(const String& root);
+
+// Absolute path of a file inside the active collection
+String deckPath(const String& relativePath);
+
+// Scan the SD root for collections, reading only each index.json's metadata
+std::vector<DeckInfo> listDecks();
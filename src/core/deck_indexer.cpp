@@ -0,0 +1,379 @@
+#include "deck_indexer.h"
+#include "deck.h"
+#include "thumbnail_cache.h"
+#include <SD.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <vector>
+#include <algorithm>
+
+// Fingerprint of one card.json, keyed by a hash of its folder name
+struct ManifestEntry {
+  uint64_t folderKey;
+  uint32_t size;
+  uint32_t mtime;
+  uint32_t hash;
+};
+
+// Position of a folder in index.json's card array
+struct CatalogSlot {
+  uint64_t folderKey;
+  int position;
+};
+
+// Folder whose card.json differs from the manifest (or is not in it)
+struct PendingFolder {
+  String folder;
+  uint32_t size;
+  uint32_t mtime;
+  uint32_t previousHash;  // 0 = unknown
+  bool inManifest;
+};
+
+static uint64_t folderKeyOf(const char* folder) {
+  uint64_t hash = 14695981039346656037ull;
+  while (*folder) {
+    hash ^= (uint8_t)*folder++;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+static bool byFolderKey(const ManifestEntry& a, const ManifestEntry& b) {
+  return a.folderKey < b.folderKey;
+}
+
+static int findCatalogPosition(const std::vector<CatalogSlot>& catalog, uint64_t key) {
+  auto it = std::lower_bound(catalog.begin(), catalog.end(), key,
+                             [](const CatalogSlot& slot, uint64_t value) { return slot.folderKey < value; });
+  return (it != catalog.end() && it->folderKey == key) ? it->position : -1;
+}
+
+static const ManifestEntry* findManifestEntry(const std::vector<ManifestEntry>& manifest, uint64_t key) {
+  ManifestEntry probe = {key, 0, 0, 0};
+  auto it = std::lower_bound(manifest.begin(), manifest.end(), probe, byFolderKey);
+  return (it != manifest.end() && it->folderKey == key) ? &*it : nullptr;
+}
+
+// Function to load the manifest into a sorted vector (large vectors land in PSRAM)
+static bool loadManifest(std::vector<ManifestEntry>& manifest) {
+  File file = SD.open(deckPath(INDEX_MANIFEST_FILE), FILE_READ);
+  if (!file) {
+    return false;
+  }
+  while (file.available()) {
+    String line = file.readStringUntil('\n');
+    int tab1 = line.indexOf('\t');
+    int tab2 = tab1 < 0 ? -1 : line.indexOf('\t', tab1 + 1);
+    int tab3 = tab2 < 0 ? -1 : line.indexOf('\t', tab2 + 1);
+    if (tab3 < 0) {
+      continue;
+    }
+    ManifestEntry entry;
+    entry.folderKey = folderKeyOf(line.substring(0, tab1).c_str());
+    entry.size = strtoul(line.substring(tab1 + 1, tab2).c_str(), nullptr, 10);
+    entry.mtime = strtoul(line.substring(tab2 + 1, tab3).c_str(), nullptr, 10);
+    entry.hash = strtoul(line.substring(tab3 + 1).c_str(), nullptr, 16);
+    manifest.push_back(entry);
+  }
+  file.close();
+  std::sort(manifest.begin(), manifest.end(), byFolderKey);
+  return true;
+}
+
+// New manifest, built in memory (one buffer, in PSRAM when large) and only
+// written back when it differs from the loaded one
+struct ManifestOutput {
+  String text;
+  int lines;
+  bool changed;
+};
+
+// Function to append one manifest line, noting whether it differs from the loaded manifest
+static void addManifestLine(ManifestOutput& out, const std::vector<ManifestEntry>& manifest,
+                            const char* folder, uint32_t size, uint32_t mtime, uint32_t hash) {
+  const ManifestEntry* known = findManifestEntry(manifest, folderKeyOf(folder));
+  if (!known || known->size != size || known->mtime != mtime || known->hash != hash) {
+    out.changed = true;
+  }
+  char line[48];
+  snprintf(line, sizeof(line), "\t%lu\t%lu\t%08lx\n", (unsigned long)size, (unsigned long)mtime, (unsigned long)hash);
+  out.text += folder;
+  out.text += line;
+  out.lines++;
+}
+
+// Function to replace the manifest file (written only when an entry changed)
+static bool writeManifest(const String& text) {
+  String path = deckPath(INDEX_MANIFEST_FILE);
+  String tempPath = path + ".tmp";
+  SD.mkdir(deckPath(".cache"));
+  File out = SD.open(tempPath, FILE_WRITE);
+  if (!out) {
+    Serial.println("[Indexer] Cannot write manifest");
+    return false;
+  }
+  bool ok = out.write((const uint8_t*)text.c_str(), text.length()) == text.length();
+  out.close();
+  if (ok) {
+    SD.remove(path);
+    ok = SD.rename(tempPath, path);
+  }
+  if (!ok) {
+    SD.remove(tempPath);
+  }
+  return ok;
+}
+
+// FNV-1a over the file contents
+static bool hashFile(const String& path, uint32_t& hash) {
+  File file = SD.open(path, FILE_READ);
+  if (!file) {
+    return false;
+  }
+  uint8_t buffer[512];
+  hash = 2166136261u;
+  int length;
+  while ((length = file.read(buffer, sizeof(buffer))) > 0) {
+    for (int i = 0; i < length; i++) {
+      hash ^= buffer[i];
+      hash *= 16777619u;
+    }
+  }
+  file.close();
+  if (hash == 0) {
+    hash = 1; // 0 is reserved for "not hashed yet"
+  }
+  return true;
+}
+
+// Function to rebuild one catalog entry from its card.json (same fields as the off-device exporter)
+static bool readCatalogEntry(const String& folder, JsonDocument& card) {
+  JsonDocument filter;
+  filter["id"] = true;
+  filter["title"] = true;
+  filter["category"] = true;
+  filter["difficulty"] = true;
+  filter["thumbnail"] = true;
+  filter["languages"] = true;
+  filter["tags"] = true;
+
+  File file = SD.open(deckPath(folder + "/card.json"), FILE_READ);
+  if (!file) {
+    return false;
+  }
+  DeserializationError error = deserializeJson(card, file, DeserializationOption::Filter(filter));
+  file.close();
+  if (error) {
+    Serial.printf("[Indexer] %s/card.json: %s\n", folder.c_str(), error.c_str());
+    return false;
+  }
+  return true;
+}
+
+static void fillCatalogEntry(JsonObject entry, const String& folder, JsonDocument& card) {
+  entry.clear();
+  entry["id"] = card["id"] | folder;
+  entry["folder"] = folder;
+  entry["title"] = card["title"] | folder;
+  entry["category"] = card["category"] | "uncategorized";
+  entry["difficulty"] = card["difficulty"] | 1;
+  entry["thumbnail"] = card["thumbnail"] | "";
+  JsonArray languages = entry["languages"].to<JsonArray>();
+  for (JsonPair language : card["languages"].as<JsonObject>()) {
+    languages.add(language.key().c_str());
+  }
+  JsonArray tags = entry["tags"].to<JsonArray>();
+  for (JsonVariant tag : card["tags"].as<JsonArray>()) {
+    tags.add(tag.as<const char*>());
+  }
+}
+
+static bool writeIndex(JsonDocument& indexDoc) {
+  String path = deckPath("index.json");
+  String tempPath = path + ".tmp";
+  File out = SD.open(tempPath, FILE_WRITE);
+  if (!out) {
+    return false;
+  }
+  bool ok = serializeJsonPretty(indexDoc, out) > 0;
+  out.close();
+  if (ok) {
+    SD.remove(path);
+    ok = SD.rename(tempPath, path);
+  }
+  if (!ok) {
+    SD.remove(tempPath);
+  }
+  return ok;
+}
+
+IndexUpdateResult updateDeckIndex(JsonDocument& indexDoc, uint32_t budgetMs, IndexProgressCallback progress) {
+  IndexUpdateResult result = {0, 0, 0, 0, 0, 0, false, false};
+  uint32_t start = millis();
+
+  std::vector<ManifestEntry> manifest;
+  bool haveManifest = loadManifest(manifest);
+
+  // Catalog positions by folder, for O(log n) lookups during the scan
+  JsonArray cards = indexDoc["cards"];
+  if (cards.isNull()) {
+    cards = indexDoc["cards"].to<JsonArray>();
+  }
+  std::vector<CatalogSlot> catalog;
+  catalog.reserve(cards.size());
+  for (int i = 0; i < cards.size(); i++) {
+    String folder = cards[i]["folder"] | "";
+    catalog.push_back({folderKeyOf(folder.c_str()), i});
+  }
+  std::sort(catalog.begin(), catalog.end(),
+            [](const CatalogSlot& a, const CatalogSlot& b) { return a.folderKey < b.folderKey; });
+  std::vector<bool> catalogSeen(cards.size(), false);
+
+  ManifestOutput manifestOut = {String(), 0, !haveManifest};
+  manifestOut.text.reserve((max(manifest.size(), (size_t)cards.size()) + 16) * 48);
+
+  // Pass 1: cheap directory walk, stat only
+  std::vector<PendingFolder> pending;
+  String rootPath = String(INDEX_SD_MOUNT_POINT) + getDeckRoot();
+  DIR* dir = opendir(rootPath.c_str());
+  if (!dir) {
+    Serial.printf("[Indexer] Cannot open %s\n", rootPath.c_str());
+    return result;
+  }
+  struct dirent* item;
+  while ((item = readdir(dir)) != nullptr) {
+    if (item->d_type != DT_DIR || item->d_name[0] == '.') {
+      continue;
+    }
+    struct stat info;
+    String cardPath = rootPath + "/" + item->d_name + "/card.json";
+    if (stat(cardPath.c_str(), &info) != 0) {
+      continue; // Not a card folder (fonts, screensaver, ...)
+    }
+    result.scanned++;
+    if (progress && result.scanned % 100 == 0) {
+      progress("Scanning", result.scanned, 0);
+    }
+
+    uint64_t key = folderKeyOf(item->d_name);
+    int position = findCatalogPosition(catalog, key);
+    bool cataloged = position >= 0;
+    if (cataloged) {
+      catalogSeen[position] = true;
+    }
+
+    const ManifestEntry* known = findManifestEntry(manifest, key);
+    if (known && known->size == (uint32_t)info.st_size && known->mtime == (uint32_t)info.st_mtime) {
+      addManifestLine(manifestOut, manifest, item->d_name, known->size, known->mtime, known->hash);
+      continue;
+    }
+    if (!haveManifest && cataloged) {
+      // First run: trust index.json for cataloged folders, hash lazily later
+      addManifestLine(manifestOut, manifest, item->d_name, info.st_size, info.st_mtime, 0);
+      continue;
+    }
+    pending.push_back({item->d_name, (uint32_t)info.st_size, (uint32_t)info.st_mtime,
+                       known ? known->hash : 0, known != nullptr});
+  }
+  closedir(dir);
+
+  // Pass 2: re-read only the changed folders, within the time budget
+  bool catalogChanged = false;
+  for (int i = 0; i < pending.size(); i++) {
+    const PendingFolder& folder = pending[i];
+    if (progress) {
+      progress("Updating", i, pending.size());
+    }
+    if (millis() - start > budgetMs) {
+      // Leave the old fingerprint so the folder is detected again next run
+      if (folder.inManifest) {
+        addManifestLine(manifestOut, manifest, folder.folder.c_str(), 0, 0, folder.previousHash);
+      }
+      result.pending++;
+      continue;
+    }
+
+    uint32_t hash;
+    if (!hashFile(deckPath(folder.folder + "/card.json"), hash)) {
+      continue;
+    }
+    int position = findCatalogPosition(catalog, folderKeyOf(folder.folder.c_str()));
+    bool cataloged = position >= 0;
+
+    if (cataloged && hash == folder.previousHash) {
+      // Touched but identical content
+      addManifestLine(manifestOut, manifest, folder.folder.c_str(), folder.size, folder.mtime, hash);
+      continue;
+    }
+
+    JsonDocument card;
+    if (!readCatalogEntry(folder.folder, card)) {
+      continue;
+    }
+    if (cataloged) {
+      fillCatalogEntry(cards[position].as<JsonObject>(), folder.folder, card);
+      invalidateThumbnailsUnder(deckPath(folder.folder + "/"));
+      result.updatedCards.push_back(position);
+      result.changed++;
+    } else {
+      result.updatedCards.push_back(cards.size());
+      fillCatalogEntry(cards.add<JsonObject>(), folder.folder, card);
+      result.added++;
+    }
+
+    // New categories get a placeholder name until index.json is edited
+    String category = card["category"] | "uncategorized";
+    if (indexDoc["categories"][category].isNull()) {
+      indexDoc["categories"][category]["name"] = category;
+    }
+    addManifestLine(manifestOut, manifest, folder.folder.c_str(), folder.size, folder.mtime, hash);
+    catalogChanged = true;
+  }
+
+  // Folders that disappeared (highest position first so earlier positions stay valid)
+  for (int i = catalogSeen.size() - 1; i >= 0; i--) {
+    if (!catalogSeen[i]) {
+      String folder = cards[i]["folder"] | "";
+      Serial.printf("[Indexer] Removed %s\n", folder.c_str());
+      invalidateThumbnailsUnder(deckPath(folder + "/"));
+      cards.remove(i);
+      result.removedCards.push_back(i);
+      result.removed++;
+      catalogChanged = true;
+    }
+  }
+
+  // Positions of updated cards in the index after the removals
+  for (int& position : result.updatedCards) {
+    int shift = 0;
+    for (int removed : result.removedCards) {
+      if (removed < position) {
+        shift++;
+      }
+    }
+    position -= shift;
+  }
+
+  // Dropped folders shorten the manifest without changing any kept line
+  if (manifestOut.lines != manifest.size()) {
+    manifestOut.changed = true;
+  }
+  if (manifestOut.changed) {
+    result.manifestWritten = writeManifest(manifestOut.text);
+  }
+
+  if (catalogChanged) {
+    indexDoc["metadata"]["total_cards"] = cards.size();
+    result.indexWritten = writeIndex(indexDoc);
+  }
+  if (progress) {
+    progress("Done", pending.size(), pending.size());
+  }
+
+  result.elapsedMs = millis() - start;
+  Serial.printf("[Indexer] %d folders: +%d ~%d -%d, %d pending, %lu ms%s%s\n", result.scanned, result.added,
+                result.changed, result.removed, result.pending, (unsigned long)result.elapsedMs,
+                result.indexWritten ? ", index.json updated" : "", result.manifestWritten ? ", manifest updated" : "");
+  return result;
+}
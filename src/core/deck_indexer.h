@@ -0,0 +1,35 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+
+// Per-collection manifest of card.json fingerprints, relative to the collection root.
+// One line per card folder: folder<TAB>size<TAB>mtime<TAB>hash (hash 0 = not yet hashed)
+#define INDEX_MANIFEST_FILE ".cache/manifest.tsv"
+
+// VFS mount point of the SD card (POSIX stat/readdir are cheaper than File handles)
+#define INDEX_SD_MOUNT_POINT "/sd"
+
+#define INDEX_DEFAULT_BUDGET_MS 10000
+
+struct IndexUpdateResult {
+    int scanned;          // Card folders found on SD
+    int added;
+    int changed;
+    int removed;
+    int pending;          // Changes deferred to the next run (time budget exhausted)
+    uint32_t elapsedMs;
+    bool indexWritten;    // index.json was rewritten
+    bool manifestWritten; // Manifest rewritten (skipped when no entry changed)
+    std::vector<int> updatedCards;  // Changed and added cards, positions in the updated index
+    std::vector<int> removedCards;  // Removed cards, positions in the previous index (highest first)
+};
+
+// Progress of a running update; total is 0 while the folder count is still unknown
+typedef void (*IndexProgressCallback)(const char* phase, int done, int total);
+
+// Bring indexDoc (and index.json) in line with the active collection's card folders.
+// Only folders whose card.json size/mtime/hash changed are re-read; thumbnails of
+// changed or removed cards are dropped from the PSRAM cache.
+IndexUpdateResult updateDeckIndex(JsonDocument& indexDoc, uint32_t budgetMs = INDEX_DEFAULT_BUDGET_MS,
+                                  IndexProgressCallback progress = nullptr);
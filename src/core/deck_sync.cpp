@@ -0,0 +1,455 @@
+#include "deck_sync.h"
+#include "deck.h"
+#include "deck_indexer.h"
+#include "serial_console.h"
+#include "thumbnail_cache.h"
+#include <SD.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <vector>
+#include <algorithm>
+
+// Cached block CRCs of one file, keyed by a hash of its path
+struct SyncManifestEntry {
+  uint64_t pathKey;
+  uint32_t size;
+  uint32_t mtime;
+  uint32_t lineOffset;   // Start of its line in the old manifest
+};
+
+// File being rebuilt: old blocks are copied and new ones written in order
+struct SyncTarget {
+  bool open;
+  String path;           // Relative to the collection root
+  uint32_t size;         // Final size
+  uint32_t crc;          // Expected CRC-32 of the whole file
+  File source;           // Current version, if any
+  File part;             // <path>.sync-part
+  uint32_t written;
+  uint32_t runningCrc;
+  uint32_t startMs;
+};
+
+static void (*syncDone)(bool configChanged) = nullptr;
+static bool sessionActive = false;
+static uint32_t lastCommandMs = 0;
+static SyncTarget target;
+static uint8_t blockBuffer[SYNC_BLOCK_SIZE];   // Received block, hashing
+static uint8_t copyBuffer[SYNC_BLOCK_SIZE];    // Old content copied into the part file
+
+// Session totals for the "done" reply
+static uint32_t sessionFiles = 0;
+static uint32_t sessionBytes = 0;
+static uint32_t sessionStartMs = 0;
+static bool sessionConfigChanged = false;
+
+static uint32_t crcTable[256];
+
+// Function to extend a CRC-32 (zlib polynomial, so the host can use zlib.crc32)
+static uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+  if (crcTable[1] == 0) {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t value = i;
+      for (int bit = 0; bit < 8; bit++) {
+        value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+      }
+      crcTable[i] = value;
+    }
+  }
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+static uint64_t pathKeyOf(const char* path) {
+  uint64_t hash = 14695981039346656037ull;
+  while (*path) {
+    hash ^= (uint8_t)*path++;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+static bool byPathKey(const SyncManifestEntry& a, const SyncManifestEntry& b) {
+  return a.pathKey < b.pathKey;
+}
+
+// Paths from the host stay inside the collection and out of .cache
+static bool safePath(const String& path) {
+  return path.length() > 0 && !path.startsWith("/") && path.indexOf("..") < 0 && !path.startsWith(".cache") &&
+         !path.endsWith(SYNC_PART_SUFFIX) && !path.endsWith(SYNC_OLD_SUFFIX);
+}
+
+// Function to create the parent folders of a relative path
+static void makeParents(const String& path) {
+  int slash = path.indexOf('/');
+  while (slash > 0) {
+    SD.mkdir(deckPath(path.substring(0, slash)));
+    slash = path.indexOf('/', slash + 1);
+  }
+}
+
+static void closeTarget(bool keepPart) {
+  if (target.source) {
+    target.source.close();
+  }
+  if (target.part) {
+    target.part.close();
+  }
+  if (target.open && !keepPart) {
+    SD.remove(deckPath(target.path + SYNC_PART_SUFFIX));
+  }
+  target.open = false;
+}
+
+// Function to load the old manifest's fingerprints into a sorted vector
+static void loadSyncManifest(File& file, std::vector<SyncManifestEntry>& manifest) {
+  while (file.available()) {
+    uint32_t offset = file.position();
+    String line = file.readStringUntil('\n');
+    int tab1 = line.indexOf('\t');
+    int tab2 = tab1 < 0 ? -1 : line.indexOf('\t', tab1 + 1);
+    int tab3 = tab2 < 0 ? -1 : line.indexOf('\t', tab2 + 1);
+    if (tab3 < 0) {
+      continue;
+    }
+    SyncManifestEntry entry;
+    entry.pathKey = pathKeyOf(line.substring(0, tab1).c_str());
+    entry.size = strtoul(line.substring(tab1 + 1, tab2).c_str(), nullptr, 10);
+    entry.mtime = strtoul(line.substring(tab2 + 1, tab3).c_str(), nullptr, 10);
+    entry.lineOffset = offset;
+    manifest.push_back(entry);
+  }
+  std::sort(manifest.begin(), manifest.end(), byPathKey);
+}
+
+// Function to compute the comma-separated block CRCs of a file
+static bool hashBlocks(const String& path, String& crcs, uint32_t& hashedBytes) {
+  File file = SD.open(deckPath(path), FILE_READ);
+  if (!file) {
+    return false;
+  }
+  crcs = "";
+  char hex[10];
+  int length;
+  while ((length = file.read(blockBuffer, SYNC_BLOCK_SIZE)) > 0) {
+    snprintf(hex, sizeof(hex), crcs.length() ? ",%08lx" : "%08lx",
+             (unsigned long)crc32Update(0, blockBuffer, length));
+    crcs += hex;
+    hashedBytes += length;
+  }
+  file.close();
+  return true;
+}
+
+// Function to finish or roll back a replacement interrupted by a reset
+static void recoverLeftover(const String& path) {
+  if (path.endsWith(SYNC_PART_SUFFIX)) {
+    SD.remove(deckPath(path));
+    Serial.printf("[Sync] Removed unfinished %s\n", path.c_str());
+    return;
+  }
+  String original = path.substring(0, path.length() - strlen(SYNC_OLD_SUFFIX));
+  if (SD.exists(deckPath(original))) {
+    SD.remove(deckPath(path));
+  } else {
+    SD.rename(deckPath(path), deckPath(original));
+    Serial.printf("[Sync] Restored %s\n", original.c_str());
+  }
+}
+
+// Function to list every file of the collection with its block CRCs
+static void listFiles() {
+  uint32_t start = millis();
+  std::vector<SyncManifestEntry> manifest;
+  String manifestPath = deckPath(SYNC_MANIFEST_FILE);
+  File oldManifest = SD.open(manifestPath, FILE_READ);
+  if (oldManifest) {
+    loadSyncManifest(oldManifest, manifest);
+  }
+
+  SD.mkdir(deckPath(".cache"));
+  String manifestTemp = manifestPath + ".tmp";
+  File newManifest = SD.open(manifestTemp, FILE_WRITE);
+
+  String rootPath = String(INDEX_SD_MOUNT_POINT) + getDeckRoot();
+  std::vector<String> folders(1, "");
+  std::vector<String> leftovers;
+  int files = 0;
+  uint32_t hashedBytes = 0;
+  while (!folders.empty()) {
+    String folder = folders.back();
+    folders.pop_back();
+    DIR* dir = opendir((rootPath + "/" + folder).c_str());
+    if (!dir) {
+      continue;
+    }
+    struct dirent* item;
+    while ((item = readdir(dir)) != nullptr) {
+      if (item->d_name[0] == '.') {
+        continue; // .cache, hidden files
+      }
+      String path = folder + item->d_name;
+      if (item->d_type == DT_DIR) {
+        folders.push_back(path + "/");
+        continue;
+      }
+      if (path.endsWith(SYNC_PART_SUFFIX) || path.endsWith(SYNC_OLD_SUFFIX)) {
+        leftovers.push_back(path);
+        continue;
+      }
+      struct stat info;
+      if (stat((rootPath + "/" + path).c_str(), &info) != 0) {
+        continue;
+      }
+
+      String crcs;
+      SyncManifestEntry probe = {pathKeyOf(path.c_str()), 0, 0, 0};
+      auto known = std::lower_bound(manifest.begin(), manifest.end(), probe, byPathKey);
+      if (known != manifest.end() && known->pathKey == probe.pathKey && known->size == (uint32_t)info.st_size &&
+          known->mtime == (uint32_t)info.st_mtime) {
+        oldManifest.seek(known->lineOffset);
+        String line = oldManifest.readStringUntil('\n');
+        crcs = line.substring(line.lastIndexOf('\t') + 1);
+      } else if (!hashBlocks(path, crcs, hashedBytes)) {
+        continue;
+      }
+      if (newManifest) {
+        newManifest.printf("%s\t%lu\t%lu\t%s\n", path.c_str(), (unsigned long)info.st_size,
+                           (unsigned long)info.st_mtime, crcs.c_str());
+      }
+      Serial.printf("SYNC F %s\t%lu\t%s\n", path.c_str(), (unsigned long)info.st_size, crcs.c_str());
+      files++;
+      lastCommandMs = millis(); // Long listings are progress, not idleness
+    }
+    closedir(dir);
+  }
+
+  if (oldManifest) {
+    oldManifest.close();
+  }
+  if (newManifest) {
+    newManifest.close();
+    SD.remove(manifestPath);
+    SD.rename(manifestTemp, manifestPath);
+  }
+  for (const String& path : leftovers) {
+    recoverLeftover(path);
+  }
+
+  uint32_t elapsed = millis() - start;
+  Serial.printf("[Sync] Listed %d files in %lu ms (%lu KB hashed)\n", files, (unsigned long)elapsed,
+                (unsigned long)(hashedBytes / 1024));
+  Serial.printf("SYNC L %d %lu\n", files, (unsigned long)elapsed);
+}
+
+// Function to copy the current version's bytes into the part file up to offset
+static bool copyOldUntil(uint32_t offset) {
+  while (target.written < offset) {
+    uint32_t length = min((uint32_t)SYNC_BLOCK_SIZE, offset - target.written);
+    if (!target.source || !target.source.seek(target.written) ||
+        target.source.read(copyBuffer, length) != (int)length) {
+      return false;
+    }
+    if (target.part.write(copyBuffer, length) != length) {
+      return false;
+    }
+    target.runningCrc = crc32Update(target.runningCrc, copyBuffer, length);
+    target.written += length;
+  }
+  return true;
+}
+
+static void openFile(String& args) {
+  closeTarget(false);
+  uint32_t size = strtoul(consoleNextWord(args).c_str(), nullptr, 10);
+  uint32_t crc = strtoul(consoleNextWord(args).c_str(), nullptr, 16);
+  String path = args;
+  if (!safePath(path)) {
+    Serial.printf("SYNC X bad path %s\n", path.c_str());
+    return;
+  }
+
+  makeParents(path);
+  String partPath = deckPath(path + SYNC_PART_SUFFIX);
+  SD.remove(partPath);
+  target.part = SD.open(partPath, FILE_WRITE);
+  if (!target.part) {
+    Serial.printf("SYNC X cannot write %s\n", path.c_str());
+    return;
+  }
+  target.source = SD.open(deckPath(path), FILE_READ);
+  target.open = true;
+  target.path = path;
+  target.size = size;
+  target.crc = crc;
+  target.written = 0;
+  target.runningCrc = 0;
+  target.startMs = millis();
+  Serial.println("SYNC O");
+}
+
+static void receiveBlock(String& args) {
+  uint32_t block = strtoul(consoleNextWord(args).c_str(), nullptr, 10);
+  uint32_t length = strtoul(consoleNextWord(args).c_str(), nullptr, 10);
+  uint32_t crc = strtoul(consoleNextWord(args).c_str(), nullptr, 16);
+  if (length > SYNC_BLOCK_SIZE) {
+    Serial.println("SYNC X block too long");
+    return;
+  }
+
+  // The raw bytes follow the command line; read them even when refusing the block
+  Serial.setTimeout(SYNC_DATA_TIMEOUT_MS);
+  size_t received = Serial.readBytes(blockBuffer, length);
+  Serial.setTimeout(1000);
+  if (!target.open) {
+    Serial.println("SYNC X no file open");
+    return;
+  }
+  uint32_t offset = block * SYNC_BLOCK_SIZE;
+  if (offset < target.written || offset + length > target.size) {
+    Serial.printf("SYNC X block %lu out of order\n", (unsigned long)block);
+    return;
+  }
+  if (received != length || crc32Update(0, blockBuffer, length) != crc) {
+    Serial.printf("SYNC R %lu\n", (unsigned long)block);
+    return;
+  }
+
+  // Unchanged blocks before this one come from the current version
+  if (!copyOldUntil(offset)) {
+    Serial.println("SYNC X old content missing");
+    closeTarget(false);
+    return;
+  }
+  if (target.part.write(blockBuffer, length) != length) {
+    Serial.println("SYNC X write failed (SD full?)");
+    closeTarget(false);
+    return;
+  }
+  target.runningCrc = crc32Update(target.runningCrc, blockBuffer, length);
+  target.written += length;
+  sessionBytes += length;
+  Serial.printf("SYNC K %lu\n", (unsigned long)block);
+}
+
+static void commitFile() {
+  if (!target.open) {
+    Serial.println("SYNC X no file open");
+    return;
+  }
+  if (!copyOldUntil(target.size) || target.runningCrc != target.crc) {
+    Serial.printf("SYNC X %s does not match (crc %08lx, expected %08lx)\n", target.path.c_str(),
+                  (unsigned long)target.runningCrc, (unsigned long)target.crc);
+    closeTarget(false);
+    return;
+  }
+  bool replacing = (bool)target.source;
+  closeTarget(true);
+
+  // Keep the old version until the new one is in place
+  String path = deckPath(target.path);
+  String partPath = path + SYNC_PART_SUFFIX;
+  String oldPath = path + SYNC_OLD_SUFFIX;
+  bool ok = true;
+  if (replacing) {
+    SD.remove(oldPath);
+    ok = SD.rename(path, oldPath);
+  }
+  ok = ok && SD.rename(partPath, path);
+  if (!ok) {
+    if (replacing && !SD.exists(path)) {
+      SD.rename(oldPath, path);
+    }
+    SD.remove(partPath);
+    Serial.printf("SYNC X cannot replace %s\n", target.path.c_str());
+    return;
+  }
+  SD.remove(oldPath);
+  invalidateThumbnailsUnder(path);
+  sessionFiles++;
+  if (path == SYNC_CONFIG_PATH) {
+    sessionConfigChanged = true;
+  }
+
+  uint32_t elapsed = millis() - target.startMs;
+  Serial.printf("[Sync] %s: %lu bytes in %lu ms\n", target.path.c_str(), (unsigned long)target.size,
+                (unsigned long)elapsed);
+  Serial.printf("SYNC C %lu %lu\n", (unsigned long)target.size, (unsigned long)elapsed);
+}
+
+static void deleteFile(const String& path) {
+  if (!safePath(path)) {
+    Serial.printf("SYNC X bad path %s\n", path.c_str());
+    return;
+  }
+  SD.remove(deckPath(path));
+  invalidateThumbnailsUnder(deckPath(path));
+  sessionFiles++;
+  if (deckPath(path) == SYNC_CONFIG_PATH) {
+    sessionConfigChanged = true;
+  }
+  Serial.println("SYNC K");
+}
+
+static void syncCommand(const String& commandArgs) {
+  String args = commandArgs;
+  String action = consoleNextWord(args);
+  lastCommandMs = millis();
+
+  if (action == "hello") {
+    closeTarget(false);
+    cancelThumbnailPrefetch(); // Keep the SD to ourselves
+    sessionActive = true;
+    sessionFiles = 0;
+    sessionBytes = 0;
+    sessionStartMs = millis();
+    sessionConfigChanged = false;
+    Serial.printf("SYNC H %d %d %s\n", SYNC_PROTOCOL_VERSION, SYNC_BLOCK_SIZE, getDeckRoot().c_str());
+  } else if (!sessionActive) {
+    Serial.println("SYNC X no session (sync hello first)");
+  } else if (action == "list") {
+    listFiles();
+  } else if (action == "open") {
+    openFile(args);
+  } else if (action == "data") {
+    receiveBlock(args);
+  } else if (action == "commit") {
+    commitFile();
+  } else if (action == "abort") {
+    closeTarget(false);
+    Serial.println("SYNC A");
+  } else if (action == "delete") {
+    deleteFile(args);
+  } else if (action == "done") {
+    closeTarget(false);
+    sessionActive = false;
+    uint32_t elapsed = millis() - sessionStartMs;
+    Serial.printf("[Sync] Session: %lu files, %lu KB received in %lu ms (%lu KB/s)\n", (unsigned long)sessionFiles,
+                  (unsigned long)(sessionBytes / 1024), (unsigned long)elapsed,
+                  (unsigned long)(elapsed ? sessionBytes / elapsed * 1000 / 1024 : 0));
+    if (syncDone && sessionFiles > 0) {
+      syncDone(sessionConfigChanged);
+    }
+    Serial.printf("SYNC D %lu %lu %lu\n", (unsigned long)sessionFiles, (unsigned long)sessionBytes,
+                  (unsigned long)(millis() - sessionStartMs));
+  } else {
+    Serial.println("SYNC X usage: sync hello | list | open size crc path | data block length crc | commit | abort | delete path | done");
+  }
+}
+
+void syncInit(void (*onDone)(bool configChanged)) {
+  syncDone = onDone;
+  consoleRegister("sync", syncCommand, "Deck sync session (tools/deck_sync.py)");
+}
+
+bool syncActive() {
+  if (sessionActive && millis() - lastCommandMs > SYNC_IDLE_TIMEOUT_MS) {
+    Serial.println("[Sync] Session timed out");
+    closeTarget(false);
+    sessionActive = false;
+  }
+  return sessionActive;
+}
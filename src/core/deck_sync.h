@@ -0,0 +1,43 @@
+#pragma once
+#include <Arduino.h>
+
+// Delta sync of the active collection over the USB serial console
+// (tools/deck_sync.py). Files are compared per block by CRC-32; only blocks
+// that differ are sent, and each file is rebuilt next to the old one and
+// swapped in once its whole-file CRC matches.
+
+#define SYNC_PROTOCOL_VERSION 1
+#define SYNC_BLOCK_SIZE 4096
+
+// Block CRCs of every file, reused while size and mtime are unchanged.
+// One line per file: path<TAB>size<TAB>mtime<TAB>crc,crc,... (hex)
+#define SYNC_MANIFEST_FILE ".cache/sync-manifest.tsv"
+
+// Suffixes of a file being replaced; leftovers are cleaned up by "sync list"
+#define SYNC_PART_SUFFIX ".sync-part"
+#define SYNC_OLD_SUFFIX ".sync-old"
+
+// Wait for the raw bytes of one block, and for the next command of a session
+#define SYNC_DATA_TIMEOUT_MS 2000
+#define SYNC_IDLE_TIMEOUT_MS 30000
+
+// Commands ("sync <command>"), replies are "SYNC "-prefixed lines:
+//   hello                        H  version  block_size  root
+//   list                         F  path<TAB>size<TAB>crcs ... then L  files  ms
+//   open size crc path           O  (or X reason)
+//   data block length crc       followed by length raw bytes; K block, R block (resend) or X
+//   commit                       C  bytes  ms
+//   abort                        A
+//   delete path                  K
+//   done                         D  files  bytes  ms   (after onDone has run)
+
+// Global configuration; a session that replaces or deletes it (active
+// collection /flipcard) reports configChanged
+#define SYNC_CONFIG_PATH "/flipcard/config.json"
+
+// Register the "sync" serial command. onDone runs after "sync done" to pick
+// up the new content (reload config and index, redraw).
+void syncInit(void (*onDone)(bool configChanged));
+
+// True from "sync hello" until "sync done" or SYNC_IDLE_TIMEOUT_MS without commands
+bool syncActive();
@@ -0,0 +1,169 @@
+#include "display_profile.h"
+#include <M5Unified.h>
+#include <SD.h>
+#include <map>
+
+// Layouts, one per panel and orientation. Button and image sizes in the two
+// PaperS3 profiles match the authored assets; the menu hotspots of the others
+// sit where tools/make_variants.py letterboxes menu.png.
+static const DisplayProfile PROFILES[] = {
+  {
+    "portrait", 2, 540, 960,
+    {45, 45, 80, 80}, {415, 45, 80, 80}, {230, 45, 80, 80},
+    {45, 35, 80, 80}, {415, 35, 80, 80}, {230, 35, 80, 80},
+    {70, 180, 400, 150}, {70, 335, 400, 80}, {70, 485, 400, 400},
+    3, 5, 120, 45, 30, 170,
+    {50, 630, 140, 115}, {204, 630, 130, 115}, {354, 630, 133, 115},
+    {70, 300, 400, 100}, {70, 450, 400, 100}, {70, 600, 400, 100}, {70, 750, 400, 100},
+    {50, 180, 440, 80}, 100, 1, 0,
+    30, 180, 0, {70, 820, 400, 100},
+  },
+  {
+    "landscape", 1, 960, 540,
+    {45, 45, 80, 80}, {835, 45, 80, 80}, {440, 45, 80, 80},
+    {45, 35, 80, 80}, {835, 35, 80, 80}, {440, 35, 80, 80},
+    {500, 180, 400, 150}, {500, 335, 400, 80}, {40, 125, 400, 400},
+    5, 3, 120, 45, 20, 130,
+    {356, 354, 79, 65}, {443, 354, 73, 65}, {527, 354, 75, 65},
+    {60, 200, 400, 100}, {500, 200, 400, 100}, {60, 350, 400, 100}, {500, 350, 400, 100},
+    {50, 180, 420, 80}, 90, 2, 460,
+    30, 180, 500, {500, 410, 400, 100},
+  },
+  {
+    // 9.7" epdiy panels (ED097TC2 and similar), landscape
+    "epdiy_1200x825", 0, 1200, 825,
+    {60, 60, 120, 120}, {1020, 60, 120, 120}, {540, 60, 120, 120},
+    {60, 45, 120, 120}, {1020, 45, 120, 120}, {540, 45, 120, 120},
+    {650, 260, 500, 188}, {650, 456, 500, 100}, {50, 215, 560, 560},
+    5, 3, 180, 60, 30, 200,
+    {411, 541, 120, 99}, {543, 541, 112, 99}, {672, 541, 114, 99},
+    {100, 260, 450, 120}, {650, 260, 450, 120}, {100, 440, 450, 120}, {650, 440, 450, 120},
+    {60, 230, 500, 90}, 110, 2, 560,
+    40, 230, 640, {640, 660, 450, 120},
+  },
+};
+static const int PROFILE_COUNT = sizeof(PROFILES) / sizeof(PROFILES[0]);
+
+// Authored asset sizes (the portrait profile)
+static const DisplayProfile& BASE_PROFILE = PROFILES[0];
+
+static const DisplayProfile* current = &PROFILES[0];
+
+// Variant lookups already made (SD.exists per draw is a directory walk)
+static std::map<String, String> variantPaths;
+
+static bool fitsPanel(const DisplayProfile& profile) {
+  M5.Display.setRotation(profile.rotation);
+  return M5.Display.width() == profile.width && M5.Display.height() == profile.height;
+}
+
+const DisplayProfile& applyDisplayProfile(const String& name) {
+  const DisplayProfile* chosen = &PROFILES[0];
+  for (int i = 0; i < PROFILE_COUNT; i++) {
+    if (name == PROFILES[i].name) {
+      chosen = &PROFILES[i];
+      break;
+    }
+  }
+
+  if (!fitsPanel(*chosen)) {
+    Serial.printf("[Profile] %s does not fit this %dx%d panel\n", chosen->name, M5.Display.width(),
+                  M5.Display.height());
+    for (int i = 0; i < PROFILE_COUNT; i++) {
+      if (fitsPanel(PROFILES[i])) {
+        chosen = &PROFILES[i];
+        break;
+      }
+    }
+    // Nothing matches: keep the requested rotation and its layout
+    if (M5.Display.width() != chosen->width || M5.Display.height() != chosen->height) {
+      M5.Display.setRotation(chosen->rotation);
+    }
+  }
+
+  if (chosen != current) {
+    variantPaths.clear();
+  }
+  current = chosen;
+  Serial.printf("[Profile] %s (%dx%d, rotation %d)\n", current->name, current->width, current->height,
+                current->rotation);
+  return *current;
+}
+
+const DisplayProfile& displayProfile() {
+  return *current;
+}
+
+LayoutRect gridSlotRect(int slot) {
+  const DisplayProfile& p = *current;
+  int col = slot % p.gridCols;
+  int row = slot / p.gridCols;
+  int gridWidth = p.gridCols * p.thumbnailSize + (p.gridCols - 1) * p.gridGapX;
+  int gridStartX = (p.width - gridWidth) / 2;
+  return {gridStartX + col * (p.thumbnailSize + p.gridGapX), p.gridTop + row * (p.thumbnailSize + p.gridGapY),
+          p.thumbnailSize, p.thumbnailSize};
+}
+
+int gridSlotAt(int x, int y) {
+  for (int slot = 0; slot < GRID_CARDS_PER_PAGE; slot++) {
+    if (gridSlotRect(slot).contains(x, y)) {
+      return slot;
+    }
+  }
+  return -1;
+}
+
+static void roleSize(const DisplayProfile& profile, AssetRole role, int& width, int& height) {
+  switch (role) {
+    case ASSET_SCREEN:
+      width = profile.width;
+      height = profile.height;
+      break;
+    case ASSET_BUTTON:
+      width = profile.navHome.w;
+      height = profile.navHome.h;
+      break;
+    case ASSET_BIG_TEXT:
+      width = profile.bigText.w;
+      height = profile.bigText.h;
+      break;
+    case ASSET_SMALL_TEXT:
+      width = profile.smallText.w;
+      height = profile.smallText.h;
+      break;
+    case ASSET_MAIN_IMAGE:
+      width = profile.mainImage.w;
+      height = profile.mainImage.h;
+      break;
+  }
+}
+
+String assetForLayout(const String& path, AssetRole role) {
+  int width, height, baseWidth, baseHeight;
+  roleSize(*current, role, width, height);
+  roleSize(BASE_PROFILE, role, baseWidth, baseHeight);
+  if (width == baseWidth && height == baseHeight) {
+    return path;
+  }
+
+  auto cached = variantPaths.find(path);
+  if (cached != variantPaths.end()) {
+    return cached->second;
+  }
+
+  int dot = path.lastIndexOf('.');
+  int slash = path.lastIndexOf('/');
+  String variant = (dot > slash ? path.substring(0, dot) : path) + "@" + String(width) + "x" + String(height) +
+                   (dot > slash ? path.substring(dot) : String(""));
+  String resolved = path;
+  if (SD.exists(variant)) {
+    resolved = variant;
+  } else {
+    Serial.printf("[Profile] No %dx%d variant of %s (run tools/make_variants.py)\n", width, height, path.c_str());
+  }
+  if (variantPaths.size() >= 512) {
+    variantPaths.clear();
+  }
+  variantPaths[path] = resolved;
+  return resolved;
+}
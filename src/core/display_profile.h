@@ -0,0 +1,75 @@
+#pragma once
+#include <Arduino.h>
+
+// Cards per grid page in every profile (gridCols x gridRows)
+#define GRID_CARDS_PER_PAGE 15
+
+struct LayoutRect {
+  int x, y, w, h;
+
+  bool contains(int px, int py) const {
+    return px >= x && px <= x + w && py >= y && py <= y + h;
+  }
+};
+
+// One panel and orientation: its rotation and where every page puts things.
+// Deck assets are authored for the "portrait" profile; other profiles draw
+// "name@WxH.ext" variants made by tools/make_variants.py.
+struct DisplayProfile {
+  const char* name;
+  int rotation;              // M5.Display.setRotation()
+  int width, height;         // Panel size after rotation
+
+  // Navigation buttons: flipcard page, and grid/category pages (pager)
+  LayoutRect navLeft, navRight, navHome;
+  LayoutRect pagerLeft, pagerRight, pagerHome;
+
+  // Flipcard regions
+  LayoutRect bigText, smallText, mainImage;
+
+  // Grid of thumbnails below the pager
+  int gridCols, gridRows;
+  int thumbnailSize;
+  int gridGapX, gridGapY;
+  int gridTop;
+
+  // Hotspots of the buttons painted in menu.png
+  LayoutRect menuCategory, menuRandom, menuOption;
+
+  // Option page buttons (the option sub-pages use pagerHome as their home button)
+  LayoutRect optionLanguage, optionCollections, optionRescan, optionEnergy;
+
+  // Language list: first row, row pitch, and further columns listColumnPitch to the right
+  LayoutRect listRow;
+  int listRowPitch, listColumns, listColumnPitch;
+
+  // Energy report: text origin, x of the per-operation column (0 = below the rest), export button
+  int energyTextX, energyTextY, energySecondColumnX;
+  LayoutRect energyExport;
+};
+
+// What an asset is drawn as; sets the size its variant must have
+enum AssetRole {
+  ASSET_SCREEN,      // Full-screen art (menu.png, empty-frame.png)
+  ASSET_BUTTON,      // Left/Right/Home buttons
+  ASSET_BIG_TEXT,
+  ASSET_SMALL_TEXT,
+  ASSET_MAIN_IMAGE
+};
+
+// Pick a profile by name ("portrait", "landscape", "epdiy_1200x825") and apply
+// its rotation. When the panel does not have that size, the built-in profile
+// matching the panel is used instead.
+const DisplayProfile& applyDisplayProfile(const String& name);
+
+const DisplayProfile& displayProfile();
+
+// Position of a grid slot (0 .. GRID_CARDS_PER_PAGE - 1)
+LayoutRect gridSlotRect(int slot);
+
+// Grid slot under a touch, -1 when none
+int gridSlotAt(int x, int y);
+
+// Path to draw for an asset in this profile: the file itself when the profile
+// uses the authored size, otherwise its "@WxH" variant if present on SD
+String assetForLayout(const String& path, AssetRole role);
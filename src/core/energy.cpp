@@ -0,0 +1,241 @@
+#include "energy.h"
+#include <M5Unified.h>
+#include <SD.h>
+
+// Power model in mW per state. These are estimates for the board running from
+// its battery (240 MHz, radios off), not measurements; the battery drain shown
+// next to them in the report is the number to check them against.
+static const float STATE_MILLIWATTS[ENERGY_STATE_COUNT] = {
+  260.0f,  // ACTIVE
+  300.0f,  // DECODE
+  330.0f,  // SD_IO (CPU plus card read current)
+  150.0f,  // IDLE
+  10.0f,   // LIGHT_SLEEP
+  250.0f,  // REFRESH (panel drive, on top of the CPU state)
+};
+
+static const char* STATE_NAMES[ENERGY_STATE_COUNT] = {
+  "active", "decode", "sd_io", "idle", "light_sleep", "refresh"
+};
+
+static const char* OPERATION_NAMES[ENERGY_OP_COUNT] = {
+  "grid_page", "card", "language", "page"
+};
+
+// Deeper nesting is counted against the innermost state that fits
+static const int MAX_STATE_DEPTH = 8;
+
+static EnergyReport report;
+static TaskHandle_t mainTask = nullptr;
+
+static uint8_t stateStack[MAX_STATE_DEPTH];
+static int stateDepth = 0;
+static int overflowDepth = 0;
+static uint32_t stateStart = 0;
+
+static bool refreshBusy = false;
+static uint32_t refreshStart = 0;
+
+static int operationDepth = 0;
+static int currentOperation = -1;
+static bool operationClosing = false;
+static uint64_t operationStart[ENERGY_STATE_COUNT];
+
+static uint32_t lastBatterySample = 0;
+
+static bool onMainTask() {
+  return mainTask != nullptr && xTaskGetCurrentTaskHandle() == mainTask;
+}
+
+static int currentState() {
+  return stateDepth > 0 ? stateStack[stateDepth - 1] : ENERGY_ACTIVE;
+}
+
+// Add the time since the last fold to the running state and the panel refresh
+static void fold() {
+  uint32_t now = micros();
+  report.micros[currentState()] += now - stateStart;
+  stateStart = now;
+
+  if (refreshBusy) {
+    report.micros[ENERGY_REFRESH] += now - refreshStart;
+  }
+  refreshStart = now;
+  refreshBusy = M5.Display.displayBusy();
+}
+
+static void finishOperation() {
+  fold();
+  EnergyOperationTotals& totals = report.operations[currentOperation];
+  totals.count++;
+  for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+    totals.micros[i] += report.micros[i] - operationStart[i];
+  }
+  currentOperation = -1;
+  operationClosing = false;
+}
+
+static void sampleBattery() {
+  lastBatterySample = millis();
+  if (report.batteryCount == ENERGY_BATTERY_SAMPLES) {
+    memmove(report.battery, report.battery + 1, sizeof(EnergyBatterySample) * (ENERGY_BATTERY_SAMPLES - 1));
+    report.batteryCount--;
+  }
+  EnergyBatterySample& sample = report.battery[report.batteryCount++];
+  sample.uptimeSeconds = lastBatterySample / 1000;
+  sample.millivolts = M5.Power.getBatteryVoltage();
+  int32_t level = M5.Power.getBatteryLevel();
+  sample.level = (level >= 0 && level <= 100) ? level : -1;
+  sample.charging = M5.Power.isCharging();
+}
+
+void energyInit() {
+  memset(&report, 0, sizeof(report));
+  mainTask = xTaskGetCurrentTaskHandle();
+  stateDepth = 0;
+  overflowDepth = 0;
+  stateStart = micros();
+  refreshStart = stateStart;
+  refreshBusy = false;
+  sampleBattery();
+}
+
+void energyTick() {
+  if (!onMainTask()) {
+    return;
+  }
+  fold();
+  if (operationClosing && !refreshBusy) {
+    finishOperation();
+  }
+  if (millis() - lastBatterySample >= ENERGY_BATTERY_SAMPLE_MS) {
+    sampleBattery();
+  }
+}
+
+void energyPush(EnergyState state) {
+  if (!onMainTask()) {
+    return;
+  }
+  if (stateDepth == MAX_STATE_DEPTH) {
+    overflowDepth++;
+    return;
+  }
+  fold();
+  stateStack[stateDepth++] = state;
+}
+
+void energyPop() {
+  if (!onMainTask()) {
+    return;
+  }
+  if (overflowDepth > 0) {
+    overflowDepth--;
+    return;
+  }
+  if (stateDepth > 0) {
+    fold();
+    stateDepth--;
+  }
+}
+
+void energyBeginOperation(EnergyOperation operation) {
+  if (!onMainTask() || operationDepth++ > 0) {
+    return;
+  }
+  // The previous operation's refresh is still running: it ends here
+  if (operationClosing) {
+    finishOperation();
+  }
+  fold();
+  memcpy(operationStart, report.micros, sizeof(operationStart));
+  currentOperation = operation;
+}
+
+void energyEndOperation() {
+  if (!onMainTask() || operationDepth == 0 || --operationDepth > 0) {
+    return;
+  }
+  operationClosing = true;
+}
+
+const EnergyReport& getEnergyReport() {
+  if (onMainTask()) {
+    fold();
+  }
+  return report;
+}
+
+float energyMillijoules(const uint64_t* micros) {
+  float total = 0;
+  for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+    total += STATE_MILLIWATTS[i] * (float)(micros[i] / 1000) / 1000.0f;
+  }
+  return total;
+}
+
+float energyBatteryDrainPerHour() {
+  // Only the samples since the charger was last connected
+  int first = report.batteryCount;
+  while (first > 0 && !report.battery[first - 1].charging) {
+    first--;
+  }
+  int last = report.batteryCount - 1;
+  if (last - first < 1) {
+    return 0;
+  }
+  uint32_t seconds = report.battery[last].uptimeSeconds - report.battery[first].uptimeSeconds;
+  if (seconds < 600) {
+    return 0; // Voltage noise dominates shorter spans
+  }
+  int drop = report.battery[first].millivolts - report.battery[last].millivolts;
+  return drop * 3600.0f / seconds;
+}
+
+const char* energyStateName(int state) {
+  return (state >= 0 && state < ENERGY_STATE_COUNT) ? STATE_NAMES[state] : "?";
+}
+
+const char* energyOperationName(int operation) {
+  return (operation >= 0 && operation < ENERGY_OP_COUNT) ? OPERATION_NAMES[operation] : "?";
+}
+
+static void writeCsvRow(File& file, const char* section, const char* name, uint32_t count, const uint64_t* micros) {
+  file.printf("%s,%s,%lu", section, name, (unsigned long)count);
+  for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+    file.printf(",%lu", (unsigned long)(micros[i] / 1000));
+  }
+  file.printf(",%.1f\n", energyMillijoules(micros));
+}
+
+bool exportEnergyCsv(const char* path) {
+  const EnergyReport& current = getEnergyReport();
+  File file = SD.open(path, FILE_WRITE);
+  if (!file) {
+    Serial.printf("[Energy] Cannot write %s\n", path);
+    return false;
+  }
+
+  // Times in ms; estimated_mj comes from the per-state power model
+  file.print("section,name,count");
+  for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+    file.printf(",%s_ms", STATE_NAMES[i]);
+  }
+  file.println(",estimated_mj");
+  writeCsvRow(file, "total", "uptime", 1, current.micros);
+  for (int op = 0; op < ENERGY_OP_COUNT; op++) {
+    writeCsvRow(file, "operation", OPERATION_NAMES[op], current.operations[op].count, current.operations[op].micros);
+  }
+
+  file.println();
+  file.println("section,uptime_s,millivolts,level,charging");
+  for (int i = 0; i < current.batteryCount; i++) {
+    const EnergyBatterySample& sample = current.battery[i];
+    file.printf("battery,%lu,%d,%d,%d\n", (unsigned long)sample.uptimeSeconds, sample.millivolts, sample.level,
+                sample.charging ? 1 : 0);
+  }
+  file.close();
+
+  Serial.printf("[Energy] Report written to %s\n", path);
+  return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <Arduino.h>
+
+// Report export path (overwritten on each export)
+#define ENERGY_CSV_PATH "/flipcard/energy.csv"
+
+// Interval between battery voltage samples
+#define ENERGY_BATTERY_SAMPLE_MS 60000
+
+// Battery samples kept for the report and the CSV (oldest dropped first)
+#define ENERGY_BATTERY_SAMPLES 120
+
+// What the CPU is doing. The innermost EnergyScope on the main task wins;
+// ACTIVE is everything outside a scope (touch handling, layout, JSON).
+enum EnergyState {
+  ENERGY_ACTIVE,
+  ENERGY_DECODE,       // Image decode, dithering and blits
+  ENERGY_SD_IO,        // Blocked waiting for SD reads
+  ENERGY_IDLE,         // loop() delay between touch samples
+  ENERGY_LIGHT_SLEEP,  // CPU in light sleep
+  ENERGY_CPU_STATE_COUNT
+};
+
+// The panel refresh runs alongside the CPU states, so it is tracked separately
+#define ENERGY_REFRESH ENERGY_CPU_STATE_COUNT
+#define ENERGY_STATE_COUNT (ENERGY_CPU_STATE_COUNT + 1)
+
+// User-visible operations the totals are broken down by
+enum EnergyOperation {
+  ENERGY_OP_GRID_PAGE,      // Grid page turn
+  ENERGY_OP_CARD,           // Card navigation (next/previous/random/open)
+  ENERGY_OP_LANGUAGE,       // Language toggle on a card
+  ENERGY_OP_PAGE,           // Full-page redraw when switching pages
+  ENERGY_OP_COUNT
+};
+
+struct EnergyBatterySample {
+  uint32_t uptimeSeconds;
+  int16_t millivolts;
+  int8_t level;             // Percent, -1 when unknown
+  bool charging;
+};
+
+struct EnergyOperationTotals {
+  uint32_t count;
+  uint64_t micros[ENERGY_STATE_COUNT];
+};
+
+struct EnergyReport {
+  uint64_t micros[ENERGY_STATE_COUNT];  // Totals since boot
+  EnergyOperationTotals operations[ENERGY_OP_COUNT];
+  EnergyBatterySample battery[ENERGY_BATTERY_SAMPLES];
+  int batteryCount;         // Valid samples, oldest first
+};
+
+// Start accounting on the calling (main) task
+void energyInit();
+
+// Once per loop(): samples panel busy time, closes finished operations and
+// takes a battery sample every ENERGY_BATTERY_SAMPLE_MS
+void energyTick();
+
+// State stack for the main task; calls from other tasks are ignored
+void energyPush(EnergyState state);
+void energyPop();
+
+// An operation runs until its last panel refresh has finished, so its
+// totals include the refresh. Nested operations count toward the outermost.
+void energyBeginOperation(EnergyOperation operation);
+void energyEndOperation();
+
+class EnergyScope {
+public:
+  explicit EnergyScope(EnergyState state) { energyPush(state); }
+  ~EnergyScope() { energyPop(); }
+};
+
+class EnergyOperationScope {
+public:
+  explicit EnergyOperationScope(EnergyOperation operation) { energyBeginOperation(operation); }
+  ~EnergyOperationScope() { energyEndOperation(); }
+};
+
+// Current totals (the running state is folded in first)
+const EnergyReport& getEnergyReport();
+
+// Estimated energy for per-state times, from the power model in energy.cpp
+float energyMillijoules(const uint64_t* micros);
+
+// Battery drain in mV per hour since the charger was last connected
+// (0 until ten minutes of samples exist)
+float energyBatteryDrainPerHour();
+
+const char* energyStateName(int state);
+const char* energyOperationName(int operation);
+
+// Write the report as CSV; returns false if the file cannot be written
+bool exportEnergyCsv(const char* path = ENERGY_CSV_PATH);
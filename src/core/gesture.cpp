@@ -0,0 +1,166 @@
+#include "gesture.h"
+#include "touch_trace.h"
+#include <M5Unified.h>
+#include <vector>
+
+static std::vector<GestureHandler> handlers[GESTURE_TYPE_COUNT];
+
+// Ring buffer of raw samples
+static TouchSample queue[GESTURE_QUEUE_SIZE];
+static int queueHead = 0;
+static int queueCount = 0;
+
+// Recognizer state for the current touch
+static bool touchDown = false;
+static uint32_t downTime = 0;
+static int16_t downX = 0, downY = 0;
+static int maxDistance = 0;
+static uint8_t maxFingers = 0;
+static bool gestureConsumed = false;   // Swipe or long-press already emitted
+static uint8_t lastCount = 0;
+
+void gestureSubscribe(GestureType type, GestureHandler handler) {
+  handlers[type].push_back(handler);
+}
+
+void gesturePushSample(const TouchSample& sample) {
+  if (queueCount == GESTURE_QUEUE_SIZE) {
+    // Drop the oldest sample; the newest state matters most
+    queueHead = (queueHead + 1) % GESTURE_QUEUE_SIZE;
+    queueCount--;
+  }
+  queue[(queueHead + queueCount) % GESTURE_QUEUE_SIZE] = sample;
+  queueCount++;
+}
+
+void gesturePoll() {
+  TouchSample sample;
+  sample.timeMs = millis();
+  sample.count = M5.Touch.getCount();
+  sample.x = 0;
+  sample.y = 0;
+  if (sample.count > 0) {
+    auto detail = M5.Touch.getDetail(0);
+    sample.x = detail.x;
+    sample.y = detail.y;
+  }
+
+  // Idle with no finger: nothing to record
+  if (sample.count == 0 && lastCount == 0) {
+    return;
+  }
+  lastCount = sample.count;
+  gesturePushSample(sample);
+  traceRecordSample(sample);
+}
+
+bool gestureTouchActive() {
+  return touchDown || lastCount > 0;
+}
+
+static void emit(GestureType type, uint32_t timeMs, float velocity) {
+  GestureEvent event;
+  event.type = type;
+  event.x = downX;
+  event.y = downY;
+  event.velocity = velocity;
+  event.timeMs = timeMs;
+  event.downTimeMs = downTime;
+
+  Serial.printf("Gesture: %s at (%d, %d) after %lu ms\n", gestureName(type), downX, downY,
+                (unsigned long)(timeMs - downTime));
+  traceGestureBegin(event);
+  for (GestureHandler handler : handlers[type]) {
+    handler(event);
+  }
+  traceGestureEnd();
+}
+
+static void processSample(const TouchSample& sample) {
+  if (sample.count > 0 && !touchDown) {
+    // Touch-down
+    touchDown = true;
+    downTime = sample.timeMs;
+    downX = sample.x;
+    downY = sample.y;
+    maxDistance = 0;
+    maxFingers = sample.count;
+    gestureConsumed = false;
+    return;
+  }
+
+  if (!touchDown) {
+    return;
+  }
+
+  if (sample.count > 0) {
+    if (sample.count > maxFingers) {
+      maxFingers = sample.count;
+    }
+    int dx = sample.x - downX;
+    int dy = sample.y - downY;
+    int distance = max(abs(dx), abs(dy));
+    if (distance > maxDistance) {
+      maxDistance = distance;
+    }
+
+    if (gestureConsumed || maxFingers > 1) {
+      return;
+    }
+
+    // Swipe: committed as soon as the direction is clear, while the finger is still down
+    if (abs(dx) >= GESTURE_SWIPE_MIN_PX && abs(dx) > 2 * abs(dy)) {
+      uint32_t elapsed = max((uint32_t)1, sample.timeMs - downTime);
+      gestureConsumed = true;
+      emit(dx < 0 ? GESTURE_SWIPE_LEFT : GESTURE_SWIPE_RIGHT, sample.timeMs, (float)dx / elapsed);
+      return;
+    }
+
+    // Long-press: held in place
+    if (maxDistance <= GESTURE_TAP_SLOP_PX && sample.timeMs - downTime >= GESTURE_LONG_PRESS_MS) {
+      gestureConsumed = true;
+      emit(GESTURE_LONG_PRESS, sample.timeMs, 0.0f);
+    }
+    return;
+  }
+
+  // Release
+  touchDown = false;
+  if (gestureConsumed) {
+    return;
+  }
+  if (maxFingers > 1) {
+    if (sample.timeMs - downTime <= GESTURE_TWO_FINGER_TAP_MS) {
+      emit(GESTURE_TWO_FINGER_TAP, sample.timeMs, 0.0f);
+    }
+  } else if (maxDistance <= GESTURE_TAP_SLOP_PX) {
+    emit(GESTURE_TAP, sample.timeMs, 0.0f);
+  }
+}
+
+void gestureProcess() {
+  while (queueCount > 0) {
+    TouchSample sample = queue[queueHead];
+    queueHead = (queueHead + 1) % GESTURE_QUEUE_SIZE;
+    queueCount--;
+    processSample(sample);
+  }
+
+  // A long-press must fire without waiting for another sample
+  if (touchDown && !gestureConsumed && maxFingers == 1 && maxDistance <= GESTURE_TAP_SLOP_PX &&
+      millis() - downTime >= GESTURE_LONG_PRESS_MS) {
+    gestureConsumed = true;
+    emit(GESTURE_LONG_PRESS, millis(), 0.0f);
+  }
+}
+
+const char* gestureName(GestureType type) {
+  switch (type) {
+    case GESTURE_TAP:            return "tap";
+    case GESTURE_SWIPE_LEFT:     return "swipe-left";
+    case GESTURE_SWIPE_RIGHT:    return "swipe-right";
+    case GESTURE_LONG_PRESS:     return "long-press";
+    case GESTURE_TWO_FINGER_TAP: return "two-finger-tap";
+    default:                     return "unknown";
+  }
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <Arduino.h>
+
+// Recognizer thresholds
+#define GESTURE_TAP_SLOP_PX          20    // Max movement for a tap / long-press
+#define GESTURE_SWIPE_MIN_PX         60    // Horizontal travel that commits a swipe
+#define GESTURE_LONG_PRESS_MS        600
+#define GESTURE_TWO_FINGER_TAP_MS    400
+#define GESTURE_QUEUE_SIZE           32
+
+enum GestureType {
+    GESTURE_TAP,
+    GESTURE_SWIPE_LEFT,      // Finger moved right-to-left
+    GESTURE_SWIPE_RIGHT,     // Finger moved left-to-right
+    GESTURE_LONG_PRESS,
+    GESTURE_TWO_FINGER_TAP,
+    GESTURE_TYPE_COUNT
+};
+
+// Raw timestamped touch sample
+struct TouchSample {
+    uint32_t timeMs;
+    int16_t x, y;
+    uint8_t count;           // Number of fingers down (0 = released)
+};
+
+struct GestureEvent {
+    GestureType type;
+    int16_t x, y;            // Touch-down position
+    float velocity;          // Swipes: horizontal px/ms at detection time
+    uint32_t timeMs;         // When the gesture was recognized
+    uint32_t downTimeMs;     // When the finger touched down
+};
+
+typedef void (*GestureHandler)(const GestureEvent& event);
+
+// Subscribe a handler to one gesture type (several handlers per type allowed)
+void gestureSubscribe(GestureType type, GestureHandler handler);
+
+// Sample M5.Touch into the queue (call every loop)
+void gesturePoll();
+
+// Queue a sample from another source (e.g. a replayed trace)
+void gesturePushSample(const TouchSample& sample);
+
+// Consume queued samples, recognize gestures and dispatch events
+void gestureProcess();
+
+// True while at least one finger is down
+bool gestureTouchActive();
+
+const char* gestureName(GestureType type);
@@ -0,0 +1,309 @@
+#include "glyph_cache.h"
+#include <M5Unified.h>
+#include <esp_heap_caps.h>
+#include <map>
+
+// Reference size used to measure a line before choosing its final size
+#define GLYPH_MEASURE_SIZE 24
+#define GLYPH_MIN_SIZE     12
+#define GLYPH_MAX_SIZE     255
+#define GLYPH_TEXT_MARGIN  10
+
+struct CachedGlyph {
+  GlyphBitmap bitmap;
+  uint32_t bytes;
+  uint32_t lastUse;
+};
+
+struct GlyphCacheStats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+};
+
+// Key: source id, code point, pixel size (low byte)
+static std::map<uint64_t, CachedGlyph> glyphs;
+static uint32_t glyphBytesUsed = 0;
+static uint32_t useCounter = 0;
+static GlyphCacheStats glyphStats = {0, 0, 0};
+
+static bool rasterizeBuiltinGlyph(uint32_t codepoint, int pixelSize, GlyphBitmap& out);
+static GlyphRasterizer activeRasterizer = rasterizeBuiltinGlyph;
+static GlyphSizeSnap activeSizeSnap = nullptr;
+static uint8_t activeSourceId = 0;
+
+static void setGrayPalette(M5Canvas& canvas) {
+  for (int i = 0; i < 16; i++) {
+    canvas.setPaletteColor(i, i * 17, i * 17, i * 17);
+  }
+}
+
+static void encodeUtf8(uint32_t codepoint, char* out) {
+  if (codepoint < 0x80) {
+    out[0] = codepoint;
+    out[1] = 0;
+  } else if (codepoint < 0x800) {
+    out[0] = 0xC0 | (codepoint >> 6);
+    out[1] = 0x80 | (codepoint & 0x3F);
+    out[2] = 0;
+  } else if (codepoint < 0x10000) {
+    out[0] = 0xE0 | (codepoint >> 12);
+    out[1] = 0x80 | ((codepoint >> 6) & 0x3F);
+    out[2] = 0x80 | (codepoint & 0x3F);
+    out[3] = 0;
+  } else {
+    out[0] = 0xF0 | (codepoint >> 18);
+    out[1] = 0x80 | ((codepoint >> 12) & 0x3F);
+    out[2] = 0x80 | ((codepoint >> 6) & 0x3F);
+    out[3] = 0x80 | (codepoint & 0x3F);
+    out[4] = 0;
+  }
+}
+
+uint32_t nextCodepoint(const String& text, int& index) {
+  uint8_t lead = text[index++];
+  int extra = 0;
+  uint32_t codepoint = lead;
+  if (lead >= 0xF0) {
+    extra = 3;
+    codepoint = lead & 0x07;
+  } else if (lead >= 0xE0) {
+    extra = 2;
+    codepoint = lead & 0x0F;
+  } else if (lead >= 0xC0) {
+    extra = 1;
+    codepoint = lead & 0x1F;
+  }
+  while (extra-- > 0 && index < (int)text.length()) {
+    codepoint = (codepoint << 6) | (text[index++] & 0x3F);
+  }
+  return codepoint;
+}
+
+// Default source: M5GFX's built-in CJK bitmap font, scaled to the requested size
+static bool rasterizeBuiltinGlyph(uint32_t codepoint, int pixelSize, GlyphBitmap& out) {
+  char utf8[5];
+  encodeUtf8(codepoint, utf8);
+
+  M5Canvas canvas;
+  canvas.setPsram(true);
+  canvas.setColorDepth(4);
+  canvas.setFont(&fonts::efontCN_24);
+  canvas.setTextSize(pixelSize / 24.0f);
+  int width = canvas.textWidth(utf8);
+  int height = canvas.fontHeight();
+  if (width <= 0 || height <= 0 || !canvas.createSprite(width, height)) {
+    return false;
+  }
+
+  // Palette index == gray level, so the sprite buffer is already packed 4bpp
+  setGrayPalette(canvas);
+  canvas.fillScreen(15);
+  canvas.setTextColor(0, 15);
+  canvas.drawString(utf8, 0, 0);
+
+  int rowBytes = (width + 1) / 2;
+  uint32_t canvasStride = canvas.bufferLength() / height;
+  out.pixels = (uint8_t*)heap_caps_malloc(rowBytes * height, MALLOC_CAP_SPIRAM);
+  if (!out.pixels) {
+    return false;
+  }
+  const uint8_t* buffer = (const uint8_t*)canvas.getBuffer();
+  for (int row = 0; row < height; row++) {
+    memcpy(out.pixels + row * rowBytes, buffer + row * canvasStride, rowBytes);
+  }
+  out.width = width;
+  out.height = height;
+  out.advance = width;
+  return true;
+}
+
+void setGlyphRasterizer(GlyphRasterizer rasterizer, GlyphSizeSnap snap, uint8_t sourceId) {
+  activeRasterizer = rasterizer ? rasterizer : rasterizeBuiltinGlyph;
+  activeSizeSnap = rasterizer ? snap : nullptr;
+  activeSourceId = rasterizer ? sourceId : 0;
+}
+
+static int snapPixelSize(int pixelSize) {
+  if (activeSizeSnap) {
+    pixelSize = activeSizeSnap(pixelSize);
+  }
+  return constrain(pixelSize, GLYPH_MIN_SIZE, GLYPH_MAX_SIZE);
+}
+
+static void evictOldestGlyph() {
+  auto oldest = glyphs.begin();
+  for (auto it = glyphs.begin(); it != glyphs.end(); ++it) {
+    if (it->second.lastUse < oldest->second.lastUse) {
+      oldest = it;
+    }
+  }
+  glyphBytesUsed -= oldest->second.bytes;
+  heap_caps_free(oldest->second.bitmap.pixels);
+  glyphs.erase(oldest);
+  glyphStats.evictions++;
+}
+
+const GlyphBitmap* getGlyph(uint32_t codepoint, int pixelSize) {
+  pixelSize = snapPixelSize(pixelSize);
+  uint64_t key = ((uint64_t)activeSourceId << 40) | ((uint64_t)codepoint << 8) | pixelSize;
+
+  auto it = glyphs.find(key);
+  if (it != glyphs.end()) {
+    glyphStats.hits++;
+    it->second.lastUse = ++useCounter;
+    return &it->second.bitmap;
+  }
+  glyphStats.misses++;
+
+  CachedGlyph entry;
+  entry.bitmap.pixels = nullptr;
+  if (!activeRasterizer(codepoint, pixelSize, entry.bitmap)) {
+    // Remember missing glyphs as blank space so they are not retried every draw
+    entry.bitmap.width = 0;
+    entry.bitmap.height = 0;
+    entry.bitmap.advance = pixelSize / 3;
+    entry.bitmap.pixels = nullptr;
+  }
+  entry.bytes = ((entry.bitmap.width + 1) / 2) * entry.bitmap.height;
+  entry.lastUse = ++useCounter;
+
+  while (!glyphs.empty() && glyphBytesUsed + entry.bytes > GLYPH_CACHE_BUDGET) {
+    evictOldestGlyph();
+  }
+  glyphBytesUsed += entry.bytes;
+  return &(glyphs[key] = entry).bitmap;
+}
+
+int measureCachedText(const String& text, int pixelSize) {
+  int width = 0;
+  int index = 0;
+  while (index < (int)text.length()) {
+    const GlyphBitmap* glyph = getGlyph(nextCodepoint(text, index), pixelSize);
+    width += glyph->advance;
+  }
+  return width;
+}
+
+// Copy a glyph into a packed 4bpp line buffer, keeping the darker pixel where they overlap
+static void blitGlyph(const GlyphBitmap* glyph, uint8_t* line, uint32_t lineStride, int lineWidth, int lineHeight, int penX) {
+  int glyphStride = (glyph->width + 1) / 2;
+  int rows = min((int)glyph->height, lineHeight);
+  for (int row = 0; row < rows; row++) {
+    const uint8_t* src = glyph->pixels + row * glyphStride;
+    uint8_t* dst = line + row * lineStride;
+    for (int col = 0; col < glyph->width; col++) {
+      int x = penX + col;
+      if (x < 0 || x >= lineWidth) {
+        continue;
+      }
+      uint8_t level = (col & 1) ? (src[col >> 1] & 0x0F) : (src[col >> 1] >> 4);
+      if (level == 15) {
+        continue;
+      }
+      uint8_t& cell = dst[x >> 1];
+      uint8_t current = (x & 1) ? (cell & 0x0F) : (cell >> 4);
+      if (level < current) {
+        cell = (x & 1) ? ((cell & 0xF0) | level) : ((cell & 0x0F) | (level << 4));
+      }
+    }
+  }
+}
+
+// Function to compose a line into one 4bpp canvas and push it in a single transfer.
+// With regionHeight > 0 the line is clipped to it and centered vertically.
+static int drawLine(LovyanGFX& target, const String& text, int x, int y, int pixelSize, int maxWidth,
+                    int regionHeight, uint8_t backgroundLevel) {
+  int lineWidth = min(measureCachedText(text, pixelSize), maxWidth);
+  int lineHeight = 0;
+  int index = 0;
+  while (index < (int)text.length()) {
+    const GlyphBitmap* glyph = getGlyph(nextCodepoint(text, index), pixelSize);
+    lineHeight = max(lineHeight, (int)glyph->height);
+  }
+  if (regionHeight > 0) {
+    lineHeight = min(lineHeight, regionHeight);
+    y += (regionHeight - lineHeight) / 2;
+  }
+  if (lineWidth <= 0 || lineHeight <= 0) {
+    return 0;
+  }
+
+  M5Canvas line;
+  line.setPsram(true);
+  line.setColorDepth(4);
+  if (!line.createSprite(lineWidth, lineHeight)) {
+    Serial.println("Text line canvas unavailable");
+    return 0;
+  }
+  setGrayPalette(line);
+  line.fillScreen(backgroundLevel);
+
+  uint8_t* buffer = (uint8_t*)line.getBuffer();
+  uint32_t stride = line.bufferLength() / lineHeight;
+  int penX = 0;
+  index = 0;
+  while (index < (int)text.length() && penX < lineWidth) {
+    const GlyphBitmap* glyph = getGlyph(nextCodepoint(text, index), pixelSize);
+    if (glyph->pixels) {
+      blitGlyph(glyph, buffer, stride, lineWidth, lineHeight, penX);
+    }
+    penX += glyph->advance;
+  }
+
+  line.pushSprite(&target, x, y);
+  return lineWidth;
+}
+
+bool drawCachedTextInRegion(LovyanGFX& target, const String& text, int x, int y, int width, int height, int maxPixelSize) {
+  if (text.length() == 0) {
+    return false;
+  }
+
+  // Estimate the size from a small reference measurement, then step down until it fits
+  int available = width - 2 * GLYPH_TEXT_MARGIN;
+  int measured = measureCachedText(text, GLYPH_MEASURE_SIZE);
+  int pixelSize = snapPixelSize(min(maxPixelSize, height));
+  if (measured > 0 && measured * pixelSize / GLYPH_MEASURE_SIZE > available) {
+    pixelSize = snapPixelSize(available * GLYPH_MEASURE_SIZE / measured);
+  }
+  int lineWidth = measureCachedText(text, pixelSize);
+  while (lineWidth > available && pixelSize > GLYPH_MIN_SIZE) {
+    int next = snapPixelSize(pixelSize * available / lineWidth);
+    if (next >= pixelSize) {
+      next = snapPixelSize(pixelSize - 1);
+      if (next >= pixelSize) {
+        break;
+      }
+    }
+    pixelSize = next;
+    lineWidth = measureCachedText(text, pixelSize);
+  }
+
+  target.fillRect(x, y, width, height, TFT_WHITE);
+  int lineX = x + max(0, (width - lineWidth) / 2);
+  return drawLine(target, text, lineX, y, pixelSize, width, height, 15) > 0;
+}
+
+int drawCachedText(LovyanGFX& target, const String& text, int x, int y, int pixelSize, uint8_t backgroundLevel) {
+  if (text.length() == 0) {
+    return 0;
+  }
+  return drawLine(target, text, x, y, snapPixelSize(pixelSize), target.width() - x, 0, backgroundLevel & 0x0F);
+}
+
+void clearGlyphCache() {
+  for (auto& entry : glyphs) {
+    heap_caps_free(entry.second.bitmap.pixels);
+  }
+  glyphs.clear();
+  glyphBytesUsed = 0;
+}
+
+void printGlyphCacheStats() {
+  uint32_t lookups = glyphStats.hits + glyphStats.misses;
+  Serial.printf("Glyph cache: %d glyphs, %lu bytes, %lu hits, %lu misses (%.1f%% hit), %lu evictions\n",
+                glyphs.size(), (unsigned long)glyphBytesUsed, (unsigned long)glyphStats.hits,
+                (unsigned long)glyphStats.misses, lookups ? 100.0f * glyphStats.hits / lookups : 0.0f,
+                (unsigned long)glyphStats.evictions);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <Arduino.h>
+#include <M5GFX.h>
+
+// PSRAM budget for rasterized glyphs
+#define GLYPH_CACHE_BUDGET (512 * 1024)
+
+// Rasterized glyph: packed 4bpp gray (0 = black, 15 = white), high nibble first
+struct GlyphBitmap {
+    uint16_t width;
+    uint16_t height;
+    int16_t advance;     // Horizontal pen advance in pixels
+    uint8_t* pixels;     // (width + 1) / 2 bytes per row, allocated in PSRAM
+};
+
+// Produces a glyph at `pixelSize` line height. Returns false if unsupported.
+typedef bool (*GlyphRasterizer)(uint32_t codepoint, int pixelSize, GlyphBitmap& out);
+
+// Maps a requested size to the size the source actually provides (fixed-size fonts)
+typedef int (*GlyphSizeSnap)(int pixelSize);
+
+// Replace the glyph source (default: M5GFX built-in CJK font, source 0).
+// Cached glyphs are keyed by source id, so switching back finds them still warm.
+void setGlyphRasterizer(GlyphRasterizer rasterizer, GlyphSizeSnap snap = nullptr, uint8_t sourceId = 0);
+
+// Look up (or rasterize and cache) a glyph; the pointer stays valid until the next lookup
+const GlyphBitmap* getGlyph(uint32_t codepoint, int pixelSize);
+
+// Decode the next UTF-8 code point, advancing `index`
+uint32_t nextCodepoint(const String& text, int& index);
+
+// Width of a single line at `pixelSize`
+int measureCachedText(const String& text, int pixelSize);
+
+// Render one line of text centered in the region (white background)
+bool drawCachedTextInRegion(LovyanGFX& target, const String& text, int x, int y, int width, int height, int maxPixelSize);
+
+// Render one line with its top-left corner at (x, y) over a gray background
+// level (15 = white, 12 = TFT_LIGHTGREY). Returns the width drawn.
+int drawCachedText(LovyanGFX& target, const String& text, int x, int y, int pixelSize, uint8_t backgroundLevel = 15);
+
+void clearGlyphCache();
+void printGlyphCacheStats();
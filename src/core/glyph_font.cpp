@@ -0,0 +1,270 @@
+#include "glyph_font.h"
+#include "glyph_cache.h"
+#include <SD.h>
+#include <esp_heap_caps.h>
+#include <vector>
+
+// On-disk records (little-endian, see tools/build_glyph_font.py)
+struct __attribute__((packed)) GlyphFontHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t sizeCount;
+  uint32_t glyphCount;
+  uint32_t reserved;
+};
+
+struct __attribute__((packed)) GlyphFontSize {
+  uint16_t pixelSize;
+  uint16_t lineHeight;
+  int16_t ascent;
+  uint16_t reserved;
+  uint32_t glyphCount;
+  uint32_t tableOffset;
+};
+
+struct __attribute__((packed)) GlyphFontRecord {
+  uint32_t codepoint;
+  uint32_t bitmapOffset;
+  uint16_t width;
+  uint16_t height;
+  int16_t xOffset;
+  int16_t yOffset;      // From the line top
+  int16_t advance;
+  uint16_t reserved;
+};
+
+struct LoadedGlyphFont {
+  String path;
+  uint8_t* data;
+  uint32_t length;
+  uint32_t modified;   // File mtime when loaded; with length, detects a replaced file
+  uint8_t sourceId;    // Glyph cache source id
+  uint32_t lastUse;
+};
+
+static std::vector<LoadedGlyphFont> loadedFonts;
+static uint8_t nextSourceId = 1;   // 0 is the built-in font
+static uint32_t fontUseCounter = 0;
+
+// Active font
+static uint8_t* fontData = nullptr;
+static uint32_t fontLength = 0;
+static const GlyphFontSize* fontSizes = nullptr;
+static int fontSizeCount = 0;
+
+bool glyphFontLoaded() {
+  return fontData != nullptr;
+}
+
+// Largest stored size not above the request (or the smallest one)
+static const GlyphFontSize* findSize(int pixelSize) {
+  const GlyphFontSize* best = nullptr;
+  const GlyphFontSize* smallest = nullptr;
+  for (int i = 0; i < fontSizeCount; i++) {
+    const GlyphFontSize* size = &fontSizes[i];
+    if (size->pixelSize <= pixelSize && (!best || size->pixelSize > best->pixelSize)) {
+      best = size;
+    }
+    if (!smallest || size->pixelSize < smallest->pixelSize) {
+      smallest = size;
+    }
+  }
+  return best ? best : smallest;
+}
+
+static int snapGlyphFontSize(int pixelSize) {
+  const GlyphFontSize* size = findSize(pixelSize);
+  return size ? size->pixelSize : pixelSize;
+}
+
+// Binary search of the size's code point table
+static const GlyphFontRecord* findRecord(const GlyphFontSize* size, uint32_t codepoint) {
+  const GlyphFontRecord* table = (const GlyphFontRecord*)(fontData + size->tableOffset);
+  int low = 0;
+  int high = (int)size->glyphCount - 1;
+  while (low <= high) {
+    int mid = (low + high) / 2;
+    if (table[mid].codepoint == codepoint) {
+      return &table[mid];
+    }
+    if (table[mid].codepoint < codepoint) {
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return nullptr;
+}
+
+// Expand a stored glyph into a line-height cell the glyph cache can blit directly
+static bool rasterizeFileGlyph(uint32_t codepoint, int pixelSize, GlyphBitmap& out) {
+  const GlyphFontSize* size = findSize(pixelSize);
+  const GlyphFontRecord* record = size ? findRecord(size, codepoint) : nullptr;
+  if (!record) {
+    return false;
+  }
+
+  int left = max(0, (int)record->xOffset);
+  int width = max((int)record->advance, left + record->width);
+  int height = size->lineHeight;
+  if (width <= 0 || height <= 0) {
+    return false;
+  }
+
+  int rowBytes = (width + 1) / 2;
+  out.pixels = (uint8_t*)heap_caps_malloc(rowBytes * height, MALLOC_CAP_SPIRAM);
+  if (!out.pixels) {
+    return false;
+  }
+  memset(out.pixels, 0xFF, rowBytes * height);
+
+  const uint8_t* src = fontData + record->bitmapOffset;
+  int srcStride = (record->width + 1) / 2;
+  for (int row = 0; row < record->height; row++) {
+    int y = record->yOffset + row;
+    if (y < 0 || y >= height) {
+      continue;
+    }
+    uint8_t* dst = out.pixels + y * rowBytes;
+    for (int col = 0; col < record->width; col++) {
+      uint8_t packed = src[row * srcStride + (col >> 1)];
+      uint8_t level = (col & 1) ? (packed & 0x0F) : (packed >> 4);
+      int x = left + col;
+      dst[x >> 1] = (x & 1) ? ((dst[x >> 1] & 0xF0) | level) : ((dst[x >> 1] & 0x0F) | (level << 4));
+    }
+  }
+
+  out.width = width;
+  out.height = height;
+  out.advance = record->advance;
+  return true;
+}
+
+// Function to validate the header and every table/bitmap range before use
+static bool validateGlyphFont(const uint8_t* data, uint32_t length) {
+  if (length < sizeof(GlyphFontHeader)) {
+    return false;
+  }
+  const GlyphFontHeader* header = (const GlyphFontHeader*)data;
+  if (memcmp(header->magic, "G4FN", 4) != 0 || header->version != 1) {
+    return false;
+  }
+  uint32_t sizesEnd = sizeof(GlyphFontHeader) + header->sizeCount * sizeof(GlyphFontSize);
+  if (header->sizeCount == 0 || sizesEnd > length) {
+    return false;
+  }
+
+  const GlyphFontSize* sizes = (const GlyphFontSize*)(data + sizeof(GlyphFontHeader));
+  for (int i = 0; i < header->sizeCount; i++) {
+    uint64_t tableEnd = (uint64_t)sizes[i].tableOffset + (uint64_t)sizes[i].glyphCount * sizeof(GlyphFontRecord);
+    if (tableEnd > length) {
+      return false;
+    }
+    const GlyphFontRecord* table = (const GlyphFontRecord*)(data + sizes[i].tableOffset);
+    for (uint32_t g = 0; g < sizes[i].glyphCount; g++) {
+      uint64_t bitmapEnd = (uint64_t)table[g].bitmapOffset + ((table[g].width + 1) / 2) * table[g].height;
+      if (bitmapEnd > length || (g > 0 && table[g].codepoint <= table[g - 1].codepoint)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static void activateFont(LoadedGlyphFont& font) {
+  font.lastUse = ++fontUseCounter;
+  fontData = font.data;
+  fontLength = font.length;
+  fontSizes = (const GlyphFontSize*)(fontData + sizeof(GlyphFontHeader));
+  fontSizeCount = ((const GlyphFontHeader*)fontData)->sizeCount;
+  setGlyphRasterizer(rasterizeFileGlyph, snapGlyphFontSize, font.sourceId);
+}
+
+static void useBuiltinFont() {
+  fontData = nullptr;
+  fontLength = 0;
+  fontSizes = nullptr;
+  fontSizeCount = 0;
+  setGlyphRasterizer(nullptr);
+}
+
+bool loadGlyphFont(const String& path) {
+  File file = SD.open(path, FILE_READ);
+  uint32_t length = file ? file.size() : 0;
+  uint32_t modified = file ? (uint32_t)file.getLastWrite() : 0;
+
+  for (auto it = loadedFonts.begin(); it != loadedFonts.end(); ++it) {
+    if (it->path != path) {
+      continue;
+    }
+    if (file && it->length == length && it->modified == modified) {
+      file.close();
+      activateFont(*it);
+      Serial.printf("[GlyphFont] Reusing %s\n", path.c_str());
+      return true;
+    }
+    // Replaced or removed since it was loaded (e.g. by a sync); its cached
+    // glyphs stay behind under the old source id and age out
+    Serial.printf("[GlyphFont] %s changed on SD, unloading\n", path.c_str());
+    if (fontData == it->data) {
+      useBuiltinFont();
+    }
+    heap_caps_free(it->data);
+    loadedFonts.erase(it);
+    break;
+  }
+
+  if (!file) {
+    Serial.printf("[GlyphFont] %s not found, using built-in font\n", path.c_str());
+    useBuiltinFont();
+    return false;
+  }
+
+  uint8_t* data = (uint8_t*)heap_caps_malloc(length, MALLOC_CAP_SPIRAM);
+  if (!data) {
+    Serial.printf("[GlyphFont] Cannot allocate %lu bytes\n", (unsigned long)length);
+    file.close();
+    useBuiltinFont();
+    return false;
+  }
+  uint32_t start = millis();
+  uint32_t bytesRead = file.read(data, length);
+  file.close();
+
+  if (bytesRead != length || !validateGlyphFont(data, length)) {
+    Serial.printf("[GlyphFont] %s is invalid, using built-in font\n", path.c_str());
+    heap_caps_free(data);
+    useBuiltinFont();
+    return false;
+  }
+
+  // Drop the least recently used inactive font when at the limit
+  if (loadedFonts.size() >= GLYPH_FONT_MAX_LOADED) {
+    auto oldest = loadedFonts.begin();
+    for (auto it = loadedFonts.begin(); it != loadedFonts.end(); ++it) {
+      if (it->lastUse < oldest->lastUse) {
+        oldest = it;
+      }
+    }
+    Serial.printf("[GlyphFont] Unloading %s\n", oldest->path.c_str());
+    heap_caps_free(oldest->data);
+    loadedFonts.erase(oldest);
+  }
+
+  LoadedGlyphFont font;
+  font.path = path;
+  font.data = data;
+  font.length = length;
+  font.modified = modified;
+  font.sourceId = nextSourceId++;
+  if (nextSourceId == 0) {
+    nextSourceId = 1;
+  }
+  loadedFonts.push_back(font);
+  activateFont(loadedFonts.back());
+
+  Serial.printf("[GlyphFont] Loaded %s: %d sizes, %lu glyphs, %lu bytes in %lu ms\n", path.c_str(), fontSizeCount,
+                (unsigned long)((const GlyphFontHeader*)fontData)->glyphCount, (unsigned long)fontLength,
+                (unsigned long)(millis() - start));
+  return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <Arduino.h>
+
+// Deck-specific anti-aliased glyph file built by tools/build_glyph_font.py
+// (relative to the collection root)
+#define GLYPH_FONT_FILE "fonts/deck.g4f"
+
+// Fonts kept resident in PSRAM so switching collections back stays warm
+#define GLYPH_FONT_MAX_LOADED 3
+
+// Load the glyph file into PSRAM (once per path) and make it the glyph
+// cache's source. Returns false and selects the built-in font if the
+// file is missing or malformed.
+bool loadGlyphFont(const String& path);
+
+bool glyphFontLoaded();
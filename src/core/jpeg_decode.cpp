@@ -0,0 +1,178 @@
+#include "jpeg_decode.h"
+#include "sd_stream.h"
+#include "thumbnail_store.h"
+#include "energy.h"
+#include <M5Unified.h>
+#include <esp_heap_caps.h>
+#include <esp32s3/rom/tjpgd.h>
+
+// Decoder context passed through JDEC::device
+struct JpegTarget {
+  lgfx::DataWrapper* data;
+  uint8_t* gray;
+  int width;
+  int height;
+};
+
+bool isJpegPath(const char* path) {
+  const char* dot = strrchr(path, '.');
+  return dot && (strcasecmp(dot, ".jpg") == 0 || strcasecmp(dot, ".jpeg") == 0);
+}
+
+void fitInside(int width, int height, int boxWidth, int boxHeight, int& fitWidth, int& fitHeight) {
+  fitWidth = width;
+  fitHeight = height;
+  if (boxWidth > 0 && fitWidth > boxWidth) {
+    fitHeight = max(1, fitHeight * boxWidth / fitWidth);
+    fitWidth = boxWidth;
+  }
+  if (boxHeight > 0 && fitHeight > boxHeight) {
+    fitWidth = max(1, fitWidth * boxHeight / fitHeight);
+    fitHeight = boxHeight;
+  }
+}
+
+int chooseJpegScale(int srcWidth, int srcHeight, int fitWidth, int fitHeight) {
+  int scale = 0;
+  while (scale < 3 && (srcWidth >> (scale + 1)) >= fitWidth && (srcHeight >> (scale + 1)) >= fitHeight) {
+    scale++;
+  }
+  return scale;
+}
+
+static uint32_t jpegInput(JDEC* decoder, uint8_t* buf, uint32_t len) {
+  JpegTarget* target = (JpegTarget*)decoder->device;
+  if (!buf) {
+    target->data->skip(len);
+    return len;
+  }
+  int got = target->data->read(buf, len);
+  return got > 0 ? got : 0;
+}
+
+// Called once per MCU block with RGB888 pixels at the reduced size
+static uint32_t jpegOutput(JDEC* decoder, void* bitmap, JRECT* rect) {
+  JpegTarget* target = (JpegTarget*)decoder->device;
+  const uint8_t* rgb = (const uint8_t*)bitmap;
+  int blockWidth = rect->right - rect->left + 1;
+  for (int y = rect->top; y <= rect->bottom; y++) {
+    const uint8_t* src = rgb + (y - rect->top) * blockWidth * 3;
+    if (y >= target->height) {
+      break;
+    }
+    uint8_t* dst = target->gray + y * target->width;
+    for (int x = rect->left; x <= rect->right && x < target->width; x++, src += 3) {
+      dst[x] = (uint8_t)((77 * src[0] + 150 * src[1] + 29 * src[2] + 128) >> 8);
+    }
+  }
+  return 1;
+}
+
+uint8_t* decodeJpegToGray8(lgfx::DataWrapper* data, int boxWidth, int boxHeight, int& width, int& height) {
+  uint8_t* work = (uint8_t*)malloc(JPEG_DECODE_WORK_SIZE);
+  if (!work) {
+    return nullptr;
+  }
+
+  JDEC decoder;
+  JpegTarget target = {data, nullptr, 0, 0};
+  JRESULT result = jd_prepare(&decoder, jpegInput, work, JPEG_DECODE_WORK_SIZE, &target);
+  if (result != JDR_OK) {
+    // Progressive and arithmetic-coded files end up here (JDR_FMT3)
+    Serial.printf("[JPEG] Cannot decode (error %d)\n", result);
+    free(work);
+    return nullptr;
+  }
+
+  int fitWidth, fitHeight;
+  fitInside(decoder.width, decoder.height, boxWidth, boxHeight, fitWidth, fitHeight);
+  int scale = chooseJpegScale(decoder.width, decoder.height, fitWidth, fitHeight);
+  target.width = (decoder.width + (1 << scale) - 1) >> scale;
+  target.height = (decoder.height + (1 << scale) - 1) >> scale;
+  target.gray = (uint8_t*)heap_caps_malloc(target.width * target.height, MALLOC_CAP_SPIRAM);
+  if (!target.gray) {
+    free(work);
+    return nullptr;
+  }
+  memset(target.gray, 0xFF, target.width * target.height);
+
+  result = jd_decomp(&decoder, jpegOutput, scale);
+  free(work);
+  if (result != JDR_OK) {
+    Serial.printf("[JPEG] Decode failed (error %d)\n", result);
+    heap_caps_free(target.gray);
+    return nullptr;
+  }
+
+  fitInside(target.width, target.height, fitWidth, fitHeight, width, height);
+  if (width == target.width && height == target.height) {
+    return target.gray;
+  }
+
+  // Finish the ratio the power-of-two IDCT reduction could not cover
+  uint8_t* fitted = (uint8_t*)heap_caps_malloc(width * height, MALLOC_CAP_SPIRAM);
+  if (fitted && !downscaleAreaAverage(target.gray, target.width, target.height, fitted, width, height)) {
+    heap_caps_free(fitted);
+    fitted = nullptr;
+  }
+  heap_caps_free(target.gray);
+  return fitted;
+}
+
+bool drawJpegFromSd(const char* path, int x, int y, int boxWidth, int boxHeight, DitherMode mode) {
+  EnergyScope decode(ENERGY_DECODE);
+  uint32_t start = millis();
+  SdStream stream;
+  if (!stream.open(path)) {
+    return false;
+  }
+  int width, height;
+  uint8_t* gray = decodeJpegToGray8(&stream, boxWidth, boxHeight, width, height);
+  stream.close();
+  if (!gray) {
+    return false;
+  }
+
+  M5Canvas canvas;
+  canvas.setPsram(true);
+  canvas.setColorDepth(4);
+  uint8_t* levels = (uint8_t*)malloc(width);
+  int errLength = ditherErrorRowLength(width);
+  int16_t* errRows = (int16_t*)calloc(errLength * 2, sizeof(int16_t));
+  bool ok = levels && errRows && canvas.createSprite(width, height);
+
+  if (ok) {
+    // Palette index == gray level, so packed rows can be written directly
+    for (int i = 0; i < 16; i++) {
+      canvas.setPaletteColor(i, i * 17, i * 17, i * 17);
+    }
+    uint8_t* packed = (uint8_t*)canvas.getBuffer();
+    uint32_t stride = canvas.bufferLength() / height;
+    int16_t* errCurrent = errRows;
+    int16_t* errNext = errRows + errLength;
+    for (int row = 0; row < height; row++) {
+      const uint8_t* line = gray + row * width;
+      if (mode == DITHER_ORDERED) {
+        ditherOrderedRow_ref(line, levels, width, row);
+      } else if (mode == DITHER_DIFFUSION) {
+        ditherDiffusionRow_ref(line, levels, width, errCurrent, errNext);
+        int16_t* swap = errCurrent;
+        errCurrent = errNext;
+        errNext = swap;
+      } else {
+        quantizeGray4Row_ref(line, levels, width);
+      }
+      pack4bppRow(levels, packed + row * stride, width);
+    }
+
+    int drawX = boxWidth > 0 ? x + (boxWidth - width) / 2 : x;
+    int drawY = boxHeight > 0 ? y + (boxHeight - height) / 2 : y;
+    canvas.pushSprite(&imageDrawTarget(), drawX, drawY);
+    Serial.printf("[JPEG] %s -> %dx%d in %lu ms\n", path, width, height, millis() - start);
+  }
+
+  heap_caps_free(gray);
+  free(levels);
+  free(errRows);
+  return ok;
+}
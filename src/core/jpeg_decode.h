@@ -0,0 +1,28 @@
+#pragma once
+#include <Arduino.h>
+#include <M5GFX.h>
+#include "pixel_kernels.h"
+
+// Work area for the ROM TJpgDec decoder (needs ~3100 bytes)
+#define JPEG_DECODE_WORK_SIZE 4096
+
+// True for .jpg/.jpeg paths (case-insensitive)
+bool isJpegPath(const char* path);
+
+// Size of width x height fitted inside a box, keeping the aspect ratio.
+// Never enlarges; a box side of 0 means unbounded.
+void fitInside(int width, int height, int boxWidth, int boxHeight, int& fitWidth, int& fitHeight);
+
+// IDCT reduction (0 = 1/1 .. 3 = 1/8) giving the smallest decode that still
+// covers fitWidth x fitHeight
+int chooseJpegScale(int srcWidth, int srcHeight, int fitWidth, int fitHeight);
+
+// Decode a baseline JPEG to 8-bit gray fitted inside the box. The decoder
+// reduces by 1/2, 1/4 or 1/8 in the DCT domain and an area average covers
+// the remaining ratio. Returns a PSRAM buffer of width x height pixels
+// (free with heap_caps_free), or nullptr.
+uint8_t* decodeJpegToGray8(lgfx::DataWrapper* data, int boxWidth, int boxHeight, int& width, int& height);
+
+// Draw a JPEG from SD fitted and centered in the box, quantized to the
+// panel's gray levels with the given dithering
+bool drawJpegFromSd(const char* path, int x, int y, int boxWidth, int boxHeight, DitherMode mode = DITHER_ORDERED);
@@ -0,0 +1,189 @@
+#include "json_arena.h"
+#include <esp_heap_caps.h>
+
+// Blocks are aligned for any member ArduinoJson stores; each one is preceded
+// by its requested size (needed to copy it when it moves)
+#define JSON_ARENA_ALIGN 8
+#define JSON_ARENA_HEADER JSON_ARENA_ALIGN
+
+static const JsonArena* arenas[JSON_ARENA_MAX_ARENAS];
+static int arenaCount = 0;
+
+static size_t alignUp(size_t bytes) {
+  return (bytes + JSON_ARENA_ALIGN - 1) & ~(size_t)(JSON_ARENA_ALIGN - 1);
+}
+
+JsonArena::JsonArena(const char* name, size_t chunkSize)
+  : _name(name), _initialChunkSize(chunkSize), _chunkSize(chunkSize), _chunks(nullptr), _last(nullptr),
+    _used(0), _highWater(0), _reserved(0), _resets(0), _inPsram(true) {
+  // Nothing is allocated until the first document is loaded (also safe as a global)
+  if (arenaCount < JSON_ARENA_MAX_ARENAS) {
+    arenas[arenaCount++] = this;
+  }
+}
+
+JsonArena::Chunk* JsonArena::addChunk(size_t minSize) {
+  minSize = max(alignUp(minSize), (size_t)JSON_ARENA_MIN_CHUNK);
+  size_t size = max(_chunkSize, minSize);
+  size_t headerBytes = alignUp(sizeof(Chunk));
+  Chunk* chunk = (Chunk*)heap_caps_malloc(headerBytes + size, MALLOC_CAP_SPIRAM);
+  if (!chunk && size > minSize) {
+    // Fragmented PSRAM: just what this allocation needs
+    size = minSize;
+    chunk = (Chunk*)heap_caps_malloc(headerBytes + size, MALLOC_CAP_SPIRAM);
+  }
+  if (!chunk) {
+    chunk = (Chunk*)heap_caps_malloc(headerBytes + size, MALLOC_CAP_8BIT);
+    if (!chunk) {
+      Serial.printf("[Json] %s arena: out of memory for %u bytes\n", _name, (unsigned)size);
+      return nullptr;
+    }
+    if (_inPsram) {
+      Serial.printf("[Json] %s arena: no PSRAM, using internal RAM\n", _name);
+    }
+    _inPsram = false;
+  }
+  chunk->next = _chunks;
+  chunk->size = size;
+  chunk->top = 0;
+  _chunks = chunk;
+  _reserved += size;
+  return chunk;
+}
+
+void JsonArena::freeChunks() {
+  while (_chunks) {
+    Chunk* next = _chunks->next;
+    heap_caps_free(_chunks);
+    _chunks = next;
+  }
+  _reserved = 0;
+  _last = nullptr;
+}
+
+size_t JsonArena::blockSize(void* ptr) {
+  return *(size_t*)((uint8_t*)ptr - JSON_ARENA_HEADER);
+}
+
+void* JsonArena::allocate(size_t size) {
+  size_t need = JSON_ARENA_HEADER + alignUp(size);
+  Chunk* chunk = _chunks;
+  if (!chunk || chunk->size - chunk->top < need) {
+    // The rest of a full chunk stays unused until the next reset
+    chunk = addChunk(need);
+    if (!chunk) {
+      return nullptr;
+    }
+  }
+  uint8_t* block = (uint8_t*)chunk + alignUp(sizeof(Chunk)) + chunk->top + JSON_ARENA_HEADER;
+  *(size_t*)(block - JSON_ARENA_HEADER) = size;
+  chunk->top += need;
+  _used += need;
+  _highWater = max(_highWater, _used);
+  _last = block;
+  return block;
+}
+
+void JsonArena::deallocate(void* ptr) {
+  if (!ptr || ptr != _last) {
+    return;  // Reclaimed by reset()
+  }
+  size_t need = JSON_ARENA_HEADER + alignUp(blockSize(ptr));
+  _chunks->top -= need;
+  _used -= need;
+  _last = nullptr;
+}
+
+void* JsonArena::reallocate(void* ptr, size_t newSize) {
+  if (!ptr) {
+    return allocate(newSize);
+  }
+  size_t oldSize = blockSize(ptr);
+  if (ptr == _last) {
+    // Latest block (a string being parsed, the pool list): resize in place
+    size_t oldNeed = alignUp(oldSize);
+    size_t newNeed = alignUp(newSize);
+    if (_chunks->top - oldNeed + newNeed <= _chunks->size) {
+      _chunks->top = _chunks->top - oldNeed + newNeed;
+      _used = _used - oldNeed + newNeed;
+      _highWater = max(_highWater, _used);
+      *(size_t*)((uint8_t*)ptr - JSON_ARENA_HEADER) = newSize;
+      return ptr;
+    }
+    // Does not fit: it moves to a new chunk below. The old block stays
+    // allocated until the copy is made, and on failure ptr is left as it was
+  } else if (newSize <= oldSize) {
+    return ptr;  // Shrinking an older block: the tail is reclaimed by reset()
+  }
+  void* moved = allocate(newSize);
+  if (!moved) {
+    return nullptr;  // ptr, its chunk and the counters are untouched
+  }
+  // The old block is no longer the latest one, so its bytes are reclaimed by reset()
+  memcpy(moved, ptr, min(oldSize, newSize));
+  return moved;
+}
+
+void JsonArena::reset(JsonDocument& doc) {
+  doc.clear();
+  bool spilled = _chunks && _chunks->next;
+  bool oversized = _chunks && _chunks->size > _initialChunkSize && _used < _chunks->size / 4;
+  if (spilled || oversized) {
+    // One chunk for a load like the last one (a bigger card, another collection)
+    _chunkSize = max(_initialChunkSize, alignUp(_used + _used / 4));
+    freeChunks();
+  } else if (_chunks) {
+    _chunks->top = 0;
+  }
+  _used = 0;
+  _last = nullptr;
+  _resets++;
+}
+
+void JsonArena::printStats() const {
+  int chunks = 0;
+  for (Chunk* chunk = _chunks; chunk; chunk = chunk->next) {
+    chunks++;
+  }
+  Serial.printf("[Json] %s arena: %u KB in use, high water %u KB, %u KB reserved in %d chunk(s) (%s), %lu resets\n",
+                _name, (unsigned)(_used / 1024), (unsigned)(_highWater / 1024), (unsigned)(_reserved / 1024),
+                chunks, _inPsram ? "PSRAM" : "internal", (unsigned long)_resets);
+}
+
+int jsonArenaCount() {
+  return arenaCount;
+}
+
+const JsonArena* jsonArena(int index) {
+  return (index >= 0 && index < arenaCount) ? arenas[index] : nullptr;
+}
+
+void printJsonArenaStats() {
+  for (int i = 0; i < arenaCount; i++) {
+    arenas[i]->printStats();
+  }
+}
+
+// Documents edited in place free blocks piecemeal, so they use the regular
+// heap allocator, only in PSRAM (internal RAM when there is none)
+class PsramJsonAllocator : public ArduinoJson::Allocator {
+public:
+  void* allocate(size_t size) override {
+    void* ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    return ptr ? ptr : heap_caps_malloc(size, MALLOC_CAP_8BIT);
+  }
+
+  void deallocate(void* ptr) override {
+    heap_caps_free(ptr);
+  }
+
+  void* reallocate(void* ptr, size_t newSize) override {
+    void* moved = heap_caps_realloc(ptr, newSize, MALLOC_CAP_SPIRAM);
+    return moved ? moved : heap_caps_realloc(ptr, newSize, MALLOC_CAP_8BIT);
+  }
+};
+
+ArduinoJson::Allocator* psramJsonAllocator() {
+  static PsramJsonAllocator allocator;
+  return &allocator;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// First chunk of each arena; later ones are sized for the last load (see reset())
+#define JSON_ARENA_INDEX_CHUNK (64 * 1024)
+#define JSON_ARENA_CARD_CHUNK  (8 * 1024)
+
+// Smallest chunk added when the current one is full
+#define JSON_ARENA_MIN_CHUNK   1024
+
+#define JSON_ARENA_MAX_ARENAS  8
+
+// Bump allocator for ArduinoJson documents, served from PSRAM chunks.
+// Allocation moves a pointer; freeing only gives back the latest block, so
+// everything else is reclaimed at once by reset(). A document that is
+// reloaded wholesale (a card, the index) never fragments the heap and
+// keeps internal SRAM free for DMA buffers and stacks.
+class JsonArena : public ArduinoJson::Allocator {
+public:
+    JsonArena(const char* name, size_t chunkSize);
+
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t newSize) override;
+
+    // Clear the document and drop everything it allocated. When the last
+    // load spilled into more chunks, or used under a quarter of a grown
+    // one, the chunks are freed and the next one is sized for that load.
+    void reset(JsonDocument& doc);
+
+    const char* name() const { return _name; }
+    size_t used() const { return _used; }             // Bytes handed out since the last reset
+    size_t highWater() const { return _highWater; }   // Most ever in use
+    size_t reserved() const { return _reserved; }     // Chunk bytes held
+    uint32_t resets() const { return _resets; }
+    bool inPsram() const { return _inPsram; }
+
+    void printStats() const;
+
+private:
+    struct Chunk {
+        Chunk* next;
+        size_t size;       // Usable bytes after the header
+        size_t top;        // Bytes handed out
+    };
+
+    Chunk* addChunk(size_t minSize);
+    void freeChunks();
+    static size_t blockSize(void* ptr);
+
+    const char* _name;
+    size_t _initialChunkSize;
+    size_t _chunkSize;
+    Chunk* _chunks;        // Newest first; only the newest one is bumped
+    uint8_t* _last;        // Latest block, the one that can grow or be given back
+    size_t _used;
+    size_t _highWater;
+    size_t _reserved;
+    uint32_t _resets;
+    bool _inPsram;
+};
+
+// Plain PSRAM allocator for documents that are edited in place (config.json)
+ArduinoJson::Allocator* psramJsonAllocator();
+
+// Every arena, in construction order (logs and "ctl counters")
+int jsonArenaCount();
+const JsonArena* jsonArena(int index);
+void printJsonArenaStats();
@@ -0,0 +1,233 @@
+#include "page_router.h"
+#include "pixel_kernels.h"
+#include <M5Unified.h>
+#include <esp_heap_caps.h>
+#include <vector>
+
+RouterStats routerStats = {0, 0, 0, 0, 0};
+
+struct RouterEntry {
+  PageState state;
+  uint8_t* snapshot;      // PackBits stream of packed 4bpp rows, nullptr if none
+  uint32_t snapshotSize;
+  int width;
+  int height;
+};
+
+static std::vector<RouterEntry> pageStack;
+static RouterEntry popped = {PageState(), nullptr, 0, 0, 0};
+static uint32_t snapshotBudget = ROUTER_DEFAULT_SNAPSHOT_BUDGET;
+
+static void freeSnapshot(RouterEntry& entry) {
+  if (entry.snapshot) {
+    heap_caps_free(entry.snapshot);
+    routerStats.snapshotBytes -= entry.snapshotSize;
+    entry.snapshot = nullptr;
+    entry.snapshotSize = 0;
+  }
+}
+
+// PackBits: control n < 128 is followed by n + 1 literal bytes, n > 128 by one
+// byte repeated 257 - n times. UI pages are mostly long runs of white.
+static uint32_t packBits(const uint8_t* src, uint32_t length, uint8_t* dst) {
+  uint32_t in = 0;
+  uint32_t out = 0;
+  while (in < length) {
+    uint32_t run = 1;
+    while (in + run < length && run < 128 && src[in + run] == src[in]) {
+      run++;
+    }
+    if (run >= 3) {
+      dst[out++] = (uint8_t)(257 - run);
+      dst[out++] = src[in];
+      in += run;
+      continue;
+    }
+    // Literal stretch up to the next run of three
+    uint32_t start = in;
+    while (in < length && in - start < 128) {
+      if (in + 2 < length && src[in] == src[in + 1] && src[in] == src[in + 2]) {
+        break;
+      }
+      in++;
+    }
+    dst[out++] = (uint8_t)(in - start - 1);
+    memcpy(dst + out, src + start, in - start);
+    out += in - start;
+  }
+  return out;
+}
+
+static bool unpackBits(const uint8_t* src, uint32_t length, uint8_t* dst, uint32_t dstLength) {
+  uint32_t in = 0;
+  uint32_t out = 0;
+  while (in < length) {
+    uint8_t control = src[in++];
+    if (control < 128) {
+      uint32_t count = control + 1;
+      if (in + count > length || out + count > dstLength) {
+        return false;
+      }
+      memcpy(dst + out, src + in, count);
+      in += count;
+      out += count;
+    } else if (control > 128) {
+      uint32_t count = 257 - control;
+      if (in >= length || out + count > dstLength) {
+        return false;
+      }
+      memset(dst + out, src[in++], count);
+      out += count;
+    }
+  }
+  return out == dstLength;
+}
+
+// Drop the oldest snapshots until all of them fit the budget
+static void enforceBudget() {
+  for (RouterEntry& entry : pageStack) {
+    if (routerStats.snapshotBytes <= snapshotBudget) {
+      break;
+    }
+    if (entry.snapshot) {
+      freeSnapshot(entry);
+      routerStats.evictions++;
+    }
+  }
+}
+
+// Read the current screen back from the display as packed gray levels, then compress
+static bool captureScreen(RouterEntry& entry) {
+  uint32_t start = millis();
+  int width = M5.Display.width();
+  int height = M5.Display.height();
+  int rowBytes = (width + 1) / 2;
+  uint32_t rawLength = (uint32_t)rowBytes * height;
+
+  uint8_t* raw = (uint8_t*)heap_caps_malloc(rawLength, MALLOC_CAP_SPIRAM);
+  uint8_t* rgbRow = (uint8_t*)malloc(width * 3);
+  uint8_t* packed = (uint8_t*)heap_caps_malloc(rawLength + rawLength / 128 + 1, MALLOC_CAP_SPIRAM);
+  if (!raw || !rgbRow || !packed) {
+    heap_caps_free(raw);
+    free(rgbRow);
+    heap_caps_free(packed);
+    return false;
+  }
+
+  // The panel only holds the 16 gray levels, so quantizing is exact
+  for (int row = 0; row < height; row++) {
+    M5.Display.readRectRGB(0, row, width, 1, rgbRow);
+    rgb888ToGray4Row(rgbRow, raw + row * rowBytes, width, row, DITHER_NONE, nullptr, nullptr);
+  }
+  free(rgbRow);
+
+  uint32_t size = packBits(raw, rawLength, packed);
+  heap_caps_free(raw);
+  if (size > snapshotBudget) {
+    heap_caps_free(packed);
+    return false;
+  }
+  uint8_t* shrunk = (uint8_t*)heap_caps_realloc(packed, size, MALLOC_CAP_SPIRAM);
+
+  entry.snapshot = shrunk ? shrunk : packed;
+  entry.snapshotSize = size;
+  entry.width = width;
+  entry.height = height;
+  routerStats.snapshots++;
+  routerStats.snapshotBytes += size;
+  Serial.printf("[Router] Snapshot %lu KB (%lu%% of raw) in %lu ms\n", (unsigned long)(size / 1024),
+                (unsigned long)(size * 100 / rawLength), millis() - start);
+  return true;
+}
+
+void setSnapshotBudget(uint32_t bytes) {
+  snapshotBudget = bytes;
+  enforceBudget();
+}
+
+void routerPush(const PageState& state, bool snapshot) {
+  if (pageStack.size() >= ROUTER_MAX_DEPTH) {
+    freeSnapshot(pageStack.front());
+    pageStack.erase(pageStack.begin());
+  }
+
+  RouterEntry entry = {state, nullptr, 0, 0, 0};
+  if (snapshot && snapshotBudget > 0) {
+    captureScreen(entry);
+  }
+  pageStack.push_back(entry);
+  enforceBudget();
+}
+
+bool routerPop(PageState& state) {
+  freeSnapshot(popped);
+  if (pageStack.empty()) {
+    return false;
+  }
+  popped = pageStack.back();
+  pageStack.pop_back();
+  state = popped.state;
+  return true;
+}
+
+bool routerShowPoppedSnapshot() {
+  if (!popped.snapshot || popped.width != M5.Display.width() || popped.height != M5.Display.height()) {
+    freeSnapshot(popped);
+    routerStats.redraws++;
+    return false;
+  }
+
+  uint32_t start = millis();
+  M5Canvas canvas;
+  canvas.setPsram(true);
+  canvas.setColorDepth(4);
+  bool ok = canvas.createSprite(popped.width, popped.height);
+  if (ok) {
+    // Palette index == gray level, so the rows unpack straight into the sprite
+    for (int i = 0; i < 16; i++) {
+      canvas.setPaletteColor(i, i * 17, i * 17, i * 17);
+    }
+    int rowBytes = (popped.width + 1) / 2;
+    uint8_t* buffer = (uint8_t*)canvas.getBuffer();
+    uint32_t stride = canvas.bufferLength() / popped.height;
+    if (stride == (uint32_t)rowBytes) {
+      ok = unpackBits(popped.snapshot, popped.snapshotSize, buffer, (uint32_t)rowBytes * popped.height);
+    } else {
+      uint8_t* raw = (uint8_t*)heap_caps_malloc((uint32_t)rowBytes * popped.height, MALLOC_CAP_SPIRAM);
+      ok = raw && unpackBits(popped.snapshot, popped.snapshotSize, raw, (uint32_t)rowBytes * popped.height);
+      for (int row = 0; ok && row < popped.height; row++) {
+        memcpy(buffer + row * stride, raw + row * rowBytes, rowBytes);
+      }
+      heap_caps_free(raw);
+    }
+  }
+  freeSnapshot(popped);
+  if (!ok) {
+    routerStats.redraws++;
+    return false;
+  }
+
+  canvas.pushSprite(&M5.Display, 0, 0);
+  routerStats.restores++;
+  Serial.printf("[Router] Restored snapshot in %lu ms\n", millis() - start);
+  return true;
+}
+
+void routerClear() {
+  for (RouterEntry& entry : pageStack) {
+    freeSnapshot(entry);
+  }
+  pageStack.clear();
+  freeSnapshot(popped);
+}
+
+int routerDepth() {
+  return pageStack.size();
+}
+
+void printRouterStats(const char* label) {
+  Serial.printf("[Router] %s: depth %d, %lu snapshots (%lu KB held), %lu restores, %lu redraws, %lu evictions\n",
+                label, (int)pageStack.size(), (unsigned long)routerStats.snapshots,
+                (unsigned long)(routerStats.snapshotBytes / 1024), (unsigned long)routerStats.restores,
+                (unsigned long)routerStats.redraws, (unsigned long)routerStats.evictions);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <Arduino.h>
+
+// Pages kept below the current one (the oldest is dropped beyond this)
+#define ROUTER_MAX_DEPTH 8
+
+// Default PSRAM budget for all page snapshots together
+#define ROUTER_DEFAULT_SNAPSHOT_BUDGET (1536 * 1024)
+
+// What a page needs to be shown again exactly as it was left
+struct PageState {
+  int mode;             // PageMode in main.cpp
+  int page;             // Grid or category list page
+  int pageCount;        // Grid pages for the category filter
+  bool randomMode;
+  String category;
+};
+
+struct RouterStats {
+  uint32_t snapshots;      // Screens captured
+  uint32_t restores;       // Back navigations served by a blit
+  uint32_t redraws;        // Back navigations that had no snapshot left
+  uint32_t evictions;      // Snapshots dropped for the budget
+  uint32_t snapshotBytes;  // Compressed bytes held now
+};
+
+extern RouterStats routerStats;
+
+// PSRAM available to snapshots; lowering it evicts the oldest ones
+void setSnapshotBudget(uint32_t bytes);
+
+// Remember the page being left. With snapshot set, the screen is captured
+// (4bpp, PackBits-compressed) so going back is a single blit.
+void routerPush(const PageState& state, bool snapshot = true);
+
+// Take the previous page off the stack; false when there is none
+bool routerPop(PageState& state);
+
+// Blit the snapshot of the page last popped (released afterwards).
+// Returns false when it had none; the caller redraws the page instead.
+bool routerShowPoppedSnapshot();
+
+// Forget all pages (index reloaded, collection switched)
+void routerClear();
+
+int routerDepth();
+
+void printRouterStats(const char* label);
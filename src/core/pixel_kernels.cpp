@@ -0,0 +1,259 @@
+#include "pixel_kernels.h"
+#include <string.h>
+
+// 4x4 Bayer matrix, thresholds pre-scaled to 8..248 (B * 16 + 8)
+static const uint8_t BAYER_4X4[4][4] = {
+  {   8, 136,  40, 168 },
+  { 200,  72, 232, 104 },
+  {  56, 184,  24, 152 },
+  { 248, 120, 216,  88 }
+};
+
+// Luma with weights summing to 256 (BT.601), rounded
+static inline uint8_t luma(uint8_t r, uint8_t g, uint8_t b) {
+  return (uint8_t)((77 * r + 150 * g + 29 * b + 128) >> 8);
+}
+
+// Scale 0..255 to 0..3840 so that (v + threshold) >> 8 lands on 0..15 with white staying 15
+static inline uint16_t scaleForOrdered(uint8_t v) {
+  return (uint16_t)((v * 3856) >> 8);
+}
+
+// Nearest 4-bit level for an 8-bit value
+static inline uint8_t nearestLevel(int v) {
+  return (uint8_t)((v * 15 + 127) / 255);
+}
+
+static inline int clamp255(int v) {
+  return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+// ---------------------------------------------------------------------------
+// Scalar reference kernels
+
+void rgb888ToGray8Row_ref(const uint8_t* rgb, uint8_t* gray8, int width) {
+  for (int x = 0; x < width; x++) {
+    gray8[x] = luma(rgb[3 * x], rgb[3 * x + 1], rgb[3 * x + 2]);
+  }
+}
+
+void quantizeGray4Row_ref(const uint8_t* gray8, uint8_t* gray4, int width) {
+  for (int x = 0; x < width; x++) {
+    gray4[x] = nearestLevel(gray8[x]);
+  }
+}
+
+void ditherOrderedRow_ref(const uint8_t* gray8, uint8_t* gray4, int width, int y) {
+  for (int x = 0; x < width; x++) {
+    int q = (scaleForOrdered(gray8[x]) + BAYER_4X4[y & 3][x & 3]) >> 8;
+    gray4[x] = (uint8_t)(q > 15 ? 15 : q);
+  }
+}
+
+// Errors are stored in 1/16 units at index x + 1; errCurrent is cleared on return
+void ditherDiffusionRow_ref(const uint8_t* gray8, uint8_t* gray4, int width, int16_t* errCurrent, int16_t* errNext) {
+  for (int x = 0; x < width; x++) {
+    int value = clamp255(gray8[x] + ((errCurrent[x + 1] + 8) >> 4));
+    uint8_t level = nearestLevel(value);
+    int error = value - level * 17;
+
+    gray4[x] = level;
+    errCurrent[x + 2] += error * 7;
+    errNext[x]        += error * 3;
+    errNext[x + 1]    += error * 5;
+    errNext[x + 2]    += error;
+  }
+  memset(errCurrent, 0, ditherErrorRowLength(width) * sizeof(int16_t));
+}
+
+void pack4bppRow_ref(const uint8_t* gray4, uint8_t* packed, int width) {
+  for (int x = 0; x < width; x += 2) {
+    uint8_t hi = gray4[x];
+    uint8_t lo = (x + 1 < width) ? gray4[x + 1] : 0;
+    packed[x / 2] = (uint8_t)((hi << 4) | lo);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Fast kernels
+//
+// The PIE 128-bit vector unit of the ESP32-S3 is not exposed by the Arduino
+// toolchain without hand-written assembly, so the fast path relies on fused
+// single-pass kernels, lookup tables and 32-bit SWAR packing instead. The
+// results are bit-exact with the reference above.
+
+static uint16_t orderedScaleLut[256];
+static uint8_t nearestLut[256];
+static bool lutsReady = false;
+
+static void buildLuts() {
+  for (int v = 0; v < 256; v++) {
+    orderedScaleLut[v] = scaleForOrdered(v);
+    nearestLut[v] = nearestLevel(v);
+  }
+  lutsReady = true;
+}
+
+void pack4bppRow(const uint8_t* gray4, uint8_t* packed, int width) {
+  int x = 0;
+  // Eight pixels per iteration: two 32-bit loads, one 32-bit store
+  for (; x + 8 <= width; x += 8) {
+    uint32_t a, b;
+    memcpy(&a, gray4 + x, 4);
+    memcpy(&b, gray4 + x + 4, 4);
+    // Little-endian lanes: byte0 = p0 << 4 | p1, byte2 = p2 << 4 | p3
+    uint32_t ta = ((a & 0x000F000F) << 4) | ((a >> 8) & 0x000F000F);
+    uint32_t tb = ((b & 0x000F000F) << 4) | ((b >> 8) & 0x000F000F);
+    uint32_t out = (ta & 0xFF) | ((ta >> 8) & 0xFF00) | ((tb & 0xFF) << 16) | ((tb << 8) & 0xFF000000);
+    memcpy(packed + x / 2, &out, 4);
+  }
+  for (; x < width; x += 2) {
+    uint8_t hi = gray4[x];
+    uint8_t lo = (x + 1 < width) ? gray4[x + 1] : 0;
+    packed[x / 2] = (uint8_t)((hi << 4) | lo);
+  }
+}
+
+void rgb888ToGray4Row(const uint8_t* rgb, uint8_t* packed, int width, int y, DitherMode mode,
+                      int16_t* errCurrent, int16_t* errNext) {
+  if (!lutsReady) {
+    buildLuts();
+  }
+
+  const uint8_t* thresholds = BAYER_4X4[y & 3];
+  uint8_t pending = 0;
+
+  for (int x = 0; x < width; x++, rgb += 3) {
+    uint8_t gray = luma(rgb[0], rgb[1], rgb[2]);
+    uint8_t level;
+
+    if (mode == DITHER_ORDERED) {
+      int q = (orderedScaleLut[gray] + thresholds[x & 3]) >> 8;
+      level = (uint8_t)(q > 15 ? 15 : q);
+    } else if (mode == DITHER_DIFFUSION) {
+      int value = clamp255(gray + ((errCurrent[x + 1] + 8) >> 4));
+      level = nearestLut[value];
+      int error = value - level * 17;
+      errCurrent[x + 2] += error * 7;
+      errNext[x]        += error * 3;
+      errNext[x + 1]    += error * 5;
+      errNext[x + 2]    += error;
+    } else {
+      level = nearestLut[gray];
+    }
+
+    // Pack on the fly, no intermediate gray row
+    if (x & 1) {
+      packed[x >> 1] = (uint8_t)((pending << 4) | level);
+    } else {
+      pending = level;
+    }
+  }
+  if (width & 1) {
+    packed[width >> 1] = (uint8_t)(pending << 4);
+  }
+
+  if (mode == DITHER_DIFFUSION) {
+    memset(errCurrent, 0, ditherErrorRowLength(width) * sizeof(int16_t));
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Verification and benchmark (device only)
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+bool runPixelKernelBenchmark() {
+  const int width = 400;
+  const int height = 64;
+  const int rowBytes = (width + 1) / 2;
+  const int errLen = ditherErrorRowLength(width);
+
+  uint8_t* rgb = (uint8_t*)heap_caps_malloc(width * height * 3, MALLOC_CAP_8BIT);
+  uint8_t* gray8 = (uint8_t*)malloc(width);
+  uint8_t* gray4 = (uint8_t*)malloc(width);
+  uint8_t* expected = (uint8_t*)malloc(rowBytes);
+  uint8_t* actual = (uint8_t*)malloc(rowBytes);
+  int16_t* err = (int16_t*)calloc(errLen * 4, sizeof(int16_t));
+  if (!rgb || !gray8 || !gray4 || !expected || !actual || !err) {
+    Serial.println("[Pixel] Benchmark allocation failed");
+    heap_caps_free(rgb); free(gray8); free(gray4); free(expected); free(actual); free(err);
+    return false;
+  }
+
+  // Gradient with noise: exercises every level and the diffusion clamps
+  for (int i = 0; i < width * height * 3; i++) {
+    rgb[i] = (uint8_t)((i / 3) % width * 255 / width + random(-24, 24));
+  }
+
+  const char* names[] = { "none", "ordered", "diffusion" };
+  bool allExact = true;
+
+  for (int m = DITHER_NONE; m <= DITHER_DIFFUSION; m++) {
+    DitherMode mode = (DitherMode)m;
+    int16_t* refCur = err;
+    int16_t* refNext = err + errLen;
+    int16_t* fastCur = err + 2 * errLen;
+    int16_t* fastNext = err + 3 * errLen;
+    memset(err, 0, errLen * 4 * sizeof(int16_t));
+
+    uint32_t refCycles = 0;
+    uint32_t fastCycles = 0;
+    bool exact = true;
+
+    for (int y = 0; y < height; y++) {
+      const uint8_t* row = rgb + y * width * 3;
+
+      uint32_t start = ESP.getCycleCount();
+      rgb888ToGray8Row_ref(row, gray8, width);
+      if (mode == DITHER_ORDERED) {
+        ditherOrderedRow_ref(gray8, gray4, width, y);
+      } else if (mode == DITHER_DIFFUSION) {
+        ditherDiffusionRow_ref(gray8, gray4, width, refCur, refNext);
+      } else {
+        quantizeGray4Row_ref(gray8, gray4, width);
+      }
+      pack4bppRow_ref(gray4, expected, width);
+      refCycles += ESP.getCycleCount() - start;
+
+      start = ESP.getCycleCount();
+      rgb888ToGray4Row(row, actual, width, y, mode, fastCur, fastNext);
+      fastCycles += ESP.getCycleCount() - start;
+
+      if (memcmp(expected, actual, rowBytes) != 0) {
+        exact = false;
+      }
+
+      int16_t* swap = refCur; refCur = refNext; refNext = swap;
+      swap = fastCur; fastCur = fastNext; fastNext = swap;
+    }
+
+    uint32_t pixels = width * height;
+    Serial.printf("[Pixel] %-9s ref %.2f cyc/px, fast %.2f cyc/px, %s\n", names[m],
+                  (float)refCycles / pixels, (float)fastCycles / pixels,
+                  exact ? "bit-exact" : "MISMATCH");
+    allExact = allExact && exact;
+  }
+
+  // Packing kernel on its own
+  for (int x = 0; x < width; x++) {
+    gray4[x] = random(16);
+  }
+  uint32_t start = ESP.getCycleCount();
+  pack4bppRow_ref(gray4, expected, width);
+  uint32_t refCycles = ESP.getCycleCount() - start;
+  start = ESP.getCycleCount();
+  pack4bppRow(gray4, actual, width);
+  uint32_t fastCycles = ESP.getCycleCount() - start;
+  bool packExact = memcmp(expected, actual, rowBytes) == 0;
+  Serial.printf("[Pixel] pack4bpp  ref %.2f cyc/px, fast %.2f cyc/px, %s\n",
+                (float)refCycles / width, (float)fastCycles / width,
+                packExact ? "bit-exact" : "MISMATCH");
+  allExact = allExact && packExact;
+
+  heap_caps_free(rgb); free(gray8); free(gray4); free(expected); free(actual); free(err);
+  return allExact;
+}
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+
+// Gray levels are 4-bit: 0 = black, 15 = white.
+// Packed rows hold two pixels per byte, leftmost pixel in the high nibble.
+
+enum DitherMode {
+    DITHER_NONE,       // Nearest level
+    DITHER_ORDERED,    // 4x4 Bayer threshold
+    DITHER_DIFFUSION   // Floyd-Steinberg error diffusion
+};
+
+// Scalar reference kernels (portable, used for verification)
+void rgb888ToGray8Row_ref(const uint8_t* rgb, uint8_t* gray8, int width);
+void quantizeGray4Row_ref(const uint8_t* gray8, uint8_t* gray4, int width);
+void ditherOrderedRow_ref(const uint8_t* gray8, uint8_t* gray4, int width, int y);
+void ditherDiffusionRow_ref(const uint8_t* gray8, uint8_t* gray4, int width, int16_t* errCurrent, int16_t* errNext);
+void pack4bppRow_ref(const uint8_t* gray4, uint8_t* packed, int width);
+
+// Fused fast kernels: RGB888 row -> packed 4bpp row in one pass.
+// Bit-exact with the reference kernels chained together.
+void rgb888ToGray4Row(const uint8_t* rgb, uint8_t* packed, int width, int y, DitherMode mode,
+                      int16_t* errCurrent, int16_t* errNext);
+void pack4bppRow(const uint8_t* gray4, uint8_t* packed, int width);
+
+// Error rows for diffusion need width + 2 entries (one guard on each side)
+inline int ditherErrorRowLength(int width) { return width + 2; }
+
+// Compare fast kernels against the reference and report cycles per pixel
+bool runPixelKernelBenchmark();
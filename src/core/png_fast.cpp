@@ -0,0 +1,208 @@
+#include "png_fast.h"
+#include "pixel_kernels.h"
+#include "sd_stream.h"
+#include "deck.h"
+#include "energy.h"
+#include <M5Unified.h>
+#include <SD.h>
+#include <vector>
+#include <esp_heap_caps.h>
+
+PngFastStats pngFastStats = {0, 0, 0, 0};
+
+void printPngFastStats(const char* label) {
+  float megapixels = pngFastStats.fastMicros ? (float)pngFastStats.fastPixels / pngFastStats.fastMicros : 0;
+  Serial.printf("[PNG] %s: %u fast, %u generic, %.2f Mpx/s fast\n", label, pngFastStats.fastDecodes,
+                pngFastStats.fallbacks, megapixels);
+}
+
+// M5GFX data source (SdStream, memory) as a source for the portable decoder
+class DataWrapperSource : public PngSource {
+public:
+  explicit DataWrapperSource(lgfx::DataWrapper* data) : _data(data) {}
+  int read(uint8_t* buf, uint32_t len) override { return _data->read(buf, len); }
+  void skip(int32_t offset) override { _data->skip(offset); }
+
+private:
+  lgfx::DataWrapper* _data;
+};
+
+bool readPngInfo(lgfx::DataWrapper* data, PngFastInfo& info) {
+  DataWrapperSource source(data);
+  return readPngInfo(source, info);
+}
+
+PngFastStatus decodePngToGray4(lgfx::DataWrapper* data, uint8_t* packed, int rowBytes, int width, int height) {
+  DataWrapperSource source(data);
+  return decodePngToGray4(source, packed, rowBytes, width, height);
+}
+
+bool drawPngFast(lgfx::DataWrapper* data, LovyanGFX& target, int x, int y, int maxWidth, int maxHeight) {
+  EnergyScope decode(ENERGY_DECODE);
+  uint32_t start = micros();
+  PngFastInfo info;
+  bool eligible = readPngInfo(data, info) && pngFastPathEligible(info);
+  data->seek(0);
+
+  if (eligible) {
+    int width = min(info.width, (int)target.width() - x);
+    int height = min(info.height, (int)target.height() - y);
+    if (maxWidth > 0) {
+      width = min(width, maxWidth);
+    }
+    if (maxHeight > 0) {
+      height = min(height, maxHeight);
+    }
+    if (width <= 0 || height <= 0) {
+      return true;
+    }
+
+    M5Canvas canvas;
+    canvas.setPsram(true);
+    canvas.setColorDepth(4);
+    if (canvas.createSprite(width, height)) {
+      // Palette index == gray level, so decoded rows land in the sprite as-is
+      for (int i = 0; i < 16; i++) {
+        canvas.setPaletteColor(i, i * 17, i * 17, i * 17);
+      }
+      uint8_t* buffer = (uint8_t*)canvas.getBuffer();
+      uint32_t stride = canvas.bufferLength() / height;
+      PngFastStatus status = decodePngToGray4(data, buffer, stride, width, height);
+      if (status == PNG_FAST_OK) {
+        canvas.pushSprite(&target, x, y);
+        pngFastStats.fastDecodes++;
+        pngFastStats.fastMicros += micros() - start;
+        pngFastStats.fastPixels += width * height;
+        return true;
+      }
+      canvas.deleteSprite();
+      data->seek(0);
+    }
+  }
+
+  pngFastStats.fallbacks++;
+  return target.drawPng(data, x, y, maxWidth, maxHeight);
+}
+
+// ---------------------------------------------------------------------------
+// Verification and benchmark
+
+#define PNG_BENCHMARK_MAX_FILES 32
+
+static void collectPngFiles(const String& directory, std::vector<String>& paths, int depth) {
+  File dir = SD.open(directory);
+  if (!dir) {
+    return;
+  }
+  File entry;
+  while (paths.size() < PNG_BENCHMARK_MAX_FILES && (entry = dir.openNextFile())) {
+    String name = entry.name();
+    String path = directory + "/" + name.substring(name.lastIndexOf('/') + 1);
+    bool isDirectory = entry.isDirectory();
+    entry.close();
+    if (isDirectory) {
+      if (depth > 0 && !path.endsWith("/.cache")) {
+        collectPngFiles(path, paths, depth - 1);
+      }
+    } else if (path.endsWith(".png") || path.endsWith(".PNG")) {
+      paths.push_back(path);
+    }
+  }
+  dir.close();
+}
+
+// Reference: M5GFX decode to RGB888, then the scalar gray quantizer
+static bool decodeReference(const String& path, int width, int height, uint8_t* packed, int rowBytes) {
+  M5Canvas canvas;
+  canvas.setPsram(true);
+  canvas.setColorDepth(lgfx::rgb888_3Byte);
+  uint8_t* rgbRow = (uint8_t*)malloc(width * 3);
+  uint8_t* gray8 = (uint8_t*)malloc(width);
+  uint8_t* gray4 = (uint8_t*)malloc(width + 1);
+  SdStream stream;
+  bool ok = rgbRow && gray8 && gray4 && canvas.createSprite(width, height) && stream.open(path.c_str());
+  if (ok) {
+    canvas.fillScreen(TFT_WHITE);
+    ok = canvas.drawPng(&stream, 0, 0);
+    stream.close();
+  }
+  for (int row = 0; ok && row < height; row++) {
+    canvas.readRectRGB(0, row, width, 1, rgbRow);
+    rgb888ToGray8Row_ref(rgbRow, gray8, width);
+    quantizeGray4Row_ref(gray8, gray4, width);
+    gray4[width] = 15;  // Odd widths pad with white, as the fast path does
+    pack4bppRow_ref(gray4, packed + row * rowBytes, width + (width & 1));
+  }
+  free(rgbRow);
+  free(gray8);
+  free(gray4);
+  return ok;
+}
+
+bool runPngFastPathBenchmark() {
+  std::vector<String> paths;
+  collectPngFiles(getDeckRoot(), paths, 1);
+
+  bool allExact = true;
+  uint32_t fastMicros = 0;
+  uint32_t referenceMicros = 0;
+  uint32_t pixels = 0;
+
+  for (const String& path : paths) {
+    SdStream stream;
+    PngFastInfo info;
+    if (!stream.open(path.c_str()) || !readPngInfo(&stream, info)) {
+      continue;
+    }
+    if (!pngFastPathEligible(info)) {
+      Serial.printf("[PNG] %s: type %d/%d-bit%s, generic only\n", path.c_str(), info.colorType, info.bitDepth,
+                    info.interlaced ? " interlaced" : "");
+      continue;
+    }
+
+    int rowBytes = (info.width + 1) / 2;
+    uint8_t* actual = (uint8_t*)heap_caps_malloc(rowBytes * info.height, MALLOC_CAP_SPIRAM);
+    uint8_t* expected = (uint8_t*)heap_caps_malloc(rowBytes * info.height, MALLOC_CAP_SPIRAM);
+    if (!actual || !expected) {
+      heap_caps_free(actual);
+      heap_caps_free(expected);
+      continue;
+    }
+
+    stream.seek(0);
+    uint32_t start = micros();
+    PngFastStatus status = decodePngToGray4(&stream, actual, rowBytes, info.width, info.height);
+    uint32_t fastTime = micros() - start;
+    stream.close();
+
+    start = micros();
+    bool referenceOk = decodeReference(path, info.width, info.height, expected, rowBytes);
+    uint32_t referenceTime = micros() - start;
+
+    int differing = 0;
+    for (int i = 0; i < rowBytes * info.height; i++) {
+      differing += (actual[i] & 0xF0) != (expected[i] & 0xF0);
+      differing += (actual[i] & 0x0F) != (expected[i] & 0x0F);
+    }
+    bool exact = status == PNG_FAST_OK && referenceOk && differing == 0;
+    Serial.printf("[PNG] %s: %dx%d type %d/%d-bit, fast %.1f ms, generic %.1f ms, %s", path.c_str(), info.width,
+                  info.height, info.colorType, info.bitDepth, fastTime / 1000.0f, referenceTime / 1000.0f,
+                  exact ? "bit-exact\n" : "MISMATCH");
+    if (!exact) {
+      Serial.printf(" (%d px differ, status %d)\n", differing, status);
+    }
+
+    allExact = allExact && exact;
+    fastMicros += fastTime;
+    referenceMicros += referenceTime;
+    pixels += info.width * info.height;
+    heap_caps_free(actual);
+    heap_caps_free(expected);
+  }
+
+  if (pixels > 0) {
+    Serial.printf("[PNG] Fast path %.2f Mpx/s, generic %.2f Mpx/s over %u px\n", (float)pixels / fastMicros,
+                  (float)pixels / referenceMicros, pixels);
+  }
+  return allExact;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <Arduino.h>
+#include <M5GFX.h>
+#include "png_gray4.h"
+
+// Decodes taken by each path since boot
+struct PngFastStats {
+    uint32_t fastDecodes;
+    uint32_t fallbacks;
+    uint32_t fastMicros;   // Total time spent in the fast path
+    uint32_t fastPixels;
+};
+
+extern PngFastStats pngFastStats;
+
+void printPngFastStats(const char* label);
+
+// readPngInfo and decodePngToGray4 (png_gray4.h) on an M5GFX data source
+bool readPngInfo(lgfx::DataWrapper* data, PngFastInfo& info);
+PngFastStatus decodePngToGray4(lgfx::DataWrapper* data, uint8_t* packed, int rowBytes, int width, int height);
+
+// Draw a PNG at 1:1: through the 4bpp fast path when eligible, otherwise
+// with M5GFX's generic decoder. maxWidth/maxHeight clip like drawPng().
+bool drawPngFast(lgfx::DataWrapper* data, LovyanGFX& target, int x, int y, int maxWidth = 0, int maxHeight = 0);
+
+// Compare the fast path against M5GFX decodes of the collection's PNGs
+// and report throughput of both
+bool runPngFastPathBenchmark();
@@ -0,0 +1,380 @@
+#include "png_gray4.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <esp32s3/rom/miniz.h>
+#else
+#include <zlib.h>
+#endif
+
+// Compressed bytes handed to the inflater per read
+#define PNG_FAST_INPUT_SIZE 4096
+
+static const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+static uint32_t readBigEndian32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static bool readExact(PngSource& source, uint8_t* buf, uint32_t len) {
+  return source.read(buf, len) == (int)len;
+}
+
+bool readPngInfo(PngSource& source, PngFastInfo& info) {
+  uint8_t header[8 + 8 + 13 + 4];
+  if (!readExact(source, header, sizeof(header)) || memcmp(header, PNG_SIGNATURE, 8) != 0 ||
+      readBigEndian32(header + 8) != 13 || memcmp(header + 12, "IHDR", 4) != 0) {
+    return false;
+  }
+  const uint8_t* ihdr = header + 16;
+  info.width = readBigEndian32(ihdr);
+  info.height = readBigEndian32(ihdr + 4);
+  info.bitDepth = ihdr[8];
+  info.colorType = ihdr[9];
+  info.interlaced = ihdr[12] != 0;
+  return info.width > 0 && info.height > 0;
+}
+
+bool pngFastPathEligible(const PngFastInfo& info) {
+  if (info.interlaced) {
+    return false;
+  }
+  if (info.colorType == 0) {
+    return info.bitDepth == 1 || info.bitDepth == 2 || info.bitDepth == 4 || info.bitDepth == 8 || info.bitDepth == 16;
+  }
+  if (info.colorType == 3) {
+    return info.bitDepth == 1 || info.bitDepth == 2 || info.bitDepth == 4 || info.bitDepth == 8;
+  }
+  return false;
+}
+
+// Same luma and rounding as the pixel kernels, so results match the generic path + quantization
+static inline uint8_t grayLevel(uint8_t r, uint8_t g, uint8_t b) {
+  uint8_t gray = (uint8_t)((77 * r + 150 * g + 29 * b + 128) >> 8);
+  return (uint8_t)((gray * 15 + 127) / 255);
+}
+
+static inline uint8_t paethPredictor(int a, int b, int c) {
+  int p = a + b - c;
+  int pa = abs(p - a);
+  int pb = abs(p - b);
+  int pc = abs(p - c);
+  if (pa <= pb && pa <= pc) {
+    return a;
+  }
+  return pb <= pc ? b : c;
+}
+
+// Undo the scanline filter in place; bpp is the filter's byte distance (1 or 2 here)
+static bool unfilterRow(uint8_t filter, uint8_t* row, const uint8_t* previous, int length, int bpp) {
+  switch (filter) {
+    case 0:
+      return true;
+    case 1:
+      for (int i = bpp; i < length; i++) {
+        row[i] += row[i - bpp];
+      }
+      return true;
+    case 2:
+      for (int i = 0; i < length; i++) {
+        row[i] += previous[i];
+      }
+      return true;
+    case 3:
+      for (int i = 0; i < length; i++) {
+        int left = i >= bpp ? row[i - bpp] : 0;
+        row[i] += (uint8_t)((left + previous[i]) >> 1);
+      }
+      return true;
+    case 4:
+      for (int i = 0; i < length; i++) {
+        int left = i >= bpp ? row[i - bpp] : 0;
+        int upperLeft = i >= bpp ? previous[i - bpp] : 0;
+        row[i] += paethPredictor(left, previous[i], upperLeft);
+      }
+      return true;
+  }
+  return false;
+}
+
+// Map one unfiltered scanline to packed gray levels through the sample -> level table
+static void convertRow(const uint8_t* row, int bitDepth, const uint8_t* levels, uint8_t* packed, int width) {
+  uint8_t pending = 0;
+  for (int x = 0; x < width; x++) {
+    uint8_t sample;
+    if (bitDepth == 8) {
+      sample = row[x];
+    } else if (bitDepth == 16) {
+      sample = row[x * 2];   // High byte
+    } else {
+      int bit = x * bitDepth;
+      sample = (row[bit >> 3] >> (8 - bitDepth - (bit & 7))) & ((1 << bitDepth) - 1);
+    }
+    uint8_t level = levels[sample];
+    if (x & 1) {
+      packed[x >> 1] = (uint8_t)((pending << 4) | level);
+    } else {
+      pending = level;
+    }
+  }
+  if (width & 1) {
+    packed[width >> 1] = (uint8_t)((pending << 4) | 0x0F);
+  }
+}
+
+enum InflateResult {
+  INFLATE_NEEDS_INPUT,
+  INFLATE_MORE_OUTPUT,   // Output space ran out; call again with the rest of the input
+  INFLATE_DONE,
+  INFLATE_FAILED
+};
+
+// Streaming zlib inflater: the ESP32-S3 ROM's miniz on the device, zlib on the host
+class Inflater {
+public:
+  Inflater() : _ready(false) {}
+  ~Inflater() { end(); }
+
+  bool begin();
+  void end();
+
+  // Consume up to inBytes (set to the bytes taken) and return the new output
+  InflateResult step(const uint8_t* in, size_t& inBytes, const uint8_t*& out, size_t& outBytes);
+
+private:
+  bool _ready;
+#ifdef ARDUINO
+  tinfl_decompressor* _state;
+  uint8_t* _dictionary;      // Output ring, doubles as the LZ window
+  uint32_t _position;
+#else
+  static const size_t OUTPUT_SIZE = 32 * 1024;
+  z_stream _stream;
+  uint8_t* _output;
+#endif
+};
+
+#ifdef ARDUINO
+// Prefer internal RAM for the inflater's hot state, PSRAM as a fallback
+static void* allocateWorkBuffer(size_t size) {
+  void* buffer = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  return buffer ? buffer : heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+}
+
+bool Inflater::begin() {
+  _state = (tinfl_decompressor*)allocateWorkBuffer(sizeof(tinfl_decompressor));
+  _dictionary = (uint8_t*)allocateWorkBuffer(TINFL_LZ_DICT_SIZE);
+  _position = 0;
+  _ready = true;
+  if (!_state || !_dictionary) {
+    end();
+    return false;
+  }
+  tinfl_init(_state);
+  return true;
+}
+
+void Inflater::end() {
+  if (_ready) {
+    heap_caps_free(_state);
+    heap_caps_free(_dictionary);
+    _ready = false;
+  }
+}
+
+InflateResult Inflater::step(const uint8_t* in, size_t& inBytes, const uint8_t*& out, size_t& outBytes) {
+  outBytes = TINFL_LZ_DICT_SIZE - _position;
+  tinfl_status status = tinfl_decompress(_state, in, &inBytes, _dictionary, _dictionary + _position, &outBytes,
+                                         TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+  out = _dictionary + _position;
+  _position = (_position + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+  if (status == TINFL_STATUS_DONE) {
+    return INFLATE_DONE;
+  }
+  if (status < 0) {
+    return INFLATE_FAILED;
+  }
+  return status == TINFL_STATUS_NEEDS_MORE_INPUT ? INFLATE_NEEDS_INPUT : INFLATE_MORE_OUTPUT;
+}
+#else
+bool Inflater::begin() {
+  _output = (uint8_t*)malloc(OUTPUT_SIZE);
+  memset(&_stream, 0, sizeof(_stream));
+  if (!_output || inflateInit(&_stream) != Z_OK) {
+    free(_output);
+    return false;
+  }
+  _ready = true;
+  return true;
+}
+
+void Inflater::end() {
+  if (_ready) {
+    inflateEnd(&_stream);
+    free(_output);
+    _ready = false;
+  }
+}
+
+InflateResult Inflater::step(const uint8_t* in, size_t& inBytes, const uint8_t*& out, size_t& outBytes) {
+  _stream.next_in = (Bytef*)in;
+  _stream.avail_in = inBytes;
+  _stream.next_out = _output;
+  _stream.avail_out = OUTPUT_SIZE;
+  int result = inflate(&_stream, Z_NO_FLUSH);
+  inBytes -= _stream.avail_in;
+  out = _output;
+  outBytes = OUTPUT_SIZE - _stream.avail_out;
+
+  if (result == Z_STREAM_END) {
+    return INFLATE_DONE;
+  }
+  if (result != Z_OK && result != Z_BUF_ERROR) {
+    return INFLATE_FAILED;
+  }
+  return _stream.avail_out == 0 ? INFLATE_MORE_OUTPUT : INFLATE_NEEDS_INPUT;
+}
+#endif
+
+PngFastStatus decodePngToGray4(PngSource& source, uint8_t* packed, int rowBytes, int width, int height) {
+  PngFastInfo info;
+  if (!readPngInfo(source, info)) {
+    return PNG_FAST_ERROR;
+  }
+  if (!pngFastPathEligible(info)) {
+    return PNG_FAST_UNSUPPORTED;
+  }
+
+  int outWidth = width < info.width ? width : info.width;
+  int outHeight = height < info.height ? height : info.height;
+  int lineLength = (info.width * info.bitDepth + 7) / 8;
+  int bpp = info.bitDepth == 16 ? 2 : 1;
+
+  // Sample value -> gray level
+  uint8_t levels[256];
+  memset(levels, 0, sizeof(levels));
+  if (info.colorType == 0) {
+    int maxValue = info.bitDepth >= 8 ? 255 : (1 << info.bitDepth) - 1;
+    for (int v = 0; v <= maxValue; v++) {
+      uint8_t gray = (uint8_t)(v * 255 / maxValue);
+      levels[v] = grayLevel(gray, gray, gray);
+    }
+  }
+
+  Inflater inflater;
+  uint8_t* input = (uint8_t*)malloc(PNG_FAST_INPUT_SIZE);
+  uint8_t* lines = (uint8_t*)calloc(2, lineLength + 1);
+  if (!inflater.begin() || !input || !lines) {
+    free(input);
+    free(lines);
+#ifdef ARDUINO
+    Serial.println("[PNG] Fast path allocation failed");
+#endif
+    return PNG_FAST_UNSUPPORTED;
+  }
+
+  // Each line buffer holds the filter byte followed by the scanline
+  uint8_t* current = lines;
+  uint8_t* previous = lines + lineLength + 1;
+  int filled = 0;
+  int row = 0;
+  PngFastStatus status = PNG_FAST_ERROR;
+  bool finished = false;
+
+  while (!finished) {
+    uint8_t chunkHeader[8];
+    if (!readExact(source, chunkHeader, sizeof(chunkHeader))) {
+      break;
+    }
+    uint32_t length = readBigEndian32(chunkHeader);
+    const uint8_t* type = chunkHeader + 4;
+
+    if (memcmp(type, "PLTE", 4) == 0 && info.colorType == 3) {
+      uint32_t entries = length / 3 < 256 ? length / 3 : 256;
+      uint8_t entry[3];
+      for (uint32_t i = 0; i < entries; i++) {
+        if (!readExact(source, entry, 3)) {
+          break;
+        }
+        levels[i] = grayLevel(entry[0], entry[1], entry[2]);
+      }
+      source.skip(length - entries * 3);
+    } else if (memcmp(type, "tRNS", 4) == 0) {
+      // Transparency needs blending with the target; leave it to the generic decoder
+      status = PNG_FAST_UNSUPPORTED;
+      break;
+    } else if (memcmp(type, "IDAT", 4) == 0) {
+      uint32_t remaining = length;
+      while (remaining > 0 && !finished) {
+        int got = source.read(input, remaining < PNG_FAST_INPUT_SIZE ? remaining : PNG_FAST_INPUT_SIZE);
+        if (got <= 0) {
+          remaining = 0;
+          finished = true;
+          break;
+        }
+        remaining -= got;
+
+        size_t inPos = 0;
+        for (;;) {
+          size_t inBytes = got - inPos;
+          const uint8_t* out;
+          size_t outBytes;
+          InflateResult result = inflater.step(input + inPos, inBytes, out, outBytes);
+          inPos += inBytes;
+
+          // Assemble scanlines from the new output
+          size_t outPos = 0;
+          while (outPos < outBytes && row < outHeight) {
+            int take = lineLength + 1 - filled;
+            if ((size_t)take > outBytes - outPos) {
+              take = outBytes - outPos;
+            }
+            memcpy(current + filled, out + outPos, take);
+            filled += take;
+            outPos += take;
+            if (filled == lineLength + 1) {
+              if (!unfilterRow(current[0], current + 1, previous + 1, lineLength, bpp)) {
+                result = INFLATE_FAILED;
+                break;
+              }
+              convertRow(current + 1, info.bitDepth, levels, packed + row * rowBytes, outWidth);
+              uint8_t* swap = current;
+              current = previous;
+              previous = swap;
+              filled = 0;
+              row++;
+            }
+          }
+
+          if (row == outHeight) {
+            // Rows below the clip are never needed
+            status = PNG_FAST_OK;
+            finished = true;
+            break;
+          }
+          if (result == INFLATE_FAILED || result == INFLATE_DONE) {
+            finished = true;
+            break;
+          }
+          if (result == INFLATE_NEEDS_INPUT) {
+            break;
+          }
+        }
+      }
+      source.skip(remaining);
+    } else if (memcmp(type, "IEND", 4) == 0) {
+      break;
+    } else {
+      source.skip(length);
+    }
+    source.skip(4); // CRC (not verified, like the generic decoder's streaming mode)
+  }
+
+  free(input);
+  free(lines);
+  return status;
+}
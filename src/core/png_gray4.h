@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+
+// Portable core of the 4bpp PNG fast path (no Arduino or M5GFX types), so the
+// host unit tests can run it on the sample assets. png_fast.h adds drawing.
+
+// PNG header fields needed to pick a decoder
+struct PngFastInfo {
+    int width;
+    int height;
+    uint8_t bitDepth;
+    uint8_t colorType;     // 0 gray, 2 RGB, 3 palette, 4 gray+alpha, 6 RGBA
+    bool interlaced;
+};
+
+enum PngFastStatus {
+    PNG_FAST_OK,
+    PNG_FAST_UNSUPPORTED,  // Valid PNG the fast path does not handle (nothing written)
+    PNG_FAST_ERROR         // Not a PNG, truncated or corrupt data
+};
+
+// Sequential byte source (an SdStream on the device, memory in the tests)
+class PngSource {
+public:
+    virtual ~PngSource() {}
+    virtual int read(uint8_t* buf, uint32_t len) = 0;
+    virtual void skip(int32_t offset) = 0;
+};
+
+// Read the signature and IHDR. Leaves the source just after IHDR.
+bool readPngInfo(PngSource& source, PngFastInfo& info);
+
+// Gray (1-16 bit) or palette (1-8 bit), non-interlaced. Palettes with
+// transparency are rejected once their tRNS chunk is seen.
+bool pngFastPathEligible(const PngFastInfo& info);
+
+// Inflate the PNG from the start of `source` row by row and write 4bpp gray
+// levels (0 black .. 15 white, high nibble first, odd widths padded with 15)
+// into `packed`. The image is clipped to width x height.
+PngFastStatus decodePngToGray4(PngSource& source, uint8_t* packed, int rowBytes, int width, int height);
@@ -0,0 +1,297 @@
+#include "screensaver.h"
+#include "png_fast.h"
+#include "jpeg_decode.h"
+#include "pixel_kernels.h"
+#include "sd_stream.h"
+#include "energy.h"
+#include <M5Unified.h>
+#include <SD.h>
+#include <esp_heap_caps.h>
+#include <vector>
+#include <algorithm>
+
+// Same layout as the native thumbnails: "G4TH", uint16 width, uint16 height, packed 4bpp rows
+static const uint8_t RASTER_MAGIC[4] = { 'G', '4', 'T', 'H' };
+static const int RASTER_HEADER_SIZE = 8;
+
+// Survives deep sleep so each sleep shows the next image
+RTC_DATA_ATTR static uint32_t screensaverCounter = 0;
+
+static std::vector<String> sources;
+static std::vector<bool> failedSources;  // Could not be rendered; skipped until the next boot
+static bool sourcesListed = false;
+static String preparedRaster;   // Raster known to exist for the current counter and panel size
+static uint32_t preparedCounter = 0;
+static int preparedWidth = 0;
+static int preparedHeight = 0;
+
+static bool isScreensaverImage(const String& name) {
+  String lower = name;
+  lower.toLowerCase();
+  return lower.endsWith(".png") || lower.endsWith(".jpg") || lower.endsWith(".jpeg");
+}
+
+static void listSources() {
+  if (sourcesListed) {
+    return;
+  }
+  sourcesListed = true;
+  File dir = SD.open(SCREENSAVER_DIR);
+  if (!dir) {
+    return;
+  }
+  File entry;
+  while ((entry = dir.openNextFile())) {
+    String name = entry.name();
+    name = name.substring(name.lastIndexOf('/') + 1);
+    if (!entry.isDirectory() && !name.startsWith(".") && isScreensaverImage(name)) {
+      sources.push_back(String(SCREENSAVER_DIR) + "/" + name);
+    }
+    entry.close();
+  }
+  dir.close();
+  std::sort(sources.begin(), sources.end(), [](const String& a, const String& b) { return a < b; });
+  failedSources.assign(sources.size(), false);
+  Serial.printf("[Screensaver] %d images\n", (int)sources.size());
+}
+
+// Raster name changes whenever the source is replaced (path + size + mtime)
+// or the panel size changes (display profile)
+static String rasterPathFor(const String& source, int width, int height) {
+  File file = SD.open(source, FILE_READ);
+  if (!file) {
+    return "";
+  }
+  uint32_t size = file.size();
+  uint32_t modified = (uint32_t)file.getLastWrite();
+  file.close();
+
+  uint32_t hash = 2166136261u;
+  for (const char* p = source.c_str(); *p; p++) {
+    hash ^= (uint8_t)*p;
+    hash *= 16777619u;
+  }
+  char name[64];
+  snprintf(name, sizeof(name), "/%08lx-%dx%d-%lx-%lx.g4", (unsigned long)hash, width, height, (unsigned long)size,
+           (unsigned long)modified);
+  return String(SCREENSAVER_CACHE_DIR) + name;
+}
+
+// Function to decode a source image into packed gray levels (white where it does not cover)
+static bool renderSource(const String& source, uint8_t* packed, int rowBytes, int width, int height) {
+  EnergyScope decode(ENERGY_DECODE);
+  memset(packed, 0xFF, rowBytes * height);
+  SdStream stream;
+  if (!stream.open(source.c_str())) {
+    return false;
+  }
+
+  if (isJpegPath(source.c_str())) {
+    int fitWidth, fitHeight;
+    uint8_t* gray = decodeJpegToGray8(&stream, width, height, fitWidth, fitHeight);
+    stream.close();
+    if (!gray) {
+      return false;  // fitWidth/fitHeight are only set on success
+    }
+    uint8_t* levels = (uint8_t*)malloc(fitWidth + 1);
+    if (!levels) {
+      heap_caps_free(gray);
+      return false;
+    }
+    // Centered; even x offset keeps whole bytes
+    int offsetX = ((width - fitWidth) / 2) & ~1;
+    int offsetY = (height - fitHeight) / 2;
+    for (int row = 0; row < fitHeight; row++) {
+      ditherOrderedRow_ref(gray + row * fitWidth, levels, fitWidth, row);
+      levels[fitWidth] = 15;  // White pad nibble for odd widths
+      pack4bppRow(levels, packed + (offsetY + row) * rowBytes + offsetX / 2, fitWidth + (fitWidth & 1));
+    }
+    heap_caps_free(gray);
+    free(levels);
+    return true;
+  }
+
+  PngFastStatus status = decodePngToGray4(&stream, packed, rowBytes, width, height);
+  if (status != PNG_FAST_UNSUPPORTED) {
+    stream.close();
+    return status == PNG_FAST_OK;
+  }
+
+  // RGB/alpha PNGs: generic decode, then dither like the main images
+  stream.seek(0);
+  M5Canvas canvas;
+  canvas.setPsram(true);
+  canvas.setColorDepth(lgfx::rgb888_3Byte);
+  if (!canvas.createSprite(width, height)) {
+    stream.close();
+    return false;
+  }
+  canvas.fillScreen(TFT_WHITE);
+  bool decoded = canvas.drawPng(&stream, 0, 0);
+  stream.close();
+  uint8_t* rgbRow = (uint8_t*)malloc(width * 3);
+  if (!decoded || !rgbRow) {
+    free(rgbRow);
+    return false;
+  }
+  for (int row = 0; row < height; row++) {
+    canvas.readRectRGB(0, row, width, 1, rgbRow);
+    rgb888ToGray4Row(rgbRow, packed + row * rowBytes, width, row, DITHER_ORDERED, nullptr, nullptr);
+  }
+  free(rgbRow);
+  return true;
+}
+
+static bool writeRaster(const String& path, const uint8_t* packed, int rowBytes, int width, int height) {
+  SD.mkdir("/flipcard/.cache");
+  SD.mkdir(SCREENSAVER_CACHE_DIR);
+  String tempPath = path + ".tmp";
+  File out = SD.open(tempPath, FILE_WRITE);
+  if (!out) {
+    return false;
+  }
+  uint8_t header[RASTER_HEADER_SIZE];
+  memcpy(header, RASTER_MAGIC, 4);
+  header[4] = width & 0xFF;
+  header[5] = width >> 8;
+  header[6] = height & 0xFF;
+  header[7] = height >> 8;
+  bool ok = out.write(header, sizeof(header)) == sizeof(header);
+  uint32_t length = (uint32_t)rowBytes * height;
+  ok = ok && out.write(packed, length) == length;
+  out.close();
+  if (ok) {
+    SD.remove(path);
+    ok = SD.rename(tempPath, path);
+  }
+  if (!ok) {
+    SD.remove(tempPath);
+  }
+  return ok;
+}
+
+bool prepareScreensaver() {
+  listSources();
+  if (sources.empty()) {
+    return false;
+  }
+  int width = M5.Display.width();
+  int height = M5.Display.height();
+  if (preparedRaster.length() > 0 && preparedCounter == screensaverCounter && preparedWidth == width &&
+      preparedHeight == height) {
+    return true;
+  }
+
+  // Move past sources that failed earlier this boot; none left = nothing to do
+  int skipped = 0;
+  while (failedSources[screensaverCounter % sources.size()]) {
+    if (++skipped >= (int)sources.size()) {
+      return false;
+    }
+    screensaverCounter++;
+  }
+
+  int index = screensaverCounter % sources.size();
+  const String& source = sources[index];
+  String raster = rasterPathFor(source, width, height);
+  bool ok = raster.length() > 0;
+  if (ok && !SD.exists(raster)) {
+    uint32_t start = millis();
+    int rowBytes = (width + 1) / 2;
+    uint8_t* packed = (uint8_t*)heap_caps_malloc(rowBytes * height, MALLOC_CAP_SPIRAM);
+    ok = packed && renderSource(source, packed, rowBytes, width, height) &&
+         writeRaster(raster, packed, rowBytes, width, height);
+    heap_caps_free(packed);
+    if (ok) {
+      Serial.printf("[Screensaver] Rendered %s in %lu ms\n", source.c_str(), millis() - start);
+    }
+  }
+  if (!ok) {
+    // Not retried this boot (each attempt decodes the whole image); the next call takes the next source
+    Serial.printf("[Screensaver] Could not render %s, skipping it\n", source.c_str());
+    failedSources[index] = true;
+    screensaverCounter++;
+    return false;
+  }
+
+  preparedRaster = raster;
+  preparedCounter = screensaverCounter;
+  preparedWidth = width;
+  preparedHeight = height;
+  return true;
+}
+
+// Function to copy a raster onto the panel; a raster that does not match the
+// panel (size or header) is removed so the next prepare renders it again
+static bool drawRaster(const String& path) {
+  File file = SD.open(path, FILE_READ);
+  if (!file) {
+    return false;
+  }
+  uint8_t header[RASTER_HEADER_SIZE];
+  int width = 0;
+  int height = 0;
+  if (file.read(header, sizeof(header)) == sizeof(header) && memcmp(header, RASTER_MAGIC, 4) == 0) {
+    width = header[4] | (header[5] << 8);
+    height = header[6] | (header[7] << 8);
+  }
+  if (width != M5.Display.width() || height != M5.Display.height()) {
+    Serial.printf("[Screensaver] %s is %dx%d, panel is %dx%d; rendering again\n", path.c_str(), width, height,
+                  M5.Display.width(), M5.Display.height());
+    file.close();
+    SD.remove(path);
+    preparedRaster = "";
+    return false;
+  }
+  int rowBytes = (width + 1) / 2;
+
+  M5Canvas canvas;
+  canvas.setPsram(true);
+  canvas.setColorDepth(4);
+  if (!canvas.createSprite(width, height)) {
+    file.close();
+    return false;
+  }
+  for (int i = 0; i < 16; i++) {
+    canvas.setPaletteColor(i, i * 17, i * 17, i * 17);
+  }
+
+  // Straight from SD into the sprite: one read when rows are not padded
+  uint8_t* buffer = (uint8_t*)canvas.getBuffer();
+  uint32_t stride = canvas.bufferLength() / height;
+  bool ok = true;
+  if (stride == (uint32_t)rowBytes) {
+    ok = file.read(buffer, rowBytes * height) == rowBytes * height;
+  } else {
+    for (int row = 0; row < height && ok; row++) {
+      ok = file.read(buffer + row * stride, rowBytes) == rowBytes;
+    }
+  }
+  file.close();
+  if (!ok) {
+    return false;
+  }
+
+  canvas.pushSprite(&M5.Display, 0, 0);
+  return true;
+}
+
+bool drawScreensaver() {
+  // A failed source is skipped, so try each source at most once
+  for (size_t attempt = 0; !prepareScreensaver(); attempt++) {
+    if (attempt + 1 >= sources.size()) {
+      return false;
+    }
+  }
+
+  // One more render when the raster on SD turned out not to match the panel
+  bool drawn = drawRaster(preparedRaster);
+  if (!drawn && preparedRaster.length() == 0 && prepareScreensaver()) {
+    drawn = drawRaster(preparedRaster);
+  }
+  if (!drawn) {
+    return false;
+  }
+  screensaverCounter++;
+  return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <Arduino.h>
+
+// Source images (PNG/JPEG, shown in name order, one per sleep)
+#define SCREENSAVER_DIR "/flipcard/screensaver"
+
+// Panel-native rasters rendered from the sources
+#define SCREENSAVER_CACHE_DIR "/flipcard/.cache/screensaver"
+
+// Idle time before the next screensaver is pre-rendered in the background of loop()
+#define SCREENSAVER_PREPARE_IDLE_MS 10000
+
+// Render the screensaver for the next sleep unless its raster is already on SD.
+// Cheap when nothing needs rendering; returns true when a raster is ready.
+// A source that cannot be rendered is skipped (not retried) until the next boot.
+bool prepareScreensaver();
+
+// Draw the next screensaver from its raster (rendering it first if needed).
+// Returns false when the directory holds no usable image.
+bool drawScreensaver();
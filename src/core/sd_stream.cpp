@@ -0,0 +1,290 @@
+#include "sd_stream.h"
+#include "png_fast.h"
+#include "jpeg_decode.h"
+#include "energy.h"
+#include <M5Unified.h>
+#include <esp_heap_caps.h>
+
+SdStreamStats sdStreamStats = {0, 0, 0, 0, 0};
+
+// Single worker shared by all streams; only one stream decodes at a time
+static QueueHandle_t prefetchQueue = nullptr;
+static TaskHandle_t prefetchTaskHandle = nullptr;
+
+void sdStreamInit() {
+  if (prefetchQueue) {
+    return;
+  }
+  prefetchQueue = xQueueCreate(1, sizeof(SdStream*));
+  if (!prefetchQueue) {
+    Serial.println("[SD] Failed to create the prefetch queue");
+    return;
+  }
+  if (xTaskCreatePinnedToCore(SdStream::prefetchTask, "sd_prefetch", 4096, nullptr, 2, &prefetchTaskHandle, 0) != pdPASS) {
+    Serial.println("[SD] Failed to start the prefetch task");
+    prefetchTaskHandle = nullptr;
+  }
+}
+
+void resetSdStreamStats() {
+  memset(&sdStreamStats, 0, sizeof(sdStreamStats));
+}
+
+void printSdStreamStats(const char* label) {
+  Serial.printf("[SD] %s: %u opens, %u syscalls, %u bytes, %u us waiting, %u prefetch hits\n",
+                label, sdStreamStats.opens, sdStreamStats.syscalls, sdStreamStats.bytesRead,
+                sdStreamStats.waitMicros, sdStreamStats.prefetchHits);
+}
+
+SdStream::SdStream(bool prefetch)
+  : _isOpen(false), _prefetchEnabled(prefetch), _prefetchPending(false),
+    _fileSize(0), _filePos(0), _pos(0), _blockSize(0), _prefetchOffset(0),
+    _current(0), _prefetchDone(nullptr) {
+  for (int i = 0; i < 2; i++) {
+    _blocks[i].data = nullptr;
+    _blocks[i].offset = 0;
+    _blocks[i].length = -1;
+  }
+}
+
+SdStream::~SdStream() {
+  close();
+}
+
+bool SdStream::allocateBlocks() {
+  // Synchronous streams only ever fill the current block, so one small one will do
+  if (!_prefetchEnabled) {
+    _blocks[0].data = (uint8_t*)heap_caps_malloc(SD_STREAM_MIN_BLOCK_SIZE, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    if (_blocks[0].data) {
+      _blockSize = SD_STREAM_MIN_BLOCK_SIZE;
+      return true;
+    }
+    Serial.println("[SD] Failed to allocate stream buffer");
+    return false;
+  }
+
+  // Try full-size blocks first, then shrink until both buffers fit
+  for (uint32_t size = SD_STREAM_BLOCK_SIZE; size >= SD_STREAM_MIN_BLOCK_SIZE; size /= 2) {
+    _blocks[0].data = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    _blocks[1].data = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    if (_blocks[0].data && _blocks[1].data) {
+      _blockSize = size;
+      return true;
+    }
+    freeBlocks();
+  }
+  Serial.println("[SD] Failed to allocate stream buffers");
+  return false;
+}
+
+void SdStream::freeBlocks() {
+  for (int i = 0; i < 2; i++) {
+    if (_blocks[i].data) {
+      heap_caps_free(_blocks[i].data);
+      _blocks[i].data = nullptr;
+    }
+    _blocks[i].length = -1;
+  }
+}
+
+bool SdStream::open(const char* path) {
+  close();
+
+  _file = SD.open(path, FILE_READ);
+  if (!_file) {
+    return false;
+  }
+
+  if (_prefetchEnabled) {
+    if (!_prefetchDone) {
+      _prefetchDone = xSemaphoreCreateBinary();
+    }
+    if (!prefetchQueue || !prefetchTaskHandle || !_prefetchDone) {
+      _prefetchEnabled = false; // Degrade to synchronous block reads
+    }
+  }
+
+  if (!allocateBlocks()) {
+    _file.close();
+    return false;
+  }
+
+  _fileSize = _file.size();
+  _filePos = 0;
+  _pos = 0;
+  _current = 0;
+  _prefetchPending = false;
+  _isOpen = true;
+  sdStreamStats.opens++;
+  return true;
+}
+
+void SdStream::close() {
+  if (!_isOpen) {
+    return;
+  }
+
+  // Never free buffers under an in-flight prefetch
+  waitPrefetch();
+  _file.close();
+  freeBlocks();
+  if (_prefetchDone) {
+    vSemaphoreDelete(_prefetchDone);
+    _prefetchDone = nullptr;
+  }
+  _isOpen = false;
+}
+
+int32_t SdStream::fillBlock(Block& block, uint32_t offset) {
+  if (_filePos != offset) {
+    _file.seek(offset);
+    sdStreamStats.syscalls++;
+  }
+
+  uint32_t wanted = min(_blockSize, _fileSize - offset);
+  int32_t got = _file.read(block.data, wanted);
+  sdStreamStats.syscalls++;
+
+  if (got < 0) {
+    got = 0;
+  }
+  sdStreamStats.bytesRead += got;
+  _filePos = offset + got;
+  block.offset = offset;
+  block.length = got;
+  return got;
+}
+
+void SdStream::prefetchTask(void* param) {
+  SdStream* stream;
+  for (;;) {
+    if (xQueueReceive(prefetchQueue, &stream, portMAX_DELAY) == pdTRUE) {
+      stream->fillBlock(stream->_blocks[stream->_current ^ 1], stream->_prefetchOffset);
+      xSemaphoreGive(stream->_prefetchDone);
+    }
+  }
+}
+
+void SdStream::startPrefetch(uint32_t offset) {
+  _prefetchOffset = offset;
+  _blocks[_current ^ 1].length = -1;
+  SdStream* self = this;
+  if (xQueueSend(prefetchQueue, &self, 0) == pdTRUE) {
+    _prefetchPending = true;
+  }
+}
+
+void SdStream::waitPrefetch() {
+  if (!_prefetchPending) {
+    return;
+  }
+  EnergyScope io(ENERGY_SD_IO);
+  uint32_t start = micros();
+  xSemaphoreTake(_prefetchDone, portMAX_DELAY);
+  sdStreamStats.waitMicros += micros() - start;
+  _prefetchPending = false;
+}
+
+bool SdStream::loadBlockFor(uint32_t position) {
+  uint32_t aligned = position - (position % _blockSize);
+
+  waitPrefetch();
+
+  Block& other = _blocks[_current ^ 1];
+  if (other.length > 0 && other.offset == aligned) {
+    _current ^= 1;
+    sdStreamStats.prefetchHits++;
+  } else {
+    EnergyScope io(ENERGY_SD_IO);
+    uint32_t start = micros();
+    fillBlock(_blocks[_current], aligned);
+    sdStreamStats.waitMicros += micros() - start;
+  }
+
+  // Read the following block while the decoder works through this one
+  uint32_t next = aligned + _blockSize;
+  if (_prefetchEnabled && next < _fileSize) {
+    startPrefetch(next);
+  }
+
+  return _blocks[_current].length > 0;
+}
+
+int SdStream::read(uint8_t* buf, uint32_t len) {
+  if (!_isOpen) {
+    return 0;
+  }
+
+  uint32_t copied = 0;
+  while (copied < len && _pos < _fileSize) {
+    Block& block = _blocks[_current];
+    if (block.length <= 0 || _pos < block.offset || _pos >= block.offset + block.length) {
+      if (!loadBlockFor(_pos)) {
+        break;
+      }
+      continue;
+    }
+
+    uint32_t inBlock = _pos - block.offset;
+    uint32_t n = min(len - copied, (uint32_t)block.length - inBlock);
+    memcpy(buf + copied, block.data + inBlock, n);
+    copied += n;
+    _pos += n;
+  }
+  return copied;
+}
+
+void SdStream::skip(int32_t offset) {
+  seek(_pos + offset);
+}
+
+bool SdStream::seek(uint32_t offset) {
+  if (offset > _fileSize) {
+    return false;
+  }
+  // Blocks stay valid; the next read() reloads only if offset left them
+  _pos = offset;
+  return true;
+}
+
+int32_t SdStream::tell() {
+  return _pos;
+}
+
+static LovyanGFX* drawTarget = nullptr;
+
+void setImageDrawTarget(LovyanGFX* target) {
+  drawTarget = target;
+}
+
+LovyanGFX& imageDrawTarget() {
+  return drawTarget ? *drawTarget : M5.Display;
+}
+
+// Draw a PNG from SD through a read-ahead SdStream
+bool drawPngFromSd(const char* path, int x, int y, int maxWidth, int maxHeight,
+                   int offX, int offY, float scaleX, float scaleY) {
+  EnergyScope decode(ENERGY_DECODE);
+  SdStream stream;
+  if (!stream.open(path)) {
+    return false;
+  }
+
+  bool result;
+  if (offX == 0 && offY == 0 && scaleX == 1.0f && (scaleY == 0.0f || scaleY == 1.0f)) {
+    // 1:1 draws can skip the RGB conversion for gray/palette PNGs
+    result = drawPngFast(&stream, imageDrawTarget(), x, y, maxWidth, maxHeight);
+  } else {
+    result = imageDrawTarget().drawPng(&stream, x, y, maxWidth, maxHeight, offX, offY, scaleX, scaleY);
+  }
+  stream.close();
+
+  return result;
+}
+
+bool drawImageFromSd(const char* path, int x, int y, int maxWidth, int maxHeight) {
+  if (isJpegPath(path)) {
+    return drawJpegFromSd(path, x, y, maxWidth, maxHeight);
+  }
+  return drawPngFromSd(path, x, y, maxWidth, maxHeight);
+}
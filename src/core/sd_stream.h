@@ -0,0 +1,92 @@
+#pragma once
+#include <Arduino.h>
+#include <SD.h>
+#include <M5GFX.h>
+
+// Read-ahead block size for SD streams (aligned to FAT sectors/clusters)
+#define SD_STREAM_BLOCK_SIZE      (32 * 1024)
+// Fallback block size when DMA-capable RAM is too fragmented for two full blocks,
+// and the single block of streams opened without prefetch
+#define SD_STREAM_MIN_BLOCK_SIZE  (4 * 1024)
+
+// I/O counters shared by all SD streams
+struct SdStreamStats {
+    uint32_t opens;         // Files opened through SdStream
+    uint32_t syscalls;      // read()/seek() calls issued to the SD driver
+    uint32_t bytesRead;     // Bytes transferred from the SD card
+    uint32_t waitMicros;    // Time the decoder spent blocked waiting for SD data
+    uint32_t prefetchHits;  // Blocks that were already prefetched when needed
+};
+
+extern SdStreamStats sdStreamStats;
+
+// Start the shared prefetch worker (once, from setup() after SD.begin()).
+// Without it every stream reads synchronously.
+void sdStreamInit();
+
+void resetSdStreamStats();
+void printSdStreamStats(const char* label);
+
+// Stream adapter between the M5GFX decoders and SD.
+// Reads the file in large aligned blocks into two DMA-capable buffers and,
+// when prefetch is enabled, fills the next block on a worker task while the
+// decoder consumes the current one. Without prefetch a single small block is
+// used, which is enough for readers that already read in chunks.
+class SdStream : public lgfx::DataWrapper {
+public:
+    explicit SdStream(bool prefetch = true);
+    ~SdStream() override;
+
+    bool open(const char* path);
+    bool isOpen() const { return _isOpen; }
+    uint32_t size() const { return _fileSize; }
+
+    int read(uint8_t* buf, uint32_t len) override;
+    void skip(int32_t offset) override;
+    bool seek(uint32_t offset) override;
+    void close() override;
+    int32_t tell() override;
+
+private:
+    struct Block {
+        uint8_t* data;
+        uint32_t offset;   // File offset of data[0]
+        int32_t length;    // Valid bytes, -1 when empty
+    };
+
+    bool allocateBlocks();
+    void freeBlocks();
+    int32_t fillBlock(Block& block, uint32_t offset);
+    bool loadBlockFor(uint32_t position);
+    void startPrefetch(uint32_t offset);
+    void waitPrefetch();
+
+    static void prefetchTask(void* param);
+    friend void sdStreamInit();
+
+    File _file;
+    bool _isOpen;
+    bool _prefetchEnabled;
+    bool _prefetchPending;
+    uint32_t _fileSize;
+    uint32_t _filePos;     // Current position of the underlying File
+    uint32_t _pos;         // Logical position seen by the decoder
+    uint32_t _blockSize;
+    uint32_t _prefetchOffset;
+    int _current;          // Index of the block being consumed
+    Block _blocks[2];
+    SemaphoreHandle_t _prefetchDone;
+};
+
+// Target of the image helpers below and of the flipcard page: M5.Display, or an
+// off-screen canvas while a frame is rendered ahead of time (nullptr = display)
+void setImageDrawTarget(LovyanGFX* target);
+LovyanGFX& imageDrawTarget();
+
+// Draw a PNG from SD through a read-ahead SdStream (1:1 draws use the 4bpp fast path)
+bool drawPngFromSd(const char* path, int x, int y, int maxWidth = 0, int maxHeight = 0,
+                   int offX = 0, int offY = 0, float scaleX = 1.0f, float scaleY = 0.0f);
+
+// Draw a PNG or JPEG chosen by file extension. PNGs are clipped to the box,
+// JPEGs are reduced to fit it and centered.
+bool drawImageFromSd(const char* path, int x, int y, int maxWidth = 0, int maxHeight = 0);
@@ -0,0 +1,79 @@
+#include "serial_console.h"
+
+struct ConsoleCommand {
+  const char* name;
+  ConsoleHandler handler;
+  const char* help;
+};
+
+static ConsoleCommand commands[CONSOLE_MAX_COMMANDS];
+static int commandCount = 0;
+
+static char line[CONSOLE_LINE_MAX];
+static int lineLength = 0;
+static bool lineOverflow = false;
+
+void consoleRegister(const char* command, ConsoleHandler handler, const char* help) {
+  if (commandCount == CONSOLE_MAX_COMMANDS) {
+    Serial.printf("[Console] No room for command %s\n", command);
+    return;
+  }
+  commands[commandCount++] = {command, handler, help};
+}
+
+String consoleNextWord(String& args) {
+  args.trim();
+  int space = args.indexOf(' ');
+  String word = space < 0 ? args : args.substring(0, space);
+  args = space < 0 ? String("") : args.substring(space + 1);
+  args.trim();
+  return word;
+}
+
+static void runLine(const char* text) {
+  String args = text;
+  String command = consoleNextWord(args);
+  if (command.length() == 0) {
+    return;
+  }
+
+  if (command == "help") {
+    for (int i = 0; i < commandCount; i++) {
+      Serial.printf("%-10s %s\n", commands[i].name, commands[i].help);
+    }
+    return;
+  }
+  for (int i = 0; i < commandCount; i++) {
+    if (command == commands[i].name) {
+      commands[i].handler(args);
+      return;
+    }
+  }
+  Serial.printf("[Console] Unknown command: %s (try help)\n", command.c_str());
+}
+
+void consolePoll() {
+  while (Serial.available() > 0) {
+    int c = Serial.read();
+    if (c == '\r') {
+      continue;
+    }
+    if (c != '\n') {
+      if (lineLength < CONSOLE_LINE_MAX - 1) {
+        line[lineLength++] = (char)c;
+      } else {
+        lineOverflow = true;
+      }
+      continue;
+    }
+
+    line[lineLength] = '\0';
+    if (lineOverflow) {
+      Serial.printf("[Console] Line longer than %d bytes dropped\n", CONSOLE_LINE_MAX - 1);
+    } else {
+      runLine(line);
+    }
+    lineLength = 0;
+    lineOverflow = false;
+  }
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <Arduino.h>
+
+// Longest command line accepted (longer lines are dropped)
+#define CONSOLE_LINE_MAX 256
+
+#define CONSOLE_MAX_COMMANDS 16
+
+// Called with everything after the command word (trimmed, may be empty)
+typedef void (*ConsoleHandler)(const String& args);
+
+// Add a command; the first word of a line selects it. "help" lists them.
+void consoleRegister(const char* command, ConsoleHandler handler, const char* help);
+
+// Read pending serial input and run complete lines (call every loop)
+void consolePoll();
+
+// Split off the first word of args; args keeps the rest
+String consoleNextWord(String& args);
@@ -0,0 +1,251 @@
+#include "thumbnail_cache.h"
+#include "sd_stream.h"
+#include "thumbnail_store.h"
+#include "energy.h"
+#include <M5Unified.h>
+#include <esp_heap_caps.h>
+
+ThumbnailCacheStats thumbnailCacheStats = {0, 0, 0, 0, 0};
+
+struct CacheEntry {
+  String path;
+  int cellSize;          // Grid cell the native thumbnail was made for
+  uint8_t* data;
+  uint32_t size;
+  uint32_t lastUse;
+};
+
+static std::vector<CacheEntry> entries;
+static uint32_t cacheBytes = 0;
+static uint32_t useCounter = 0;
+static SemaphoreHandle_t cacheMutex = nullptr;
+
+// Prefetch job state (guarded by cacheMutex)
+static std::vector<String> pendingPaths;
+static int pendingSize = 0;
+static volatile uint32_t prefetchGeneration = 0;
+static SemaphoreHandle_t prefetchWake = nullptr;
+static TaskHandle_t prefetchTaskHandle = nullptr;
+
+static void ensureCacheInit() {
+  if (!cacheMutex) {
+    cacheMutex = xSemaphoreCreateMutex();
+  }
+}
+
+static int findEntry(const String& path, int cellSize) {
+  for (int i = 0; i < entries.size(); i++) {
+    if (entries[i].path == path && entries[i].cellSize == cellSize) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Drop least recently used entries until `needed` more bytes fit
+static void evictFor(uint32_t needed) {
+  while (!entries.empty() && cacheBytes + needed > THUMBNAIL_CACHE_BUDGET) {
+    int oldest = 0;
+    for (int i = 1; i < entries.size(); i++) {
+      if (entries[i].lastUse < entries[oldest].lastUse) {
+        oldest = i;
+      }
+    }
+    cacheBytes -= entries[oldest].size;
+    heap_caps_free(entries[oldest].data);
+    entries.erase(entries.begin() + oldest);
+    thumbnailCacheStats.evictions++;
+  }
+}
+
+// Read a whole file into PSRAM. Aborts when the prefetch generation changes.
+static uint8_t* readFileToPsram(const String& path, uint32_t& size, uint32_t generation, bool cancellable) {
+  SdStream stream(false);
+  if (!stream.open(path.c_str())) {
+    return nullptr;
+  }
+
+  size = stream.size();
+  if (size == 0 || size > THUMBNAIL_CACHE_MAX_FILE) {
+    return nullptr;
+  }
+
+  uint8_t* data = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+  if (!data) {
+    return nullptr;
+  }
+
+  // Read in small chunks so cancellation takes effect quickly
+  uint32_t done = 0;
+  while (done < size) {
+    if (cancellable && generation != prefetchGeneration) {
+      heap_caps_free(data);
+      return nullptr;
+    }
+    int n = stream.read(data + done, min((uint32_t)4096, size - done));
+    if (n <= 0) {
+      heap_caps_free(data);
+      return nullptr;
+    }
+    done += n;
+  }
+  return data;
+}
+
+static void insertEntry(const String& path, int cellSize, uint8_t* data, uint32_t size) {
+  if (findEntry(path, cellSize) >= 0) {
+    heap_caps_free(data); // Loaded concurrently by the other side
+    return;
+  }
+  evictFor(size);
+  CacheEntry entry;
+  entry.path = path;
+  entry.cellSize = cellSize;
+  entry.data = data;
+  entry.size = size;
+  entry.lastUse = ++useCounter;
+  entries.push_back(entry);
+  cacheBytes += size;
+}
+
+// Cached blobs are either native 4bpp thumbnails or encoded PNGs/JPEGs
+static bool drawBlob(const uint8_t* data, uint32_t length, int x, int y, int size) {
+  EnergyScope decode(ENERGY_DECODE);
+  if (isNativeThumbnail(data, length)) {
+    return drawNativeThumbnail(data, length, x, y);
+  }
+  if (length >= 2 && data[0] == 0xFF && data[1] == 0xD8) {
+    return M5.Display.drawJpg(data, length, x, y, size, size);
+  }
+  return M5.Display.drawPng(data, length, x, y, size, size);
+}
+
+bool drawCachedThumbnail(const String& path, int x, int y, int size) {
+  ensureCacheInit();
+
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  int index = findEntry(path, size);
+  if (index >= 0) {
+    thumbnailCacheStats.hits++;
+    entries[index].lastUse = ++useCounter;
+    bool result = drawBlob(entries[index].data, entries[index].size, x, y, size);
+    xSemaphoreGive(cacheMutex);
+    return result;
+  }
+  thumbnailCacheStats.misses++;
+  xSemaphoreGive(cacheMutex);
+
+  // Miss: load into the cache so revisiting this page is warm as well
+  String file = resolveThumbnailFile(path, size);
+  uint32_t fileSize = 0;
+  uint8_t* data = readFileToPsram(file, fileSize, 0, false);
+  if (!data) {
+    return drawImageFromSd(file.c_str(), x, y, size, size);
+  }
+
+  bool result = drawBlob(data, fileSize, x, y, size);
+
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  insertEntry(path, size, data, fileSize);
+  xSemaphoreGive(cacheMutex);
+  return result;
+}
+
+static void prefetchTask(void* param) {
+  for (;;) {
+    xSemaphoreTake(prefetchWake, portMAX_DELAY);
+
+    for (;;) {
+      xSemaphoreTake(cacheMutex, portMAX_DELAY);
+      if (pendingPaths.empty()) {
+        xSemaphoreGive(cacheMutex);
+        break;
+      }
+      String path = pendingPaths.front();
+      pendingPaths.erase(pendingPaths.begin());
+      int size = pendingSize;
+      uint32_t generation = prefetchGeneration;
+      bool cached = findEntry(path, size) >= 0;
+      xSemaphoreGive(cacheMutex);
+
+      if (cached) {
+        continue;
+      }
+
+      // Only native thumbnails that already exist: generating one means a full
+      // decode, which is left to the draw on the main task
+      String file = existingThumbnailFile(path, size);
+      if (file.length() == 0) {
+        continue;
+      }
+      uint32_t fileSize = 0;
+      uint8_t* data = readFileToPsram(file, fileSize, generation, true);
+      if (!data) {
+        continue;
+      }
+
+      xSemaphoreTake(cacheMutex, portMAX_DELAY);
+      if (generation == prefetchGeneration) {
+        insertEntry(path, size, data, fileSize);
+        thumbnailCacheStats.prefetched++;
+      } else {
+        heap_caps_free(data);
+      }
+      xSemaphoreGive(cacheMutex);
+    }
+  }
+}
+
+void prefetchThumbnails(const std::vector<String>& paths, int size) {
+  ensureCacheInit();
+  if (!prefetchTaskHandle) {
+    prefetchWake = xSemaphoreCreateBinary();
+    xTaskCreatePinnedToCore(prefetchTask, "thumb_prefetch", 4096, nullptr, 1, &prefetchTaskHandle, 0);
+  }
+
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  if (!pendingPaths.empty()) {
+    thumbnailCacheStats.cancelled++;
+  }
+  prefetchGeneration++;
+  pendingPaths = paths;
+  pendingSize = size;
+  xSemaphoreGive(cacheMutex);
+
+  xSemaphoreGive(prefetchWake);
+}
+
+void cancelThumbnailPrefetch() {
+  if (!cacheMutex) {
+    return;
+  }
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  if (!pendingPaths.empty()) {
+    thumbnailCacheStats.cancelled++;
+    pendingPaths.clear();
+  }
+  prefetchGeneration++; // Aborts the file currently being read
+  xSemaphoreGive(cacheMutex);
+}
+
+void invalidateThumbnailsUnder(const String& prefix) {
+  ensureCacheInit();
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  for (int i = entries.size() - 1; i >= 0; i--) {
+    if (entries[i].path.startsWith(prefix)) {
+      cacheBytes -= entries[i].size;
+      heap_caps_free(entries[i].data);
+      entries.erase(entries.begin() + i);
+    }
+  }
+  xSemaphoreGive(cacheMutex);
+}
+
+void printThumbnailCacheStats() {
+  uint32_t lookups = thumbnailCacheStats.hits + thumbnailCacheStats.misses;
+  float hitRate = lookups > 0 ? (100.0f * thumbnailCacheStats.hits / lookups) : 0.0f;
+  Serial.printf("[Thumbs] hit rate %.1f%% (%u hits, %u misses), %u prefetched, %u evicted, %u cancelled, %u entries / %u bytes\n",
+                hitRate, thumbnailCacheStats.hits, thumbnailCacheStats.misses,
+                thumbnailCacheStats.prefetched, thumbnailCacheStats.evictions,
+                thumbnailCacheStats.cancelled, entries.size(), cacheBytes);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <Arduino.h>
+#include <vector>
+
+// PSRAM budget for cached thumbnail files (native 4bpp or encoded bytes)
+#define THUMBNAIL_CACHE_BUDGET       (2 * 1024 * 1024)
+// Files larger than this are never cached
+#define THUMBNAIL_CACHE_MAX_FILE     (128 * 1024)
+
+struct ThumbnailCacheStats {
+    uint32_t hits;        // Draws served from PSRAM
+    uint32_t misses;      // Draws that had to read SD
+    uint32_t prefetched;  // Files loaded by the background prefetcher
+    uint32_t evictions;   // Entries dropped to stay within budget
+    uint32_t cancelled;   // Prefetch batches abandoned before completion
+};
+
+extern ThumbnailCacheStats thumbnailCacheStats;
+
+// Draw a thumbnail, loading it into the cache first on a miss.
+// Entries are keyed by source path and cell size (the display profile's
+// thumbnailSize) and hold the native thumbnail when one exists.
+bool drawCachedThumbnail(const String& path, int x, int y, int size);
+
+// Replace any pending prefetch with the given source files (loaded in order)
+void prefetchThumbnails(const std::vector<String>& paths, int size);
+
+// Stop background loading immediately (e.g. when leaving the grid)
+void cancelThumbnailPrefetch();
+
+// Drop cached entries whose source path starts with `prefix` (e.g. an edited card folder)
+void invalidateThumbnailsUnder(const String& prefix);
+
+void printThumbnailCacheStats();
@@ -0,0 +1,346 @@
+#include "thumbnail_store.h"
+#include "pixel_kernels.h"
+#include "sd_stream.h"
+#include "jpeg_decode.h"
+#include <M5Unified.h>
+#include <SD.h>
+#include <esp_heap_caps.h>
+#include <vector>
+
+// File layout: "G4TH", uint16 width, uint16 height (little endian), packed 4bpp rows
+static const uint8_t NATIVE_MAGIC[4] = { 'G', '4', 'T', 'H' };
+static const int NATIVE_HEADER_SIZE = 8;
+
+static uint32_t fnv1a(const char* text, uint32_t hash = 2166136261u) {
+  while (*text) {
+    hash ^= (uint8_t)*text++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// Read width/height from the IHDR chunk without decoding
+static bool readPngSize(File& file, int& width, int& height) {
+  uint8_t header[24];
+  if (file.read(header, sizeof(header)) != sizeof(header)) {
+    return false;
+  }
+  if (header[1] != 'P' || header[2] != 'N' || header[3] != 'G' ||
+      memcmp(header + 12, "IHDR", 4) != 0) {
+    return false;
+  }
+  width = (header[16] << 24) | (header[17] << 16) | (header[18] << 8) | header[19];
+  height = (header[20] << 24) | (header[21] << 16) | (header[22] << 8) | header[23];
+  return width > 0 && height > 0;
+}
+
+// Area-averaging downscale. Along each axis a source pixel spans `dst` sub-units
+// and a destination pixel spans `src` sub-units, so each destination pixel is
+// the coverage-weighted mean of the source pixels under it.
+bool downscaleAreaAverage(const uint8_t* src, int srcWidth, int srcHeight,
+                          uint8_t* dst, int dstWidth, int dstHeight) {
+  uint32_t* rowSum = (uint32_t*)calloc(dstWidth, sizeof(uint32_t));
+  uint32_t* colSum = (uint32_t*)calloc(dstWidth, sizeof(uint32_t));
+  if (!rowSum || !colSum) {
+    Serial.println("[ThumbStore] Out of memory for the downscale rows");
+    free(rowSum);
+    free(colSum);
+    return false;
+  }
+
+  uint32_t totalWeight = (uint32_t)srcWidth * srcHeight;
+  int dy = 0;
+  uint32_t yPos = 0; // In units of 1/dstHeight source rows
+
+  for (int sy = 0; sy < srcHeight; sy++) {
+    // Horizontal pass for this source row
+    memset(rowSum, 0, dstWidth * sizeof(uint32_t));
+    const uint8_t* line = src + sy * srcWidth;
+    int dx = 0;
+    uint32_t xPos = 0;
+    for (int sx = 0; sx < srcWidth; sx++) {
+      uint32_t end = xPos + dstWidth;
+      while (xPos < end) {
+        uint32_t boundary = (uint32_t)(dx + 1) * srcWidth;
+        uint32_t take = min(end, boundary) - xPos;
+        rowSum[dx] += line[sx] * take;
+        xPos += take;
+        if (xPos == boundary) {
+          dx++;
+        }
+      }
+    }
+
+    // Vertical pass: spread this row over the destination rows it covers
+    uint32_t end = yPos + dstHeight;
+    while (yPos < end) {
+      uint32_t boundary = (uint32_t)(dy + 1) * srcHeight;
+      uint32_t take = min(end, boundary) - yPos;
+      for (int x = 0; x < dstWidth; x++) {
+        colSum[x] += rowSum[x] * take;
+      }
+      yPos += take;
+      if (yPos == boundary) {
+        uint8_t* out = dst + dy * dstWidth;
+        for (int x = 0; x < dstWidth; x++) {
+          out[x] = (uint8_t)((colSum[x] + totalWeight / 2) / totalWeight);
+        }
+        memset(colSum, 0, dstWidth * sizeof(uint32_t));
+        dy++;
+      }
+    }
+  }
+
+  free(rowSum);
+  free(colSum);
+  return true;
+}
+
+// Decode a PNG at full size through an RGB888 canvas and fit it into the cell
+static uint8_t* decodePngFitted(const String& sourcePath, int srcWidth, int srcHeight, int size,
+                                int& fitWidth, int& fitHeight) {
+  if (srcWidth > THUMBNAIL_STORE_MAX_SOURCE || srcHeight > THUMBNAIL_STORE_MAX_SOURCE) {
+    return nullptr;
+  }
+
+  M5Canvas canvas;
+  canvas.setPsram(true);
+  canvas.setColorDepth(lgfx::rgb888_3Byte);
+  if (!canvas.createSprite(srcWidth, srcHeight)) {
+    return nullptr;
+  }
+  SdStream stream;
+  if (!stream.open(sourcePath.c_str())) {
+    return nullptr;
+  }
+  canvas.fillScreen(TFT_WHITE);
+  bool decoded = canvas.drawPng(&stream, 0, 0);
+  stream.close();
+  if (!decoded) {
+    return nullptr;
+  }
+
+  // Fit inside the cell, keeping aspect ratio
+  fitWidth = size;
+  fitHeight = size;
+  if (srcWidth > srcHeight) {
+    fitHeight = max(1, size * srcHeight / srcWidth);
+  } else if (srcHeight > srcWidth) {
+    fitWidth = max(1, size * srcWidth / srcHeight);
+  }
+
+  uint8_t* gray = (uint8_t*)heap_caps_malloc(srcWidth * srcHeight, MALLOC_CAP_SPIRAM);
+  uint8_t* rgbRow = (uint8_t*)malloc(srcWidth * 3);
+  uint8_t* scaled = (uint8_t*)malloc(fitWidth * fitHeight);
+  if (gray && rgbRow && scaled) {
+    for (int y = 0; y < srcHeight; y++) {
+      canvas.readRectRGB(0, y, srcWidth, 1, rgbRow);
+      rgb888ToGray8Row_ref(rgbRow, gray + y * srcWidth, srcWidth);
+    }
+    canvas.deleteSprite();
+    if (!downscaleAreaAverage(gray, srcWidth, srcHeight, scaled, fitWidth, fitHeight)) {
+      free(scaled);
+      scaled = nullptr;
+    }
+  } else {
+    free(scaled);
+    scaled = nullptr;
+  }
+  heap_caps_free(gray);
+  free(rgbRow);
+  return scaled;
+}
+
+// Decode the source image, fit it into a size x size cell and write the native file
+static bool generateNativeThumbnail(const String& sourcePath, int srcWidth, int srcHeight,
+                                    int size, const String& nativePath) {
+  int fitWidth = 0;
+  int fitHeight = 0;
+  uint8_t* scaled = nullptr;
+  if (isJpegPath(sourcePath.c_str())) {
+    // Reduced in the DCT domain; small photos stay at their own size
+    SdStream stream;
+    if (stream.open(sourcePath.c_str())) {
+      scaled = decodeJpegToGray8(&stream, size, size, fitWidth, fitHeight);
+      stream.close();
+    }
+  } else {
+    scaled = decodePngFitted(sourcePath, srcWidth, srcHeight, size, fitWidth, fitHeight);
+  }
+  if (!scaled) {
+    return false;
+  }
+
+  uint8_t* cell = (uint8_t*)malloc(size);
+  uint8_t* levels = (uint8_t*)malloc(size);
+  int rowBytes = (size + 1) / 2;
+  uint8_t* packed = (uint8_t*)malloc(rowBytes);
+  bool ok = cell && levels && packed;
+
+  if (ok) {
+    String tempPath = nativePath + ".tmp";
+    File out = SD.open(tempPath, FILE_WRITE);
+    ok = out;
+    if (ok) {
+      uint8_t header[NATIVE_HEADER_SIZE];
+      memcpy(header, NATIVE_MAGIC, 4);
+      header[4] = size & 0xFF;
+      header[5] = size >> 8;
+      header[6] = size & 0xFF;
+      header[7] = size >> 8;
+      out.write(header, sizeof(header));
+
+      int offsetX = (size - fitWidth) / 2;
+      int offsetY = (size - fitHeight) / 2;
+      for (int y = 0; y < size && ok; y++) {
+        memset(cell, 0xFF, size); // White letterbox
+        if (y >= offsetY && y < offsetY + fitHeight) {
+          memcpy(cell + offsetX, scaled + (y - offsetY) * fitWidth, fitWidth);
+        }
+        ditherOrderedRow_ref(cell, levels, size, y);
+        pack4bppRow(levels, packed, size);
+        ok = out.write(packed, rowBytes) == rowBytes;
+      }
+      out.close();
+
+      if (ok) {
+        SD.remove(nativePath);
+        ok = SD.rename(tempPath, nativePath);
+      } else {
+        SD.remove(tempPath);
+      }
+    }
+  }
+
+  heap_caps_free(scaled);
+  free(cell);
+  free(levels);
+  free(packed);
+  return ok;
+}
+
+// Native file for the source as it is now (path + file size + mtime + target size).
+// Also reports the PNG dimensions; false when the source cannot be thumbnailed.
+static bool nativePathFor(const String& sourcePath, int size, String& nativePath,
+                          int& srcWidth, int& srcHeight) {
+  File source = SD.open(sourcePath, FILE_READ);
+  if (!source) {
+    return false;
+  }
+  uint32_t fileSize = source.size();
+  uint32_t modified = (uint32_t)source.getLastWrite();
+  srcWidth = 0;
+  srcHeight = 0;
+  bool isPng = readPngSize(source, srcWidth, srcHeight);
+  source.close();
+
+  // JPEG dimensions come from the decoder itself
+  if (!isPng && !isJpegPath(sourcePath.c_str())) {
+    return false;
+  }
+
+  char key[64];
+  uint32_t hash = fnv1a(sourcePath.c_str());
+  snprintf(key, sizeof(key), "/%08lx-%lx-%lx-%d.g4", (unsigned long)hash,
+           (unsigned long)fileSize, (unsigned long)modified, size);
+  nativePath = String(THUMBNAIL_STORE_DIR) + key;
+  return true;
+}
+
+// Remove native files made from earlier versions of this source (other size/mtime).
+// Files for other cell sizes of the current version are kept.
+static void pruneStaleThumbnails(const String& nativePath) {
+  String name = nativePath.substring(nativePath.lastIndexOf('/') + 1);
+  String sourcePrefix = name.substring(0, name.indexOf('-') + 1);       // "<hash>-"
+  String versionPrefix = name.substring(0, name.lastIndexOf('-') + 1);  // "<hash>-<size>-<mtime>-"
+
+  File dir = SD.open(THUMBNAIL_STORE_DIR);
+  if (!dir) {
+    return;
+  }
+  std::vector<String> stale;
+  File entry;
+  while ((entry = dir.openNextFile())) {
+    String entryName = entry.name();
+    entryName = entryName.substring(entryName.lastIndexOf('/') + 1);
+    if (!entry.isDirectory() && entryName.startsWith(sourcePrefix) && !entryName.startsWith(versionPrefix)) {
+      stale.push_back(String(THUMBNAIL_STORE_DIR) + "/" + entryName);
+    }
+    entry.close();
+  }
+  dir.close();
+
+  for (const String& path : stale) {
+    SD.remove(path);
+    Serial.printf("[ThumbStore] Removed stale %s\n", path.c_str());
+  }
+}
+
+String existingThumbnailFile(const String& sourcePath, int size) {
+  String nativePath;
+  int srcWidth, srcHeight;
+  if (nativePathFor(sourcePath, size, nativePath, srcWidth, srcHeight) && SD.exists(nativePath)) {
+    return nativePath;
+  }
+  return "";
+}
+
+String resolveThumbnailFile(const String& sourcePath, int size) {
+  String nativePath;
+  int srcWidth, srcHeight;
+  if (!nativePathFor(sourcePath, size, nativePath, srcWidth, srcHeight)) {
+    return sourcePath;
+  }
+
+  bool available = SD.exists(nativePath);
+  if (!available) {
+    SD.mkdir("/flipcard/.cache");
+    SD.mkdir(THUMBNAIL_STORE_DIR);
+    pruneStaleThumbnails(nativePath);
+    uint32_t start = millis();
+    available = generateNativeThumbnail(sourcePath, srcWidth, srcHeight, size, nativePath);
+    if (available) {
+      Serial.printf("[ThumbStore] Generated %s (%dx%d -> %d) in %lu ms\n", nativePath.c_str(),
+                    srcWidth, srcHeight, size, millis() - start);
+    } else {
+      Serial.printf("[ThumbStore] Could not generate thumbnail for %s\n", sourcePath.c_str());
+    }
+  }
+
+  return available ? nativePath : sourcePath;
+}
+
+bool isNativeThumbnail(const uint8_t* data, uint32_t length) {
+  return length >= NATIVE_HEADER_SIZE && memcmp(data, NATIVE_MAGIC, 4) == 0;
+}
+
+bool drawNativeThumbnail(const uint8_t* data, uint32_t length, int x, int y) {
+  if (!isNativeThumbnail(data, length)) {
+    return false;
+  }
+  int width = data[4] | (data[5] << 8);
+  int height = data[6] | (data[7] << 8);
+  int rowBytes = (width + 1) / 2;
+  if (length < NATIVE_HEADER_SIZE + (uint32_t)rowBytes * height) {
+    return false;
+  }
+
+  M5Canvas canvas;
+  canvas.setColorDepth(4);
+  if (!canvas.createSprite(width, height)) {
+    return false;
+  }
+  for (int i = 0; i < 16; i++) {
+    canvas.setPaletteColor(i, i * 17, i * 17, i * 17);
+  }
+
+  // Copy row by row: sprite rows may be padded
+  uint8_t* buffer = (uint8_t*)canvas.getBuffer();
+  uint32_t stride = canvas.bufferLength() / height;
+  const uint8_t* rows = data + NATIVE_HEADER_SIZE;
+  for (int row = 0; row < height; row++) {
+    memcpy(buffer + row * stride, rows + row * rowBytes, rowBytes);
+  }
+  canvas.pushSprite(&M5.Display, x, y);
+  return true;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <Arduino.h>
+
+// On-SD cache of grid-sized, panel-native (4bpp gray) thumbnails
+#define THUMBNAIL_STORE_DIR "/flipcard/.cache/thumbs"
+
+// Largest source image the generator will decode (per side)
+#define THUMBNAIL_STORE_MAX_SOURCE 2048
+
+// Return the file to draw for `sourcePath` at `size`x`size`: the cached
+// native thumbnail, generating it on first view. Falls back to the source
+// path when generation is not possible. Generation decodes the whole source,
+// so only the main task may do it.
+String resolveThumbnailFile(const String& sourcePath, int size);
+
+// The cached native thumbnail if it already exists, "" otherwise. Never
+// decodes, so it is safe on the prefetch task.
+String existingThumbnailFile(const String& sourcePath, int size);
+
+// Native thumbnail blobs (as read from the store)
+bool isNativeThumbnail(const uint8_t* data, uint32_t length);
+bool drawNativeThumbnail(const uint8_t* data, uint32_t length, int x, int y);
+
+// Area-averaging downscale of an 8-bit gray image (any ratio <= 1:1).
+// False when the work rows cannot be allocated; dst is then not written.
+bool downscaleAreaAverage(const uint8_t* src, int srcWidth, int srcHeight,
+                          uint8_t* dst, int dstWidth, int dstHeight);
@@ -0,0 +1,377 @@
+#include "touch_trace.h"
+#include "serial_console.h"
+#include <M5Unified.h>
+#include <SD.h>
+#include <algorithm>
+#include <vector>
+
+static const char* INTERACTION_NAMES[TRACE_INTERACTION_COUNT] = {
+  "category_select", "grid_page", "card_next", "language_cycle", "page"
+};
+
+enum ReplayMode { REPLAY_NONE, REPLAY_SD, REPLAY_SERIAL };
+
+static void (*resetUi)() = nullptr;
+static const char* (*currentPageName)() = nullptr;
+
+static TraceSink recordSink = TRACE_SINK_OFF;
+static String recordBuffer;
+
+static ReplayMode replayMode = REPLAY_NONE;
+static std::vector<TouchSample> replaySamples;
+static size_t replayNext = 0;
+static uint32_t replayBase = 0;      // Added to trace times to get millis()
+static bool replayInTouch = false;
+static bool replayAwaitingReady = false;
+static uint32_t replayReadyAt = 0;   // No touch-down before this (SD replay)
+static String replayResults;
+
+// The gesture being dispatched, then the interaction waiting for its refresh
+static bool dispatching = false;
+static int dispatchKind = -1;
+static uint32_t dispatchGestureMs = 0;
+static bool pending = false;
+static int pendingKind = 0;
+static uint32_t pendingGestureMs = 0;
+static uint32_t pendingHandledMs = 0;
+
+static uint16_t latencies[TRACE_INTERACTION_COUNT][TOUCH_TRACE_LATENCIES];
+static uint32_t latencyCount[TRACE_INTERACTION_COUNT];
+
+static const char* pageName() {
+  return currentPageName ? currentPageName() : "?";
+}
+
+static void flushRecording() {
+  if (recordBuffer.length() == 0) {
+    return;
+  }
+  File file = SD.open(TOUCH_TRACE_PATH, FILE_APPEND);
+  if (!file) {
+    Serial.printf("[Trace] Cannot append to %s, recording stopped\n", TOUCH_TRACE_PATH);
+    recordSink = TRACE_SINK_OFF;
+  } else {
+    file.print(recordBuffer);
+    file.close();
+  }
+  recordBuffer = "";
+}
+
+// One trace line to the recording, and during a replay to its results
+static void writeLine(const String& text, bool replayResult) {
+  if (recordSink == TRACE_SINK_SERIAL || (replayResult && replayMode != REPLAY_NONE)) {
+    Serial.printf("TRACE %s\n", text.c_str());
+  }
+  if (recordSink == TRACE_SINK_SD) {
+    recordBuffer += text;
+    recordBuffer += '\n';
+  }
+  if (replayResult && replayMode == REPLAY_SD) {
+    replayResults += text;
+    replayResults += '\n';
+  }
+}
+
+static void closeInteraction(uint32_t inkMs) {
+  pending = false;
+  uint32_t latency = inkMs - pendingGestureMs;
+  latencies[pendingKind][latencyCount[pendingKind] % TOUCH_TRACE_LATENCIES] = (uint16_t)min(latency, (uint32_t)65535);
+  latencyCount[pendingKind]++;
+
+  char text[96];
+  snprintf(text, sizeof(text), "I\t%s\t%lu\t%lu\t%lu\t%s", INTERACTION_NAMES[pendingKind],
+           (unsigned long)pendingGestureMs, (unsigned long)pendingHandledMs, (unsigned long)inkMs, pageName());
+  writeLine(text, true);
+  Serial.printf("[Trace] %s: %lu ms to ink (%lu ms handling)\n", INTERACTION_NAMES[pendingKind],
+                (unsigned long)latency, (unsigned long)(pendingHandledMs - pendingGestureMs));
+  replayReadyAt = inkMs + TOUCH_TRACE_REPLAY_GAP_MS;
+}
+
+void traceResetStats() {
+  memset(latencyCount, 0, sizeof(latencyCount));
+}
+
+bool traceStartRecording(TraceSink sink) {
+  traceStopRecording();
+  if (sink == TRACE_SINK_OFF) {
+    return true;
+  }
+  if (replayMode != REPLAY_NONE) {
+    Serial.println("[Trace] Cannot record during a replay");
+    return false;
+  }
+  if (sink == TRACE_SINK_SD) {
+    File file = SD.open(TOUCH_TRACE_PATH, FILE_WRITE);
+    if (!file) {
+      Serial.printf("[Trace] Cannot write %s\n", TOUCH_TRACE_PATH);
+      return false;
+    }
+    file.println("# flipcard touch trace 1");
+    file.close();
+  }
+  recordSink = sink;
+  traceResetStats();
+  writeLine(String("P\t") + pageName(), false);
+  Serial.printf("[Trace] Recording to %s\n", sink == TRACE_SINK_SD ? TOUCH_TRACE_PATH : "serial");
+  return true;
+}
+
+void traceStopRecording() {
+  if (recordSink == TRACE_SINK_OFF) {
+    return;
+  }
+  flushRecording();
+  recordSink = TRACE_SINK_OFF;
+  printTraceStats("Recording");
+}
+
+static void beginReplay(ReplayMode mode) {
+  traceStopRecording();
+  replayMode = mode;
+  replayNext = 0;
+  replayInTouch = false;
+  replayAwaitingReady = false;
+  replayReadyAt = 0;
+  replayResults = "";
+  pending = false;
+  traceResetStats();
+  writeLine(String("P\t") + pageName(), true);
+}
+
+bool traceStartReplay(const char* path) {
+  File file = SD.open(path, FILE_READ);
+  if (!file) {
+    Serial.printf("[Trace] Cannot open %s\n", path);
+    return false;
+  }
+  replaySamples.clear();
+  while (file.available()) {
+    String text = file.readStringUntil('\n');
+    unsigned long timeMs;
+    int x, y, fingers;
+    if (text.startsWith("S") && sscanf(text.c_str() + 1, "%lu %d %d %d", &timeMs, &x, &y, &fingers) == 4) {
+      replaySamples.push_back({(uint32_t)timeMs, (int16_t)x, (int16_t)y, (uint8_t)fingers});
+    }
+  }
+  file.close();
+
+  if (replaySamples.empty()) {
+    Serial.printf("[Trace] No touch samples in %s\n", path);
+    return false;
+  }
+  beginReplay(REPLAY_SD);
+  Serial.printf("[Trace] Replaying %d samples from %s\n", (int)replaySamples.size(), path);
+  return true;
+}
+
+void traceStartSerialReplay() {
+  replaySamples.clear();
+  beginReplay(REPLAY_SERIAL);
+  Serial.println("[Trace] Serial replay: send \"trace S time x y fingers\" lines");
+  Serial.println("TRACE R");
+}
+
+void traceStopReplay() {
+  if (replayMode == REPLAY_NONE) {
+    return;
+  }
+  if (replayMode == REPLAY_SD) {
+    File file = SD.open(TOUCH_TRACE_REPLAY_PATH, FILE_WRITE);
+    if (file) {
+      file.println("# flipcard touch trace 1");
+      file.print(replayResults);
+      file.close();
+      Serial.printf("[Trace] Results written to %s\n", TOUCH_TRACE_REPLAY_PATH);
+    } else {
+      Serial.printf("[Trace] Cannot write %s\n", TOUCH_TRACE_REPLAY_PATH);
+    }
+  }
+  replayMode = REPLAY_NONE;
+  replaySamples.clear();
+  replayResults = "";
+  printTraceStats("Replay");
+  Serial.println("TRACE E");
+}
+
+bool traceReplaying() {
+  return replayMode != REPLAY_NONE;
+}
+
+bool traceBusy() {
+  return pending || replayMode != REPLAY_NONE;
+}
+
+void traceRecordSample(const TouchSample& sample) {
+  if (recordSink == TRACE_SINK_OFF) {
+    return;
+  }
+  char text[48];
+  snprintf(text, sizeof(text), "S\t%lu\t%d\t%d\t%d", (unsigned long)sample.timeMs, sample.x, sample.y, sample.count);
+  writeLine(text, false);
+}
+
+void traceGestureBegin(const GestureEvent& event) {
+  if (pending) {
+    // A new gesture before the last refresh ended: count up to here
+    closeInteraction(millis());
+  }
+  dispatching = true;
+  dispatchKind = -1;
+  dispatchGestureMs = event.timeMs;
+}
+
+void traceGestureEnd() {
+  dispatching = false;
+  if (dispatchKind < 0 && M5.Display.displayBusy()) {
+    dispatchKind = TRACE_PAGE;
+  }
+  if (dispatchKind < 0) {
+    return;  // Nothing visible happened
+  }
+  pending = true;
+  pendingKind = dispatchKind;
+  pendingGestureMs = dispatchGestureMs;
+  pendingHandledMs = millis();
+}
+
+void traceInteraction(TraceInteraction kind) {
+  if (dispatching && dispatchKind < 0) {
+    dispatchKind = kind;
+  }
+}
+
+void traceReplayPoll() {
+  uint32_t now = millis();
+  while (replayNext < replaySamples.size()) {
+    TouchSample sample = replaySamples[replayNext];
+    if (!replayInTouch) {
+      if (sample.count == 0) {
+        replayNext++;  // Release without a touch-down (trace started mid-touch)
+        continue;
+      }
+      // Touch-down: wait for the previous interaction's ink, then rebase
+      // the trace so this sample is due now
+      if (pending || gestureTouchActive() || (int32_t)(now - replayReadyAt) < 0) {
+        break;
+      }
+      replayBase = now - sample.timeMs;
+      replayInTouch = true;
+    }
+    uint32_t due = sample.timeMs + replayBase;
+    if ((int32_t)(now - due) < 0) {
+      break;
+    }
+    sample.timeMs = due;
+    gesturePushSample(sample);
+    replayNext++;
+    if (sample.count == 0) {
+      replayInTouch = false;
+      replayAwaitingReady = true;
+    }
+  }
+
+  if (replayNext == replaySamples.size() && replayMode == REPLAY_SERIAL) {
+    replaySamples.clear();
+    replayNext = 0;
+  }
+}
+
+void traceTick() {
+  if (pending && !M5.Display.displayBusy()) {
+    closeInteraction(millis());
+  }
+  if (pending || gestureTouchActive()) {
+    return;
+  }
+
+  if (replayAwaitingReady && replayNext == replaySamples.size()) {
+    replayAwaitingReady = false;
+    if (replayMode == REPLAY_SERIAL) {
+      Serial.println("TRACE R");  // Host sends the next gesture
+    }
+  }
+  if (replayMode == REPLAY_SD && replayNext == replaySamples.size()) {
+    traceStopReplay();
+  }
+
+  // SD writes only between interactions, so they do not add to a latency
+  flushRecording();
+}
+
+bool traceLatency(int kind, uint32_t& count, uint16_t& p50, uint16_t& p90, uint16_t& maxMs) {
+  int kept = min(latencyCount[kind], (uint32_t)TOUCH_TRACE_LATENCIES);
+  if (kept == 0) {
+    return false;
+  }
+  uint16_t sorted[TOUCH_TRACE_LATENCIES];
+  memcpy(sorted, latencies[kind], kept * sizeof(uint16_t));
+  std::sort(sorted, sorted + kept);
+  count = latencyCount[kind];
+  p50 = sorted[kept / 2];
+  p90 = sorted[(kept * 9) / 10];
+  maxMs = sorted[kept - 1];
+  return true;
+}
+
+void printTraceStats(const char* label) {
+  Serial.printf("[Trace] %s latency (gesture to ink):\n", label);
+  for (int kind = 0; kind < TRACE_INTERACTION_COUNT; kind++) {
+    uint32_t count;
+    uint16_t p50, p90, maxMs;
+    if (traceLatency(kind, count, p50, p90, maxMs)) {
+      Serial.printf("[Trace]   %-16s n=%lu p50=%u p90=%u max=%u ms\n", INTERACTION_NAMES[kind],
+                    (unsigned long)count, p50, p90, maxMs);
+    }
+  }
+}
+
+const char* traceInteractionName(int kind) {
+  return (kind >= 0 && kind < TRACE_INTERACTION_COUNT) ? INTERACTION_NAMES[kind] : "unknown";
+}
+
+// "trace record sd|serial", "trace replay [path|serial]", "trace S ...",
+// "trace stop", "trace stats"
+static void traceCommand(const String& line) {
+  String args = line;
+  String action = consoleNextWord(args);
+
+  if (action == "S") {
+    unsigned long timeMs;
+    int x, y, fingers;
+    if (replayMode != REPLAY_SERIAL || sscanf(args.c_str(), "%lu %d %d %d", &timeMs, &x, &y, &fingers) != 4) {
+      Serial.println("[Trace] Ignored sample (start with: trace replay serial)");
+      return;
+    }
+    replaySamples.push_back({(uint32_t)timeMs, (int16_t)x, (int16_t)y, (uint8_t)fingers});
+  } else if (action == "record") {
+    TraceSink sink = args == "serial" ? TRACE_SINK_SERIAL : TRACE_SINK_SD;
+    traceStopReplay();
+    if (resetUi) {
+      resetUi();
+    }
+    traceStartRecording(sink);
+  } else if (action == "replay") {
+    traceStopReplay();
+    if (resetUi) {
+      resetUi();
+    }
+    if (args == "serial") {
+      traceStartSerialReplay();
+    } else if (!traceStartReplay(args.length() > 0 ? args.c_str() : TOUCH_TRACE_PATH)) {
+      Serial.println("TRACE E");
+    }
+  } else if (action == "stop") {
+    traceStopRecording();
+    traceStopReplay();
+  } else if (action == "stats") {
+    printTraceStats("Current");
+  } else {
+    Serial.println("[Trace] Usage: trace record sd|serial | replay [path|serial] | stop | stats");
+  }
+}
+
+void traceInit(void (*onReset)(), const char* (*pageNameFn)()) {
+  resetUi = onReset;
+  currentPageName = pageNameFn;
+  consoleRegister("trace", traceCommand, "Touch trace: record sd|serial, replay [path|serial], stop, stats");
+}
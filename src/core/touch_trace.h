@@ -0,0 +1,82 @@
+#pragma once
+#include <Arduino.h>
+#include "gesture.h"
+
+// Recording written by "trace record sd" (overwritten each time)
+#define TOUCH_TRACE_PATH "/flipcard/trace.tsv"
+
+// Results of a replay from SD
+#define TOUCH_TRACE_REPLAY_PATH "/flipcard/trace-replay.tsv"
+
+// Pause between the ink of one replayed interaction and the next touch-down
+#define TOUCH_TRACE_REPLAY_GAP_MS 500
+
+// Latencies kept per interaction for the on-device summary
+#define TOUCH_TRACE_LATENCIES 256
+
+// What a gesture did. Interactions that refresh the panel without being
+// one of the named kinds are counted as TRACE_PAGE.
+enum TraceInteraction {
+  TRACE_CATEGORY_SELECT,    // Category tapped (grid or random card shown)
+  TRACE_GRID_PAGE,          // Grid page turn
+  TRACE_CARD_NEXT,          // Next/previous/random card
+  TRACE_LANGUAGE_CYCLE,     // Language cycled on a card
+  TRACE_PAGE,               // Any other page transition
+  TRACE_INTERACTION_COUNT
+};
+
+enum TraceSink {
+  TRACE_SINK_OFF,
+  TRACE_SINK_SD,            // TOUCH_TRACE_PATH, flushed between interactions
+  TRACE_SINK_SERIAL         // "TRACE "-prefixed lines
+};
+
+// Trace lines (tab-separated, times in ms):
+//   P  page                                    page the trace starts on
+//   S  time  x  y  fingers                     raw touch sample
+//   I  interaction  gesture  handled  ink  page  one interaction
+// Latency is ink - gesture: from recognizing the gesture (tap release,
+// swipe commit) until the panel refresh it caused has finished.
+
+// Register the "trace" serial command. onReset brings the UI to the page
+// every trace starts on (the menu) before recording or replay; pageName
+// names the page shown, for the P and I lines.
+void traceInit(void (*onReset)(), const char* (*pageName)());
+
+bool traceStartRecording(TraceSink sink);
+void traceStopRecording();
+
+// Replay the samples of a recorded trace from SD, or as "trace S" lines
+// sent over serial (tools/touch_trace.py). Real touches are ignored meanwhile.
+bool traceStartReplay(const char* path);
+void traceStartSerialReplay();
+void traceStopReplay();
+bool traceReplaying();
+
+// True while an interaction waits for its refresh or a replay runs
+bool traceBusy();
+
+// Hooks for the gesture recognizer
+void traceRecordSample(const TouchSample& sample);
+void traceGestureBegin(const GestureEvent& event);
+void traceGestureEnd();
+
+// Name the interaction the gesture being dispatched performs (first wins)
+void traceInteraction(TraceInteraction kind);
+
+// Feed due replay samples into the gesture queue (instead of gesturePoll)
+void traceReplayPoll();
+
+// Once per loop(): closes interactions whose refresh has finished
+void traceTick();
+
+// Count, median, 90th percentile and max latency per interaction
+void printTraceStats(const char* label);
+
+// The same for one interaction kind; false when none was measured
+bool traceLatency(int kind, uint32_t& count, uint16_t& p50, uint16_t& p90, uint16_t& maxMs);
+
+// Forget the latencies measured so far (recording and replay start do this too)
+void traceResetStats();
+
+const char* traceInteractionName(int kind);
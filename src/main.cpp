@@ -5,12 +5,32 @@
 #include <M5GFX.h>
 #include <ArduinoJson.h>
 #include <vector>
+#include <esp_heap_caps.h>
 #include "pages/empty_frame_page.h"
 #include "pages/flipcard_page.h"
 #include "pages/grid_page.h"
 #include "pages/category_page.h"
 #include "pages/menu_page.h"
 #include "pages/option_page.h"
+#include "pages/collection_page.h"
+#include "pages/energy_page.h"
+#include "core/sd_stream.h"
+#include "core/thumbnail_cache.h"
+#include "core/gesture.h"
+#include "core/glyph_font.h"
+#include "core/deck.h"
+#include "core/deck_indexer.h"
+#include "core/png_fast.h"
+#include "core/screensaver.h"
+#include "core/energy.h"
+#include "core/page_router.h"
+#include "core/display_profile.h"
+#include "core/serial_console.h"
+#include "core/touch_trace.h"
+#include "core/card_facets.h"
+#include "core/deck_sync.h"
+#include "core/control.h"
+#include "core/json_arena.h"
 
 #define SD_SPI_CS_PIN   47
 #define SD_SPI_SCK_PIN  39
@@ -24,43 +44,110 @@ int totalCards = 0;            // Total number of cards loaded from JSON
 int maxCardIndex = 0;          // Maximum index (totalCards - 1)
 
 // Page navigation state
-enum PageMode { MENU_MODE, CATEGORY_MODE, GRID_MODE, FLIPCARD_MODE, OPTION_MODE, LANGUAGE_SELECTION_MODE };
+enum PageMode { MENU_MODE, CATEGORY_MODE, GRID_MODE, FLIPCARD_MODE, OPTION_MODE, LANGUAGE_SELECTION_MODE, COLLECTION_MODE, ENERGY_MODE };
 PageMode currentPageMode = MENU_MODE;  // Start with menu page
 int currentGridPage = 0;      // Current page in grid view (0-based)
 int totalGridPages = 0;       // Total pages in grid view
 String selectedCategory = ""; // Selected category for filtering grid
+CardFilter studyFilter;       // Difficulty/tag/language filter on top of the category (config "filter", console)
+int currentCategoryPage = 0;  // Current page in category list (0-based)
+int currentCollectionPage = 0; // Current page in collection list (0-based)
 
 // Random mode state
 bool isRandomMode = false;    // Track if we're in random mode
 String lastRandomCardId = ""; // Track last random card to avoid duplicates
 
 // Language configuration
-JsonDocument languageDoc;     // Document to hold enabled languages array
+JsonDocument languageDoc(psramJsonAllocator()); // Document to hold enabled languages array
 JsonArray enabledLanguages;   // Array of enabled language keys
 String defaultLanguage;       // Default language from config
 
-// JSON documents
-JsonDocument indexDoc;
-JsonDocument currentCardDoc;
-JsonDocument configDoc;
+// JSON documents, all in PSRAM. The index and the cards are reloaded
+// wholesale, so each has a bump arena that is reset on every load.
+JsonArena indexArena("index", JSON_ARENA_INDEX_CHUNK);
+JsonArena cardArena("card", JSON_ARENA_CARD_CHUNK);
+JsonArena slideshowCardArena("slideshow", JSON_ARENA_CARD_CHUNK);
+JsonDocument indexDoc(&indexArena);
+JsonDocument currentCardDoc(&cardArena);
+JsonDocument configDoc(psramJsonAllocator());
 
 // Sleep functionality variables
 unsigned long lastActivityTime = 0;
 const unsigned long SLEEP_TIMEOUT = 3 * 60 * 1000; // 3 minutes in milliseconds
 
-// Function to reset language index to default language
-void resetToDefaultLanguage() {
-  currentLanguageIndex = 0; // fallback to first language
+// Slideshow (navigation.auto_advance): the next step is rendered off-screen
+// right after each flip, so the flip at its deadline is a blit and a refresh
+const unsigned long SLIDESHOW_LATE_MS = 100;      // Later than this counts as a missed deadline
+const unsigned long SLIDESHOW_MIN_SLEEP_MS = 200; // Shorter waits stay in the loop
+struct SlideshowState {
+  bool enabled;                  // navigation.auto_advance
+  bool running;                  // False while paused by a touch
+  bool cycleLanguages;           // navigation.auto_advance_languages
+  bool lightSleep;               // navigation.auto_advance_light_sleep
+  unsigned long delay;           // navigation.auto_advance_delay
+  unsigned long resumeDelay;     // navigation.auto_advance_resume (0 = stay paused)
+  unsigned long deadline;        // millis() of the next flip
+  bool prepared;                 // Next step rendered off-screen
+  bool languageStep;             // Next step only changes the language
+  int nextCardIndex;
+  int nextLanguageIndex;
+  int languagesShown;            // Languages shown for the current card
+  unsigned long renderMs;        // Time the last step took to render
+  uint32_t flips;
+  uint32_t missed;
+};
+SlideshowState slideshow = {false, false, false, true, 5000, 30000, 0, false, false, 0, 0, 1, 0, 0, 0};
+JsonDocument slideshowCardDoc(&slideshowCardArena); // card.json of the prepared card step
+
+// Function to find the default language in the enabled languages array
+int getDefaultLanguageIndex() {
   for (int i = 0; i < enabledLanguages.size(); i++) {
     if (enabledLanguages[i] == defaultLanguage) {
-      currentLanguageIndex = i;
-      break;
+      return i;
+    }
+  }
+  return 0; // fallback to first language
+}
+
+// Function to find the next enabled language a card has, after fromIndex and
+// wrapping around to fromIndex itself (-1 if it has none of them)
+int nextCardLanguageIndex(int cardIndex, int fromIndex) {
+  int count = enabledLanguages.size();
+  for (int step = 1; step <= count; step++) {
+    int candidate = (fromIndex + step) % count;
+    if (cardHasLanguage(cardIndex, enabledLanguages[candidate].as<String>())) {
+      return candidate;
     }
   }
+  return -1;
+}
+
+// Function to pick the language a card opens in: the default, else the next one it has
+int firstCardLanguageIndex(int cardIndex) {
+  int defaultIndex = getDefaultLanguageIndex();
+  if (enabledLanguages.size() == 0 || cardHasLanguage(cardIndex, enabledLanguages[defaultIndex].as<String>())) {
+    return defaultIndex;
+  }
+  int available = nextCardLanguageIndex(cardIndex, defaultIndex);
+  return available >= 0 ? available : defaultIndex;
+}
+
+// Function to count the enabled languages a card has
+int cardLanguageCount(int cardIndex) {
+  int count = 0;
+  for (JsonVariant language : enabledLanguages) {
+    count += cardHasLanguage(cardIndex, language.as<String>());
+  }
+  return count;
+}
+
+// Function to reset language index to default language (or the card's first if it lacks it)
+void resetToDefaultLanguage() {
+  currentLanguageIndex = firstCardLanguageIndex(currentCardIndex);
   Serial.printf("Reset to default language: %s (index %d)\n", defaultLanguage.c_str(), currentLanguageIndex);
 }
 
-// Function to load config.json
+// Function to load config.json (a file that fails to parse leaves the loaded config as it was)
 bool loadConfig() {
   File file = SD.open("/flipcard/config.json");
   if (!file) {
@@ -68,19 +155,23 @@ bool loadConfig() {
     return false;
   }
   
-  DeserializationError error = deserializeJson(configDoc, file);
+  // Parsed on the side: configDoc is edited in place and written back by
+  // saveDefaultLanguage(), so it must never be left empty by a bad file
+  JsonDocument parsed(psramJsonAllocator());
+  DeserializationError error = deserializeJson(parsed, file);
   file.close();
   
   if (error) {
     Serial.printf("Failed to parse config.json: %s\n", error.c_str());
     return false;
   }
+  configDoc = std::move(parsed);
   
   // Load default language
   defaultLanguage = configDoc["languages"]["default"].as<String>();
   
-  // Create enabled languages array in persistent document
-  enabledLanguages = languageDoc.add<JsonArray>();
+  // Create enabled languages array in persistent document (replaced on reload)
+  enabledLanguages = languageDoc.to<JsonArray>();
   JsonObject supportedLangs = configDoc["languages"]["supported"];
   
   for (JsonPair lang : supportedLangs) {
@@ -92,20 +183,91 @@ bool loadConfig() {
   // Set current language index to default language
   resetToDefaultLanguage();
   
+  // Dithering for photo-like main images: "none", "ordered" or "diffusion"
+  String ditherMode = configDoc["display"]["main_image_dither"] | "diffusion";
+  if (ditherMode == "none") {
+    setMainImageDitherMode(DITHER_NONE);
+  } else if (ditherMode == "ordered") {
+    setMainImageDitherMode(DITHER_ORDERED);
+  } else {
+    setMainImageDitherMode(DITHER_DIFFUSION);
+  }
+  
+  // Language fields: "image" (big/small PNGs) or "text" (card.json strings, PNG fallback)
+  String textMode = configDoc["display"]["text_mode"] | "image";
+  setLanguageTextMode(textMode == "text");
+  
+  // PSRAM for the back stack's page snapshots (0 = always redraw on back)
+  setSnapshotBudget((uint32_t)(configDoc["display"]["snapshot_budget_kb"] | ROUTER_DEFAULT_SNAPSHOT_BUDGET / 1024) * 1024);
+  
+  // Layout and rotation; "orientation" picks between the two PaperS3 profiles
+  String orientation = configDoc["display"]["orientation"] | "portrait";
+  applyDisplayProfile(configDoc["display"]["profile"] | orientation);
+  
+  // Hands-free slideshow in the flipcard view
+  JsonObject navigation = configDoc["navigation"];
+  slideshow.enabled = navigation["auto_advance"] | false;
+  slideshow.delay = max(1000UL, (unsigned long)(navigation["auto_advance_delay"] | 5000));
+  slideshow.cycleLanguages = navigation["auto_advance_languages"] | false;
+  slideshow.lightSleep = navigation["auto_advance_light_sleep"] | true;
+  slideshow.resumeDelay = navigation["auto_advance_resume"] | 30000;
+  
+  // Study filter on top of the selected category: difficulty range, any of the tags, all of the languages
+  JsonObject filter = configDoc["filter"];
+  studyFilter = CardFilter();
+  studyFilter.minDifficulty = filter["min_difficulty"] | FACET_MIN_DIFFICULTY;
+  studyFilter.maxDifficulty = filter["max_difficulty"] | FACET_MAX_DIFFICULTY;
+  for (JsonVariant tag : filter["tags"].as<JsonArray>()) {
+    studyFilter.tags.push_back(tag.as<String>());
+  }
+  for (JsonVariant language : filter["languages"].as<JsonArray>()) {
+    studyFilter.languages.push_back(language.as<String>());
+  }
+  if (cardFilterNarrows(studyFilter)) {
+    Serial.printf("Study filter: %s\n", describeCardFilter(studyFilter).c_str());
+  }
+  
   Serial.printf("Loaded config: %d enabled languages\n", enabledLanguages.size());
   Serial.printf("Default language: %s (index %d)\n", defaultLanguage.c_str(), currentLanguageIndex);
   
   return true;
 }
 
-// Function to load index.json
-bool loadIndex() {
-  File file = SD.open("/flipcard/index.json");
+// Function to recompute state derived from indexDoc: from scratch after loading,
+// or only for the entries an incremental update touched
+void applyIndex(const IndexUpdateResult* update = nullptr) {
+  totalCards = indexDoc["metadata"]["total_cards"];
+  maxCardIndex = totalCards - 1;
+  
+  // Calculate grid pages (15 thumbnails per page)
+  totalGridPages = (totalCards + GRID_CARDS_PER_PAGE - 1) / GRID_CARDS_PER_PAGE; // Ceiling division
+  
+  // Facet bitsets for filtering; the category list takes its counts from them lazily
+  if (update) {
+    updateCardFacets(indexDoc, update->removedCards, update->updatedCards);
+  } else {
+    buildCardFacets(indexDoc);
+  }
+  invalidateCategoryList();
+  currentCategoryPage = 0;
+  
+  // Pages on the back stack show the old index
+  routerClear();
+  
+  Serial.printf("Loaded index: %d cards, %d grid pages\n", totalCards, totalGridPages);
+}
+
+// Function to parse index.json into indexDoc (derived state is left to applyIndex)
+bool readIndexFile() {
+  File file = SD.open(deckPath("index.json"));
   if (!file) {
     Serial.println("Failed to open index.json");
     return false;
   }
   
+  // Start the arena over; incremental updates (refreshIndex) add to it
+  // until the next load
+  indexArena.reset(indexDoc);
   DeserializationError error = deserializeJson(indexDoc, file);
   file.close();
   
@@ -113,19 +275,64 @@ bool loadIndex() {
     Serial.printf("Failed to parse index.json: %s\n", error.c_str());
     return false;
   }
+  return true;
+}
+
+// Function to load index.json
+bool loadIndex() {
+  if (!readIndexFile()) {
+    return false;
+  }
   
-  totalCards = indexDoc["metadata"]["total_cards"];
-  maxCardIndex = totalCards - 1;
-  
-  // Calculate grid pages (15 thumbnails per page)
-  totalGridPages = (totalCards + 14) / 15; // Ceiling division
-  
-  Serial.printf("Loaded index: %d cards, %d grid pages\n", totalCards, totalGridPages);
+  applyIndex();
+  indexArena.printStats();
   return true;
 }
 
-// Function to load individual card JSON
-bool loadCard(int cardIndex) {
+// Function to show indexer progress (throttled: each e-paper refresh is slow)
+void drawIndexProgress(const char* phase, int done, int total) {
+  static String lastPhase;
+  static uint32_t phaseStart = 0;
+  static uint32_t lastDraw = 0;
+  uint32_t now = millis();
+  if (lastPhase != phase) {
+    lastPhase = phase;
+    phaseStart = now;
+  }
+  // Quick phases never touch the display
+  if (strcmp(phase, "Done") == 0 || now - phaseStart < 500 || now - lastDraw < 1000) {
+    return;
+  }
+  lastDraw = now;
+  
+  int barX = 70, barY = 480, barWidth = 400, barHeight = 30;
+  M5.Display.fillRect(0, barY - 60, M5.Display.width(), 120, TFT_WHITE);
+  String label = String(phase) + " cards... " + String(done) + (total > 0 ? "/" + String(total) : "");
+  M5.Display.setFont(&fonts::efontCN_16);
+  M5.Display.setTextSize(2);
+  M5.Display.setTextColor(TFT_BLACK);
+  M5.Display.drawString(label.c_str(), barX, barY - 50);
+  M5.Display.drawRect(barX, barY, barWidth, barHeight, TFT_BLACK);
+  if (total > 0) {
+    M5.Display.fillRect(barX + 2, barY + 2, (barWidth - 4) * done / total, barHeight - 4, TFT_BLACK);
+  }
+}
+
+// Function to bring index.json up to date with the card folders on SD (incremental)
+void refreshIndex() {
+  uint32_t budgetMs = configDoc["storage"]["index_budget_ms"] | INDEX_DEFAULT_BUDGET_MS;
+  cancelThumbnailPrefetch();
+  IndexUpdateResult result = updateDeckIndex(indexDoc, budgetMs, drawIndexProgress);
+  if (result.added || result.changed || result.removed) {
+    applyIndex(&result);
+  }
+  if (result.pending > 0) {
+    Serial.printf("%d card folders left for the next index update\n", result.pending);
+  }
+}
+
+// Function to load individual card JSON (into currentCardDoc unless another document and its arena are given)
+bool loadCard(int cardIndex, JsonDocument& cardDoc = currentCardDoc, JsonArena& arena = cardArena) {
   if (cardIndex < 0 || cardIndex >= totalCards) {
     Serial.printf("Invalid card index: %d\n", cardIndex);
     return false;
@@ -133,7 +340,7 @@ bool loadCard(int cardIndex) {
   
   String cardId = indexDoc["cards"][cardIndex]["id"];
   String folder = indexDoc["cards"][cardIndex]["folder"];
-  String cardFile = "/flipcard/" + folder + "/card.json";
+  String cardFile = deckPath(folder + "/card.json");
   
   File file = SD.open(cardFile);
   if (!file) {
@@ -141,7 +348,9 @@ bool loadCard(int cardIndex) {
     return false;
   }
   
-  DeserializationError error = deserializeJson(currentCardDoc, file);
+  // The previous card goes all at once; nothing is freed piecemeal
+  arena.reset(cardDoc);
+  DeserializationError error = deserializeJson(cardDoc, file);
   file.close();
   
   if (error) {
@@ -185,40 +394,78 @@ String getCurrentLanguage() {
   return defaultLanguage; // fallback
 }
 
-// Function to get random card index from category (excluding specific card)
-int getRandomCardFromCategory(String category, String excludeCardId) {
-  std::vector<int> availableIndices;
-  JsonArray cards = indexDoc["cards"];
-  
-  // Collect all card indices in the category except excluded one
-  for (int i = 0; i < cards.size(); i++) {
-    JsonObject card = cards[i];
-    if (card["category"].as<String>() == category) {
-      String cardId = card["id"].as<String>();
-      if (cardId != excludeCardId) {
-        availableIndices.push_back(i);
-      }
-    }
+// Function to get the cards the grid, card navigation and random mode walk
+// through: the selected category combined with the study filter
+const CardBits& visibleCards() {
+  static CardBits cards;
+  CardFilter filter = studyFilter;
+  filter.category = selectedCategory;
+  matchCards(filter, cards);
+  return cards;
+}
+
+// Function to tell whether any filter applies (otherwise all cards in index order)
+bool cardFilterActive() {
+  return selectedCategory != "" || cardFilterNarrows(studyFilter);
+}
+
+// Function to get a random visible card other than excludeCardIndex (-1 if there is none)
+int getRandomFilteredCard(int excludeCardIndex) {
+  int cardIndex = randomCard(visibleCards(), excludeCardIndex);
+  if (cardIndex < 0 && containsCard(visibleCards(), excludeCardIndex)) {
+    return excludeCardIndex; // Only card in the filter
   }
-  
-  // If no other cards available, return current card index
-  if (availableIndices.empty()) {
-    // Find current card index as fallback
-    for (int i = 0; i < cards.size(); i++) {
-      if (cards[i]["id"].as<String>() == excludeCardId) {
-        return i;
-      }
-    }
-    return 0; // ultimate fallback
+  return cardIndex;
+}
+
+// Helper functions for filtered card navigation (popcounts over the facet bitsets)
+int getFilteredCardIndex(int globalCardIndex) {
+  if (!cardFilterActive()) {
+    return globalCardIndex; // No filtering
   }
-  
-  // Return random index from available cards
-  int randomIndex = random(availableIndices.size());
-  return availableIndices[randomIndex];
+  return cardRank(visibleCards(), globalCardIndex); // -1 when not in the filter
+}
+
+int getGlobalCardIndexFromFiltered(int filteredIndex) {
+  if (!cardFilterActive()) {
+    return filteredIndex; // No filtering
+  }
+  return nthCard(visibleCards(), filteredIndex); // -1 past the last card
+}
+
+int getFilteredCardCount() {
+  if (!cardFilterActive()) {
+    return totalCards;
+  }
+  return countCards(visibleCards());
+}
+
+// Function to start the slideshow from the current card (first flip one delay from now)
+void startSlideshow() {
+  slideshow.running = true;
+  slideshow.prepared = false;
+  slideshow.languagesShown = 1;
+  slideshow.deadline = millis() + slideshow.delay;
+  Serial.printf("[Slideshow] Running, %lu ms per step%s\n", slideshow.delay,
+                slideshow.cycleLanguages ? " (cycling languages)" : "");
+}
+
+// Function to pause the slideshow (any touch); the prepared frame is dropped
+void pauseSlideshow() {
+  if (!slideshow.running) {
+    return;
+  }
+  slideshow.running = false;
+  slideshow.prepared = false;
+  releaseFlipcardFrame();
+  Serial.printf("[Slideshow] Paused after %lu flips, %lu missed deadlines\n",
+                (unsigned long)slideshow.flips, (unsigned long)slideshow.missed);
 }
 
 // Function to go to menu page mode
 void goToMenuMode() {
+  EnergyOperationScope operation(ENERGY_OP_PAGE);
+  routerClear(); // Menu is the root of the back stack
   currentPageMode = MENU_MODE;
   isRandomMode = false; // Reset random mode when going back to menu
   selectedCategory = ""; // Clear category selection
@@ -226,8 +473,34 @@ void goToMenuMode() {
   drawMenuPage();
 }
 
+// Function to pick up content written by "sync": reload config.json if it was
+// replaced, then one full index reload (index.json as synced plus card folders
+// it doesn't list yet, derived state rebuilt once) and start over from the menu
+void onDeckSynced(bool configChanged) {
+  if (configChanged) {
+    Serial.println("[Sync] config.json changed, reloading it");
+    if (!loadConfig()) {
+      Serial.println("[Sync] Error: synced config.json is unreadable, keeping the previous config");
+    }
+  }
+  
+  if (!readIndexFile()) {
+    Serial.println("[Sync] index.json unreadable after sync, rebuilding it from the card folders");
+  }
+  uint32_t budgetMs = configDoc["storage"]["index_budget_ms"] | INDEX_DEFAULT_BUDGET_MS;
+  cancelThumbnailPrefetch();
+  IndexUpdateResult result = updateDeckIndex(indexDoc, budgetMs, drawIndexProgress);
+  if (result.pending > 0) {
+    Serial.printf("%d card folders left for the next index update\n", result.pending);
+  }
+  applyIndex();
+  indexArena.printStats();
+  goToMenuMode();
+}
+
 // Function to go to option page mode
 void goToOptionMode() {
+  EnergyOperationScope operation(ENERGY_OP_PAGE);
   currentPageMode = OPTION_MODE;
   Serial.println("Switched to option mode");
   drawOptionPage();
@@ -235,48 +508,148 @@ void goToOptionMode() {
 
 // Function to go to language selection mode
 void goToLanguageSelectionMode() {
+  EnergyOperationScope operation(ENERGY_OP_PAGE);
   currentPageMode = LANGUAGE_SELECTION_MODE;
   Serial.println("Switched to language selection mode");
   drawLanguageSelectionPage(configDoc);
 }
 
+// Function to go to collection selection mode
+void goToCollectionMode() {
+  EnergyOperationScope operation(ENERGY_OP_PAGE);
+  currentPageMode = COLLECTION_MODE;
+  currentCollectionPage = 0;
+  invalidateCollectionList(); // Collections may have been added or synced since the last visit
+  Serial.println("Switched to collection mode");
+  drawCollectionPage(getDeckRoot(), currentCollectionPage);
+}
+
+// Functions to navigate collection list pages (circular, like category pages)
+void goToPreviousCollectionPage() {
+  EnergyOperationScope operation(ENERGY_OP_PAGE);
+  int totalCollectionPages = getCollectionPageCount();
+  currentCollectionPage--;
+  if (currentCollectionPage < 0) {
+    currentCollectionPage = totalCollectionPages - 1; // Loop to last page
+  }
+  Serial.printf("Collection page: %d/%d\n", currentCollectionPage + 1, totalCollectionPages);
+  drawCollectionPage(getDeckRoot(), currentCollectionPage);
+}
+
+void goToNextCollectionPage() {
+  EnergyOperationScope operation(ENERGY_OP_PAGE);
+  int totalCollectionPages = getCollectionPageCount();
+  currentCollectionPage++;
+  if (currentCollectionPage >= totalCollectionPages) {
+    currentCollectionPage = 0; // Loop to first page
+  }
+  Serial.printf("Collection page: %d/%d\n", currentCollectionPage + 1, totalCollectionPages);
+  drawCollectionPage(getDeckRoot(), currentCollectionPage);
+}
+
+// Function to go to the energy report page
+void goToEnergyMode() {
+  EnergyOperationScope operation(ENERGY_OP_PAGE);
+  currentPageMode = ENERGY_MODE;
+  Serial.println("Switched to energy report mode");
+  drawEnergyPage();
+}
+
+// Function to mount another deck collection without rebooting.
+// Thumbnail and glyph caches are keyed by path/source, so a collection
+// switched back to finds its entries still warm.
+void switchCollection(const String& root) {
+  if (root == getDeckRoot()) {
+    goToMenuMode();
+    return;
+  }
+  
+  uint32_t start = millis();
+  String previousRoot = getDeckRoot();
+  cancelThumbnailPrefetch();
+  setDeckRoot(root);
+  if (!loadIndex()) {
+    Serial.printf("Failed to mount %s, staying on %s\n", root.c_str(), previousRoot.c_str());
+    setDeckRoot(previousRoot);
+    loadIndex();
+    goToCollectionMode();
+    return;
+  }
+  if (configDoc["storage"]["incremental_index"] | true) {
+    refreshIndex();
+  }
+  loadGlyphFont(deckPath(GLYPH_FONT_FILE));
+  
+  // Positions from the previous collection are meaningless here
+  currentCardIndex = 0;
+  currentGridPage = 0;
+  selectedCategory = "";
+  lastRandomCardId = "";
+  
+  saveActiveCollection(configDoc, root);
+  Serial.printf("Switched to collection %s in %lu ms\n", root.c_str(), (unsigned long)(millis() - start));
+  goToMenuMode();
+}
+
 // Function to go to category page mode
 void goToCategoryMode() {
+  EnergyOperationScope operation(ENERGY_OP_PAGE);
   currentPageMode = CATEGORY_MODE;
   if (isRandomMode) {
     Serial.println("Switched to category mode (Random)");
-    drawCategoryPage(indexDoc, true);
+    drawCategoryPage(indexDoc, true, currentCategoryPage);
   } else {
     Serial.println("Switched to category mode");
-    drawCategoryPage(indexDoc, false);
+    drawCategoryPage(indexDoc, false, currentCategoryPage);
+  }
+}
+
+// Functions to navigate category list pages (circular, like grid pages)
+void goToPreviousCategoryPage() {
+  EnergyOperationScope operation(ENERGY_OP_PAGE);
+  int totalCategoryPages = getCategoryPageCount(indexDoc);
+  currentCategoryPage--;
+  if (currentCategoryPage < 0) {
+    currentCategoryPage = totalCategoryPages - 1; // Loop to last page
   }
+  Serial.printf("Category page: %d/%d\n", currentCategoryPage + 1, totalCategoryPages);
+  drawCategoryPage(indexDoc, isRandomMode, currentCategoryPage);
+}
+
+void goToNextCategoryPage() {
+  EnergyOperationScope operation(ENERGY_OP_PAGE);
+  int totalCategoryPages = getCategoryPageCount(indexDoc);
+  currentCategoryPage++;
+  if (currentCategoryPage >= totalCategoryPages) {
+    currentCategoryPage = 0; // Loop to first page
+  }
+  Serial.printf("Category page: %d/%d\n", currentCategoryPage + 1, totalCategoryPages);
+  drawCategoryPage(indexDoc, isRandomMode, currentCategoryPage);
 }
 
 // Function to go to grid page mode
 void goToGridMode() {
+  EnergyOperationScope operation(ENERGY_OP_PAGE);
   currentPageMode = GRID_MODE;
   // Reset to first page when entering grid mode
   currentGridPage = 0;
   
   // Calculate total grid pages based on filtering
-  int filteredCardCount;
-  if (selectedCategory != "") {
-    filteredCardCount = getFilteredCardCount(indexDoc, selectedCategory);
-  } else {
-    filteredCardCount = totalCards;
-  }
-  totalGridPages = (filteredCardCount + 14) / 15; // 15 cards per page
+  int filteredCardCount = getFilteredCardCount();
+  totalGridPages = (filteredCardCount + GRID_CARDS_PER_PAGE - 1) / GRID_CARDS_PER_PAGE; // 15 cards per page
   if (totalGridPages < 1) totalGridPages = 1;
   
   Serial.printf("Switched to grid mode, page %d/%d", currentGridPage + 1, totalGridPages);
-  if (selectedCategory != "") {
-    Serial.printf(" (category: %s, %d cards)", selectedCategory.c_str(), filteredCardCount);
+  if (cardFilterActive()) {
+    CardFilter filter = studyFilter;
+    filter.category = selectedCategory;
+    Serial.printf(" (%s: %d cards)", describeCardFilter(filter).c_str(), filteredCardCount);
   }
   Serial.println();
   
   // Use filtered or normal grid drawing
-  if (selectedCategory != "") {
-    drawGridPageFiltered(indexDoc, currentGridPage, totalGridPages, selectedCategory);
+  if (cardFilterActive()) {
+    drawGridPageFiltered(indexDoc, currentGridPage, totalGridPages, visibleCards());
   } else {
     drawGridPage(indexDoc, currentGridPage, totalGridPages);
   }
@@ -284,6 +657,7 @@ void goToGridMode() {
 
 // Function to go to flipcard mode
 void goToFlipcardMode(int cardIndex) {
+  EnergyOperationScope operation(ENERGY_OP_CARD);
   currentPageMode = FLIPCARD_MODE;
   currentCardIndex = cardIndex;
   
@@ -298,6 +672,10 @@ void goToFlipcardMode(int cardIndex) {
     // Draw flipcard
     drawEmptyFrame();
     drawFlipcard(currentCardDoc, folderPath, currentLang);
+    
+    if (slideshow.enabled) {
+      startSlideshow();
+    }
   } else {
     Serial.println("Failed to load selected card");
   }
@@ -305,6 +683,8 @@ void goToFlipcardMode(int cardIndex) {
 
 // Function to navigate grid pages
 void goToPreviousGridPage() {
+  EnergyOperationScope operation(ENERGY_OP_GRID_PAGE);
+  traceInteraction(TRACE_GRID_PAGE);
   currentGridPage--;
   if (currentGridPage < 0) {
     currentGridPage = totalGridPages - 1; // Loop to last page
@@ -312,14 +692,16 @@ void goToPreviousGridPage() {
   Serial.printf("Grid page: %d/%d\n", currentGridPage + 1, totalGridPages);
   
   // Use filtered or normal grid drawing
-  if (selectedCategory != "") {
-    drawGridPageFiltered(indexDoc, currentGridPage, totalGridPages, selectedCategory);
+  if (cardFilterActive()) {
+    drawGridPageFiltered(indexDoc, currentGridPage, totalGridPages, visibleCards());
   } else {
     drawGridPage(indexDoc, currentGridPage, totalGridPages);
   }
 }
 
 void goToNextGridPage() {
+  EnergyOperationScope operation(ENERGY_OP_GRID_PAGE);
+  traceInteraction(TRACE_GRID_PAGE);
   currentGridPage++;
   if (currentGridPage >= totalGridPages) {
     currentGridPage = 0; // Loop to first page
@@ -327,83 +709,33 @@ void goToNextGridPage() {
   Serial.printf("Grid page: %d/%d\n", currentGridPage + 1, totalGridPages);
   
   // Use filtered or normal grid drawing
-  if (selectedCategory != "") {
-    drawGridPageFiltered(indexDoc, currentGridPage, totalGridPages, selectedCategory);
+  if (cardFilterActive()) {
+    drawGridPageFiltered(indexDoc, currentGridPage, totalGridPages, visibleCards());
   } else {
     drawGridPage(indexDoc, currentGridPage, totalGridPages);
   }
 }
 
-// Helper functions for filtered card navigation
-int getFilteredCardIndex(int globalCardIndex) {
-  if (selectedCategory == "") {
-    return globalCardIndex; // No filtering
-  }
-  
-  JsonArray cards = indexDoc["cards"];
-  int filteredIndex = 0;
-  for (int i = 0; i < cards.size(); i++) {
-    JsonObject card = cards[i];
-    if (card["category"].as<String>() == selectedCategory) {
-      if (i == globalCardIndex) {
-        return filteredIndex;
-      }
-      filteredIndex++;
-    }
-  }
-  return -1; // Not found in filter
-}
-
-int getGlobalCardIndexFromFiltered(int filteredIndex) {
-  if (selectedCategory == "") {
-    return filteredIndex; // No filtering
-  }
-  
-  JsonArray cards = indexDoc["cards"];
-  int count = 0;
-  for (int i = 0; i < cards.size(); i++) {
-    JsonObject card = cards[i];
-    if (card["category"].as<String>() == selectedCategory) {
-      if (count == filteredIndex) {
-        return i;
-      }
-      count++;
-    }
-  }
-  return -1; // Not found
-}
-
-int getFilteredCardCount() {
-  if (selectedCategory == "") {
-    return totalCards;
-  }
-  
-  int count = 0;
-  JsonArray cards = indexDoc["cards"];
-  for (JsonObject card : cards) {
-    if (card["category"].as<String>() == selectedCategory) {
-      count++;
-    }
-  }
-  return count;
-}
-
 // Function to cycle to next language
 void cycleToNextLanguage() {
   Serial.printf("cycleToNextLanguage called. enabledLanguages.size(): %d\n", enabledLanguages.size());
-  if (enabledLanguages.size() > 1) {
+  // Languages the card lacks (per the index) are skipped
+  int nextIndex = nextCardLanguageIndex(currentCardIndex, currentLanguageIndex);
+  if (nextIndex >= 0 && nextIndex != currentLanguageIndex) {
     int oldIndex = currentLanguageIndex;
-    currentLanguageIndex = (currentLanguageIndex + 1) % enabledLanguages.size();
+    currentLanguageIndex = nextIndex;
     String currentLang = getCurrentLanguage();
     Serial.printf("Language switched from index %d to %d: %s\n", oldIndex, currentLanguageIndex, currentLang.c_str());
   } else {
-    Serial.println("Cannot cycle languages: only 1 or 0 languages enabled");
+    Serial.println("Cannot cycle languages: the card has only 1 or 0 of the enabled languages");
   }
 }
 
 // Function to navigate to previous card (circular, respects category filter)
 void goToPreviousCard() {
-  if (selectedCategory == "") {
+  EnergyOperationScope operation(ENERGY_OP_CARD);
+  traceInteraction(TRACE_CARD_NEXT);
+  if (!cardFilterActive()) {
     // No filtering - use original logic
     currentCardIndex--;
     if (currentCardIndex < 0) {
@@ -452,7 +784,9 @@ void goToPreviousCard() {
 
 // Function to navigate to next card (circular, respects category filter)
 void goToNextCard() {
-  if (selectedCategory == "") {
+  EnergyOperationScope operation(ENERGY_OP_CARD);
+  traceInteraction(TRACE_CARD_NEXT);
+  if (!cardFilterActive()) {
     // No filtering - use original logic
     currentCardIndex++;
     if (currentCardIndex > maxCardIndex) {
@@ -501,14 +835,9 @@ void goToNextCard() {
 
 // Function to display lock screen before sleep
 void displayLockScreen() {
-  // Clear screen first
-  M5.Display.fillScreen(TFT_WHITE);
-  
-  // Try to display screensaver image from SD card
-  if (SD.exists("/flipcard/screensaver/Thousand-Miles1.png")) {
-    // Draw the PNG image from top-left corner (0,0)
-    M5.Display.drawPngFile(SD, "/flipcard/screensaver/Thousand-Miles1.png", 0, 0);
-  } else {
+  // Pre-rendered full-screen raster: no decoding, and it covers the whole panel
+  if (!drawScreensaver()) {
+    M5.Display.fillScreen(TFT_WHITE);
     // Fallback: display simple text if image not found
     M5.Display.setTextSize(4);
     M5.Display.setTextColor(TFT_BLACK);
@@ -519,8 +848,9 @@ void displayLockScreen() {
     M5.Display.drawString("Touch to wake up", M5.Display.width() / 2, M5.Display.height() / 2 + 40);
   }
   
-  // Give 2 seconds for image to display before deep sleep
-  delay(2000);
+  // Sleep as soon as the panel has finished the refresh
+  M5.Display.display();
+  M5.Display.waitDisplay();
 }
 
 // Function to check for deep sleep timeout
@@ -528,9 +858,12 @@ void checkDeepSleep() {
   unsigned long currentTime = millis();
   if (currentTime - lastActivityTime > SLEEP_TIMEOUT) {
     Serial.println("Inactivity timeout reached - going to sleep");
+    uint32_t sleepStart = millis();
+    cancelThumbnailPrefetch();
     
     // Display lock screen image before deep sleep
     displayLockScreen();
+    Serial.printf("[Sleep] Lock screen shown, entering deep sleep after %lu ms\n", millis() - sleepStart);
     
     // Go to deep sleep
     M5.Power.deepSleep();
@@ -539,17 +872,22 @@ void checkDeepSleep() {
 
 // Function to go to random card in category
 void goToRandomCard() {
+  EnergyOperationScope operation(ENERGY_OP_CARD);
+  traceInteraction(TRACE_CARD_NEXT);
   if (selectedCategory == "") {
     Serial.println("No category selected for random mode");
     return;
   }
   
-  // Get random card from current category (excluding current card)
-  String currentCardId = getCurrentCardId();
-  int randomCardIndex = getRandomCardFromCategory(selectedCategory, currentCardId);
+  // Get random card from current category and filter (excluding current card)
+  int randomCardIndex = getRandomFilteredCard(currentCardIndex);
+  if (randomCardIndex < 0) {
+    Serial.println("No cards match the filter");
+    return;
+  }
   
   // Update tracking
-  lastRandomCardId = currentCardId;
+  lastRandomCardId = getCurrentCardId();
   currentCardIndex = randomCardIndex;
   
   // Load the new card data
@@ -568,12 +906,519 @@ void goToRandomCard() {
   }
 }
 
+// Function to remember the current page (state and screen) before navigating forward
+void pushCurrentPage() {
+  PageState state;
+  state.mode = currentPageMode;
+  if (currentPageMode == GRID_MODE) {
+    state.page = currentGridPage;
+  } else if (currentPageMode == COLLECTION_MODE) {
+    state.page = currentCollectionPage;
+  } else {
+    state.page = currentCategoryPage;
+  }
+  state.pageCount = totalGridPages;
+  state.randomMode = isRandomMode;
+  state.category = selectedCategory;
+  routerPush(state);
+}
+
+// Function to redraw the current page from the state variables
+void redrawCurrentPage() {
+  switch (currentPageMode) {
+    case MENU_MODE:
+      drawMenuPage();
+      break;
+    case CATEGORY_MODE:
+      drawCategoryPage(indexDoc, isRandomMode, currentCategoryPage);
+      break;
+    case GRID_MODE:
+      if (cardFilterActive()) {
+        drawGridPageFiltered(indexDoc, currentGridPage, totalGridPages, visibleCards());
+      } else {
+        drawGridPage(indexDoc, currentGridPage, totalGridPages);
+      }
+      break;
+    case OPTION_MODE:
+      drawOptionPage();
+      break;
+    case LANGUAGE_SELECTION_MODE:
+      drawLanguageSelectionPage(configDoc);
+      break;
+    case COLLECTION_MODE:
+      drawCollectionPage(getDeckRoot(), currentCollectionPage);
+      break;
+    case ENERGY_MODE:
+      drawEnergyPage();
+      break;
+    case FLIPCARD_MODE:
+      drawEmptyFrame();
+      drawFlipcard(currentCardDoc, getCurrentCardFolder(), getCurrentLanguage());
+      break;
+  }
+}
+
+// Function to return to the previous page exactly as it was left: one blit
+// when its snapshot is still held, otherwise a redraw from its saved state.
+// Returns false when there is no previous page.
+bool goBack() {
+  PageState state;
+  if (!routerPop(state)) {
+    return false;
+  }
+  
+  EnergyOperationScope operation(ENERGY_OP_PAGE);
+  currentPageMode = (PageMode)state.mode;
+  isRandomMode = state.randomMode;
+  selectedCategory = state.category;
+  if (currentPageMode == GRID_MODE) {
+    currentGridPage = state.page;
+    totalGridPages = state.pageCount;
+  } else if (currentPageMode == CATEGORY_MODE) {
+    currentCategoryPage = state.page;
+  } else if (currentPageMode == COLLECTION_MODE) {
+    currentCollectionPage = state.page;
+  }
+  
+  if (routerShowPoppedSnapshot()) {
+    // Touch areas and background work the draw functions would have set up
+    if (currentPageMode == CATEGORY_MODE) {
+      restoreCategoryPageState(indexDoc, currentCategoryPage);
+    } else if (currentPageMode == GRID_MODE) {
+      prefetchAdjacentGridPages(indexDoc, currentGridPage, totalGridPages, cardFilterActive() ? &visibleCards() : nullptr);
+    }
+    Serial.printf("Back to page mode %d (snapshot)\n", currentPageMode);
+  } else {
+    Serial.printf("Back to page mode %d (redraw)\n", currentPageMode);
+    redrawCurrentPage();
+  }
+  printRouterStats("Back");
+  return true;
+}
+
+// Function to leave the flipcard view (Home button or long-press)
+void leaveFlipcard() {
+  if (goBack()) {
+    return;
+  }
+  if (isRandomMode) {
+    goToCategoryMode();
+  } else {
+    goToGridMode();
+  }
+}
+
+// Function to get the card after the current one without moving (category filter and random mode apply)
+int peekNextCardIndex() {
+  if (isRandomMode) {
+    return getRandomFilteredCard(currentCardIndex);
+  }
+  if (!cardFilterActive()) {
+    return currentCardIndex >= maxCardIndex ? 0 : currentCardIndex + 1;
+  }
+  int filteredIndex = getFilteredCardIndex(currentCardIndex);
+  if (filteredIndex == -1) {
+    return -1;
+  }
+  return getGlobalCardIndexFromFiltered((filteredIndex + 1) % getFilteredCardCount());
+}
+
+// Function to render the next slideshow step off-screen: the next language of
+// this card while languages are being cycled, otherwise the next card
+void prepareSlideshowStep() {
+  uint32_t start = millis();
+  bool ok;
+  slideshow.languageStep = slideshow.cycleLanguages && slideshow.languagesShown < cardLanguageCount(currentCardIndex);
+  if (slideshow.languageStep) {
+    slideshow.nextCardIndex = currentCardIndex;
+    slideshow.nextLanguageIndex = nextCardLanguageIndex(currentCardIndex, currentLanguageIndex);
+    ok = renderFlipcardLanguageFrame(currentCardDoc, getCurrentCardFolder(),
+                                     enabledLanguages[slideshow.nextLanguageIndex].as<String>());
+  } else {
+    slideshow.nextCardIndex = peekNextCardIndex();
+    slideshow.nextLanguageIndex = firstCardLanguageIndex(slideshow.nextCardIndex);
+    ok = slideshow.nextCardIndex >= 0 && loadCard(slideshow.nextCardIndex, slideshowCardDoc, slideshowCardArena);
+    if (ok) {
+      String folderPath = indexDoc["cards"][slideshow.nextCardIndex]["folder"];
+      ok = renderFlipcardFrame(slideshowCardDoc, folderPath,
+                               enabledLanguages[slideshow.nextLanguageIndex].as<String>());
+    }
+  }
+  
+  slideshow.renderMs = millis() - start;
+  slideshow.prepared = ok;
+  if (!ok) {
+    Serial.println("[Slideshow] Could not prepare the next step");
+    pauseSlideshow();
+  } else {
+    long slack = (long)(slideshow.deadline - millis());
+    Serial.printf("[Slideshow] Next step rendered in %lu ms, %ld ms before its deadline\n", slideshow.renderMs, slack);
+  }
+}
+
+// Function to show the prepared step at its deadline
+void flipSlideshowStep() {
+  EnergyOperationScope operation(slideshow.languageStep ? ENERGY_OP_LANGUAGE : ENERGY_OP_CARD);
+  long late = (long)(millis() - slideshow.deadline);
+  showFlipcardFrame(slideshow.languageStep);
+  
+  if (slideshow.languageStep) {
+    currentLanguageIndex = slideshow.nextLanguageIndex;
+    slideshow.languagesShown++;
+  } else {
+    lastRandomCardId = getCurrentCardId();
+    currentCardIndex = slideshow.nextCardIndex;
+    // Copy into the card arena (assignment would hand over the slideshow's arena)
+    cardArena.reset(currentCardDoc);
+    currentCardDoc.set(slideshowCardDoc);
+    currentLanguageIndex = slideshow.nextLanguageIndex;
+    slideshow.languagesShown = 1;
+    Serial.printf("[Slideshow] Card %s\n", getCurrentCardId().c_str());
+  }
+  
+  slideshow.flips++;
+  if (late > (long)SLIDESHOW_LATE_MS) {
+    slideshow.missed++;
+    Serial.printf("[Slideshow] Missed deadline by %ld ms (render took %lu ms), %lu of %lu flips late\n",
+                  late, slideshow.renderMs, (unsigned long)slideshow.missed, (unsigned long)slideshow.flips);
+    // Start over from now instead of rushing the following steps
+    slideshow.deadline = millis();
+  }
+  slideshow.deadline += slideshow.delay;
+  slideshow.prepared = false;
+  
+  // A running slideshow keeps the device awake
+  lastActivityTime = millis();
+}
+
+// Function to drive the slideshow from loop(): prepare the next step as soon
+// as the previous flip is done, light-sleep until its deadline, then flip
+void slideshowTick() {
+  if (!slideshow.enabled || currentPageMode != FLIPCARD_MODE) {
+    return;
+  }
+  if (!slideshow.running) {
+    if (slideshow.resumeDelay > 0 && millis() - lastActivityTime > slideshow.resumeDelay) {
+      startSlideshow();
+    }
+    return;
+  }
+  
+  if (!slideshow.prepared) {
+    prepareSlideshowStep();
+    if (!slideshow.prepared) {
+      return;
+    }
+  }
+  
+  long remaining = (long)(slideshow.deadline - millis());
+  if (remaining > (long)SLIDESHOW_MIN_SLEEP_MS && slideshow.lightSleep) {
+    // The panel needs the CPU until the previous flip's refresh is done
+    M5.Display.waitDisplay();
+    remaining = (long)(slideshow.deadline - millis());
+    if (remaining > (long)SLIDESHOW_MIN_SLEEP_MS) {
+      EnergyScope sleep(ENERGY_LIGHT_SLEEP);
+      M5.Power.lightSleep((uint64_t)remaining * 1000, true);
+    }
+    // Woken early by a touch: loop() pauses before the gesture is handled
+    remaining = (long)(slideshow.deadline - millis());
+  }
+  if (remaining > 0) {
+    return;
+  }
+  
+  flipSlideshowStep();
+}
+
+#ifdef INDEX_BENCHMARK
+// Synthetic indexes for the scaling benchmark (same shape as tools/gen_deck.py)
+#define INDEX_BENCHMARK_ROOT "/flipcard/.cache/index-bench"
+static const int INDEX_BENCHMARK_SIZES[] = {100, 1000, 10000, 100000};
+static const int INDEX_BENCHMARK_CATEGORIES = 20;
+
+// Function to write a synthetic index.json with cardCount cards, round-robin over the categories
+bool writeBenchmarkIndex(int cardCount) {
+  File file = SD.open(INDEX_BENCHMARK_ROOT "/index.json", FILE_WRITE);
+  if (!file) {
+    return false;
+  }
+  file.printf("{\"metadata\":{\"name\":\"Benchmark %d cards\",\"version\":\"2.0\",\"total_cards\":%d},\"cards\":[",
+              cardCount, cardCount);
+  char entry[256];
+  for (int i = 1; i <= cardCount; i++) {
+    int length = snprintf(entry, sizeof(entry),
+                          "%s{\"id\":\"%06d\",\"folder\":\"flip-%06d\",\"title\":\"Card %d\",\"category\":\"cat%02d\","
+                          "\"difficulty\":%d,\"thumbnail\":\"thumb-%06d.png\",\"languages\":[\"english\",\"chinese\"]}",
+                          i > 1 ? "," : "", i, i, i, (i - 1) % INDEX_BENCHMARK_CATEGORIES, 1 + i % 5, i);
+    file.write((const uint8_t*)entry, length);
+  }
+  file.print("],\"categories\":{");
+  for (int c = 0; c < INDEX_BENCHMARK_CATEGORIES; c++) {
+    file.printf("%s\"cat%02d\":{\"name\":\"Category %d\",\"color\":\"#9E9E9E\",\"icon\":\"\"}", c > 0 ? "," : "", c, c);
+  }
+  file.print("}}");
+  file.close();
+  return true;
+}
+
+// Function to time the index operations against synthetic decks of growing size.
+// One CSV row per size; memory is what the loaded index takes from each heap.
+void runIndexBenchmark() {
+  String savedRoot = getDeckRoot();
+  String savedCategory = selectedCategory;
+  SD.mkdir("/flipcard/.cache");
+  SD.mkdir(INDEX_BENCHMARK_ROOT);
+  setDeckRoot(INDEX_BENCHMARK_ROOT);
+  
+  Serial.println("[IndexBench] cards,file_kb,load_ms,internal_kb,psram_kb,arena_kb,count_us,filtered_index_us,"
+                 "global_index_us,random_us,categories_us");
+  for (int cardCount : INDEX_BENCHMARK_SIZES) {
+    uint32_t start = millis();
+    if (!writeBenchmarkIndex(cardCount)) {
+      Serial.println("[IndexBench] Cannot write the synthetic index");
+      break;
+    }
+    File written = SD.open(INDEX_BENCHMARK_ROOT "/index.json");
+    uint32_t fileBytes = written ? written.size() : 0;
+    written.close();
+    Serial.printf("[IndexBench] Wrote %d cards in %lu ms\n", cardCount, millis() - start);
+    
+    // Heap deltas include arena chunks kept from the previous size; arena_kb is the document itself
+    indexArena.reset(indexDoc);
+    size_t internalBefore = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    size_t psramBefore = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    start = millis();
+    bool loaded = loadIndex();
+    uint32_t loadMs = millis() - start;
+    if (!loaded || indexDoc.overflowed()) {
+      Serial.printf("[IndexBench] %d,%lu,failed (out of memory?)\n", cardCount, (unsigned long)(fileBytes / 1024));
+      break;
+    }
+    int internalKb = ((int)internalBefore - (int)heap_caps_get_free_size(MALLOC_CAP_INTERNAL)) / 1024;
+    int psramKb = ((int)psramBefore - (int)heap_caps_get_free_size(MALLOC_CAP_SPIRAM)) / 1024;
+    int arenaKb = (int)(indexArena.used() / 1024);
+    
+    // Worst cases: the last card of the first category
+    selectedCategory = "cat00";
+    int lastInCategory = ((cardCount - 1) / INDEX_BENCHMARK_CATEGORIES) * INDEX_BENCHMARK_CATEGORIES;
+    
+    start = micros();
+    int filteredCount = getFilteredCardCount();
+    uint32_t countUs = micros() - start;
+    
+    start = micros();
+    int filteredIndex = getFilteredCardIndex(lastInCategory);
+    uint32_t filteredUs = micros() - start;
+    
+    start = micros();
+    int globalIndex = getGlobalCardIndexFromFiltered(filteredCount - 1);
+    uint32_t globalUs = micros() - start;
+    
+    start = micros();
+    getRandomFilteredCard(0);
+    uint32_t randomUs = micros() - start;
+    
+    invalidateCategoryList();
+    start = micros();
+    getCategoryPageCount(indexDoc);
+    uint32_t categoriesUs = micros() - start;
+    
+    if (filteredIndex != filteredCount - 1 || globalIndex != lastInCategory) {
+      Serial.printf("[IndexBench] Unexpected result: filtered %d, global %d\n", filteredIndex, globalIndex);
+    }
+    Serial.printf("[IndexBench] %d,%lu,%lu,%d,%d,%d,%lu,%lu,%lu,%lu,%lu\n", cardCount, (unsigned long)(fileBytes / 1024),
+                  (unsigned long)loadMs, internalKb, psramKb, arenaKb, (unsigned long)countUs, (unsigned long)filteredUs,
+                  (unsigned long)globalUs, (unsigned long)randomUs, (unsigned long)categoriesUs);
+  }
+  
+  SD.remove(INDEX_BENCHMARK_ROOT "/index.json");
+  SD.rmdir(INDEX_BENCHMARK_ROOT);
+  indexArena.reset(indexDoc);
+  invalidateCategoryList();
+  selectedCategory = savedCategory;
+  setDeckRoot(savedRoot);
+}
+#endif
+
+// Function to change the study filter from the serial console:
+// filter [clear | difficulty 1-2 | tags t1 t2 | languages l1 l2]
+void filterCommand(const String& args) {
+  String rest = args;
+  String part = consoleNextWord(rest);
+  if (part == "clear") {
+    studyFilter = CardFilter();
+  } else if (part == "difficulty") {
+    String range = consoleNextWord(rest);
+    int dash = range.indexOf('-');
+    studyFilter.minDifficulty = range.toInt();
+    studyFilter.maxDifficulty = dash < 0 ? studyFilter.minDifficulty : range.substring(dash + 1).toInt();
+    if (range.length() == 0) {
+      studyFilter.minDifficulty = FACET_MIN_DIFFICULTY;
+      studyFilter.maxDifficulty = FACET_MAX_DIFFICULTY;
+    }
+  } else if (part == "tags" || part == "languages") {
+    std::vector<String>& values = part == "tags" ? studyFilter.tags : studyFilter.languages;
+    values.clear();
+    while (rest.length() > 0) {
+      values.push_back(consoleNextWord(rest));
+    }
+  } else if (part.length() > 0) {
+    Serial.printf("[Filter] Unknown part: %s\n", part.c_str());
+    return;
+  }
+  
+  CardFilter filter = studyFilter;
+  filter.category = selectedCategory;
+  Serial.printf("[Filter] %s: %d of %d cards\n", describeCardFilter(filter).c_str(), getFilteredCardCount(), totalCards);
+  if (part.length() > 0) {
+    routerClear(); // Snapshots show the old filter
+    if (currentPageMode == GRID_MODE) {
+      goToGridMode();
+    }
+  }
+}
+
+// Function to name the current page (logs and touch traces)
+const char* pageModeName() {
+  switch (currentPageMode) {
+    case MENU_MODE:               return "MENU";
+    case CATEGORY_MODE:           return "CATEGORY";
+    case GRID_MODE:               return "GRID";
+    case FLIPCARD_MODE:           return "FLIPCARD";
+    case OPTION_MODE:             return "OPTION";
+    case LANGUAGE_SELECTION_MODE: return "LANGUAGE_SELECTION";
+    case COLLECTION_MODE:         return "COLLECTION";
+    case ENERGY_MODE:             return "ENERGY";
+    default:                      return "UNKNOWN";
+  }
+}
+
+// Function to navigate for "ctl go" (scripted runs) along the same paths as
+// the touch handlers. Returns nullptr on success or the error for the reply.
+const char* controlNavigate(const String& target, String& args) {
+  if (target == "menu") {
+    goToMenuMode();
+  } else if (target == "options") {
+    pushCurrentPage();
+    goToOptionMode();
+  } else if (target == "categories") {
+    // "categories [random]": the Categories or Random button of the menu
+    pushCurrentPage();
+    isRandomMode = args == "random";
+    lastRandomCardId = "";
+    currentCategoryPage = 0;
+    goToCategoryMode();
+  } else if (target == "category") {
+    // "category <id> [random]": grid of the category, or a random card of it
+    String categoryId = consoleNextWord(args);
+    CardFilter categoryFilter = studyFilter;
+    categoryFilter.category = categoryId;
+    CardBits categoryCards;
+    matchCards(categoryFilter, categoryCards);
+    if (countCards(categoryCards) == 0) {
+      return "no cards of that category match the filter";
+    }
+    pushCurrentPage();
+    isRandomMode = args == "random";
+    selectedCategory = categoryId;
+    if (isRandomMode) {
+      goToFlipcardMode(getRandomFilteredCard(-1));
+      lastRandomCardId = getCurrentCardId();
+    } else {
+      goToGridMode();
+    }
+  } else if (target == "grid") {
+    // "grid next|prev|<page>" (pages count from 0)
+    if (currentPageMode != GRID_MODE) {
+      return "not on the grid";
+    }
+    String page = consoleNextWord(args);
+    if (page == "next") {
+      goToNextGridPage();
+    } else if (page == "prev") {
+      goToPreviousGridPage();
+    } else {
+      int number = page.toInt();
+      if (page.length() == 0 || number < 0 || number >= totalGridPages) {
+        return "grid page out of range";
+      }
+      // Land on the page through the page turn path (same tracing and prefetch)
+      currentGridPage = number - 1;
+      goToNextGridPage();
+    }
+  } else if (target == "card") {
+    // "card next|prev|random" on a card, or "card <index>" (index.json order)
+    String which = consoleNextWord(args);
+    if (which == "next" || which == "prev" || which == "random") {
+      if (currentPageMode != FLIPCARD_MODE) {
+        return "not on a card";
+      }
+      if (which == "random" || isRandomMode) {
+        goToRandomCard();
+      } else if (which == "next") {
+        goToNextCard();
+      } else {
+        goToPreviousCard();
+      }
+    } else {
+      int cardIndex = which.toInt();
+      if (which.length() == 0 || cardIndex < 0 || cardIndex >= totalCards) {
+        return "card index out of range";
+      }
+      pushCurrentPage();
+      goToFlipcardMode(cardIndex);
+    }
+  } else if (target == "language") {
+    if (currentPageMode != FLIPCARD_MODE) {
+      return "not on a card";
+    }
+    EnergyOperationScope operation(ENERGY_OP_LANGUAGE);
+    cycleToNextLanguage();
+    refreshLanguageImages(currentCardDoc, getCurrentCardFolder(), getCurrentLanguage());
+  } else if (target == "back") {
+    if (!goBack()) {
+      return "nothing to go back to";
+    }
+  } else {
+    return "targets: menu, options, categories [random], category <id> [random], grid next|prev|<page>, "
+           "card next|prev|random|<index>, language, back";
+  }
+  return nullptr;
+}
+
+// Function to describe the UI state for "ctl state" and action replies
+void controlDescribe(JsonObject state) {
+  CardFilter filter = studyFilter;
+  filter.category = selectedCategory;
+  state["page"] = pageModeName();
+  state["collection"] = getDeckRoot();
+  state["total_cards"] = totalCards;
+  state["random"] = isRandomMode;
+  state["category"] = selectedCategory;
+  state["filter"] = describeCardFilter(filter);
+  state["filtered_cards"] = getFilteredCardCount();
+  state["category_page"] = currentCategoryPage;
+  state["grid_page"] = currentGridPage;
+  state["grid_pages"] = totalGridPages;
+  state["card"] = currentCardIndex;
+  state["card_id"] = getCurrentCardId();
+  state["language"] = getCurrentLanguage();
+  state["slideshow"] = slideshow.running;
+}
+
+// Gesture handlers (defined after setup)
+void onTapGesture(const GestureEvent& event);
+void handleSwipe(const GestureEvent& event);
+void handleLongPress(const GestureEvent& event);
+void handleTwoFingerTap(const GestureEvent& event);
+
 void setup() {
   auto cfg = M5.config();
   cfg.serial_baudrate = 115200;
   M5.begin(cfg);
+  energyInit();
 
-  M5.Display.setRotation(2); // Portrait mode
+  M5.Display.setRotation(2); // Portrait until config.json picks a display profile
   M5.Display.clear();
 
   Serial.println("Starting simple image display...");
@@ -596,6 +1441,12 @@ void setup() {
   }
   
   Serial.println("SD card OK");
+  sdStreamInit();
+  
+#ifdef PIXEL_KERNEL_BENCHMARK
+  // Verify fast pixel kernels against the scalar reference
+  runPixelKernelBenchmark();
+#endif
   
   // Add more delay and stabilization before loading files
   // delay(500);  
@@ -613,251 +1464,455 @@ void setup() {
     return;
   }
   
+#ifdef INDEX_BENCHMARK
+  // Time and memory of the index operations at 100 to 100k cards
+  runIndexBenchmark();
+#endif
+  
+  // Mount the last used collection (falls back to the built-in one)
+  setDeckRoot(configDoc["storage"]["active_collection"] | DECK_DEFAULT_ROOT);
+  
   // Load index.json
-  if (!loadIndex()) {
+  bool indexLoaded = loadIndex();
+  if (!indexLoaded && getDeckRoot() != DECK_DEFAULT_ROOT) {
+    Serial.println("Saved collection unavailable - using default");
+    setDeckRoot(DECK_DEFAULT_ROOT);
+    indexLoaded = loadIndex();
+  }
+  if (!indexLoaded) {
     Serial.println("Failed to load index.json - using fallback");
     M5.Display.println("JSON load error!");
     return;
   }
   
+  // Pick up card folders added, edited or removed since the last boot
+  if (configDoc["storage"]["incremental_index"] | true) {
+    refreshIndex();
+  }
+  
+  // Deck glyph file (optional; the built-in font is used without it)
+  loadGlyphFont(deckPath(GLYPH_FONT_FILE));
+  
+#ifdef PNG_FAST_PATH_BENCHMARK
+  // Verify the 4bpp PNG fast path against M5GFX decodes of this collection's images
+  runPngFastPathBenchmark();
+#endif
+  
+  // Page handlers subscribe to semantic touch gestures
+  gestureSubscribe(GESTURE_TAP, onTapGesture);
+  gestureSubscribe(GESTURE_SWIPE_LEFT, handleSwipe);
+  gestureSubscribe(GESTURE_SWIPE_RIGHT, handleSwipe);
+  gestureSubscribe(GESTURE_LONG_PRESS, handleLongPress);
+  gestureSubscribe(GESTURE_TWO_FINGER_TAP, handleTwoFingerTap);
+  
+  // Serial "trace" command; recordings and replays start from the menu
+  traceInit(goToMenuMode, pageModeName);
+  syncInit(onDeckSynced);
+  controlInit(controlNavigate, controlDescribe);
+  consoleRegister("filter", filterCommand, "Study filter: clear, difficulty 1-2, tags t1 t2, languages l1 l2");
+  
   // Start with menu mode
   Serial.printf("Starting in menu mode with %d cards loaded\n", totalCards);
   goToMenuMode();
   M5.update();
+  
+  // Optional touch trace from boot ("sd" or "serial")
+  String touchTrace = configDoc["diagnostics"]["touch_trace"] | "off";
+  if (touchTrace == "sd") {
+    traceStartRecording(TRACE_SINK_SD);
+  } else if (touchTrace == "serial") {
+    traceStartRecording(TRACE_SINK_SERIAL);
+  }
 }
 
-void loop() {
-  M5.update();
+// Function to dispatch a tap to the current page (touch-down position)
+void handleTap(int touchX, int touchY) {
+  Serial.printf("Touch detected at (%d, %d) in %s mode\n", touchX, touchY, pageModeName());
   
-  // Check for touch input
-  if (M5.Touch.getCount()) {
-    auto t = M5.Touch.getDetail();
-    if (t.wasPressed()) {
-      // Reset activity timer on any touch
-      lastActivityTime = millis();
-      
-      int touchX = t.x;
-      int touchY = t.y;
-      
-      Serial.printf("Touch detected at (%d, %d) in %s mode\n", 
-                    touchX, touchY, 
-                    currentPageMode == MENU_MODE ? "MENU" :
-                    (currentPageMode == CATEGORY_MODE ? "CATEGORY" : 
-                    (currentPageMode == GRID_MODE ? "GRID" : 
-                    (currentPageMode == FLIPCARD_MODE ? "FLIPCARD" :
-                    (currentPageMode == OPTION_MODE ? "OPTION" : "LANGUAGE_SELECTION")))));
-      
-      if (currentPageMode == MENU_MODE) {
-        // Handle menu page touch
-        int buttonPressed = handleMenuTouch(touchX, touchY);
-        if (buttonPressed == 1) {
-          // Category button was pressed, go to normal category mode
-          isRandomMode = false;
-          goToCategoryMode();
-        } else if (buttonPressed == 2) {
-          // Random button was pressed, go to random category mode
-          isRandomMode = true;
-          lastRandomCardId = ""; // Reset random history
-          goToCategoryMode();
-        } else if (buttonPressed == 3) {
-          // Option button was pressed, go to option mode
-          goToOptionMode();
+  if (currentPageMode == MENU_MODE) {
+    // Handle menu page touch
+    int buttonPressed = handleMenuTouch(touchX, touchY);
+    if (buttonPressed != 0) {
+      pushCurrentPage();
+    }
+    if (buttonPressed == 1) {
+      // Category button was pressed, go to normal category mode
+      isRandomMode = false;
+      currentCategoryPage = 0;
+      goToCategoryMode();
+    } else if (buttonPressed == 2) {
+      // Random button was pressed, go to random category mode
+      isRandomMode = true;
+      lastRandomCardId = ""; // Reset random history
+      currentCategoryPage = 0;
+      goToCategoryMode();
+    } else if (buttonPressed == 3) {
+      // Option button was pressed, go to option mode
+      goToOptionMode();
+    }
+    
+  } else if (currentPageMode == CATEGORY_MODE) {
+    // Handle category page touch
+    // Check home button first
+    String buttonType;
+    if (isTouchOnCategoryHomeButton(touchX, touchY)) {
+      Serial.println("Category: Home button touched - returning to menu");
+      if (!goBack()) {
+        goToMenuMode();
+      }
+    } else if (isTouchOnGridNavButton(touchX, touchY, buttonType) && buttonType != "home") {
+      // Paging controls (same buttons as the grid page)
+      if (getCategoryPageCount(indexDoc) > 1) {
+        if (buttonType == "left") {
+          Serial.println("Category: Previous page");
+          goToPreviousCategoryPage();
+        } else {
+          Serial.println("Category: Next page");
+          goToNextCategoryPage();
         }
+      } else {
+        Serial.println("Category: Paging button pressed but only one page - no action");
+      }
+    } else {
+      // Check category selection
+      String categoryId = getCategoryIdFromTouch(touchX, touchY, indexDoc);
+      // Random mode needs a card to open; with the study filter a category can have none
+      CardBits categoryCards;
+      if (categoryId != "" && isRandomMode) {
+        CardFilter categoryFilter = studyFilter;
+        categoryFilter.category = categoryId;
+        matchCards(categoryFilter, categoryCards);
+      }
+      if (categoryId != "" && isRandomMode && countCards(categoryCards) == 0) {
+        Serial.printf("Random mode: no %s cards match the filter\n", categoryId.c_str());
+      } else if (categoryId != "") {
+        Serial.printf("Category: Selected category %s\n", categoryId.c_str());
+        traceInteraction(TRACE_CATEGORY_SELECT);
+        pushCurrentPage();
+        selectedCategory = categoryId;
         
-      } else if (currentPageMode == CATEGORY_MODE) {
-        // Handle category page touch
-        // Check home button first
-        if (isTouchOnCategoryHomeButton(touchX, touchY)) {
-          Serial.println("Category: Home button touched - returning to menu");
-          goToMenuMode();
+        if (isRandomMode) {
+          // Random mode: skip grid, go directly to random flipcard
+          Serial.println("Random mode: going directly to flipcard");
+          // Get first random card from category
+          int randomCardIndex = getRandomFilteredCard(-1);
+          goToFlipcardMode(randomCardIndex);
+          lastRandomCardId = getCurrentCardId();
         } else {
-          // Check category selection
-          String categoryId = getCategoryIdFromTouch(touchX, touchY, indexDoc);
-          if (categoryId != "") {
-            Serial.printf("Category: Selected category %s\n", categoryId.c_str());
-            selectedCategory = categoryId;
-            
-            if (isRandomMode) {
-              // Random mode: skip grid, go directly to random flipcard
-              Serial.println("Random mode: going directly to flipcard");
-              // Get first random card from category
-              int randomCardIndex = getRandomCardFromCategory(selectedCategory, "");
-              goToFlipcardMode(randomCardIndex);
-              lastRandomCardId = getCurrentCardId();
-            } else {
-              // Normal mode: go to grid
-              goToGridMode();
-            }
-          }
+          // Normal mode: go to grid
+          goToGridMode();
         }
-        
-      } else if (currentPageMode == GRID_MODE) {
-        // Handle grid page touch
-        String buttonType;
-        if (isTouchOnGridNavButton(touchX, touchY, buttonType)) {
-          if (buttonType == "left") {
-            if (totalGridPages > 1) {
-              Serial.println("Grid: Previous page");
-              goToPreviousGridPage();
-            } else {
-              Serial.println("Grid: Left button pressed but only one page - no action");
-            }
-          } else if (buttonType == "right") {
-            if (totalGridPages > 1) {
-              Serial.println("Grid: Next page");
-              goToNextGridPage();
-            } else {
-              Serial.println("Grid: Right button pressed but only one page - no action");
-            }
-          } else if (buttonType == "home") {
-            Serial.println("Grid: Home button - back to category");
-            selectedCategory = ""; // Clear category filter
-            goToCategoryMode();
-          }
+      }
+    }
+    
+  } else if (currentPageMode == GRID_MODE) {
+    // Handle grid page touch
+    String buttonType;
+    if (isTouchOnGridNavButton(touchX, touchY, buttonType)) {
+      if (buttonType == "left") {
+        if (totalGridPages > 1) {
+          Serial.println("Grid: Previous page");
+          goToPreviousGridPage();
         } else {
-          // Check if touch is on a thumbnail
-          int cardIndex;
-          if (selectedCategory != "") {
-            cardIndex = getTouchedThumbnailIndexFiltered(touchX, touchY, currentGridPage, indexDoc, selectedCategory);
-          } else {
-            cardIndex = getTouchedThumbnailIndex(touchX, touchY, currentGridPage);
-          }
-          
-          if (cardIndex >= 0 && cardIndex < totalCards) {
-            Serial.printf("Grid: Selected card %d\n", cardIndex);
-            goToFlipcardMode(cardIndex);
-          }
+          Serial.println("Grid: Left button pressed but only one page - no action");
         }
-        M5.update();
-        
-      } else if (currentPageMode == OPTION_MODE) {
-        // Handle option page touch
-        // Check home button first
-        if (isTouchOnOptionHomeButton(touchX, touchY)) {
-          Serial.println("Option: Home button touched - returning to menu");
-          goToMenuMode();
+      } else if (buttonType == "right") {
+        if (totalGridPages > 1) {
+          Serial.println("Grid: Next page");
+          goToNextGridPage();
         } else {
-          // Check option buttons
-          int buttonPressed = handleOptionTouch(touchX, touchY);
-          if (buttonPressed == 1) {
-            // Language button was pressed
-            goToLanguageSelectionMode();
-          } else if (buttonPressed == 2) {
-            // Root Menu button was pressed (not implemented yet)
-            Serial.println("Root Menu not implemented yet");
-          }
+          Serial.println("Grid: Right button pressed but only one page - no action");
         }
-        
-      } else if (currentPageMode == LANGUAGE_SELECTION_MODE) {
-        // Handle language selection touch
-        // Check home button first
-        if (isTouchOnOptionHomeButton(touchX, touchY)) {
-          Serial.println("Language Selection: Home button touched - returning to options");
-          goToOptionMode();
+      } else if (buttonType == "home") {
+        Serial.println("Grid: Home button - back to category");
+        cancelThumbnailPrefetch(); // Leaving the grid
+        if (!goBack()) {
+          selectedCategory = ""; // Clear category filter
+          goToCategoryMode();
+        }
+      }
+    } else {
+      // Check if touch is on a thumbnail
+      int cardIndex;
+      if (cardFilterActive()) {
+        cardIndex = getTouchedThumbnailIndexFiltered(touchX, touchY, currentGridPage, visibleCards());
+      } else {
+        cardIndex = getTouchedThumbnailIndex(touchX, touchY, currentGridPage);
+      }
+      
+      if (cardIndex >= 0 && cardIndex < totalCards) {
+        Serial.printf("Grid: Selected card %d\n", cardIndex);
+        cancelThumbnailPrefetch(); // Leaving the grid
+        pushCurrentPage();
+        goToFlipcardMode(cardIndex);
+      }
+    }
+    M5.update();
+    
+  } else if (currentPageMode == OPTION_MODE) {
+    // Handle option page touch
+    // Check home button first
+    if (isTouchOnOptionHomeButton(touchX, touchY)) {
+      Serial.println("Option: Home button touched - returning to menu");
+      if (!goBack()) {
+        goToMenuMode();
+      }
+    } else {
+      // Check option buttons
+      int buttonPressed = handleOptionTouch(touchX, touchY);
+      if (buttonPressed == 1 || buttonPressed == 2 || buttonPressed == 4) {
+        pushCurrentPage(); // Sub-pages come back here
+      }
+      if (buttonPressed == 1) {
+        // Language button was pressed
+        goToLanguageSelectionMode();
+      } else if (buttonPressed == 2) {
+        // Root Menu button was pressed: choose a deck collection
+        goToCollectionMode();
+      } else if (buttonPressed == 3) {
+        // Rescan button was pressed: incremental index update
+        M5.Display.clear();
+        refreshIndex();
+        goToOptionMode();
+      } else if (buttonPressed == 4) {
+        // Energy button was pressed: battery/performance report
+        goToEnergyMode();
+      }
+    }
+    
+  } else if (currentPageMode == COLLECTION_MODE) {
+    // Handle collection selection touch
+    String buttonType;
+    if (isTouchOnCollectionHomeButton(touchX, touchY)) {
+      Serial.println("Collection: Home button touched - returning to options");
+      if (!goBack()) {
+        goToOptionMode();
+      }
+    } else if (isTouchOnGridNavButton(touchX, touchY, buttonType) && buttonType != "home") {
+      // Paging controls (same buttons as the category page)
+      if (getCollectionPageCount() > 1) {
+        if (buttonType == "left") {
+          Serial.println("Collection: Previous page");
+          goToPreviousCollectionPage();
         } else {
-          // Check language selection
-          String selectedLang = handleLanguageSelectionTouch(touchX, touchY, configDoc);
-          if (selectedLang != "") {
-            Serial.printf("Language Selected: %s\n", selectedLang.c_str());
-            
-            // Save new default language
-            if (saveDefaultLanguage(selectedLang)) {
-              Serial.println("Successfully saved new default language");
-              
-              // Reload config to update global state
-              if (loadConfig()) {
-                Serial.println("Config reloaded successfully");
-                Serial.printf("New default language is now: %s (index %d)\n", defaultLanguage.c_str(), currentLanguageIndex);
-              } else {
-                Serial.println("Failed to reload config");
-              }
-              
-              // Return to option page
-              goToOptionMode();
-            } else {
-              Serial.println("Failed to save new default language");
-            }
-          }
+          Serial.println("Collection: Next page");
+          goToNextCollectionPage();
         }
+      } else {
+        Serial.println("Collection: Paging button pressed but only one page - no action");
+      }
+    } else {
+      String selectedRoot = handleCollectionTouch(touchX, touchY);
+      if (selectedRoot != "") {
+        switchCollection(selectedRoot);
+      }
+    }
+    
+  } else if (currentPageMode == ENERGY_MODE) {
+    // Handle energy report touch
+    if (isTouchOnOptionHomeButton(touchX, touchY)) {
+      Serial.println("Energy: Home button touched - returning to options");
+      if (!goBack()) {
+        goToOptionMode();
+      }
+    } else if (isTouchOnEnergyExportButton(touchX, touchY)) {
+      bool saved = exportEnergyCsv();
+      drawEnergyPage(saved ? "Saved to " ENERGY_CSV_PATH : "Export failed");
+    }
+    
+  } else if (currentPageMode == LANGUAGE_SELECTION_MODE) {
+    // Handle language selection touch
+    // Check home button first
+    if (isTouchOnOptionHomeButton(touchX, touchY)) {
+      Serial.println("Language Selection: Home button touched - returning to options");
+      if (!goBack()) {
+        goToOptionMode();
+      }
+    } else {
+      // Check language selection
+      String selectedLang = handleLanguageSelectionTouch(touchX, touchY, configDoc);
+      if (selectedLang != "") {
+        Serial.printf("Language Selected: %s\n", selectedLang.c_str());
         
-      } else { // FLIPCARD_MODE
-        // Handle flipcard touch (existing logic)
-        int screenWidth = M5.Display.width();
-        int buttonSize = 80;
-        int buttonMargin = 20;
-        
-        // Button positions
-        int leftButtonX = buttonMargin + 25;
-        int leftButtonY = buttonMargin + 25;
-        int rightButtonX = screenWidth - buttonSize - buttonMargin - 25;
-        int rightButtonY = buttonMargin + 25;
-        int homeButtonX = (screenWidth - buttonSize) / 2;
-        int homeButtonY = buttonMargin + 25;
-        
-        // Check navigation buttons
-        bool touchOnLeftButton = (touchX >= leftButtonX && touchX <= leftButtonX + buttonSize && 
-                                 touchY >= leftButtonY && touchY <= leftButtonY + buttonSize);
-        bool touchOnRightButton = (touchX >= rightButtonX && touchX <= rightButtonX + buttonSize && 
-                                  touchY >= rightButtonY && touchY <= rightButtonY + buttonSize);
-        bool touchOnHomeButton = (touchX >= homeButtonX && touchX <= homeButtonX + buttonSize && 
-                                 touchY >= homeButtonY && touchY <= homeButtonY + buttonSize);
-        
-        if (touchOnLeftButton) {
-          if (isRandomMode) {
-            Serial.println("Flipcard: Random previous card");
-            goToRandomCard();
-          } else {
-            Serial.println("Flipcard: Previous card");
-            goToPreviousCard();
-          }
-        } else if (touchOnRightButton) {
-          if (isRandomMode) {
-            Serial.println("Flipcard: Random next card");
-            goToRandomCard();
-          } else {
-            Serial.println("Flipcard: Next card");
-            goToNextCard();
-          }
-        } else if (touchOnHomeButton) {
-          if (isRandomMode) {
-            Serial.println("Flipcard: Home button - back to categories (random mode)");
-            goToCategoryMode();
+        // Save new default language
+        if (saveDefaultLanguage(configDoc, selectedLang)) {
+          Serial.println("Successfully saved new default language");
+          
+          // Reload config to update global state
+          if (loadConfig()) {
+            Serial.println("Config reloaded successfully");
+            Serial.printf("New default language is now: %s (index %d)\n", defaultLanguage.c_str(), currentLanguageIndex);
           } else {
-            Serial.println("Flipcard: Home button - back to grid");
-            goToGridMode();
+            Serial.println("Failed to reload config");
           }
-        } else {
-          // Define center area bounds (big and small image areas)
-          int bigWidth = 400, bigHeight = 150;
-          int smallWidth = 400, smallHeight = 80;
-          
-          int bigX = (screenWidth - bigWidth) / 2;
-          int smallX = (screenWidth - smallWidth) / 2;
-          int bigY = 180;
-          int smallY = bigY + bigHeight + 5;
           
-          // Check if touch is in the center area (big or small image)
-          bool touchInCenter = (touchX >= bigX && touchX <= bigX + bigWidth && 
-                               touchY >= bigY && touchY <= smallY + smallHeight);
-          
-          if (touchInCenter) {
-            Serial.printf("Touch detected in center area at (%d, %d)\n", touchX, touchY);
-            // Cycle to next language
-            cycleToNextLanguage();
-            
-            // Refresh only the language images using JSON data (more efficient)
-            String folderPath = getCurrentCardFolder();
-            String currentLang = getCurrentLanguage();
-            refreshLanguageImages(currentCardDoc, folderPath, currentLang);
+          // Return to option page
+          if (!goBack()) {
+            goToOptionMode();
           }
+        } else {
+          Serial.println("Failed to save new default language");
         }
-        M5.update();
       }
     }
+    
+  } else { // FLIPCARD_MODE
+    // Handle flipcard touch (existing logic)
+    const DisplayProfile& layout = displayProfile();
+    
+    // Check navigation buttons
+    bool touchOnLeftButton = layout.navLeft.contains(touchX, touchY);
+    bool touchOnRightButton = layout.navRight.contains(touchX, touchY);
+    bool touchOnHomeButton = layout.navHome.contains(touchX, touchY);
+    
+    if (touchOnLeftButton) {
+      if (isRandomMode) {
+        Serial.println("Flipcard: Random previous card");
+        goToRandomCard();
+      } else {
+        Serial.println("Flipcard: Previous card");
+        goToPreviousCard();
+      }
+    } else if (touchOnRightButton) {
+      if (isRandomMode) {
+        Serial.println("Flipcard: Random next card");
+        goToRandomCard();
+      } else {
+        Serial.println("Flipcard: Next card");
+        goToNextCard();
+      }
+    } else if (touchOnHomeButton) {
+      Serial.println("Flipcard: Home button - back to grid/categories");
+      leaveFlipcard();
+    } else {
+      // Check if touch is in the center area (big or small image)
+      bool touchInCenter = layout.bigText.contains(touchX, touchY) || layout.smallText.contains(touchX, touchY);
+      
+      if (touchInCenter) {
+        Serial.printf("Touch detected in center area at (%d, %d)\n", touchX, touchY);
+        // Cycle to next language
+        EnergyOperationScope operation(ENERGY_OP_LANGUAGE);
+        traceInteraction(TRACE_LANGUAGE_CYCLE);
+        cycleToNextLanguage();
+        
+        // Refresh only the language images using JSON data (more efficient)
+        String folderPath = getCurrentCardFolder();
+        String currentLang = getCurrentLanguage();
+        refreshLanguageImages(currentCardDoc, folderPath, currentLang);
+      }
+    }
+    M5.update();
+  }
+}
+
+// Gesture handlers: swipes page/flip in the current view
+void handleSwipe(const GestureEvent& event) {
+  bool forward = (event.type == GESTURE_SWIPE_LEFT); // Finger moved right-to-left
+  
+  if (currentPageMode == FLIPCARD_MODE) {
+    if (isRandomMode) {
+      Serial.println("Flipcard: Swipe - random card");
+      goToRandomCard();
+    } else if (forward) {
+      Serial.println("Flipcard: Swipe - next card");
+      goToNextCard();
+    } else {
+      Serial.println("Flipcard: Swipe - previous card");
+      goToPreviousCard();
+    }
+  } else if (currentPageMode == GRID_MODE && totalGridPages > 1) {
+    if (forward) {
+      goToNextGridPage();
+    } else {
+      goToPreviousGridPage();
+    }
+  } else if (currentPageMode == CATEGORY_MODE && getCategoryPageCount(indexDoc) > 1) {
+    if (forward) {
+      goToNextCategoryPage();
+    } else {
+      goToPreviousCategoryPage();
+    }
+  } else if (currentPageMode == COLLECTION_MODE && getCollectionPageCount() > 1) {
+    if (forward) {
+      goToNextCollectionPage();
+    } else {
+      goToPreviousCollectionPage();
+    }
+  }
+}
+
+void handleLongPress(const GestureEvent& event) {
+  if (currentPageMode == FLIPCARD_MODE) {
+    // Same as the Home button
+    Serial.println("Flipcard: Long-press - back to grid/categories");
+    leaveFlipcard();
+  }
+}
+
+void handleTwoFingerTap(const GestureEvent& event) {
+  if (currentPageMode == FLIPCARD_MODE) {
+    // Cycle language from anywhere on the card
+    EnergyOperationScope operation(ENERGY_OP_LANGUAGE);
+    traceInteraction(TRACE_LANGUAGE_CYCLE);
+    cycleToNextLanguage();
+    String folderPath = getCurrentCardFolder();
+    String currentLang = getCurrentLanguage();
+    refreshLanguageImages(currentCardDoc, folderPath, currentLang);
+  }
+}
+
+void onTapGesture(const GestureEvent& event) {
+  handleTap(event.x, event.y);
+}
+
+void loop() {
+  M5.update();
+  
+  // Serial commands (touch trace record/replay, deck sync, scripted control)
+  consolePoll();
+  if (syncActive() || controlBusy()) {
+    // A sync session or scripted action keeps the device awake
+    lastActivityTime = millis();
+  }
+  
+  // Sample touch into the gesture queue; recognized gestures are dispatched
+  // to the handlers subscribed in setup(). A trace replay or touches
+  // injected with "ctl" stand in for the touch panel.
+  if (traceReplaying()) {
+    traceReplayPoll();
+  } else if (controlInjecting()) {
+    controlPoll();
+  } else {
+    gesturePoll();
+  }
+  if (gestureTouchActive() || traceReplaying() || controlInjecting()) {
+    // Reset activity timer on any touch
+    lastActivityTime = millis();
+    pauseSlideshow();
+  }
+  gestureProcess();
+  
+  // Next slideshow step: render ahead, sleep, flip at the deadline
+  slideshowTick();
+  
+  // Render the next screensaver while idle so sleep entry only blits it
+  if (millis() - lastActivityTime > SCREENSAVER_PREPARE_IDLE_MS) {
+    prepareScreensaver();
   }
   
   // Check for sleep timeout
   checkDeepSleep();
   
-  delay(50);
+  // Panel refresh time, finished operations and battery samples
+  energyTick();
+  
+  // Tap-to-ink latency of the last interaction, and the reply to a scripted action
+  traceTick();
+  controlTick();
+  
+  // Sample faster while a finger is down so swipes are detected early, and
+  // while a traced or scripted interaction waits for its refresh; during a
+  // sync the next command is waiting on the serial link
+  EnergyScope idle(ENERGY_IDLE);
+  delay(syncActive() ? 1 : gestureTouchActive() || traceBusy() || controlBusy() ? 10 : 50);
 }
\ No newline at end of file
@@ -1,118 +1,137 @@
 #include "category_page.h"
+#include "grid_page.h"
 #include <M5Unified.h>
 #include <SD.h>
+#include "../core/sd_stream.h"
+#include "../core/glyph_cache.h"
+#include "../core/display_profile.h"
+#include "../core/card_facets.h"
 #include <vector>
 
 // Layout constants
 const int CATEGORY_ITEM_HEIGHT = 80;
 const int CATEGORY_PADDING = 20;
 const int CATEGORY_START_Y = 200;  // Moved down to make room for home icon
-const int NAV_BUTTON_SIZE = 80;
-const int NAV_BUTTON_MARGIN = 20;
+const int CATEGORY_ROW_PITCH = CATEGORY_ITEM_HEIGHT + CATEGORY_PADDING;
+const int CATEGORY_TEXT_SIZE = 32;
 
+// All categories with precomputed counts (rebuilt after each index load or update)
 static std::vector<CategoryInfo> categories;
+static bool categoriesBuilt = false;
 
-void drawCategoryPage(JsonDocument& indexDoc) {
-    drawCategoryPage(indexDoc, false);
-}
+// Currently displayed window
+static int visiblePage = 0;
+
+// Build category list; counts come from the category bitsets, so no pass over the cards
+static void buildCategoryList(JsonDocument& indexDoc) {
+    if (categoriesBuilt) {
+        return;
+    }
 
-void drawCategoryPage(JsonDocument& indexDoc, bool isRandomMode) {
-    auto& display = M5.Display;
-    display.clear();
-    
-    // Setup categories from JSON
     categories.clear();
-    
-    // Count number of cards per category
-    JsonArray cards = indexDoc["cards"];
+
     JsonObject categoriesObj = indexDoc["categories"];
-    
-    // Loop through categories in JSON
     for (JsonPair categoryPair : categoriesObj) {
-        String categoryId = categoryPair.key().c_str();
-        String categoryName = categoryPair.value()["name"].as<String>();
-        
-        // Count number of cards for this category
-        int count = 0;
-        for (JsonObject card : cards) {
-            if (card["category"].as<String>() == categoryId) {
-                count++;
-            }
-        }
-        
-        // Add to categories list
         CategoryInfo info;
-        info.id = categoryId;
-        info.name = categoryName;
-        info.count = count;
-        
-        // Calculate position
-        int index = categories.size();
-        info.x = CATEGORY_PADDING;
-        info.y = CATEGORY_START_Y + (index * (CATEGORY_ITEM_HEIGHT + CATEGORY_PADDING));
-        info.width = display.width() - (2 * CATEGORY_PADDING);
-        info.height = CATEGORY_ITEM_HEIGHT;
-        
+        info.id = categoryPair.key().c_str();
+        info.name = categoryPair.value()["name"].as<String>();
+        info.count = categoryCardCount(info.id);
         categories.push_back(info);
     }
-    
-    // Draw home icon at same position as grid page
-    int screenWidth = display.width();
-    int homeButtonX = (screenWidth - NAV_BUTTON_SIZE) / 2;  // Centered horizontally
-    int homeButtonY = NAV_BUTTON_MARGIN + 15;  // Same Y as grid page buttons
-    
-    // Load home button PNG
-    File homeFile = SD.open("/flipcard/Home.png");
-    if (homeFile) {
-        M5.Display.drawPng(&homeFile, homeButtonX, homeButtonY, NAV_BUTTON_SIZE, NAV_BUTTON_SIZE);
-        homeFile.close();
-    } else {
-        // Fallback: draw simple home icon
-        display.fillRoundRect(homeButtonX, homeButtonY, NAV_BUTTON_SIZE, NAV_BUTTON_SIZE, 8, TFT_DARKGREY);
-        display.setTextColor(TFT_WHITE);
-        display.setTextSize(3);
-        display.setCursor(homeButtonX + 20, homeButtonY + 20);
-        display.print("H");
+
+    categoriesBuilt = true;
+    Serial.printf("Built category list: %d categories\n", categories.size());
+}
+
+void invalidateCategoryList() {
+    categoriesBuilt = false;
+    categories.clear();
+}
+
+// Number of rows that fit between the header and the bottom of the screen
+int getCategoryRowsPerPage() {
+    int rows = (M5.Display.height() - CATEGORY_START_Y) / CATEGORY_ROW_PITCH;
+    return rows > 0 ? rows : 1;
+}
+
+int getCategoryPageCount(JsonDocument& indexDoc) {
+    buildCategoryList(indexDoc);
+    int rowsPerPage = getCategoryRowsPerPage();
+    int pages = (categories.size() + rowsPerPage - 1) / rowsPerPage;
+    return pages > 0 ? pages : 1;
+}
+
+void restoreCategoryPageState(JsonDocument& indexDoc, int categoryPage) {
+    int totalPages = getCategoryPageCount(indexDoc);
+    visiblePage = (categoryPage >= 0 && categoryPage < totalPages) ? categoryPage : 0;
+}
+
+void drawCategoryPage(JsonDocument& indexDoc) {
+    drawCategoryPage(indexDoc, false, 0);
+}
+
+void drawCategoryPage(JsonDocument& indexDoc, bool isRandomMode, int categoryPage) {
+    auto& display = M5.Display;
+    display.clear();
+
+    buildCategoryList(indexDoc);
+
+    int totalPages = getCategoryPageCount(indexDoc);
+    if (categoryPage < 0 || categoryPage >= totalPages) {
+        categoryPage = 0;
     }
-    
+    visiblePage = categoryPage;
+
+    // Paging controls and home icon, same as the grid page
+    drawGridNavigationButtons(categoryPage, totalPages);
+
     // Header (moved down slightly)
-    display.setFont(&fonts::efontCN_16);
-    display.setTextSize(2);
-    display.setTextColor(TFT_BLACK);
-    if (isRandomMode) {
-        display.drawString("Categories (Random Mode)", 20, 120);
-    } else {
-        display.drawString("Categories", 20, 120);
+    String header = isRandomMode ? "Categories (Random Mode)" : "Categories";
+    if (totalPages > 1) {
+        header += " " + String(categoryPage + 1) + "/" + String(totalPages);
     }
-    
-    // Draw categories
-    for (const auto& category : categories) {
+    drawCachedText(display, header, 20, 120, CATEGORY_TEXT_SIZE);
+
+    // Draw only the visible window of categories
+    int rowsPerPage = getCategoryRowsPerPage();
+    int first = categoryPage * rowsPerPage;
+    int last = min(first + rowsPerPage, (int)categories.size());
+    int itemWidth = display.width() - (2 * CATEGORY_PADDING);
+
+    for (int i = first; i < last; i++) {
+        const CategoryInfo& category = categories[i];
+        int itemY = CATEGORY_START_Y + (i - first) * CATEGORY_ROW_PITCH;
+
         // Background box
-        display.fillRoundRect(category.x, category.y, category.width, category.height, 10, TFT_LIGHTGREY);
-        
-        // Category name and count
-        display.setTextColor(TFT_BLACK);
-        display.setTextSize(2);
+        display.fillRoundRect(CATEGORY_PADDING, itemY, itemWidth, CATEGORY_ITEM_HEIGHT, 10, TFT_LIGHTGREY);
+
+        // Category name and count (light grey background = gray level 12)
         String text = category.name + " (" + String(category.count) + ")";
-        display.drawString(text.c_str(), category.x + 20, category.y + (category.height/2) - 15);
+        drawCachedText(display, text, CATEGORY_PADDING + 20, itemY + (CATEGORY_ITEM_HEIGHT/2) - 15, CATEGORY_TEXT_SIZE, 12);
     }
-    
-    // No back button needed for category page
-    
+
     display.display();
 }
 
 bool isTouchOnCategory(int x, int y, String& selectedCategoryId) {
-    // Check categories
-    for (const auto& category : categories) {
-        if (x >= category.x && x <= category.x + category.width &&
-            y >= category.y && y <= category.y + category.height) {
-            selectedCategoryId = category.id;
-            return true;
-        }
+    // Resolve the row directly from the touch position
+    if (x < CATEGORY_PADDING || x > M5.Display.width() - CATEGORY_PADDING || y < CATEGORY_START_Y) {
+        return false;
     }
-    
-    return false;
+
+    int row = (y - CATEGORY_START_Y) / CATEGORY_ROW_PITCH;
+    int offsetInRow = (y - CATEGORY_START_Y) % CATEGORY_ROW_PITCH;
+    if (row >= getCategoryRowsPerPage() || offsetInRow > CATEGORY_ITEM_HEIGHT) {
+        return false; // Below the list or in the gap between rows
+    }
+
+    int index = visiblePage * getCategoryRowsPerPage() + row;
+    if (index >= categories.size()) {
+        return false;
+    }
+
+    selectedCategoryId = categories[index].id;
+    return true;
 }
 
 String getCategoryIdFromTouch(int x, int y, JsonDocument& indexDoc) {
@@ -124,10 +143,6 @@ String getCategoryIdFromTouch(int x, int y, JsonDocument& indexDoc) {
 }
 
 bool isTouchOnCategoryHomeButton(int x, int y) {
-    int screenWidth = 540;  // M5.Display.width()
-    int homeButtonX = (screenWidth - NAV_BUTTON_SIZE) / 2;  // Centered horizontally
-    int homeButtonY = NAV_BUTTON_MARGIN + 15;  // Same Y as grid page buttons
-    
-    return (x >= homeButtonX && x <= homeButtonX + NAV_BUTTON_SIZE &&
-            y >= homeButtonY && y <= homeButtonY + NAV_BUTTON_SIZE);
+    // Same button as the grid page pager
+    return displayProfile().pagerHome.contains(x, y);
 }
\ No newline at end of file
@@ -6,11 +6,20 @@ struct CategoryInfo {
     String id;           // "transport", "technology"
     String name;         // "Transportation", "Technology"
     int count;           // Number of cards in category
-    int x, y, width, height;  // Touch area
 };
 
 void drawCategoryPage(JsonDocument& indexDoc);
-void drawCategoryPage(JsonDocument& indexDoc, bool isRandomMode);
+void drawCategoryPage(JsonDocument& indexDoc, bool isRandomMode, int categoryPage = 0);
 bool isTouchOnCategory(int x, int y, String& selectedCategoryId);
 String getCategoryIdFromTouch(int x, int y, JsonDocument& indexDoc);
-bool isTouchOnCategoryHomeButton(int x, int y);
\ No newline at end of file
+bool isTouchOnCategoryHomeButton(int x, int y);
+
+// Paging of the category list (only the visible rows are drawn)
+int getCategoryRowsPerPage();
+int getCategoryPageCount(JsonDocument& indexDoc);
+
+// Touch areas for a category page shown from a snapshot instead of drawn
+void restoreCategoryPageState(JsonDocument& indexDoc, int categoryPage);
+
+// Drop precomputed categories/counts (call after index.json is reloaded)
+void invalidateCategoryList();
\ No newline at end of file
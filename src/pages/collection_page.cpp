@@ -0,0 +1,133 @@
+#include "collection_page.h"
+#include "grid_page.h"
+#include <M5Unified.h>
+#include <SD.h>
+#include <ArduinoJson.h>
+#include "../core/glyph_cache.h"
+#include "../core/display_profile.h"
+#include <vector>
+
+// Layout (same frame as the language selection page)
+const int COLLECTION_START_Y = 180;
+const int COLLECTION_ROW_X = 50;
+const int COLLECTION_ROW_WIDTH = 440;
+const int COLLECTION_ROW_HEIGHT = 90;
+const int COLLECTION_ROW_PITCH = 100;
+const int COLLECTION_TEXT_SIZE = 32;
+const int COLLECTION_DETAIL_SIZE = 24;
+
+// All collections on the card (listed once per visit) and the page shown
+static std::vector<DeckInfo> decks;
+static bool decksListed = false;
+static int visiblePage = 0;
+
+static void listCollections() {
+    if (!decksListed) {
+        // Only each index.json's metadata is read here; cards load when a collection is opened
+        decks = listDecks();
+        decksListed = true;
+    }
+}
+
+void invalidateCollectionList() {
+    decksListed = false;
+    decks.clear();
+}
+
+static int collectionRowsPerPage() {
+    int rows = (M5.Display.height() - COLLECTION_START_Y) / COLLECTION_ROW_PITCH;
+    return rows > 0 ? rows : 1;
+}
+
+int getCollectionPageCount() {
+    listCollections();
+    int rowsPerPage = collectionRowsPerPage();
+    int pages = (decks.size() + rowsPerPage - 1) / rowsPerPage;
+    return pages > 0 ? pages : 1;
+}
+
+void drawCollectionPage(const String& activeRoot, int collectionPage) {
+    auto& display = M5.Display;
+    display.clear();
+    
+    int totalPages = getCollectionPageCount();
+    if (collectionPage < 0 || collectionPage >= totalPages) {
+        collectionPage = 0;
+    }
+    visiblePage = collectionPage;
+    
+    // Paging controls and home icon (returns to options), as on the category page
+    drawGridNavigationButtons(collectionPage, totalPages);
+    
+    String header = "Collections";
+    if (totalPages > 1) {
+        header += " " + String(collectionPage + 1) + "/" + String(totalPages);
+    }
+    drawCachedText(display, header, 20, 120, COLLECTION_TEXT_SIZE);
+    
+    int rowsPerPage = collectionRowsPerPage();
+    int first = collectionPage * rowsPerPage;
+    int last = min(first + rowsPerPage, (int)decks.size());
+    
+    for (int i = first; i < last; i++) {
+        const DeckInfo& deck = decks[i];
+        int rowY = COLLECTION_START_Y + (i - first) * COLLECTION_ROW_PITCH;
+        
+        display.fillRect(COLLECTION_ROW_X, rowY, COLLECTION_ROW_WIDTH, COLLECTION_ROW_HEIGHT, TFT_WHITE);
+        display.drawRect(COLLECTION_ROW_X, rowY, COLLECTION_ROW_WIDTH, COLLECTION_ROW_HEIGHT, TFT_BLACK);
+        
+        // Add asterisk (*) for the active collection
+        String title = (deck.root == activeRoot ? "* " : "") + deck.name;
+        drawCachedText(display, title, COLLECTION_ROW_X + 20, rowY + 10, COLLECTION_TEXT_SIZE);
+        String detail = deck.root + " - " + String(deck.totalCards) + " cards";
+        drawCachedText(display, detail, COLLECTION_ROW_X + 20, rowY + 52, COLLECTION_DETAIL_SIZE);
+    }
+    
+    if (decks.empty()) {
+        drawCachedText(display, "No collections found", COLLECTION_ROW_X, COLLECTION_START_Y, COLLECTION_TEXT_SIZE);
+    }
+    
+    Serial.printf("Displayed collections %d-%d of %d\n", first + 1, last, decks.size());
+}
+
+bool isTouchOnCollectionHomeButton(int x, int y) {
+    // Same button as the grid page pager
+    return displayProfile().pagerHome.contains(x, y);
+}
+
+String handleCollectionTouch(int x, int y) {
+    if (x < COLLECTION_ROW_X || x > COLLECTION_ROW_X + COLLECTION_ROW_WIDTH || y < COLLECTION_START_Y) {
+        return "";
+    }
+    
+    int row = (y - COLLECTION_START_Y) / COLLECTION_ROW_PITCH;
+    int offsetInRow = (y - COLLECTION_START_Y) % COLLECTION_ROW_PITCH;
+    int index = visiblePage * collectionRowsPerPage() + row;
+    if (row >= collectionRowsPerPage() || index >= decks.size() || offsetInRow > COLLECTION_ROW_HEIGHT) {
+        return "";
+    }
+    
+    Serial.printf("Selected collection: %s\n", decks[index].root.c_str());
+    return decks[index].root;
+}
+
+bool saveActiveCollection(JsonDocument& configDoc, const String& root) {
+    // The loaded config is the current file; it is edited in place and written out
+    configDoc["storage"]["active_collection"] = root;
+    
+    File file = SD.open("/flipcard/config.json", FILE_WRITE);
+    if (!file) {
+        Serial.println("Failed to open config.json for writing");
+        return false;
+    }
+    
+    if (serializeJson(configDoc, file) == 0) {
+        Serial.println("Failed to write config.json");
+        file.close();
+        return false;
+    }
+    
+    file.close();
+    Serial.printf("Saved active collection %s to config.json\n", root.c_str());
+    return true;
+}
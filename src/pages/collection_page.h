@@ -0,0 +1,21 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "../core/deck.h"
+
+// Draw one page of the deck collections found on the SD card (active one marked with *)
+void drawCollectionPage(const String& activeRoot, int collectionPage = 0);
+
+// Paging of the collection list (same pager buttons as the category page)
+int getCollectionPageCount();
+bool isTouchOnCollectionHomeButton(int x, int y);
+
+// Rescan the SD card for collections on the next draw
+void invalidateCollectionList();
+
+// Handle touch input for the collection page
+// Returns the selected collection root, empty string if none
+String handleCollectionTouch(int x, int y);
+
+// Remember the active collection in the loaded config and config.json (storage.active_collection)
+bool saveActiveCollection(JsonDocument& configDoc, const String& root);
@@ -0,0 +1,117 @@
+#include "energy_page.h"
+#include "option_page.h"
+#include <M5Unified.h>
+#include "../core/energy.h"
+#include "../core/glyph_cache.h"
+#include "../core/display_profile.h"
+
+// Layout (text origin and export button come from the display profile)
+const int ENERGY_LINE_PITCH = 34;
+const int ENERGY_TITLE_SIZE = 32;
+const int ENERGY_TEXT_SIZE = 24;
+
+static String formatDuration(uint64_t micros) {
+    uint32_t seconds = micros / 1000000;
+    char text[24];
+    if (seconds >= 3600) {
+        snprintf(text, sizeof(text), "%luh %02lum", (unsigned long)(seconds / 3600), (unsigned long)(seconds / 60 % 60));
+    } else if (seconds >= 60) {
+        snprintf(text, sizeof(text), "%lum %02lus", (unsigned long)(seconds / 60), (unsigned long)(seconds % 60));
+    } else {
+        snprintf(text, sizeof(text), "%.1fs", micros / 1000000.0f);
+    }
+    return String(text);
+}
+
+void drawEnergyPage(const char* status) {
+    auto& display = M5.Display;
+    display.clear();
+    
+    // Draw home button (returns to options)
+    drawOptionHomeButton();
+    
+    drawCachedText(display, "Energy Report", 20, 120, ENERGY_TITLE_SIZE);
+    
+    const DisplayProfile& layout = displayProfile();
+    const EnergyReport& report = getEnergyReport();
+    int textX = layout.energyTextX;
+    int lineY = layout.energyTextY;
+    char line[96];
+    
+    uint64_t uptime = 0;
+    for (int i = 0; i < ENERGY_CPU_STATE_COUNT; i++) {
+        uptime += report.micros[i];
+    }
+    drawCachedText(display, "Uptime " + formatDuration(uptime), textX, lineY, ENERGY_TEXT_SIZE);
+    lineY += ENERGY_LINE_PITCH;
+    
+    // Measured: battery voltage and its drain since the charger was unplugged
+    if (report.batteryCount > 0) {
+        const EnergyBatterySample& latest = report.battery[report.batteryCount - 1];
+        float drain = energyBatteryDrainPerHour();
+        int length = snprintf(line, sizeof(line), "Battery %d mV", latest.millivolts);
+        if (latest.level >= 0) {
+            length += snprintf(line + length, sizeof(line) - length, " (%d%%)", latest.level);
+        }
+        if (latest.charging) {
+            snprintf(line + length, sizeof(line) - length, ", charging");
+        } else if (drain != 0) {
+            snprintf(line + length, sizeof(line) - length, ", -%.0f mV/h", drain);
+        }
+        drawCachedText(display, line, textX, lineY, ENERGY_TEXT_SIZE);
+        lineY += ENERGY_LINE_PITCH;
+    }
+    lineY += ENERGY_LINE_PITCH / 2;
+    
+    // Estimated: time per state times the power model
+    drawCachedText(display, "Time and estimated energy", textX, lineY, ENERGY_TEXT_SIZE);
+    lineY += ENERGY_LINE_PITCH;
+    for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+        uint64_t only[ENERGY_STATE_COUNT] = {0};
+        only[i] = report.micros[i];
+        snprintf(line, sizeof(line), "  %s: %s, %.1f J", energyStateName(i), formatDuration(report.micros[i]).c_str(),
+                 energyMillijoules(only) / 1000.0f);
+        drawCachedText(display, line, textX, lineY, ENERGY_TEXT_SIZE);
+        lineY += ENERGY_LINE_PITCH;
+    }
+    lineY += ENERGY_LINE_PITCH / 2;
+    
+    // Average per operation, including the panel refresh it triggered
+    // (its own column on wide panels, where the page is too short for both)
+    if (layout.energySecondColumnX > 0) {
+        textX = layout.energySecondColumnX;
+        lineY = layout.energyTextY;
+    }
+    drawCachedText(display, "Average per operation", textX, lineY, ENERGY_TEXT_SIZE);
+    lineY += ENERGY_LINE_PITCH;
+    for (int op = 0; op < ENERGY_OP_COUNT; op++) {
+        const EnergyOperationTotals& totals = report.operations[op];
+        if (totals.count == 0) {
+            snprintf(line, sizeof(line), "  %s: none yet", energyOperationName(op));
+        } else {
+            uint64_t busy = 0;
+            for (int i = 0; i < ENERGY_CPU_STATE_COUNT; i++) {
+                busy += totals.micros[i];
+            }
+            snprintf(line, sizeof(line), "  %s x%lu: %lu ms, %.2f J", energyOperationName(op),
+                     (unsigned long)totals.count, (unsigned long)(busy / totals.count / 1000),
+                     energyMillijoules(totals.micros) / 1000.0f / totals.count);
+        }
+        drawCachedText(display, line, textX, lineY, ENERGY_TEXT_SIZE);
+        lineY += ENERGY_LINE_PITCH;
+    }
+    
+    const LayoutRect& exportButton = layout.energyExport;
+    if (status) {
+        drawCachedText(display, status, textX, exportButton.y - ENERGY_LINE_PITCH - 10, ENERGY_TEXT_SIZE);
+    }
+    
+    // Export button: write the same numbers as CSV
+    display.fillRect(exportButton.x, exportButton.y, exportButton.w, exportButton.h, TFT_WHITE);
+    display.drawRect(exportButton.x, exportButton.y, exportButton.w, exportButton.h, TFT_BLACK);
+    drawCachedText(display, "Export CSV", exportButton.x + 80, exportButton.y + exportButton.h / 2 - 10, ENERGY_TITLE_SIZE);
+}
+
+bool isTouchOnEnergyExportButton(int x, int y) {
+    return displayProfile().energyExport.contains(x, y);
+}
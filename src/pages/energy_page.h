@@ -0,0 +1,10 @@
+#pragma once
+#include <Arduino.h>
+
+// Draw the battery/performance report: time and estimated energy per state,
+// average cost per operation type and the measured battery drain.
+// status (optional) is shown above the export button.
+void drawEnergyPage(const char* status = nullptr);
+
+// Check if touch is on the Export CSV button
+bool isTouchOnEnergyExportButton(int x, int y);
@@ -2,167 +2,502 @@
 #include <M5Unified.h>
 #include <SD.h>
 #include <ArduinoJson.h>
+#include "../core/sd_stream.h"
+#include "../core/deck.h"
+#include "../core/glyph_cache.h"
+#include "../core/jpeg_decode.h"
+#include "../core/energy.h"
+#include "empty_frame_page.h"
+#include "../core/display_profile.h"
 
-// Helper function to load PNG using file handle
-bool loadPngFromFile(const char* filename, int x, int y, int width, int height) {
-  File file = SD.open(filename);
-  if (!file) {
-    return false;
+// Largest glyph sizes for the language regions (text shrinks to fit the width)
+const int BIG_TEXT_MAX_SIZE = 96;
+const int SMALL_TEXT_MAX_SIZE = 40;
+
+// Dithering applied to the photo-like main image (set from config.json)
+static DitherMode mainImageDitherMode = DITHER_DIFFUSION;
+
+void setMainImageDitherMode(DitherMode mode) {
+  mainImageDitherMode = mode;
+}
+
+// Draw big_text/small_text with the glyph cache instead of the language PNGs
+static bool languageTextMode = false;
+
+void setLanguageTextMode(bool enabled) {
+  languageTextMode = enabled;
+}
+
+// Function to draw one language field: rendered text when available, otherwise its PNG
+static bool drawLanguageField(JsonDocument& cardData, const String& currentLanguage, const char* textKey,
+                              const String& imagePath, int x, int y, int width, int height, int maxPixelSize) {
+  if (languageTextMode) {
+    String text = cardData["languages"][currentLanguage][textKey] | "";
+    if (text.length() > 0 && drawCachedTextInRegion(imageDrawTarget(), text, x, y, width, height, maxPixelSize)) {
+      return true;
+    }
+    Serial.printf("No %s for %s, falling back to PNG\n", textKey, currentLanguage.c_str());
   }
-  
-  bool result = M5.Display.drawPng(&file, x, y, width, height);
-  file.close();
-  
-  return result;
+  return loadPngFromFile(imagePath.c_str(), x, y, width, height);
 }
 
-// Function to draw navigation buttons (separated for modularity)
-void drawNavigationButtons() {
-  int screenWidth = M5.Display.width();
-  
-  // Draw navigation buttons (80x80 pixels)
-  int buttonSize = 80;
-  int buttonMargin = 20;
+// Helper function to load a PNG or JPEG through the read-ahead SD stream
+bool loadPngFromFile(const char* filename, int x, int y, int width, int height) {
+  return drawImageFromSd(filename, x, y, width, height);
+}
+
+// Helper function to load a photo-like PNG: decode to RGB888 off-screen,
+// then convert to the panel's 16 gray levels with dithering
+bool loadDitheredPngFromFile(const char* filename, int x, int y, int width, int height, DitherMode mode) {
+  EnergyScope decode(ENERGY_DECODE);
+  if (isJpegPath(filename)) {
+    // Decoded to gray at the reduced size directly, no RGB canvas
+    return drawJpegFromSd(filename, x, y, width, height, mode);
+  }
+  if (mode == DITHER_NONE) {
+    return loadPngFromFile(filename, x, y, width, height);
+  }
   
-  // Left button position (add 25px to both top and left)
-  int leftButtonX = buttonMargin + 25;  // 45px from left edge
-  int leftButtonY = buttonMargin + 25;  // 45px from top edge
+  M5Canvas source;
+  source.setPsram(true);
+  source.setColorDepth(lgfx::rgb888_3Byte);
+  M5Canvas target;
+  target.setPsram(true);
+  target.setColorDepth(4);
+  if (!source.createSprite(width, height) || !target.createSprite(width, height)) {
+    Serial.println("Dither canvases unavailable, drawing directly");
+    return loadPngFromFile(filename, x, y, width, height);
+  }
   
-  // Right button position (add 25px to both top and right)
-  int rightButtonX = screenWidth - buttonSize - buttonMargin - 25;  // 45px from right edge
-  int rightButtonY = buttonMargin + 25;  // 45px from top edge
+  SdStream stream;
+  if (!stream.open(filename)) {
+    return false;
+  }
+  source.fillScreen(TFT_WHITE);
+  bool result = source.drawPng(&stream, 0, 0, width, height);
+  stream.close();
+  if (!result) {
+    return false;
+  }
   
-  // Home button position (center between left and right)
-  int homeButtonX = (screenWidth - buttonSize) / 2;  // Centered horizontally
-  int homeButtonY = buttonMargin + 25;  // Same Y as other buttons (45px from top)
+  // Palette index == gray level, so packed rows can be written directly
+  for (int i = 0; i < 16; i++) {
+    target.setPaletteColor(i, i * 17, i * 17, i * 17);
+  }
+  uint8_t* packed = (uint8_t*)target.getBuffer();
+  uint32_t rowBytes = target.bufferLength() / height;
   
-  // Draw left button
-  Serial.println("Loading left button: /flipcard/Left.png");
-  if (!loadPngFromFile("/flipcard/Left.png", leftButtonX, leftButtonY, buttonSize, buttonSize)) {
-    Serial.println("Failed to load left button");
-    M5.Display.fillRect(leftButtonX, leftButtonY, buttonSize, buttonSize, 0x07E0); // Green fallback
-    M5.Display.drawRect(leftButtonX, leftButtonY, buttonSize, buttonSize, 0x0000);
+  int errLength = ditherErrorRowLength(width);
+  uint8_t* rgbRow = (uint8_t*)malloc(width * 3);
+  int16_t* errRows = (int16_t*)calloc(errLength * 2, sizeof(int16_t));
+  if (!rgbRow || !errRows) {
+    free(rgbRow);
+    free(errRows);
+    source.pushSprite(&imageDrawTarget(), x, y);
+    return true;
   }
   
-  // Draw right button
-  Serial.println("Loading right button: /flipcard/Right.png");
-  if (!loadPngFromFile("/flipcard/Right.png", rightButtonX, rightButtonY, buttonSize, buttonSize)) {
-    Serial.println("Failed to load right button");
-    M5.Display.fillRect(rightButtonX, rightButtonY, buttonSize, buttonSize, 0xF800); // Red fallback
-    M5.Display.drawRect(rightButtonX, rightButtonY, buttonSize, buttonSize, 0x0000);
+  int16_t* errCurrent = errRows;
+  int16_t* errNext = errRows + errLength;
+  for (int row = 0; row < height; row++) {
+    source.readRectRGB(0, row, width, 1, rgbRow);
+    rgb888ToGray4Row(rgbRow, packed + row * rowBytes, width, row, mode, errCurrent, errNext);
+    int16_t* swap = errCurrent;
+    errCurrent = errNext;
+    errNext = swap;
   }
+  free(rgbRow);
+  free(errRows);
   
-  // Draw home button (Home.png)
-  Serial.println("Loading home button: /flipcard/Home.png");
-  if (!loadPngFromFile("/flipcard/Home.png", homeButtonX, homeButtonY, buttonSize, buttonSize)) {
-    Serial.println("Failed to load home button");
-    M5.Display.fillRect(homeButtonX, homeButtonY, buttonSize, buttonSize, 0x001F); // Blue fallback
-    M5.Display.drawRect(homeButtonX, homeButtonY, buttonSize, buttonSize, 0x0000);
+  target.pushSprite(&imageDrawTarget(), x, y);
+  return true;
+}
+
+// Function to draw one navigation button, with a colored box when its PNG is missing
+static void drawNavigationButton(const char* file, const LayoutRect& rect, uint16_t fallbackColor) {
+  String path = assetForLayout(file, ASSET_BUTTON);
+  Serial.printf("Loading button: %s\n", path.c_str());
+  if (!loadPngFromFile(path.c_str(), rect.x, rect.y, rect.w, rect.h)) {
+    Serial.printf("Failed to load %s\n", path.c_str());
+    imageDrawTarget().fillRect(rect.x, rect.y, rect.w, rect.h, fallbackColor);
+    imageDrawTarget().drawRect(rect.x, rect.y, rect.w, rect.h, 0x0000);
   }
 }
 
+// Function to draw navigation buttons (separated for modularity)
+void drawNavigationButtons() {
+  const DisplayProfile& layout = displayProfile();
+  drawNavigationButton("/flipcard/Left.png", layout.navLeft, 0x07E0);   // Green fallback
+  drawNavigationButton("/flipcard/Right.png", layout.navRight, 0xF800); // Red fallback
+  drawNavigationButton("/flipcard/Home.png", layout.navHome, 0x001F);   // Blue fallback
+}
+
 // Main flipcard display function (JSON-driven)
 void drawFlipcard(JsonDocument& cardData, String folderPath, String currentLanguage) {
-  int screenWidth = M5.Display.width();
-  int screenHeight = M5.Display.height();
+  const DisplayProfile& layout = displayProfile();
   
   // Get filenames from JSON using dynamic language key
   String bigImageFile = cardData["languages"][currentLanguage]["big_file"];
   String smallImageFile = cardData["languages"][currentLanguage]["small_file"];
   String mainImageFile = cardData["main_image"];
   
-  // Build full paths
-  String bigImagePath = "/flipcard/" + folderPath + "/" + bigImageFile;
-  String smallImagePath = "/flipcard/" + folderPath + "/" + smallImageFile;
-  String mainImagePath = "/flipcard/" + folderPath + "/" + mainImageFile;
+  // Build full paths (variants at this profile's region sizes)
+  String bigImagePath = assetForLayout(deckPath(folderPath + "/" + bigImageFile), ASSET_BIG_TEXT);
+  String smallImagePath = assetForLayout(deckPath(folderPath + "/" + smallImageFile), ASSET_SMALL_TEXT);
+  String mainImagePath = assetForLayout(deckPath(folderPath + "/" + mainImageFile), ASSET_MAIN_IMAGE);
   
   Serial.println("=== Drawing Flipcard Layout (JSON) ===");
+  resetSdStreamStats();
   Serial.printf("Card: %s\n", cardData["title"].as<String>().c_str());
   Serial.printf("Language: %s\n", currentLanguage.c_str());
   Serial.printf("Big: %s\n", bigImagePath.c_str());
   Serial.printf("Small: %s\n", smallImagePath.c_str());
   Serial.printf("Main: %s\n", mainImagePath.c_str());
   
-  // Calculate positions (same as before)
-  int bigWidth = 400, bigHeight = 150;
-  int smallWidth = 400, smallHeight = 80;
-  int mainWidth = 400, mainHeight = 400;
-  
-  int bigX = (screenWidth - bigWidth) / 2;
-  int smallX = (screenWidth - smallWidth) / 2;
-  int mainX = (screenWidth - mainWidth) / 2;
-  
-  int bigY = 180;
-  int smallY = bigY + bigHeight + 5;
-  int mainY = screenHeight - mainHeight - 75;
+  // Regions from the display profile
+  int bigX = layout.bigText.x, bigY = layout.bigText.y;
+  int bigWidth = layout.bigText.w, bigHeight = layout.bigText.h;
+  int smallX = layout.smallText.x, smallY = layout.smallText.y;
+  int smallWidth = layout.smallText.w, smallHeight = layout.smallText.h;
+  int mainX = layout.mainImage.x, mainY = layout.mainImage.y;
+  int mainWidth = layout.mainImage.w, mainHeight = layout.mainImage.h;
   
   // Draw navigation buttons
   drawNavigationButtons();
   
   // Draw big image
-  if (!loadPngFromFile(bigImagePath.c_str(), bigX, bigY, bigWidth, bigHeight)) {
+  if (!drawLanguageField(cardData, currentLanguage, "big_text", bigImagePath, bigX, bigY, bigWidth, bigHeight, BIG_TEXT_MAX_SIZE)) {
     Serial.println("Failed to load big image");
-    M5.Display.fillRect(bigX, bigY, bigWidth, bigHeight, 0xF800);
+    imageDrawTarget().fillRect(bigX, bigY, bigWidth, bigHeight, 0xF800);
   } else {
     Serial.println("Big image loaded successfully");
   }
   
   // Draw small image
-  if (!loadPngFromFile(smallImagePath.c_str(), smallX, smallY, smallWidth, smallHeight)) {
+  if (!drawLanguageField(cardData, currentLanguage, "small_text", smallImagePath, smallX, smallY, smallWidth, smallHeight, SMALL_TEXT_MAX_SIZE)) {
     Serial.println("Failed to load small image");
-    M5.Display.fillRect(smallX, smallY, smallWidth, smallHeight, 0x07E0);
+    imageDrawTarget().fillRect(smallX, smallY, smallWidth, smallHeight, 0x07E0);
   } else {
     Serial.println("Small image loaded successfully");
   }
   
   // Draw main image
-  if (!loadPngFromFile(mainImagePath.c_str(), mainX, mainY, mainWidth, mainHeight)) {
+  if (!loadDitheredPngFromFile(mainImagePath.c_str(), mainX, mainY, mainWidth, mainHeight, mainImageDitherMode)) {
     Serial.println("Failed to load main image");
-    M5.Display.fillRect(mainX, mainY, mainWidth, mainHeight, 0x001F);
+    imageDrawTarget().fillRect(mainX, mainY, mainWidth, mainHeight, 0x001F);
   } else {
     Serial.println("Main image loaded successfully");
   }
   
+  printSdStreamStats("Flipcard");
   Serial.println("=== Flipcard Layout Complete (JSON) ===");
 }
 
-// Language refresh function (JSON-driven)
-void refreshLanguageImages(JsonDocument& cardData, String folderPath, String currentLanguage) {
-  int screenWidth = M5.Display.width();
+// Language cycling renders the next language off-screen and refreshes only
+// the rectangles whose pixels changed. Changed rows closer than
+// LANGUAGE_DIFF_ROW_GAP share a rectangle; at most LANGUAGE_DIFF_MAX_RECTS.
+const int LANGUAGE_DIFF_MAX_RECTS = 4;
+const int LANGUAGE_DIFF_ROW_GAP = 8;
+
+// Above this share of the band one full-band refresh replaces the rectangles
+const int LANGUAGE_DIFF_FULL_PERCENT = 70;
+
+// Big and small language regions as one band
+static LayoutRect languageBand() {
+  const LayoutRect& big = displayProfile().bigText;
+  const LayoutRect& small = displayProfile().smallText;
+  int bandX = min(big.x, small.x);
+  int bandY = min(big.y, small.y);
+  int bandRight = max(big.x + big.w, small.x + small.w);
+  int bandBottom = max(big.y + big.h, small.y + small.h);
+  return {bandX, bandY, bandRight - bandX, bandBottom - bandY};
+}
+
+struct DiffRect {
+  LayoutRect rect;
+  bool blackAndWhite;   // Every pixel it changes or ends up with is black or white
+};
+
+static bool pureLevel(uint8_t level) {
+  return level == 0 || level == 15;
+}
+
+// Function to merge a rectangle into another (bounding box of both)
+static void mergeDiffRect(DiffRect& into, const DiffRect& from) {
+  int right = max(into.rect.x + into.rect.w, from.rect.x + from.rect.w);
+  int bottom = max(into.rect.y + into.rect.h, from.rect.y + from.rect.h);
+  into.rect.x = min(into.rect.x, from.rect.x);
+  into.rect.y = min(into.rect.y, from.rect.y);
+  into.rect.w = right - into.rect.x;
+  into.rect.h = bottom - into.rect.y;
+  into.blackAndWhite = into.blackAndWhite && from.blackAndWhite;
+}
+
+// Function to check that a canvas holds only black and white inside a rectangle
+static bool canvasBlackAndWhite(M5Canvas& source, int originX, int originY, const LayoutRect& rect, uint8_t* levels) {
+  const uint8_t* pixels = (const uint8_t*)source.getBuffer();
+  int stride = source.bufferLength() / source.height();
+  for (int y = rect.y; y < rect.y + rect.h; y++) {
+    quantizeGray4Row_ref(pixels + (y - originY) * stride + (rect.x - originX), levels, rect.w);
+    for (int x = 0; x < rect.w; x++) {
+      if (!pureLevel(levels[x])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Function to push a band from an 8-bit gray canvas (its pixel 0,0 at screen
+// originX, originY), refreshing only the rectangles that differ from what the
+// panel shows. Pure black/white rectangles use the fastest (direct) waveform.
+static void pushChangedRegions(M5Canvas& source, int originX, int originY, const LayoutRect& band) {
+  uint32_t diffStart = millis();
+  const uint8_t* pixels = (const uint8_t*)source.getBuffer();
+  int stride = source.bufferLength() / source.height();
+  
+  // RGB row read back from the panel, its gray row, then old and new levels
+  uint8_t* work = (uint8_t*)malloc(band.w * 6);
+  if (!work) {
+    M5.Display.setClipRect(band.x, band.y, band.w, band.h);
+    source.pushSprite(&M5.Display, originX, originY);
+    M5.Display.clearClipRect();
+    return;
+  }
+  uint8_t* rgbRow = work;
+  uint8_t* grayRow = work + band.w * 3;
+  uint8_t* oldLevels = grayRow + band.w;
+  uint8_t* newLevels = oldLevels + band.w;
+  
+  DiffRect rects[LANGUAGE_DIFF_MAX_RECTS + 1];
+  int rectCount = 0;
+  int lastChangedRow = -1;
+  long changedPixels = 0;
+  bool changedAllPure = true;
+  for (int row = 0; row < band.h; row++) {
+    int y = band.y + row;
+    M5.Display.readRectRGB(band.x, y, band.w, 1, rgbRow);
+    rgb888ToGray8Row_ref(rgbRow, grayRow, band.w);
+    quantizeGray4Row_ref(grayRow, oldLevels, band.w);
+    quantizeGray4Row_ref(pixels + (y - originY) * stride + (band.x - originX), newLevels, band.w);
+    
+    int left = -1, right = -1;
+    bool rowPure = true;
+    for (int x = 0; x < band.w; x++) {
+      if (oldLevels[x] != newLevels[x]) {
+        if (left < 0) {
+          left = x;
+        }
+        right = x;
+        changedPixels++;
+        rowPure = rowPure && pureLevel(oldLevels[x]);
+      }
+    }
+    if (left < 0) {
+      continue;
+    }
+    changedAllPure = changedAllPure && rowPure;
+    
+    DiffRect rowRect = {{band.x + left, y, right - left + 1, 1}, rowPure};
+    if (rectCount > 0 && row - lastChangedRow <= LANGUAGE_DIFF_ROW_GAP) {
+      mergeDiffRect(rects[rectCount - 1], rowRect);
+    } else {
+      rects[rectCount++] = rowRect;
+      if (rectCount > LANGUAGE_DIFF_MAX_RECTS) {
+        // Too many: merge the two neighbours with the smallest gap between them
+        int closest = 0;
+        int closestGap = band.h;
+        for (int i = 0; i + 1 < rectCount; i++) {
+          int gap = rects[i + 1].rect.y - (rects[i].rect.y + rects[i].rect.h);
+          if (gap < closestGap) {
+            closestGap = gap;
+            closest = i;
+          }
+        }
+        mergeDiffRect(rects[closest], rects[closest + 1]);
+        for (int i = closest + 1; i + 1 < rectCount; i++) {
+          rects[i] = rects[i + 1];
+        }
+        rectCount--;
+      }
+    }
+    lastChangedRow = row;
+  }
+  
+  if (rectCount == 0) {
+    free(work);
+    Serial.printf("[Lang] Band unchanged, no refresh (%lu ms)\n", (unsigned long)(millis() - diffStart));
+    return;
+  }
+  
+  long rectArea = 0;
+  for (int i = 0; i < rectCount; i++) {
+    rectArea += (long)rects[i].rect.w * rects[i].rect.h;
+  }
+  if (rectArea * 100 > (long)band.w * band.h * LANGUAGE_DIFF_FULL_PERCENT) {
+    rects[0] = {band, changedAllPure};
+    rectCount = 1;
+    rectArea = (long)band.w * band.h;
+  }
+  
+  // Unchanged pixels inside a rectangle are refreshed too, so they must be pure as well
+  int fastCount = 0;
+  for (int i = 0; i < rectCount; i++) {
+    rects[i].blackAndWhite = rects[i].blackAndWhite && canvasBlackAndWhite(source, originX, originY, rects[i].rect, newLevels);
+    fastCount += rects[i].blackAndWhite;
+  }
+  free(work);
+  uint32_t diffMs = millis() - diffStart;
   
+  epd_mode_t previousMode = M5.Display.getEpdMode();
+  for (int i = 0; i < rectCount; i++) {
+    const LayoutRect& rect = rects[i].rect;
+    M5.Display.setEpdMode(rects[i].blackAndWhite ? epd_mode_t::epd_fastest : previousMode);
+    M5.Display.setClipRect(rect.x, rect.y, rect.w, rect.h);
+    source.pushSprite(&M5.Display, originX, originY);
+    M5.Display.clearClipRect();
+  }
+  M5.Display.setEpdMode(previousMode);
+  
+  Serial.printf("[Lang] %ld px changed, %d rect(s) covering %ld of %d px, %d fast, diff %lu ms\n",
+                changedPixels, rectCount, rectArea, band.w * band.h, fastCount, (unsigned long)diffMs);
+}
+
+// Next language rendered off-screen; kept in PSRAM between cycles
+static M5Canvas languageFrame;
+
+// Function to render both language fields into languageFrame (band coordinates)
+static bool renderLanguageBand(JsonDocument& cardData, const String& currentLanguage,
+                               const String& bigImagePath, const String& smallImagePath) {
+  LayoutRect band = languageBand();
+  if (languageFrame.getBuffer() && (languageFrame.width() != band.w || languageFrame.height() != band.h)) {
+    languageFrame.deleteSprite();   // Display profile changed
+  }
+  if (!languageFrame.getBuffer()) {
+    languageFrame.setPsram(true);
+    languageFrame.setColorDepth(lgfx::grayscale_8bit);
+    if (!languageFrame.createSprite(band.w, band.h)) {
+      Serial.println("Language frame unavailable, redrawing in place");
+      return false;
+    }
+  }
+  
+  const LayoutRect& big = displayProfile().bigText;
+  const LayoutRect& small = displayProfile().smallText;
+  int bigX = big.x - band.x, bigY = big.y - band.y;
+  int smallX = small.x - band.x, smallY = small.y - band.y;
+  
+  languageFrame.fillScreen(TFT_WHITE);
+  setImageDrawTarget(&languageFrame);
+  if (!drawLanguageField(cardData, currentLanguage, "big_text", bigImagePath, bigX, bigY, big.w, big.h, BIG_TEXT_MAX_SIZE)) {
+    Serial.println("Failed to load big image");
+    languageFrame.fillRect(bigX, bigY, big.w, big.h, 0xF800);
+  }
+  if (!drawLanguageField(cardData, currentLanguage, "small_text", smallImagePath, smallX, smallY, small.w, small.h, SMALL_TEXT_MAX_SIZE)) {
+    Serial.println("Failed to load small image");
+    languageFrame.fillRect(smallX, smallY, small.w, small.h, 0x07E0);
+  }
+  setImageDrawTarget(nullptr);
+  return true;
+}
+
+// Function to resolve a language's big/small image paths (variants at this profile's region sizes)
+static void languageImagePaths(JsonDocument& cardData, const String& folderPath, const String& currentLanguage,
+                               String& bigImagePath, String& smallImagePath) {
   // Get filenames from JSON using dynamic language key
   String bigImageFile = cardData["languages"][currentLanguage]["big_file"];
   String smallImageFile = cardData["languages"][currentLanguage]["small_file"];
   
-  // Build full paths
-  String bigImagePath = "/flipcard/" + folderPath + "/" + bigImageFile;
-  String smallImagePath = "/flipcard/" + folderPath + "/" + smallImageFile;
+  bigImagePath = assetForLayout(deckPath(folderPath + "/" + bigImageFile), ASSET_BIG_TEXT);
+  smallImagePath = assetForLayout(deckPath(folderPath + "/" + smallImageFile), ASSET_SMALL_TEXT);
+}
+
+// Language refresh function (JSON-driven)
+void refreshLanguageImages(JsonDocument& cardData, String folderPath, String currentLanguage) {
+  const DisplayProfile& layout = displayProfile();
   
-  // Calculate positions (same as main function)
-  int bigWidth = 400, bigHeight = 150;
-  int smallWidth = 400, smallHeight = 80;
+  String bigImagePath, smallImagePath;
+  languageImagePaths(cardData, folderPath, currentLanguage, bigImagePath, smallImagePath);
   
-  int bigX = (screenWidth - bigWidth) / 2;
-  int smallX = (screenWidth - smallWidth) / 2;
-  int bigY = 180;
-  int smallY = bigY + bigHeight + 5;
+  // Regions from the display profile (same as main function)
+  int bigX = layout.bigText.x, bigY = layout.bigText.y;
+  int bigWidth = layout.bigText.w, bigHeight = layout.bigText.h;
+  int smallX = layout.smallText.x, smallY = layout.smallText.y;
+  int smallWidth = layout.smallText.w, smallHeight = layout.smallText.h;
   
   Serial.printf("Refreshing language images (JSON) to: %s\n", currentLanguage.c_str());
   Serial.printf("Big: %s\n", bigImagePath.c_str());
   Serial.printf("Small: %s\n", smallImagePath.c_str());
   
-  // Clear and redraw big image area
-  M5.Display.fillRect(bigX, bigY, bigWidth, bigHeight, 0xFFFF);
-  if (!loadPngFromFile(bigImagePath.c_str(), bigX, bigY, bigWidth, bigHeight)) {
-    Serial.println("Failed to load big image");
-    M5.Display.fillRect(bigX, bigY, bigWidth, bigHeight, 0xF800);
+  uint32_t refreshStart = millis();
+  if (&imageDrawTarget() == &M5.Display && renderLanguageBand(cardData, currentLanguage, bigImagePath, smallImagePath)) {
+    // Off-screen, then only what differs from the panel goes out
+    LayoutRect band = languageBand();
+    pushChangedRegions(languageFrame, band.x, band.y, band);
+  } else {
+    // Clear and redraw big image area
+    imageDrawTarget().fillRect(bigX, bigY, bigWidth, bigHeight, 0xFFFF);
+    if (!drawLanguageField(cardData, currentLanguage, "big_text", bigImagePath, bigX, bigY, bigWidth, bigHeight, BIG_TEXT_MAX_SIZE)) {
+      Serial.println("Failed to load big image");
+      imageDrawTarget().fillRect(bigX, bigY, bigWidth, bigHeight, 0xF800);
+    }
+    
+    // Clear and redraw small image area
+    imageDrawTarget().fillRect(smallX, smallY, smallWidth, smallHeight, 0xFFFF);
+    if (!drawLanguageField(cardData, currentLanguage, "small_text", smallImagePath, smallX, smallY, smallWidth, smallHeight, SMALL_TEXT_MAX_SIZE)) {
+      Serial.println("Failed to load small image");
+      imageDrawTarget().fillRect(smallX, smallY, smallWidth, smallHeight, 0x07E0);
+    }
   }
   
-  // Clear and redraw small image area
-  M5.Display.fillRect(smallX, smallY, smallWidth, smallHeight, 0xFFFF);
-  if (!loadPngFromFile(smallImagePath.c_str(), smallX, smallY, smallWidth, smallHeight)) {
-    Serial.println("Failed to load small image");
-    M5.Display.fillRect(smallX, smallY, smallWidth, smallHeight, 0x07E0);
+  Serial.printf("Language refresh took %lu ms\n", (unsigned long)(millis() - refreshStart));
+  if (languageTextMode) {
+    printGlyphCacheStats();
   }
 }
 
+// Slideshow frame: 8-bit gray so every helper's colors convert the same way as on the panel
+static M5Canvas nextFrame;
+
+bool renderFlipcardFrame(JsonDocument& cardData, String folderPath, String currentLanguage) {
+  if (nextFrame.getBuffer() && (nextFrame.width() != M5.Display.width() || nextFrame.height() != M5.Display.height())) {
+    nextFrame.deleteSprite();   // Display profile changed
+  }
+  if (!nextFrame.getBuffer()) {
+    nextFrame.setPsram(true);
+    nextFrame.setColorDepth(lgfx::grayscale_8bit);
+    if (!nextFrame.createSprite(M5.Display.width(), M5.Display.height())) {
+      Serial.println("Slideshow frame unavailable");
+      return false;
+    }
+  }
+  
+  nextFrame.fillScreen(TFT_WHITE);
+  setImageDrawTarget(&nextFrame);
+  drawEmptyFrame();
+  drawFlipcard(cardData, folderPath, currentLanguage);
+  setImageDrawTarget(nullptr);
+  return true;
+}
+
+bool renderFlipcardLanguageFrame(JsonDocument& cardData, String folderPath, String currentLanguage) {
+  String bigImagePath, smallImagePath;
+  languageImagePaths(cardData, folderPath, currentLanguage, bigImagePath, smallImagePath);
+  return renderLanguageBand(cardData, currentLanguage, bigImagePath, smallImagePath);
+}
+
+void showFlipcardFrame(bool languageOnly) {
+  if (languageOnly) {
+    // Same band and frame as refreshLanguageImages(), and only what changed in it
+    if (languageFrame.getBuffer()) {
+      LayoutRect band = languageBand();
+      pushChangedRegions(languageFrame, band.x, band.y, band);
+    }
+  } else if (nextFrame.getBuffer()) {
+    nextFrame.pushSprite(&M5.Display, 0, 0);
+  }
+}
+
+void releaseFlipcardFrame() {
+  nextFrame.deleteSprite();
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include "../core/pixel_kernels.h"
 
 // Function declarations for JSON-driven flipcard display
 void drawFlipcard(JsonDocument& cardData, String folderPath, String currentLanguage);
@@ -9,5 +10,21 @@ void refreshLanguageImages(JsonDocument& cardData, String folderPath, String cur
 // Navigation function
 void drawNavigationButtons();
 
-// Helper function
-bool loadPngFromFile(const char* filename, int x, int y, int width, int height);
\ No newline at end of file
+// Dithering used for the main image (photo-like content)
+void setMainImageDitherMode(DitherMode mode);
+
+// Render big_text/small_text from card.json instead of the per-language PNGs
+void setLanguageTextMode(bool enabled);
+
+// Off-screen frame for the slideshow: render a whole flipcard (frame included)
+// ahead of its flip, then show it with one blit. The frame's PSRAM is kept
+// until released. A language step only renders the big/small language band
+// (renderFlipcardLanguageFrame) and shows it with languageOnly.
+bool renderFlipcardFrame(JsonDocument& cardData, String folderPath, String currentLanguage);
+bool renderFlipcardLanguageFrame(JsonDocument& cardData, String folderPath, String currentLanguage);
+void showFlipcardFrame(bool languageOnly);
+void releaseFlipcardFrame();
+
+// Helper functions
+bool loadPngFromFile(const char* filename, int x, int y, int width, int height);
+bool loadDitheredPngFromFile(const char* filename, int x, int y, int width, int height, DitherMode mode);
\ No newline at end of file
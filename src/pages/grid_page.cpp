@@ -3,42 +3,70 @@
 #include <SD.h>
 #include <ArduinoJson.h>
 #include <vector>
+#include "../core/sd_stream.h"
+#include "../core/deck.h"
+#include "../core/thumbnail_cache.h"
+#include "../core/display_profile.h"
 
-// Helper function to load thumbnail using file handle
+// Helper function to load thumbnail (PSRAM cache first, then SD)
 bool loadThumbnailFromCard(const char* folderPath, const char* thumbnailFile, int x, int y, int size) {
-  String fullPath = "/flipcard/" + String(folderPath) + "/" + String(thumbnailFile);
-  File file = SD.open(fullPath);
-  if (!file) {
-    return false;
-  }
+  String fullPath = deckPath(String(folderPath) + "/" + String(thumbnailFile));
+  return drawCachedThumbnail(fullPath, x, y, size);
+}
+
+// Append thumbnail paths of one grid page, using the same order as the draw functions
+static void collectGridPageThumbnails(JsonDocument& indexData, int gridPage, const CardBits* visibleCards, std::vector<String>& paths) {
+  int cardsPerPage = GRID_CARDS_PER_PAGE;
+  int startIndex = gridPage * cardsPerPage;
+  JsonArray cards = indexData["cards"];
   
-  bool result = M5.Display.drawPng(&file, x, y, size, size);
-  file.close();
+  for (int slot = 0; slot < cardsPerPage; slot++) {
+    int cardIndex = visibleCards ? nthCard(*visibleCards, startIndex + slot) : startIndex + slot;
+    if (cardIndex < 0 || cardIndex >= (int)cards.size()) {
+      break;
+    }
+    JsonObject card = cards[cardIndex];
+    paths.push_back(deckPath(card["folder"].as<String>() + "/" + card["thumbnail"].as<String>()));
+  }
+}
+
+// Warm the thumbnails of the next and previous grid pages (wrap-around, like paging)
+void prefetchAdjacentGridPages(JsonDocument& indexData, int gridPage, int totalGridPages, const CardBits* visibleCards) {
+  std::vector<String> paths;
+  if (totalGridPages > 1) {
+    int nextPage = (gridPage + 1) % totalGridPages;
+    int previousPage = (gridPage - 1 + totalGridPages) % totalGridPages;
+    
+    // Next page first: forward paging is the common case
+    collectGridPageThumbnails(indexData, nextPage, visibleCards, paths);
+    if (previousPage != nextPage) {
+      collectGridPageThumbnails(indexData, previousPage, visibleCards, paths);
+    }
+  }
   
-  return result;
+  printThumbnailCacheStats();
+  prefetchThumbnails(paths, displayProfile().thumbnailSize);
 }
 
 // Function to draw grid navigation buttons (same as flipcard but different function)
 void drawGridNavigationButtons(int currentPage, int totalPages) {
+  const DisplayProfile& layout = displayProfile();
   int screenWidth = M5.Display.width();
   
-  // Navigation buttons (80x80 pixels)
-  int buttonSize = 80;
-  int buttonMargin = 20;
-  
-  // Button positions (moved higher)
-  int leftButtonX = buttonMargin + 25;  // 45px from left edge
-  int leftButtonY = buttonMargin + 15;  // 35px from top edge (10px higher)
-  int rightButtonX = screenWidth - buttonSize - buttonMargin - 25;  // 45px from right edge
-  int rightButtonY = buttonMargin + 15;  // 35px from top edge (10px higher)
-  int homeButtonX = (screenWidth - buttonSize) / 2;  // Centered horizontally
-  int homeButtonY = buttonMargin + 15;  // Same Y as other buttons (10px higher)
+  // Button positions from the display profile (pager row)
+  int buttonSize = layout.pagerHome.w;
+  int leftButtonX = layout.pagerLeft.x;
+  int leftButtonY = layout.pagerLeft.y;
+  int rightButtonX = layout.pagerRight.x;
+  int rightButtonY = layout.pagerRight.y;
+  int homeButtonX = layout.pagerHome.x;
+  int homeButtonY = layout.pagerHome.y;
   
   // Draw left button (always show, use grey version for single page)
-  String leftButtonFile = (totalPages > 1) ? "/flipcard/Left.png" : "/flipcard/LeftGrey.png";
+  String leftButtonFile = assetForLayout((totalPages > 1) ? "/flipcard/Left.png" : "/flipcard/LeftGrey.png", ASSET_BUTTON);
   Serial.printf("Loading left button: %s\n", leftButtonFile.c_str());
-  File leftFile = SD.open(leftButtonFile);
-  if (leftFile) {
+  SdStream leftFile;
+  if (leftFile.open(leftButtonFile.c_str())) {
     if (M5.Display.drawPng(&leftFile, leftButtonX, leftButtonY, buttonSize, buttonSize)) {
       Serial.println("Left button loaded successfully");
     } else {
@@ -59,10 +87,10 @@ void drawGridNavigationButtons(int currentPage, int totalPages) {
   }
   
   // Draw right button (always show, use grey version for single page)
-  String rightButtonFile = (totalPages > 1) ? "/flipcard/Right.png" : "/flipcard/RightGrey.png";
+  String rightButtonFile = assetForLayout((totalPages > 1) ? "/flipcard/Right.png" : "/flipcard/RightGrey.png", ASSET_BUTTON);
   Serial.printf("Loading right button: %s\n", rightButtonFile.c_str());
-  File rightFile = SD.open(rightButtonFile);
-  if (rightFile) {
+  SdStream rightFile;
+  if (rightFile.open(rightButtonFile.c_str())) {
     if (M5.Display.drawPng(&rightFile, rightButtonX, rightButtonY, buttonSize, buttonSize)) {
       Serial.println("Right button loaded successfully");
     } else {
@@ -83,9 +111,10 @@ void drawGridNavigationButtons(int currentPage, int totalPages) {
   }
   
   // Draw home button (back to flipcard)
-  Serial.println("Loading home button for grid: /flipcard/Home.png");
-  File homeFile = SD.open("/flipcard/Home.png");
-  if (homeFile) {
+  String homeButtonFile = assetForLayout("/flipcard/Home.png", ASSET_BUTTON);
+  Serial.printf("Loading home button for grid: %s\n", homeButtonFile.c_str());
+  SdStream homeFile;
+  if (homeFile.open(homeButtonFile.c_str())) {
     if (M5.Display.drawPng(&homeFile, homeButtonX, homeButtonY, buttonSize, buttonSize)) {
       Serial.println("Home button loaded successfully");
     } else {
@@ -114,35 +143,19 @@ void drawGridNavigationButtons(int currentPage, int totalPages) {
 
 // Main grid display function
 void drawGridPage(JsonDocument& indexData, int gridPage, int totalGridPages) {
-  int screenWidth = M5.Display.width();
-  int screenHeight = M5.Display.height();
-  
   // Clear screen with white background
   M5.Display.clear();
   
   Serial.println("=== Drawing Grid Page ===");
+  resetSdStreamStats();
   Serial.printf("Grid Page: %d/%d\n", gridPage + 1, totalGridPages);
   
   // Draw navigation buttons first
   drawGridNavigationButtons(gridPage, totalGridPages);
   
-  // Grid layout configuration for 540x960 fullscreen
-  int thumbnailSize = 120;  // Back to 120px as requested
-  int cols = 3;
-  int rows = 5;
-  int maxThumbnails = cols * rows; // 15 thumbnails per page
-  
-  // Spacing configuration (calculated for perfect balance)
-  // Available width: 540 - (3 × 120) = 180px
-  // Divided by 4 spaces (2 margins + 2 gaps) = 45px each
-  int horizontalSpacing = 45;
-  int verticalSpacing = 30;    // Generous vertical spacing
-  
-  // Calculate grid area (below navigation buttons, moved lower)
-  int gridStartY = 170; // Start below navigation buttons and page indicator (20px lower)
-  int gridWidth = (cols * thumbnailSize) + ((cols - 1) * horizontalSpacing);
-  int gridHeight = (rows * thumbnailSize) + ((rows - 1) * verticalSpacing);
-  int gridStartX = (screenWidth - gridWidth) / 2; // Center horizontally
+  // Grid layout from the display profile
+  int thumbnailSize = displayProfile().thumbnailSize;
+  int maxThumbnails = GRID_CARDS_PER_PAGE;
   
   // Calculate cards for this page
   int totalCards = indexData["metadata"]["total_cards"];
@@ -153,11 +166,9 @@ void drawGridPage(JsonDocument& indexData, int gridPage, int totalGridPages) {
   
   // Draw all grid slots (15 total)
   for (int gridPos = 0; gridPos < maxThumbnails; gridPos++) {
-    int col = gridPos % cols;
-    int row = gridPos / cols;
-    
-    int thumbX = gridStartX + (col * (thumbnailSize + horizontalSpacing));
-    int thumbY = gridStartY + (row * (thumbnailSize + verticalSpacing));
+    LayoutRect slotRect = gridSlotRect(gridPos);
+    int thumbX = slotRect.x;
+    int thumbY = slotRect.y;
     
     int cardIndex = startCardIndex + gridPos; // Global card index
     
@@ -199,66 +210,20 @@ void drawGridPage(JsonDocument& indexData, int gridPage, int totalGridPages) {
     }
   }
   
+  printSdStreamStats("Grid page");
+  prefetchAdjacentGridPages(indexData, gridPage, totalGridPages, nullptr);
   Serial.println("=== Grid Page Complete ===");
 }
 
 // Function to detect which thumbnail was touched
 int getTouchedThumbnailIndex(int touchX, int touchY, int gridPage) {
-  // Grid layout configuration (same as drawGridPage)
-  int thumbnailSize = 120;
-  int cols = 3;
-  int rows = 5;
-  int screenWidth = M5.Display.width();
-  
-  // Spacing configuration (same as drawGridPage)
-  int horizontalSpacing = 45;
-  int verticalSpacing = 30;
-  
-  // Calculate grid area
-  int gridStartY = 170;
-  int gridWidth = (cols * thumbnailSize) + ((cols - 1) * horizontalSpacing);
-  int gridHeight = (rows * thumbnailSize) + ((rows - 1) * verticalSpacing);
-  int gridStartX = (screenWidth - gridWidth) / 2;
-  
-  // Check if touch is within grid area
-  if (touchX < gridStartX || touchX > gridStartX + gridWidth ||
-      touchY < gridStartY || touchY > gridStartY + gridHeight) {
-    return -1; // Touch outside grid
-  }
-  
-  // Calculate which thumbnail was touched (accounting for spacing)
-  int relativeX = touchX - gridStartX;
-  int relativeY = touchY - gridStartY;
-  
-  // Find the column and row considering spacing
-  int col = -1, row = -1;
-  
-  // Check each column
-  for (int c = 0; c < cols; c++) {
-    int colStart = c * (thumbnailSize + horizontalSpacing);
-    int colEnd = colStart + thumbnailSize;
-    if (relativeX >= colStart && relativeX <= colEnd) {
-      col = c;
-      break;
-    }
-  }
-  
-  // Check each row
-  for (int r = 0; r < rows; r++) {
-    int rowStart = r * (thumbnailSize + verticalSpacing);
-    int rowEnd = rowStart + thumbnailSize;
-    if (relativeY >= rowStart && relativeY <= rowEnd) {
-      row = r;
-      break;
-    }
-  }
-  
-  if (col == -1 || row == -1) {
-    return -1; // Touch in spacing area
+  // Grid slot under the touch (same layout as drawGridPage)
+  int gridPos = gridSlotAt(touchX, touchY); // 0-14
+  if (gridPos < 0) {
+    return -1; // Touch outside grid or in spacing area
   }
   
-  int gridPos = (row * cols) + col; // 0-14
-  int cardIndex = (gridPage * 15) + gridPos; // Global card index
+  int cardIndex = (gridPage * GRID_CARDS_PER_PAGE) + gridPos; // Global card index
   
   Serial.printf("Touch at (%d,%d) -> Grid pos: %d, Card index: %d\n", 
                 touchX, touchY, gridPos, cardIndex);
@@ -271,35 +236,23 @@ int getTouchedThumbnailIndex(int touchX, int touchY, int gridPage) {
 
 // Function to detect navigation button touches
 bool isTouchOnGridNavButton(int touchX, int touchY, String& buttonType) {
-  int screenWidth = M5.Display.width();
-  int buttonSize = 80;
-  int buttonMargin = 20;
-  
   // Button positions (same as drawGridNavigationButtons)
-  int leftButtonX = buttonMargin + 25;
-  int leftButtonY = buttonMargin + 25;
-  int rightButtonX = screenWidth - buttonSize - buttonMargin - 25;
-  int rightButtonY = buttonMargin + 25;
-  int homeButtonX = (screenWidth - buttonSize) / 2;
-  int homeButtonY = buttonMargin + 25;
+  const DisplayProfile& layout = displayProfile();
   
   // Check left button
-  if (touchX >= leftButtonX && touchX <= leftButtonX + buttonSize && 
-      touchY >= leftButtonY && touchY <= leftButtonY + buttonSize) {
+  if (layout.pagerLeft.contains(touchX, touchY)) {
     buttonType = "left";
     return true;
   }
   
   // Check right button
-  if (touchX >= rightButtonX && touchX <= rightButtonX + buttonSize && 
-      touchY >= rightButtonY && touchY <= rightButtonY + buttonSize) {
+  if (layout.pagerRight.contains(touchX, touchY)) {
     buttonType = "right";
     return true;
   }
   
   // Check home button
-  if (touchX >= homeButtonX && touchX <= homeButtonX + buttonSize && 
-      touchY >= homeButtonY && touchY <= homeButtonY + buttonSize) {
+  if (layout.pagerHome.contains(touchX, touchY)) {
     buttonType = "home";
     return true;
   }
@@ -307,71 +260,21 @@ bool isTouchOnGridNavButton(int touchX, int touchY, String& buttonType) {
   return false;
 }
 
-// Helper function to get count of cards in category
-int getFilteredCardCount(JsonDocument& indexData, String categoryFilter) {
-  if (categoryFilter == "") {
-    return indexData["metadata"]["total_cards"].as<int>();
-  }
-  
-  int count = 0;
-  JsonArray cards = indexData["cards"];
-  for (JsonObject card : cards) {
-    if (card["category"].as<String>() == categoryFilter) {
-      count++;
-    }
-  }
-  return count;
-}
-
-// Helper function to convert filtered index to global card index
-int getFilteredCardGlobalIndex(JsonDocument& indexData, String categoryFilter, int filteredIndex) {
-  if (categoryFilter == "") {
-    return filteredIndex; // No filtering, same index
-  }
-  
-  int count = 0;
-  JsonArray cards = indexData["cards"];
-  for (int i = 0; i < cards.size(); i++) {
-    JsonObject card = cards[i];
-    if (card["category"].as<String>() == categoryFilter) {
-      if (count == filteredIndex) {
-        return i; // Return global index
-      }
-      count++;
-    }
-  }
-  return -1; // Not found
-}
-
-// Draw grid page with category filtering
-void drawGridPageFiltered(JsonDocument& indexData, int gridPage, int totalGridPages, String categoryFilter) {
+// Draw grid page with the cards of a filter (category and facets)
+void drawGridPageFiltered(JsonDocument& indexData, int gridPage, int totalGridPages, const CardBits& visibleCards) {
   auto& display = M5.Display;
   display.clear();
+  resetSdStreamStats();
   
   // Draw navigation buttons
   drawGridNavigationButtons(gridPage, totalGridPages);
   
-  // Grid configuration
-  int cols = 3;
-  int rows = 5;
-  int cardsPerPage = cols * rows;
-  int thumbnailSize = 120;
-  int thumbnailMargin = 45;
-  
-  // Calculate total filtered cards
-  int totalFilteredCards = getFilteredCardCount(indexData, categoryFilter);
+  // Grid configuration (same slots as drawGridPage)
+  int cardsPerPage = GRID_CARDS_PER_PAGE;
+  int thumbnailSize = displayProfile().thumbnailSize;
   
   JsonArray cards = indexData["cards"];
   
-  // Build filtered card list for current page
-  std::vector<int> filteredCardIndices;
-  for (int i = 0; i < cards.size(); i++) {
-    JsonObject card = cards[i];
-    if (categoryFilter == "" || card["category"].as<String>() == categoryFilter) {
-      filteredCardIndices.push_back(i);
-    }
-  }
-  
   // Calculate start index for current page
   int startCardIndex = gridPage * cardsPerPage;
   
@@ -380,14 +283,13 @@ void drawGridPageFiltered(JsonDocument& indexData, int gridPage, int totalGridPa
     int cardIndex = startCardIndex + slot;
     
     // Calculate grid position
-    int col = slot % cols;
-    int row = slot / cols;
-    int x = thumbnailMargin + col * (thumbnailSize + thumbnailMargin);
-    int y = 140 + row * (thumbnailSize + thumbnailMargin); // Start below nav buttons
+    LayoutRect slotRect = gridSlotRect(slot);
+    int x = slotRect.x;
+    int y = slotRect.y;
     
-    if (cardIndex < filteredCardIndices.size()) {
+    int globalCardIndex = nthCard(visibleCards, cardIndex);
+    if (globalCardIndex >= 0) {
       // Draw actual card thumbnail
-      int globalCardIndex = filteredCardIndices[cardIndex];
       JsonObject card = cards[globalCardIndex];
       
       String folderPath = card["folder"].as<String>();
@@ -413,48 +315,20 @@ void drawGridPageFiltered(JsonDocument& indexData, int gridPage, int totalGridPa
     }
   }
   
+  printSdStreamStats("Filtered grid page");
   display.display();
+  
+  prefetchAdjacentGridPages(indexData, gridPage, totalGridPages, &visibleCards);
 }
 
 // Get touched thumbnail index for filtered cards
-int getTouchedThumbnailIndexFiltered(int touchX, int touchY, int gridPage, JsonDocument& indexData, String categoryFilter) {
-  // Grid configuration (same as drawGridPageFiltered)
-  int cols = 3;
-  int rows = 5;
-  int cardsPerPage = cols * rows;
-  int thumbnailSize = 120;
-  int thumbnailMargin = 45;
-  int startY = 140; // Start below nav buttons
-  
-  // Build filtered card list
-  std::vector<int> filteredCardIndices;
-  JsonArray cards = indexData["cards"];
-  for (int i = 0; i < cards.size(); i++) {
-    JsonObject card = cards[i];
-    if (categoryFilter == "" || card["category"].as<String>() == categoryFilter) {
-      filteredCardIndices.push_back(i);
-    }
-  }
-  
-  // Check each thumbnail position
-  for (int slot = 0; slot < cardsPerPage; slot++) {
-    int col = slot % cols;
-    int row = slot / cols;
-    int x = thumbnailMargin + col * (thumbnailSize + thumbnailMargin);
-    int y = startY + row * (thumbnailSize + thumbnailMargin);
-    
-    // Check if touch is within this thumbnail
-    if (touchX >= x && touchX <= x + thumbnailSize && 
-        touchY >= y && touchY <= y + thumbnailSize) {
-      
-      int cardIndex = gridPage * cardsPerPage + slot;
-      
-      // Check if this slot has a card
-      if (cardIndex < filteredCardIndices.size()) {
-        return filteredCardIndices[cardIndex]; // Return global card index
-      }
-    }
+int getTouchedThumbnailIndexFiltered(int touchX, int touchY, int gridPage, const CardBits& visibleCards) {
+  // Grid slot under the touch (same layout as drawGridPageFiltered)
+  int slot = gridSlotAt(touchX, touchY);
+  if (slot < 0) {
+    return -1; // Touch outside grid or in spacing area
   }
   
-  return -1; // No thumbnail touched
+  // Global index of the card in this slot, -1 past the last card
+  return nthCard(visibleCards, gridPage * GRID_CARDS_PER_PAGE + slot);
 }
\ No newline at end of file
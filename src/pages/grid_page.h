@@ -1,17 +1,20 @@
 #pragma once
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include "../core/card_facets.h"
 
 // Function declarations for grid thumbnail page
 void drawGridPage(JsonDocument& indexData, int gridPage, int totalGridPages);
-void drawGridPageFiltered(JsonDocument& indexData, int gridPage, int totalGridPages, String categoryFilter);
+void drawGridPageFiltered(JsonDocument& indexData, int gridPage, int totalGridPages, const CardBits& visibleCards);
 int getTouchedThumbnailIndex(int touchX, int touchY, int gridPage);
-int getTouchedThumbnailIndexFiltered(int touchX, int touchY, int gridPage, JsonDocument& indexData, String categoryFilter);
+int getTouchedThumbnailIndexFiltered(int touchX, int touchY, int gridPage, const CardBits& visibleCards);
 bool isTouchOnGridNavButton(int touchX, int touchY, String& buttonType);
 
-// Helper functions for filtering
-int getFilteredCardCount(JsonDocument& indexData, String categoryFilter);
-int getFilteredCardGlobalIndex(JsonDocument& indexData, String categoryFilter, int filteredIndex);
+// Left/Right/Home paging controls (shared with the category page)
+void drawGridNavigationButtons(int currentPage, int totalPages);
+
+// Background warm-up of the neighbouring pages' thumbnails (visibleCards null = all cards)
+void prefetchAdjacentGridPages(JsonDocument& indexData, int gridPage, int totalGridPages, const CardBits* visibleCards);
 
 // Helper function
 bool loadThumbnailFromCard(const char* folderPath, const char* thumbnailFile, int x, int y, int size);
\ No newline at end of file
@@ -2,20 +2,14 @@
 #include <M5Unified.h>
 #include <SD.h>
 #include <ArduinoJson.h>
+#include "../core/sd_stream.h"
+#include "../core/glyph_cache.h"
+#include "../core/display_profile.h"
 #include <vector>
 
-// Option page button coordinates
-int languageBtnX = 70;      // Language button
-int languageBtnY = 300;     
-int languageBtnW = 400;     
-int languageBtnH = 100;     
-
-     
-
-// Home button coordinates (same as other pages)
-int optionHomeBtnX = 230;   // Centered
-int optionHomeBtnY = 35;    
-int optionHomeBtnSize = 80;
+// Text sizes (pixels)
+const int OPTION_TITLE_SIZE = 48;
+const int OPTION_TEXT_SIZE = 32;
 
 // Language selection state
 struct LanguageInfo {
@@ -26,55 +20,86 @@ struct LanguageInfo {
 };
 static std::vector<LanguageInfo> availableLanguages;
 
-void drawOptionPage() {
+// Function to draw one option button (rect from the display profile)
+static void drawOptionButton(const LayoutRect& button, const char* label) {
     auto& display = M5.Display;
-    display.clear();
-    
-    // Draw home button
-    File homeFile = SD.open("/flipcard/Home.png");
-    if (homeFile) {
-        display.drawPng(&homeFile, optionHomeBtnX, optionHomeBtnY, optionHomeBtnSize, optionHomeBtnSize);
-        homeFile.close();
-    } else {
+    display.fillRect(button.x, button.y, button.w, button.h, TFT_WHITE);
+    display.drawRect(button.x, button.y, button.w, button.h, TFT_BLACK);
+    drawCachedText(display, label, button.x + 80, button.y + button.h / 2 - 10, OPTION_TEXT_SIZE);
+}
+
+void drawOptionHomeButton() {
+    auto& display = M5.Display;
+    // Same place as the pager's home button in every profile
+    const LayoutRect& home = displayProfile().pagerHome;
+    if (!drawPngFromSd("/flipcard/Home.png", home.x, home.y, home.w, home.h)) {
         // Fallback home button
-        display.fillRoundRect(optionHomeBtnX, optionHomeBtnY, optionHomeBtnSize, optionHomeBtnSize, 8, TFT_BLUE);
+        display.fillRoundRect(home.x, home.y, home.w, home.h, 8, TFT_BLUE);
         display.setTextColor(TFT_WHITE);
         display.setTextSize(2);
-        display.drawString("H", optionHomeBtnX + 30, optionHomeBtnY + 30);
+        display.drawString("H", home.x + home.w / 2 - 10, home.y + home.h / 2 - 10);
     }
+}
+
+void drawOptionPage() {
+    auto& display = M5.Display;
+    display.clear();
+    
+    // Draw home button
+    drawOptionHomeButton();
     
     // Header
-    display.setFont(&fonts::efontCN_16);
-    display.setTextSize(3);
-    display.setTextColor(TFT_BLACK);
-    display.drawString("Options", 20, 120);
+    drawCachedText(display, "Options", 20, 120, OPTION_TITLE_SIZE);
+    
+    const DisplayProfile& layout = displayProfile();
     
     // Language button
-    display.fillRect(languageBtnX, languageBtnY, languageBtnW, languageBtnH, TFT_WHITE);
-    display.drawRect(languageBtnX, languageBtnY, languageBtnW, languageBtnH, TFT_BLACK);
-    display.setTextColor(TFT_BLACK);
-    display.setTextSize(2);
-    display.drawString("Language Settings", languageBtnX + 80, languageBtnY + 40);
+    drawOptionButton(layout.optionLanguage, "Language Settings");
+    
+    // Root Menu button: switch deck collection
+    drawOptionButton(layout.optionCollections, "Collections");
     
+    // Rescan button: pick up card folders changed on the SD card
+    drawOptionButton(layout.optionRescan, "Rescan Cards");
+    
+    // Energy button: time and energy spent per state and operation
+    drawOptionButton(layout.optionEnergy, "Energy Report");
 }
 
 int handleOptionTouch(int x, int y) {
     Serial.printf("Option touch: x=%d, y=%d\n", x, y);
     
+    const DisplayProfile& layout = displayProfile();
+    
     // Check Language button
-    if (x >= languageBtnX && x <= languageBtnX + languageBtnW &&
-        y >= languageBtnY && y <= languageBtnY + languageBtnH) {
+    if (layout.optionLanguage.contains(x, y)) {
         Serial.println("Language button touched!");
         return 1; // Language settings
     }
     
+    // Check Root Menu button
+    if (layout.optionCollections.contains(x, y)) {
+        Serial.println("Root Menu button touched!");
+        return 2; // Collections
+    }
+    
+    // Check Rescan button
+    if (layout.optionRescan.contains(x, y)) {
+        Serial.println("Rescan button touched!");
+        return 3; // Rescan cards
+    }
+    
+    // Check Energy button
+    if (layout.optionEnergy.contains(x, y)) {
+        Serial.println("Energy button touched!");
+        return 4; // Energy report
+    }
     
     return 0; // No button touched
 }
 
 bool isTouchOnOptionHomeButton(int x, int y) {
-    return (x >= optionHomeBtnX && x <= optionHomeBtnX + optionHomeBtnSize &&
-            y >= optionHomeBtnY && y <= optionHomeBtnY + optionHomeBtnSize);
+    return displayProfile().pagerHome.contains(x, y);
 }
 
 void drawLanguageSelectionPage(JsonDocument& configDoc) {
@@ -85,31 +110,20 @@ void drawLanguageSelectionPage(JsonDocument& configDoc) {
     availableLanguages.clear();
     
     // Draw home button
-    File homeFile = SD.open("/flipcard/Home.png");
-    if (homeFile) {
-        display.drawPng(&homeFile, optionHomeBtnX, optionHomeBtnY, optionHomeBtnSize, optionHomeBtnSize);
-        homeFile.close();
-    } else {
-        // Fallback home button
-        display.fillRoundRect(optionHomeBtnX, optionHomeBtnY, optionHomeBtnSize, optionHomeBtnSize, 8, TFT_BLUE);
-        display.setTextColor(TFT_WHITE);
-        display.setTextSize(2);
-        display.drawString("H", optionHomeBtnX + 30, optionHomeBtnY + 30);
-    }
+    drawOptionHomeButton();
     
     // Header
-    display.setFont(&fonts::efontCN_16);
-    display.setTextSize(2);
-    display.setTextColor(TFT_BLACK);
-    display.drawString("Select Default Language", 20, 120);
+    drawCachedText(display, "Select Default Language", 20, 120, OPTION_TEXT_SIZE);
     
     // Get current default language
     String currentDefault = configDoc["languages"]["default"].as<String>();
     Serial.printf("Current default language: %s\n", currentDefault.c_str());
     
-    // List supported languages
+    // List supported languages: rows from the display profile, then further columns
+    const DisplayProfile& layout = displayProfile();
+    int rowsPerColumn = max(1, (M5.Display.height() - layout.listRow.y) / layout.listRowPitch);
+    int capacity = rowsPerColumn * layout.listColumns;
     JsonObject supportedLangs = configDoc["languages"]["supported"];
-    int yPos = 180;
     int index = 0;
     
     for (JsonPair langPair : supportedLangs) {
@@ -118,6 +132,10 @@ void drawLanguageSelectionPage(JsonDocument& configDoc) {
         
         // Only show enabled languages
         if (langInfo["enabled"].as<bool>()) {
+            if (index >= capacity) {
+                Serial.printf("Language %s does not fit the list\n", langKey.c_str());
+                continue;
+            }
             LanguageInfo info;
             info.key = langKey;
             
@@ -127,10 +145,10 @@ void drawLanguageSelectionPage(JsonDocument& configDoc) {
             info.enabled = true;
             
             // Position
-            info.x = 50;
-            info.y = yPos;
-            info.width = 440;
-            info.height = 80;
+            info.x = layout.listRow.x + (index / rowsPerColumn) * layout.listColumnPitch;
+            info.y = layout.listRow.y + (index % rowsPerColumn) * layout.listRowPitch;
+            info.width = layout.listRow.w;
+            info.height = layout.listRow.h;
             
             // Draw language option (all with white background)
             bool isDefault = (langKey == currentDefault);
@@ -138,19 +156,15 @@ void drawLanguageSelectionPage(JsonDocument& configDoc) {
             display.fillRect(info.x, info.y, info.width, info.height, TFT_WHITE);
             display.drawRect(info.x, info.y, info.width, info.height, TFT_BLACK);
             
-            display.setTextColor(TFT_BLACK);
-            display.setTextSize(2);
-            
             // Add asterisk (*) for default language
             if (isDefault) {
                 String displayText = "* " + info.displayName;
-                display.drawString(displayText.c_str(), info.x + 20, info.y + 30);
+                drawCachedText(display, displayText, info.x + 20, info.y + 30, OPTION_TEXT_SIZE);
             } else {
-                display.drawString(info.displayName.c_str(), info.x + 20, info.y + 30);
+                drawCachedText(display, info.displayName, info.x + 20, info.y + 30, OPTION_TEXT_SIZE);
             }
             
             availableLanguages.push_back(info);
-            yPos += 100;
             index++;
         }
     }
@@ -173,31 +187,15 @@ String handleLanguageSelectionTouch(int x, int y, JsonDocument& configDoc) {
     return ""; // No language selected
 }
 
-bool saveDefaultLanguage(String newDefaultLang) {
+bool saveDefaultLanguage(JsonDocument& configDoc, String newDefaultLang) {
     Serial.printf("Attempting to save new default language: %s\n", newDefaultLang.c_str());
     
-    // Read current config
-    File file = SD.open("/flipcard/config.json", FILE_READ);
-    if (!file) {
-        Serial.println("Failed to open config.json for reading");
-        return false;
-    }
-    
-    JsonDocument configDoc;
-    DeserializationError error = deserializeJson(configDoc, file);
-    file.close();
-    
-    if (error) {
-        Serial.printf("Failed to parse config.json: %s\n", error.c_str());
-        return false;
-    }
-    
-    // Update default language
+    // Update default language in the loaded config (no second copy of config.json)
     configDoc["languages"]["default"] = newDefaultLang;
     Serial.printf("Updated default language to: %s\n", newDefaultLang.c_str());
     
     // Write back to file
-    file = SD.open("/flipcard/config.json", FILE_WRITE);
+    File file = SD.open("/flipcard/config.json", FILE_WRITE);
     if (!file) {
         Serial.println("Failed to open config.json for writing");
         return false;
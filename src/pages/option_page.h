@@ -1,11 +1,11 @@
 #pragma once
 #include <ArduinoJson.h>
 
-// Draw option page with two buttons: Language and Root Menu
+// Draw option page with four buttons: Language, Root Menu, Rescan Cards and Energy Report
 void drawOptionPage();
 
 // Handle touch input for option page
-// Returns: 1 = language, 2 = root menu, 0 = no button
+// Returns: 1 = language, 2 = root menu, 3 = rescan cards, 4 = energy report, 0 = no button
 int handleOptionTouch(int x, int y);
 
 // Draw language selection page
@@ -15,8 +15,11 @@ void drawLanguageSelectionPage(JsonDocument& configDoc);
 // Returns language key if selected, empty string if home button
 String handleLanguageSelectionTouch(int x, int y, JsonDocument& configDoc);
 
+// Home button shared by the option sub-pages
+void drawOptionHomeButton();
+
 // Check if touch is on option home button
 bool isTouchOnOptionHomeButton(int x, int y);
 
-// Save new default language to config.json
-bool saveDefaultLanguage(String newDefaultLang);
\ No newline at end of file
+// Set the default language in the loaded config and write it to config.json
+bool saveDefaultLanguage(JsonDocument& configDoc, String newDefaultLang);
\ No newline at end of file
@@ -0,0 +1,131 @@
+// Fast pixel kernels must match the scalar reference bit for bit
+// (pio test -e native)
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "core/pixel_kernels.h"
+
+// Odd widths exercise the unpaired last pixel, widths past 8 the SWAR loop
+static const int WIDTHS[] = { 1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 31, 121, 400, 401 };
+static const int ROWS = 12;
+
+static uint32_t rngState;
+
+// xorshift32: the same rows on every run, so failures reproduce
+static uint8_t nextByte() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return (uint8_t)(rngState >> 24);
+}
+
+void setUp() {
+  rngState = 0x2545F491u;
+}
+
+void tearDown() {
+}
+
+// Random rows, with every third row near black or white to hit the diffusion clamps
+static void fillRows(std::vector<uint8_t>& rgb, int width) {
+  rgb.resize(width * ROWS * 3);
+  for (int y = 0; y < ROWS; y++) {
+    for (int i = 0; i < width * 3; i++) {
+      uint8_t value = nextByte();
+      if (y % 3 == 2) {
+        value = (value & 1) ? 240 + (value >> 4) : value >> 4;
+      }
+      rgb[y * width * 3 + i] = value;
+    }
+  }
+}
+
+// The reference kernels chained the way the fused kernel works in one pass
+static void referenceRow(const uint8_t* rgb, uint8_t* packed, int width, int y, DitherMode mode,
+                         int16_t* errCurrent, int16_t* errNext) {
+  std::vector<uint8_t> gray8(width);
+  std::vector<uint8_t> gray4(width);
+  rgb888ToGray8Row_ref(rgb, gray8.data(), width);
+  if (mode == DITHER_ORDERED) {
+    ditherOrderedRow_ref(gray8.data(), gray4.data(), width, y);
+  } else if (mode == DITHER_DIFFUSION) {
+    ditherDiffusionRow_ref(gray8.data(), gray4.data(), width, errCurrent, errNext);
+  } else {
+    quantizeGray4Row_ref(gray8.data(), gray4.data(), width);
+  }
+  pack4bppRow_ref(gray4.data(), packed, width);
+}
+
+static void checkMode(DitherMode mode) {
+  char message[64];
+  for (int width : WIDTHS) {
+    std::vector<uint8_t> rgb;
+    fillRows(rgb, width);
+    int rowBytes = (width + 1) / 2;
+    int errLen = ditherErrorRowLength(width);
+    std::vector<int16_t> refErr(errLen * 2, 0);
+    std::vector<int16_t> fastErr(errLen * 2, 0);
+    int16_t* refCur = refErr.data();
+    int16_t* refNext = refErr.data() + errLen;
+    int16_t* fastCur = fastErr.data();
+    int16_t* fastNext = fastErr.data() + errLen;
+    std::vector<uint8_t> expected(rowBytes);
+    std::vector<uint8_t> actual(rowBytes);
+
+    for (int y = 0; y < ROWS; y++) {
+      const uint8_t* row = rgb.data() + y * width * 3;
+      referenceRow(row, expected.data(), width, y, mode, refCur, refNext);
+      rgb888ToGray4Row(row, actual.data(), width, y, mode, fastCur, fastNext);
+
+      snprintf(message, sizeof(message), "mode %d, width %d, row %d", mode, width, y);
+      TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(expected.data(), actual.data(), rowBytes, message);
+      if (mode == DITHER_DIFFUSION) {
+        // The error carried into the next row must match as well
+        TEST_ASSERT_EQUAL_INT16_ARRAY_MESSAGE(refNext, fastNext, errLen, message);
+      }
+
+      int16_t* swap = refCur; refCur = refNext; refNext = swap;
+      swap = fastCur; fastCur = fastNext; fastNext = swap;
+    }
+  }
+}
+
+void test_quantize_matches_reference() {
+  checkMode(DITHER_NONE);
+}
+
+void test_ordered_dither_matches_reference() {
+  checkMode(DITHER_ORDERED);
+}
+
+void test_diffusion_matches_reference() {
+  checkMode(DITHER_DIFFUSION);
+}
+
+void test_pack4bpp_matches_reference() {
+  char message[32];
+  for (int width : WIDTHS) {
+    std::vector<uint8_t> levels(width);
+    for (int x = 0; x < width; x++) {
+      levels[x] = nextByte() & 0x0F;
+    }
+    int rowBytes = (width + 1) / 2;
+    std::vector<uint8_t> expected(rowBytes);
+    std::vector<uint8_t> actual(rowBytes);
+    pack4bppRow_ref(levels.data(), expected.data(), width);
+    pack4bppRow(levels.data(), actual.data(), width);
+
+    snprintf(message, sizeof(message), "width %d", width);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(expected.data(), actual.data(), rowBytes, message);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_quantize_matches_reference);
+  RUN_TEST(test_ordered_dither_matches_reference);
+  RUN_TEST(test_diffusion_matches_reference);
+  RUN_TEST(test_pack4bpp_matches_reference);
+  return UNITY_END();
+}
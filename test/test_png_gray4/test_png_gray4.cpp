@@ -0,0 +1,197 @@
+// PNG fast path against reference gray levels from Pillow decodes
+// (tools/png_reference.py writes reference.txt and fixtures/).
+// pio test -e native runs this from the project root.
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "core/png_gray4.h"
+
+#define REFERENCE_LIST "test/test_png_gray4/reference.txt"
+
+// A whole file in memory
+class MemorySource : public PngSource {
+public:
+  explicit MemorySource(const std::vector<uint8_t>& data) : _data(data), _position(0) {}
+
+  int read(uint8_t* buf, uint32_t len) override {
+    uint32_t left = _data.size() - _position;
+    uint32_t n = len < left ? len : left;
+    memcpy(buf, _data.data() + _position, n);
+    _position += n;
+    return n;
+  }
+
+  void skip(int32_t offset) override {
+    _position += offset;
+    if (_position > _data.size()) {
+      _position = _data.size();
+    }
+  }
+
+private:
+  const std::vector<uint8_t>& _data;
+  size_t _position;
+};
+
+struct ReferenceEntry {
+  std::string path;
+  int width;
+  int height;
+  bool supported;
+  uint32_t hash;
+};
+
+static std::vector<ReferenceEntry> references;
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& data) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  data.resize(ftell(file));
+  fseek(file, 0, SEEK_SET);
+  bool ok = fread(data.data(), 1, data.size(), file) == data.size();
+  fclose(file);
+  return ok;
+}
+
+static uint32_t fnv1a(const uint8_t* data, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= data[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static uint8_t levelAt(const std::vector<uint8_t>& packed, int rowBytes, int x, int y) {
+  uint8_t byte = packed[y * rowBytes + x / 2];
+  return (x & 1) ? byte & 0x0F : byte >> 4;
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_reference_list_loads() {
+  FILE* file = fopen(REFERENCE_LIST, "r");
+  TEST_ASSERT_NOT_NULL_MESSAGE(file, "run from the project root (" REFERENCE_LIST ")");
+  char line[512];
+  while (fgets(line, sizeof(line), file)) {
+    if (line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+    char path[400];
+    char expected[16];
+    ReferenceEntry entry;
+    unsigned int hash = 0;
+    int fields = sscanf(line, "%399s %d %d %15s %x", path, &entry.width, &entry.height, expected, &hash);
+    TEST_ASSERT_TRUE_MESSAGE(fields >= 4, line);
+    entry.path = path;
+    entry.supported = strcmp(expected, "ok") == 0;
+    entry.hash = hash;
+    references.push_back(entry);
+  }
+  fclose(file);
+  TEST_ASSERT_TRUE_MESSAGE(!references.empty(), "empty reference list");
+}
+
+// Every listed PNG decodes to exactly the reference levels, or is declined
+void test_decodes_match_reference() {
+  TEST_ASSERT_TRUE_MESSAGE(!references.empty(), "no reference list");
+  for (const ReferenceEntry& entry : references) {
+    std::vector<uint8_t> data;
+    TEST_ASSERT_TRUE_MESSAGE(readFile(entry.path, data), entry.path.c_str());
+
+    MemorySource infoSource(data);
+    PngFastInfo info;
+    TEST_ASSERT_TRUE_MESSAGE(readPngInfo(infoSource, info), entry.path.c_str());
+    TEST_ASSERT_EQUAL_INT_MESSAGE(entry.width, info.width, entry.path.c_str());
+    TEST_ASSERT_EQUAL_INT_MESSAGE(entry.height, info.height, entry.path.c_str());
+
+    int rowBytes = (info.width + 1) / 2;
+    std::vector<uint8_t> packed(rowBytes * info.height, 0);
+    MemorySource source(data);
+    PngFastStatus status = decodePngToGray4(source, packed.data(), rowBytes, info.width, info.height);
+    if (!entry.supported) {
+      TEST_ASSERT_EQUAL_INT_MESSAGE(PNG_FAST_UNSUPPORTED, status, entry.path.c_str());
+      continue;
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(PNG_FAST_OK, status, entry.path.c_str());
+    TEST_ASSERT_EQUAL_HEX32_MESSAGE(entry.hash, fnv1a(packed.data(), packed.size()), entry.path.c_str());
+  }
+}
+
+// A clipped decode yields the top-left of the full decode
+void test_clipped_decodes_match_full() {
+  for (const ReferenceEntry& entry : references) {
+    if (!entry.supported) {
+      continue;
+    }
+    std::vector<uint8_t> data;
+    TEST_ASSERT_TRUE_MESSAGE(readFile(entry.path, data), entry.path.c_str());
+
+    int fullBytes = (entry.width + 1) / 2;
+    std::vector<uint8_t> full(fullBytes * entry.height);
+    MemorySource fullSource(data);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(PNG_FAST_OK, decodePngToGray4(fullSource, full.data(), fullBytes, entry.width, entry.height),
+                                  entry.path.c_str());
+
+    int width = entry.width > 1 ? entry.width - 1 : 1;
+    int height = entry.height / 2 + 1;
+    int clipBytes = (width + 1) / 2;
+    std::vector<uint8_t> clipped(clipBytes * height);
+    MemorySource clipSource(data);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(PNG_FAST_OK, decodePngToGray4(clipSource, clipped.data(), clipBytes, width, height),
+                                  entry.path.c_str());
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        if (levelAt(full, fullBytes, x, y) != levelAt(clipped, clipBytes, x, y)) {
+          char message[480];
+          snprintf(message, sizeof(message), "%s: clipped pixel %d,%d differs", entry.path.c_str(), x, y);
+          TEST_FAIL_MESSAGE(message);
+        }
+      }
+    }
+  }
+}
+
+// Truncated or damaged files are errors, never OK
+void test_truncated_and_damaged_files_fail() {
+  for (const ReferenceEntry& entry : references) {
+    if (!entry.supported) {
+      continue;
+    }
+    std::vector<uint8_t> data;
+    TEST_ASSERT_TRUE_MESSAGE(readFile(entry.path, data), entry.path.c_str());
+    int rowBytes = (entry.width + 1) / 2;
+    std::vector<uint8_t> packed(rowBytes * entry.height);
+
+    std::vector<uint8_t> truncated(data.begin(), data.begin() + data.size() * 2 / 3);
+    MemorySource truncatedSource(truncated);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(PNG_FAST_ERROR,
+                                  decodePngToGray4(truncatedSource, packed.data(), rowBytes, entry.width, entry.height),
+                                  entry.path.c_str());
+
+    std::vector<uint8_t> badSignature = data;
+    badSignature[1] = 'X';
+    MemorySource badSource(badSignature);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(PNG_FAST_ERROR,
+                                  decodePngToGray4(badSource, packed.data(), rowBytes, entry.width, entry.height),
+                                  entry.path.c_str());
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_reference_list_loads);
+  RUN_TEST(test_decodes_match_reference);
+  RUN_TEST(test_clipped_decodes_match_full);
+  RUN_TEST(test_truncated_and_damaged_files_fail);
+  return UNITY_END();
+}
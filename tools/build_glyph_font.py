@@ -0,0 +1,238 @@
+#!/usr/bin/env python3
+"""Build a deck-specific glyph font (.g4f) for the flipcard firmware.
+
+Scans every card.json (plus index.json and config.json) in a deck for the
+code points it actually uses, rasterizes them with one or more TrueType/OpenType
+fonts at the requested pixel sizes, and writes a compact binary file the
+firmware loads from /flipcard/fonts/deck.g4f.
+
+Usage:
+    python3 tools/build_glyph_font.py --deck sd_card_content/flipcard \\
+        --font NotoSansSC-Regular.otf --font DejaVuSans.ttf
+
+Fonts are tried in order, so list a CJK font first and a Latin/IPA font as
+fallback. Requires Pillow (pip install pillow).
+
+File layout (little-endian):
+    header      "G4FN", u16 version, u16 sizeCount, u32 glyphCount, u32 reserved
+    size table  sizeCount x {u16 pixelSize, u16 lineHeight, i16 ascent,
+                u16 reserved, u32 glyphCount, u32 glyphTableOffset}
+    glyphs      per size, sorted by code point (binary searchable):
+                {u32 codepoint, u32 bitmapOffset, u16 width, u16 height,
+                 i16 xOffset, i16 yOffset, i16 advance, u16 reserved}
+    bitmaps     packed 4bpp gray, high nibble first, (width + 1) / 2 bytes per
+                row, 0 = black, 15 = white; yOffset is relative to the line top
+"""
+
+import argparse
+import json
+import struct
+import sys
+from pathlib import Path
+
+MAGIC = b"G4FN"
+VERSION = 1
+HEADER = struct.Struct("<4sHHII")
+SIZE_RECORD = struct.Struct("<HHhHII")
+GLYPH_RECORD = struct.Struct("<IIHHhhhH")
+
+DEFAULT_SIZES = [96, 64, 48, 40, 32, 24]
+
+# Characters the firmware draws itself (headers, buttons, counters)
+UI_CHARACTERS = "".join(chr(c) for c in range(0x20, 0x7F)) + "◀▶"
+
+
+def collect_strings(value, out):
+    """Append every string found in a JSON value."""
+    if isinstance(value, str):
+        out.append(value)
+    elif isinstance(value, dict):
+        for item in value.values():
+            collect_strings(item, out)
+    elif isinstance(value, list):
+        for item in value:
+            collect_strings(item, out)
+
+
+def load_json(path):
+    try:
+        with open(path, encoding="utf-8") as f:
+            return json.load(f)
+    except (OSError, ValueError) as error:
+        print(f"warning: skipping {path}: {error}", file=sys.stderr)
+        return None
+
+
+def collect_codepoints(deck):
+    """Code points used by the deck's displayable text."""
+    strings = [UI_CHARACTERS]
+
+    for card_path in sorted(deck.glob("*/card.json")):
+        card = load_json(card_path)
+        if not card:
+            continue
+        strings.append(card.get("title", ""))
+        for fields in card.get("languages", {}).values():
+            for key in ("big_text", "small_text", "notes"):
+                strings.append(fields.get(key, ""))
+
+    index = load_json(deck / "index.json") if (deck / "index.json").exists() else None
+    if index:
+        for category in index.get("categories", {}).values():
+            strings.append(category.get("name", ""))
+        for card in index.get("cards", []):
+            strings.append(card.get("title", ""))
+
+    config = load_json(deck / "config.json") if (deck / "config.json").exists() else None
+    if config:
+        for language in config.get("languages", {}).get("supported", {}).values():
+            collect_strings([language.get("name", ""), language.get("english_name", "")], strings)
+
+    codepoints = set()
+    for text in strings:
+        codepoints.update(ord(ch) for ch in text if ord(ch) >= 0x20)
+    return sorted(codepoints)
+
+
+def read_cmap(font_path):
+    """Set of code points mapped by a TrueType/OpenType font (cmap formats 4 and 12)."""
+    data = Path(font_path).read_bytes()
+    if data[:4] == b"ttcf":
+        data_offset = struct.unpack_from(">I", data, 12)[0]
+    else:
+        data_offset = 0
+    num_tables = struct.unpack_from(">H", data, data_offset + 4)[0]
+    cmap_offset = None
+    for i in range(num_tables):
+        tag, _, offset, _ = struct.unpack_from(">4sIII", data, data_offset + 12 + 16 * i)
+        if tag == b"cmap":
+            cmap_offset = offset
+    if cmap_offset is None:
+        return set()
+
+    covered = set()
+    num_subtables = struct.unpack_from(">H", data, cmap_offset + 2)[0]
+    for i in range(num_subtables):
+        platform, encoding, offset = struct.unpack_from(">HHI", data, cmap_offset + 4 + 8 * i)
+        if platform not in (0, 3):
+            continue
+        table = cmap_offset + offset
+        fmt = struct.unpack_from(">H", data, table)[0]
+        if fmt == 4:
+            seg_count = struct.unpack_from(">H", data, table + 6)[0] // 2
+            ends = struct.unpack_from(f">{seg_count}H", data, table + 14)
+            starts = struct.unpack_from(f">{seg_count}H", data, table + 16 + 2 * seg_count)
+            for start, end in zip(starts, ends):
+                if start != 0xFFFF:
+                    covered.update(range(start, end + 1))
+        elif fmt == 12:
+            groups = struct.unpack_from(">I", data, table + 12)[0]
+            for g in range(groups):
+                start, end, _ = struct.unpack_from(">III", data, table + 16 + 12 * g)
+                covered.update(range(start, end + 1))
+    return covered
+
+
+def pack_4bpp(image):
+    """Pack an 8-bit grayscale image into 4bpp rows (0 = black, 15 = white)."""
+    width, height = image.size
+    pixels = image.tobytes()
+    out = bytearray()
+    for y in range(height):
+        row = pixels[y * width:(y + 1) * width]
+        levels = [(v * 15 + 127) // 255 for v in row]
+        if width & 1:
+            levels.append(15)
+        for x in range(0, len(levels), 2):
+            out.append((levels[x] << 4) | levels[x + 1])
+    return bytes(out)
+
+
+def rasterize(font, codepoint, ascent):
+    """Tight anti-aliased bitmap of one glyph plus its placement."""
+    from PIL import Image, ImageDraw
+
+    ch = chr(codepoint)
+    advance = round(font.getlength(ch))
+    x0, y0, x1, y1 = font.getbbox(ch, anchor="ls")
+    width, height = x1 - x0, y1 - y0
+    if width <= 0 or height <= 0:
+        return 0, 0, 0, 0, advance, b""
+
+    image = Image.new("L", (width, height), 255)
+    ImageDraw.Draw(image).text((-x0, -y0), ch, font=font, fill=0, anchor="ls")
+    # Place relative to the line top: baseline sits at `ascent`
+    return width, height, x0, ascent + y0, advance, pack_4bpp(image)
+
+
+def build(deck, font_paths, sizes, output):
+    from PIL import ImageFont
+
+    codepoints = collect_codepoints(deck)
+    coverage = [read_cmap(path) for path in font_paths]
+
+    # Pick the first font that covers each code point
+    assignment = {}
+    missing = []
+    for cp in codepoints:
+        for index, covered in enumerate(coverage):
+            if cp in covered:
+                assignment[cp] = index
+                break
+        else:
+            missing.append(cp)
+    if missing:
+        print("warning: no font covers: " + " ".join(f"U+{cp:04X}" for cp in missing), file=sys.stderr)
+
+    size_records = []
+    glyph_tables = []
+    bitmaps = bytearray()
+    for size in sorted(sizes, reverse=True):
+        fonts = [ImageFont.truetype(str(path), size) for path in font_paths]
+        ascent, descent = fonts[0].getmetrics()
+        records = []
+        for cp in sorted(assignment):
+            width, height, x_offset, y_offset, advance, data = rasterize(fonts[assignment[cp]], cp, ascent)
+            records.append((cp, len(bitmaps), width, height, x_offset, y_offset, advance))
+            bitmaps += data
+        size_records.append((size, ascent + descent, ascent, len(records)))
+        glyph_tables.append(records)
+
+    glyph_base = HEADER.size + SIZE_RECORD.size * len(size_records)
+    glyph_count = sum(len(table) for table in glyph_tables)
+    bitmap_base = glyph_base + GLYPH_RECORD.size * glyph_count
+
+    out = bytearray(HEADER.pack(MAGIC, VERSION, len(size_records), glyph_count, 0))
+    table_offset = glyph_base
+    for (size, line_height, ascent, count) in size_records:
+        out += SIZE_RECORD.pack(size, line_height, ascent, 0, count, table_offset)
+        table_offset += GLYPH_RECORD.size * count
+    for table in glyph_tables:
+        for (cp, offset, width, height, x_offset, y_offset, advance) in table:
+            out += GLYPH_RECORD.pack(cp, bitmap_base + offset, width, height, x_offset, y_offset, advance, 0)
+    out += bitmaps
+
+    output.parent.mkdir(parents=True, exist_ok=True)
+    output.write_bytes(out)
+    print(f"{output}: {len(assignment)} code points x {len(size_records)} sizes, {len(out)} bytes")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--deck", type=Path, default=Path("sd_card_content/flipcard"),
+                        help="deck root containing index.json and flip-*/card.json")
+    parser.add_argument("--font", type=Path, action="append", required=True,
+                        help="TrueType/OpenType font; repeat for fallbacks")
+    parser.add_argument("--sizes", default=",".join(map(str, DEFAULT_SIZES)),
+                        help="comma-separated pixel sizes (em height)")
+    parser.add_argument("--output", type=Path, help="default: <deck>/fonts/deck.g4f")
+    args = parser.parse_args()
+
+    sizes = [int(s) for s in args.sizes.split(",") if s.strip()]
+    if not sizes or any(s <= 0 or s > 255 for s in sizes):
+        parser.error("sizes must be between 1 and 255")
+    build(args.deck, args.font, sizes, args.output or args.deck / "fonts" / "deck.g4f")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,397 @@
+#!/usr/bin/env python3
+"""Lint a flipcard deck for consistency problems and assets that are slow on device.
+
+Checks index.json against every card.json and the files that actually exist,
+applies config.json's file_naming.validation rules, and parses PNG/JPEG headers
+(without decoding) to report dimensions, scaling needs and a predicted decode
+cost per asset.
+
+Usage:
+    python3 tools/deck_lint.py sd_card_content/flipcard
+    python3 tools/deck_lint.py /media/sd/collection-01 --config /media/sd/flipcard/config.json \\
+        --max-warnings 0 --slow-ms 150 --top 20
+
+Exit status is 1 when errors exceed --max-errors (default 0) or warnings exceed
+--max-warnings (default: unlimited). Uses only the Python standard library.
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor
+from pathlib import Path
+
+# Target size of each asset role on the 540x960 panel
+ROLE_SIZES = {
+    "big": (400, 150),
+    "small": (400, 80),
+    "main": (400, 400),
+    "thumbnail": (120, 120),
+    "button": (80, 80),
+    "screensaver": (540, 960),
+    "frame": (540, 960),
+}
+
+# Roles the firmware resizes (thumbnail cache, screensaver renderer). Other PNGs
+# are drawn 1:1 and cropped to their box; JPEGs are always fitted.
+SCALED_PNG_ROLES = {"thumbnail", "screensaver"}
+
+# Rough on-device cost model (ESP32-S3, SD over SPI). These are estimates for
+# ranking assets, not measurements; compare with the firmware's SdStream stats.
+SD_BYTES_PER_MS = 1200          # Sequential SD reads
+INFLATE_BYTES_PER_MS = 6000     # zlib output (raw scanline bytes)
+PIXEL_NS = 60                   # Unfilter + color convert + push, per source pixel
+FAST_PIXEL_NS = 20              # Same on the 4bpp fast path (gray/palette PNGs)
+SCALE_PIXEL_NS = 40             # Extra per source pixel when drawn scaled
+INTERLACE_FACTOR = 1.35         # Adam7: seven passes, worse locality
+JPEG_PIXEL_NS = 110             # Baseline JPEG decode, per pixel
+
+PNG_SIGNATURE = b"\x89PNG\r\n\x1a\n"
+PNG_COLOR_TYPES = {0: "gray", 2: "rgb", 3: "palette", 4: "gray+alpha", 6: "rgba"}
+PNG_CHANNELS = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}
+METADATA_CHUNKS = {b"tEXt", b"zTXt", b"iTXt", b"eXIf", b"iCCP", b"tIME"}
+
+
+class Report:
+    """Findings for one card (merged on the main thread)."""
+
+    def __init__(self):
+        self.findings = []   # (severity, path, message)
+        self.assets = []     # dicts describing each parsed image
+
+    def add(self, severity, path, message):
+        self.findings.append((severity, str(path), message))
+
+
+def parse_png(path):
+    """Header facts of a PNG, walking chunk headers only."""
+    with open(path, "rb") as f:
+        if f.read(8) != PNG_SIGNATURE:
+            raise ValueError("not a PNG file")
+        info = {"format": "png", "idat_bytes": 0, "metadata_bytes": 0, "has_trns": False}
+        while True:
+            header = f.read(8)
+            if len(header) < 8:
+                raise ValueError("truncated before IEND")
+            length, ctype = struct.unpack(">I4s", header)
+            if ctype == b"IHDR":
+                data = f.read(length)
+                width, height, depth, color, _, _, interlace = struct.unpack(">IIBBBBB", data[:13])
+                info.update(width=width, height=height, bit_depth=depth, color_type=color, interlaced=interlace == 1)
+                f.seek(4, os.SEEK_CUR)
+                continue
+            if ctype == b"IDAT":
+                info["idat_bytes"] += length
+            elif ctype == b"tRNS":
+                info["has_trns"] = True
+            elif ctype in METADATA_CHUNKS:
+                info["metadata_bytes"] += length
+            elif ctype == b"IEND":
+                break
+            f.seek(length + 4, os.SEEK_CUR)
+    if "width" not in info:
+        raise ValueError("missing IHDR")
+    return info
+
+
+def parse_jpeg(path):
+    """Dimensions and progressive flag from the first SOF marker."""
+    with open(path, "rb") as f:
+        if f.read(2) != b"\xff\xd8":
+            raise ValueError("not a JPEG file")
+        while True:
+            marker = f.read(2)
+            if len(marker) < 2 or marker[0] != 0xFF:
+                raise ValueError("no SOF marker")
+            code = marker[1]
+            (length,) = struct.unpack(">H", f.read(2))
+            if code in (0xC0, 0xC1, 0xC2):
+                _, height, width = struct.unpack(">BHH", f.read(5))
+                return {"format": "jpeg", "width": width, "height": height, "progressive": code == 0xC2}
+            f.seek(length - 2, os.SEEK_CUR)
+
+
+def fast_path_eligible(info):
+    """Mirrors pngFastPathEligible() in src/core/png_gray4.cpp."""
+    return (info["format"] == "png" and not info["interlaced"] and not info["has_trns"]
+            and info["color_type"] in (0, 3) and (info["color_type"] == 0 or info["bit_depth"] <= 8))
+
+
+def jpeg_scale(info, target):
+    """IDCT reduction the firmware picks (mirrors chooseJpegScale())."""
+    if target is None:
+        return 0
+    fit = min(1.0, target[0] / info["width"], target[1] / info["height"])
+    fit_width, fit_height = int(info["width"] * fit), int(info["height"] * fit)
+    scale = 0
+    while scale < 3 and info["width"] >> (scale + 1) >= fit_width and info["height"] >> (scale + 1) >= fit_height:
+        scale += 1
+    return scale
+
+
+def is_scaled(info, role, target):
+    """Whether the firmware resizes this asset (rather than drawing it 1:1)."""
+    if target is None or (info["width"], info["height"]) == target:
+        return False
+    return info["format"] != "png" or role in SCALED_PNG_ROLES
+
+
+def predict_cost_ms(info, file_size, role, target):
+    """Estimated decode+draw time for one asset in its role."""
+    pixels = info["width"] * info["height"]
+    scaled = is_scaled(info, role, target)
+    cost = file_size / SD_BYTES_PER_MS
+    if info["format"] == "png":
+        bits = info["bit_depth"] * PNG_CHANNELS.get(info["color_type"], 4)
+        raw_bytes = info["height"] * (1 + (info["width"] * bits + 7) // 8)
+        pixel_ns = FAST_PIXEL_NS if fast_path_eligible(info) and not scaled else PIXEL_NS
+        cost += raw_bytes / INFLATE_BYTES_PER_MS + pixels * pixel_ns / 1e6
+        if info["interlaced"]:
+            cost *= INTERLACE_FACTOR
+        if scaled:
+            cost += pixels * SCALE_PIXEL_NS / 1e6
+    else:
+        # Reduced while decoding, then area-averaged at the smaller size
+        decoded = pixels >> (2 * jpeg_scale(info, target))
+        cost += decoded * JPEG_PIXEL_NS / 1e6
+        if scaled:
+            cost += decoded * SCALE_PIXEL_NS / 1e6
+    return cost
+
+
+def check_asset(report, path, role, rules, slow_ms):
+    """Header-level checks of one image file."""
+    try:
+        file_size = path.stat().st_size
+    except OSError:
+        report.add("error", path, f"{role} image is missing")
+        return
+
+    extension = path.suffix.lower().lstrip(".")
+    formats = [f.lower() for f in rules.get("supported_formats", ["png", "jpg"])]
+    if extension not in formats and not (extension == "jpeg" and "jpg" in formats):
+        report.add("error", path, f"unsupported format .{extension} (allowed: {', '.join(formats)})")
+        return
+
+    limit = rules.get("thumbnail_max_size") if role == "thumbnail" else rules.get("max_file_size")
+    if limit and file_size > limit:
+        report.add("error", path, f"{file_size} bytes exceeds the {role} limit of {limit}")
+
+    try:
+        info = parse_png(path) if extension == "png" else parse_jpeg(path)
+    except (OSError, ValueError, struct.error) as error:
+        report.add("error", path, f"unreadable image header: {error}")
+        return
+
+    target = ROLE_SIZES.get(role)
+    width, height = info["width"], info["height"]
+    if target and (width, height) != target and info["format"] == "png":
+        factor = min(target[0] / width, target[1] / height)
+        if factor < 1 and role in SCALED_PNG_ROLES:
+            report.add("warning", path, f"{width}x{height} is larger than {target[0]}x{target[1]}; "
+                       f"decoded at full size and scaled by {factor:.2f}")
+        elif width > target[0] or height > target[1]:
+            report.add("warning", path, f"{width}x{height} is larger than {target[0]}x{target[1]}; "
+                       "drawn 1:1 and cropped")
+        else:
+            report.add("warning", path, f"{width}x{height} does not match {target[0]}x{target[1]}")
+
+    if info["format"] == "png":
+        if info["interlaced"]:
+            report.add("warning", path, "interlaced (Adam7) PNG decodes in seven passes")
+        if not fast_path_eligible(info) and not info["interlaced"]:
+            # 16-bit gray is fine: the fast path keeps the high byte of each sample
+            depth = "16-bit " if info["bit_depth"] == 16 else ""
+            report.add("info", path, f"{depth}{PNG_COLOR_TYPES.get(info['color_type'], '?')} PNG misses the 4bpp "
+                       "fast path; save as gray or palette without transparency")
+        if info["metadata_bytes"] > 1024:
+            report.add("info", path, f"{info['metadata_bytes']} bytes of metadata chunks")
+    elif info["progressive"]:
+        report.add("error", path, "progressive JPEG is not supported by the device decoder")
+
+    cost = predict_cost_ms(info, file_size, role, target)
+    if slow_ms and cost > slow_ms:
+        report.add("warning", path, f"predicted {cost:.0f} ms to draw (limit {slow_ms} ms)")
+
+    report.assets.append({
+        "path": str(path), "role": role, "bytes": file_size, "width": width, "height": height,
+        "format": info["format"],
+        "color": PNG_COLOR_TYPES.get(info.get("color_type"), info["format"]),
+        "bit_depth": info.get("bit_depth", 8), "interlaced": info.get("interlaced", info.get("progressive", False)),
+        "scaled": is_scaled(info, role, target),
+        "predicted_ms": round(cost, 1),
+    })
+
+
+def expected_name(pattern, language_suffix, card_id):
+    return pattern.replace("{lang}", language_suffix or "").replace("{id}", card_id or "")
+
+
+def lint_card(deck, entry, config, options):
+    """All checks for one index entry (runs on a worker thread)."""
+    report = Report()
+    rules = config.get("file_naming", {}).get("validation", {})
+    convention = config.get("file_naming", {}).get("convention", {})
+    supported = config.get("languages", {}).get("supported", {})
+    text_mode = config.get("display", {}).get("text_mode") == "text"
+
+    folder = entry.get("folder")
+    if not folder:
+        report.add("error", deck / "index.json", f"card {entry.get('id')} has no folder")
+        return report
+    card_dir = deck / folder
+    card_path = card_dir / "card.json"
+    try:
+        with open(card_path, encoding="utf-8") as f:
+            card = json.load(f)
+    except FileNotFoundError:
+        report.add("error", card_path, "listed in index.json but missing")
+        return report
+    except ValueError as error:
+        report.add("error", card_path, f"invalid JSON: {error}")
+        return report
+
+    # index.json must mirror card.json
+    for key in ("id", "title", "category", "thumbnail"):
+        if key in entry and key in card and entry[key] != card[key]:
+            report.add("error", card_path, f"{key} is {card[key]!r} but index.json has {entry[key]!r}")
+    card_languages = sorted(card.get("languages", {}))
+    if sorted(entry.get("languages", [])) != card_languages:
+        report.add("warning", card_path, f"languages {card_languages} differ from index.json {entry.get('languages')}")
+    if "tags" in entry and sorted(entry["tags"]) != sorted(card.get("tags", [])):
+        report.add("warning", card_path, f"tags {card.get('tags', [])} differ from index.json {entry['tags']}")
+
+    card_id = card.get("id", entry.get("id"))
+    for role, key in (("main", "main_image"), ("thumbnail", "thumbnail")):
+        name = card.get(key)
+        if not name:
+            report.add("error", card_path, f"missing {key}")
+            continue
+        check_asset(report, card_dir / name, role, rules, options.slow_ms)
+        pattern = convention.get("main_image" if role == "main" else "thumbnail")
+        if pattern and name != expected_name(pattern, None, card_id):
+            report.add("info", card_dir / name, f"name differs from convention {pattern}")
+
+    for language, fields in card.get("languages", {}).items():
+        if language not in supported:
+            report.add("warning", card_path, f"language {language!r} is not in config.json")
+        suffix = supported.get(language, {}).get("file_suffix")
+        for role in ("big", "small"):
+            name = fields.get(f"{role}_file")
+            has_text = bool(fields.get(f"{role}_text"))
+            if not name:
+                if not (text_mode and has_text):
+                    report.add("error", card_path, f"{language}.{role}_file is missing")
+                continue
+            path = card_dir / name
+            if text_mode and has_text and not path.exists():
+                continue  # Drawn from text; the PNG is optional
+            check_asset(report, path, role, rules, options.slow_ms)
+            pattern = convention.get(f"{role}_image")
+            if pattern and suffix and name != expected_name(pattern, suffix, card_id):
+                report.add("info", path, f"name differs from convention {pattern}")
+    return report
+
+
+def lint_deck_assets(deck, rules, options):
+    """UI assets that live at the collection root (only checked when present)."""
+    report = Report()
+    for name, role in (("Left.png", "button"), ("Right.png", "button"), ("Home.png", "button"),
+                       ("LeftGrey.png", "button"), ("RightGrey.png", "button"),
+                       ("empty-frame.png", "frame"), ("screensaver/Thousand-Miles1.png", "screensaver")):
+        if (deck / name).exists():
+            check_asset(report, deck / name, role, rules, options.slow_ms)
+    return report
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("deck", type=Path, help="collection root containing index.json")
+    parser.add_argument("--config", type=Path, help="config.json (default: <deck>/config.json)")
+    parser.add_argument("--jobs", type=int, default=min(32, (os.cpu_count() or 4) * 4),
+                        help="worker threads")
+    parser.add_argument("--slow-ms", type=float, default=250, help="warn when an asset is predicted slower (0 = off)")
+    parser.add_argument("--max-errors", type=int, default=0, help="fail when errors exceed this")
+    parser.add_argument("--max-warnings", type=int, default=-1, help="fail when warnings exceed this (-1 = never)")
+    parser.add_argument("--top", type=int, default=10, help="list the N slowest assets")
+    parser.add_argument("--quiet", action="store_true", help="only print errors and the summary")
+    parser.add_argument("--json", type=Path, help="write the full report as JSON")
+    options = parser.parse_args()
+
+    started = time.monotonic()
+    deck = options.deck
+    config_path = options.config or deck / "config.json"
+    try:
+        config = json.loads(config_path.read_text(encoding="utf-8"))
+    except (OSError, ValueError) as error:
+        print(f"warning: no usable config ({config_path}: {error}); using defaults", file=sys.stderr)
+        config = {}
+    try:
+        index = json.loads((deck / "index.json").read_text(encoding="utf-8"))
+    except (OSError, ValueError) as error:
+        print(f"error: cannot read {deck / 'index.json'}: {error}", file=sys.stderr)
+        return 2
+
+    cards = index.get("cards", [])
+    top = Report()
+
+    # Index-level consistency
+    declared = index.get("metadata", {}).get("total_cards")
+    if declared is not None and declared != len(cards):
+        top.add("error", deck / "index.json", f"metadata.total_cards is {declared} but {len(cards)} cards are listed")
+    categories = index.get("categories", {})
+    seen_ids, seen_folders = set(), set()
+    for entry in cards:
+        for key, seen in (("id", seen_ids), ("folder", seen_folders)):
+            value = entry.get(key)
+            if value in seen:
+                top.add("error", deck / "index.json", f"duplicate {key} {value!r}")
+            seen.add(value)
+        if entry.get("category") not in categories:
+            top.add("error", deck / "index.json", f"card {entry.get('id')} uses unknown category {entry.get('category')!r}")
+    for child in deck.iterdir():
+        if child.is_dir() and (child / "card.json").exists() and child.name not in seen_folders:
+            top.add("warning", child / "card.json", "card folder is not listed in index.json")
+
+    rules = config.get("file_naming", {}).get("validation", {})
+    with ThreadPoolExecutor(max_workers=max(1, options.jobs)) as pool:
+        reports = list(pool.map(lambda entry: lint_card(deck, entry, config, options), cards))
+    reports.append(lint_deck_assets(deck, rules, options))
+    reports.insert(0, top)
+
+    findings = [finding for report in reports for finding in report.findings]
+    assets = [asset for report in reports for asset in report.assets]
+    counts = {severity: sum(1 for f in findings if f[0] == severity) for severity in ("error", "warning", "info")}
+
+    for severity, path, message in findings:
+        if not options.quiet or severity == "error":
+            print(f"{severity.upper():7} {path}: {message}")
+
+    if options.top and assets:
+        print(f"\nSlowest {min(options.top, len(assets))} assets (predicted):")
+        for asset in sorted(assets, key=lambda a: a["predicted_ms"], reverse=True)[:options.top]:
+            print(f"  {asset['predicted_ms']:7.1f} ms  {asset['width']}x{asset['height']} {asset['color']}"
+                  f"{' scaled' if asset['scaled'] else ''}  {asset['path']}")
+
+    total_ms = sum(asset["predicted_ms"] for asset in assets)
+    elapsed = time.monotonic() - started
+    print(f"\n{len(cards)} cards, {len(assets)} assets ({total_ms / 1000:.1f} s predicted draw time): "
+          f"{counts['error']} errors, {counts['warning']} warnings, {counts['info']} notes in {elapsed:.2f} s")
+
+    if options.json:
+        options.json.write_text(json.dumps({
+            "findings": [{"severity": s, "path": p, "message": m} for s, p, m in findings],
+            "assets": assets,
+            "counts": counts,
+        }, indent=2, ensure_ascii=False), encoding="utf-8")
+
+    failed = counts["error"] > options.max_errors or (
+        options.max_warnings >= 0 and counts["warning"] > options.max_warnings)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
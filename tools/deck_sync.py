@@ -0,0 +1,364 @@
+#!/usr/bin/env python3
+"""Sync a collection to the device over USB serial, sending only changed blocks.
+
+The firmware keeps CRC-32s of every 4 KB block of every file in the active
+collection (.cache/sync-manifest.tsv on SD). push lists them, compares them
+with the local files and sends just the blocks that differ; the device
+rebuilds each file next to the old one, checks its CRC and swaps it in, then
+reloads config.json (when synced) and index.json, including card folders the
+index doesn't list yet, without rebooting.
+
+Usage:
+    # Bring the device's active collection in line with a local folder
+    python3 tools/deck_sync.py push sd_card_content/flipcard --port /dev/ttyACM0
+
+    # Also delete device files that are not in the local folder
+    python3 tools/deck_sync.py push /tmp/deck-10k --port /dev/ttyACM0 --delete
+
+    # Only show what would be sent
+    python3 tools/deck_sync.py push /tmp/deck-10k --port /dev/ttyACM0 --dry-run
+
+    # Simulated device backed by a directory, on a pseudo-terminal (Linux);
+    # prints the port to pass to push --port
+    python3 tools/deck_sync.py simulate /tmp/device-sd
+
+push prints what was sent and the throughput (payload and wire bytes per
+second, and how many file bytes that brought up to date). Hidden files and
+folders (.cache) are never synced; index.json is sent last. push needs
+pyserial (pip install pyserial); simulate uses only the standard library.
+"""
+
+import argparse
+import os
+import sys
+import time
+import zlib
+from pathlib import Path
+
+PROTOCOL_VERSION = 1
+PART_SUFFIX = ".sync-part"
+OLD_SUFFIX = ".sync-old"
+
+
+def block_crcs(data, block_size):
+    return [zlib.crc32(data[offset:offset + block_size]) for offset in range(0, len(data), block_size)]
+
+
+def local_files(root):
+    """Relative path -> absolute path of every non-hidden file under root."""
+    files = {}
+    for folder, directories, names in os.walk(root):
+        directories[:] = sorted(d for d in directories if not d.startswith("."))
+        for name in sorted(names):
+            if name.startswith(".") or name.endswith((PART_SUFFIX, OLD_SUFFIX)):
+                continue
+            path = Path(folder) / name
+            files[path.relative_to(root).as_posix()] = path
+    return files
+
+
+class SyncError(Exception):
+    pass
+
+
+class Device:
+    """SYNC lines from the firmware's serial console; other log lines are skipped."""
+
+    def __init__(self, port, baud, timeout, log):
+        import serial  # pyserial, only needed for push
+        self.port = serial.Serial(port, baud, timeout=0.1)
+        self.timeout = timeout
+        self.log = log
+        self.pending = b""
+        self.wire_bytes = 0
+
+    def send(self, text, payload=b""):
+        data = (text + "\n").encode() + payload
+        self.port.write(data)
+        self.wire_bytes += len(data)
+
+    def reply(self, timeout=None):
+        """Next SYNC reply as a list of fields (the F line keeps its tab-separated tail)."""
+        deadline = time.monotonic() + (timeout or self.timeout)
+        while time.monotonic() < deadline:
+            if b"\n" in self.pending:
+                line, self.pending = self.pending.split(b"\n", 1)
+                text = line.decode(errors="replace").rstrip("\r")
+                if self.log:
+                    self.log.write(text + "\n")
+                if "SYNC " in text:
+                    text = text[text.index("SYNC ") + 5:]
+                    if text.startswith("X"):
+                        raise SyncError(f"device: {text[2:]}")
+                    return text.split(" ", 1 if text.startswith("F") else -1)
+                continue
+            self.pending += self.port.read(max(1, self.port.in_waiting))
+        raise SyncError("no reply from the device (is the firmware current?)")
+
+    def expect(self, kind, timeout=None):
+        fields = self.reply(timeout)
+        if fields[0] != kind:
+            raise SyncError(f"expected {kind}, got {' '.join(fields)}")
+        return fields
+
+
+def push(options):
+    root = options.folder
+    if not (root / "index.json").is_file():
+        print(f"warning: {root} has no index.json", file=sys.stderr)
+    log = open(options.log, "w", encoding="utf-8") if options.log else None
+    device = Device(options.port, options.baud, options.timeout, log)
+    started = time.monotonic()
+    try:
+        device.send("sync hello")
+        _, version, block_size, device_root = device.expect("H")
+        if int(version) != PROTOCOL_VERSION:
+            raise SyncError(f"device speaks sync protocol {version}, this tool {PROTOCOL_VERSION}")
+        block_size = int(block_size)
+
+        # Device files with their block CRCs (hashing unchanged files is cached on the device)
+        device.send("sync list")
+        remote = {}
+        while True:
+            fields = device.reply(options.list_timeout)
+            if fields[0] == "L":
+                break
+            path, size, crcs = fields[1].split("\t")
+            remote[path] = (int(size), [int(crc, 16) for crc in crcs.split(",") if crc])
+        listed = time.monotonic()
+
+        files = local_files(root)
+        # index.json last, so it never names files the device doesn't have yet
+        order = sorted(files, key=lambda path: (path == "index.json", path))
+        stats = {"unchanged": 0, "changed": 0, "new": 0, "deleted": 0, "blocks": 0, "sent": 0,
+                 "payload": 0, "file_bytes": 0}
+        for path in order:
+            data = files[path].read_bytes()
+            crcs = block_crcs(data, block_size)
+            stats["blocks"] += len(crcs)
+            known = remote.get(path)
+            if known and known[0] == len(data) and known[1] == crcs:
+                stats["unchanged"] += 1
+                continue
+            old = known[1] if known else []
+            changed = [i for i, crc in enumerate(crcs) if i >= len(old) or old[i] != crc]
+            stats["changed" if known else "new"] += 1
+            stats["sent"] += len(changed)
+            stats["file_bytes"] += len(data)
+            print(f"  {'~' if known else '+'} {path}: {len(changed)}/{len(crcs)} blocks")
+            if options.dry_run:
+                stats["payload"] += sum(len(data[i * block_size:(i + 1) * block_size]) for i in changed)
+                continue
+
+            device.send(f"sync open {len(data)} {zlib.crc32(data):08x} {path}")
+            device.expect("O")
+            for index in changed:
+                block = data[index * block_size:(index + 1) * block_size]
+                for attempt in range(3):
+                    device.send(f"sync data {index} {len(block)} {zlib.crc32(block):08x}", block)
+                    fields = device.reply()
+                    if fields[0] == "K":
+                        break
+                    if fields[0] != "R" or attempt == 2:
+                        device.send("sync abort")
+                        raise SyncError(f"{path}: block {index} not accepted ({' '.join(fields)})")
+                stats["payload"] += len(block)
+            device.send("sync commit")
+            device.expect("C")
+
+        if options.delete:
+            for path in sorted(set(remote) - set(files)):
+                stats["deleted"] += 1
+                print(f"  - {path}")
+                if not options.dry_run:
+                    device.send(f"sync delete {path}")
+                    device.expect("K")
+        transferred = time.monotonic()
+
+        # The device reloads and refreshes its index before answering
+        device.send("sync done")
+        device.expect("D", options.list_timeout)
+        finished = time.monotonic()
+    except SyncError as error:
+        print(f"error: {error}", file=sys.stderr)
+        return 2
+    finally:
+        if log:
+            log.close()
+
+    transfer_s = max(transferred - listed, 1e-6)
+    print(f"{'Dry run: ' if options.dry_run else ''}{root} -> {options.port} ({device_root})")
+    print(f"  files: {len(files)} local, {stats['unchanged']} unchanged, {stats['changed']} changed, "
+          f"{stats['new']} new, {stats['deleted']} deleted")
+    share = stats["sent"] * 100.0 / stats["blocks"] if stats["blocks"] else 0.0
+    print(f"  blocks: {stats['sent']} of {stats['blocks']} sent ({share:.1f}%), "
+          f"{stats['payload'] / 1024:.0f} KB payload, {device.wire_bytes / 1024:.0f} KB on the wire")
+    print(f"  time: list {listed - started:.2f} s, transfer {transferred - listed:.2f} s, "
+          f"index refresh {finished - transferred:.2f} s, total {finished - started:.2f} s")
+    print(f"  throughput: {stats['payload'] / 1024 / transfer_s:.0f} KB/s payload, "
+          f"{device.wire_bytes / 1024 / max(finished - started, 1e-6):.0f} KB/s on the wire; "
+          f"{stats['file_bytes'] / 1024:.0f} KB of files updated at "
+          f"{stats['file_bytes'] / 1024 / transfer_s:.0f} KB/s effective")
+    return 0
+
+
+class SimulatedDevice:
+    """The firmware's sync commands on a directory instead of the SD card."""
+
+    def __init__(self, root, block_size):
+        self.root = root
+        self.block_size = block_size
+        self.target = None
+        self.session = False
+        self.files = 0
+
+    def reply(self, text):
+        return ("SYNC " + text + "\n").encode()
+
+    def safe(self, path):
+        return (path and not path.startswith("/") and ".." not in path and not path.startswith(".cache")
+                and not path.endswith((PART_SUFFIX, OLD_SUFFIX)))
+
+    def command(self, line, read_exact):
+        """Handle one console line; returns the output bytes."""
+        words = line.split(" ")
+        if words[0] != "sync" or len(words) < 2:
+            return f"[Console] Unknown command: {words[0]} (try help)\n".encode()
+        action, args = words[1], words[2:]
+        if action == "hello":
+            self.session, self.target, self.files = True, None, 0
+            return self.reply(f"H {PROTOCOL_VERSION} {self.block_size} /{self.root.name}")
+        if not self.session:
+            return self.reply("X no session (sync hello first)")
+        if action == "list":
+            out = b"[Sync] Listing (simulated)\n"
+            files = local_files(self.root)
+            for path, full in files.items():
+                data = full.read_bytes()
+                crcs = ",".join(f"{crc:08x}" for crc in block_crcs(data, self.block_size))
+                out += self.reply(f"F {path}\t{len(data)}\t{crcs}")
+            return out + self.reply(f"L {len(files)} 0")
+        if action == "open":
+            size, crc, path = int(args[0]), int(args[1], 16), " ".join(args[2:])
+            if not self.safe(path):
+                return self.reply(f"X bad path {path}")
+            full = self.root / path
+            old = full.read_bytes() if full.is_file() else None
+            self.target = {"path": path, "size": size, "crc": crc, "old": old, "data": bytearray()}
+            return self.reply("O")
+        if action == "data":
+            block, length, crc = int(args[0]), int(args[1]), int(args[2], 16)
+            payload = read_exact(length)
+            target = self.target
+            if target is None:
+                return self.reply("X no file open")
+            offset = block * self.block_size
+            if offset < len(target["data"]) or offset + length > target["size"]:
+                return self.reply(f"X block {block} out of order")
+            if len(payload) != length or zlib.crc32(payload) != crc:
+                return self.reply(f"R {block}")
+            if not self.copy_old(offset):
+                self.target = None
+                return self.reply("X old content missing")
+            target["data"] += payload
+            return self.reply(f"K {block}")
+        if action == "commit":
+            target = self.target
+            if target is None:
+                return self.reply("X no file open")
+            ok = self.copy_old(target["size"]) and zlib.crc32(bytes(target["data"])) == target["crc"]
+            self.target = None
+            if not ok:
+                return self.reply(f"X {target['path']} does not match")
+            full = self.root / target["path"]
+            full.parent.mkdir(parents=True, exist_ok=True)
+            part = full.with_name(full.name + PART_SUFFIX)
+            part.write_bytes(bytes(target["data"]))
+            os.replace(part, full)
+            self.files += 1
+            return self.reply(f"C {target['size']} 0")
+        if action == "abort":
+            self.target = None
+            return self.reply("A")
+        if action == "delete":
+            path = " ".join(args)
+            if not self.safe(path):
+                return self.reply(f"X bad path {path}")
+            (self.root / path).unlink(missing_ok=True)
+            self.files += 1
+            return self.reply("K")
+        if action == "done":
+            self.session = False
+            return b"[Sync] Session done (simulated)\n" + self.reply(f"D {self.files} 0 0")
+        return self.reply("X usage")
+
+    def copy_old(self, offset):
+        target = self.target
+        missing = offset - len(target["data"])
+        if missing <= 0:
+            return True
+        old = target["old"] or b""
+        chunk = old[len(target["data"]):offset]
+        if len(chunk) != missing:
+            return False
+        target["data"] += chunk
+        return True
+
+
+def simulate(options):
+    import pty
+    import tty
+    root = options.folder
+    root.mkdir(parents=True, exist_ok=True)
+    master, slave = pty.openpty()
+    tty.setraw(slave)
+    print(f"Simulated device on {os.ttyname(slave)} backed by {root} (Ctrl-C to stop)", flush=True)
+    device = SimulatedDevice(root, options.block_size)
+    pending = b""
+
+    def read_exact(length):
+        nonlocal pending
+        while len(pending) < length:
+            pending += os.read(master, 65536)
+        data, pending = pending[:length], pending[length:]
+        return data
+
+    try:
+        while True:
+            while b"\n" not in pending:
+                pending += os.read(master, 65536)
+            line, pending = pending.split(b"\n", 1)
+            text = line.decode(errors="replace").strip("\r")
+            if text:
+                os.write(master, device.command(text, read_exact))
+    except KeyboardInterrupt:
+        return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    run = commands.add_parser("push", help="send the changed blocks of a local collection")
+    run.add_argument("folder", type=Path, help="local collection root (with index.json)")
+    run.add_argument("--port", required=True, help="serial port, e.g. /dev/ttyACM0")
+    run.add_argument("--baud", type=int, default=115200)
+    run.add_argument("--delete", action="store_true", help="delete device files missing locally")
+    run.add_argument("--dry-run", action="store_true", help="list what would be sent")
+    run.add_argument("--timeout", type=float, default=10.0, help="seconds to wait for each reply")
+    run.add_argument("--list-timeout", type=float, default=300.0,
+                     help="seconds to wait while the device hashes files or refreshes its index")
+    run.add_argument("--log", type=Path, help="copy of everything the device printed")
+    run.set_defaults(handler=push)
+
+    sim = commands.add_parser("simulate", help="simulated device on a pseudo-terminal (Linux)")
+    sim.add_argument("folder", type=Path, help="directory standing in for the collection on SD")
+    sim.add_argument("--block-size", type=int, default=4096)
+    sim.set_defaults(handler=simulate)
+
+    options = parser.parse_args()
+    return options.handler(options)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,552 @@
+#!/usr/bin/env python3
+"""Run scripted benchmark scenarios on the device over its serial console.
+
+The firmware's "ctl" command navigates (menu, categories, grid pages, cards,
+languages), injects touches, and reports the UI state and its timing and
+memory counters as JSON. A scenario is a text file of those commands; each
+action is answered once the panel refresh it caused has finished, with the
+time the handler took and the time to ink.
+
+Usage:
+    # Run a scenario 3 times and keep every reply and the counters
+    python3 tools/device_bench.py run tools/scenarios/browse.txt --port /dev/ttyACM0 --repeat 3 -o run.json
+
+    # Compare the per-step timings of two result files
+    python3 tools/device_bench.py compare before.json run.json --threshold 10 --min-ms 30
+
+    # Stand-in device on a pseudo-terminal (Linux) for trying scenarios and
+    # the tool itself; prints the port to pass to run --port
+    python3 tools/device_bench.py simulate --deck sd_card_content/flipcard
+
+Scenario lines (# starts a comment):
+    go menu | go categories [random] | go category <id> [random]
+    go grid next|prev|<page> | go card next|prev|random|<index> | go language | go back
+    tap x y | long x y | twofinger x y | swipe left|right [y]
+    state | counters | reset          sent as they are
+    repeat N ... end                  run the enclosed lines N times (may nest)
+    expect key=value ...              check fields of the last reply's state
+    sleep ms                          wait on the host
+
+run exits with status 1 when a command fails or an expectation does not
+hold; compare exits with status 1 when a step got slower. run needs pyserial
+(pip install pyserial); compare and simulate use only the standard library.
+"""
+
+import argparse
+import json
+import os
+import random
+import re
+import sys
+import time
+from pathlib import Path
+
+PROTOCOL_VERSION = 1
+COUNTER_GROUPS = ["loop", "sd", "thumbnails", "png", "router"]
+
+
+class ControlError(Exception):
+    pass
+
+
+def parse_scenario(path):
+    """Scenario file -> list of (line number, text) with repeat blocks expanded."""
+    lines = []
+    for number, line in enumerate(Path(path).read_text(encoding="utf-8").splitlines(), 1):
+        text = line.split("#", 1)[0].strip()
+        if text:
+            lines.append((number, text))
+
+    def expand(position, depth):
+        steps = []
+        while position < len(lines):
+            number, text = lines[position]
+            words = text.split()
+            if words[0] == "end":
+                if depth == 0:
+                    raise ControlError(f"{path}:{number}: end without repeat")
+                return steps, position + 1
+            if words[0] == "repeat":
+                if len(words) != 2 or not words[1].isdigit():
+                    raise ControlError(f"{path}:{number}: repeat needs a count")
+                body, position = expand(position + 1, depth + 1)
+                steps.extend(body * int(words[1]))
+                continue
+            steps.append((number, text))
+            position += 1
+        if depth > 0:
+            raise ControlError(f"{path}: repeat without end")
+        return steps, position
+
+    return expand(0, 0)[0]
+
+
+def step_key(command):
+    """Group replies by command without its coordinates or indexes ("go card 12" -> "go card")."""
+    words = []
+    for word in command.split():
+        if re.fullmatch(r"-?\d+", word):
+            break
+        words.append(word)
+    return " ".join(words)
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * fraction))]
+
+
+def summarize(steps):
+    """Per step key: n, p50/p90/max of ink_ms, p50 of handled_ms and of the host round trip."""
+    summary = {}
+    for key in dict.fromkeys(step_key(step["cmd"]) for step in steps if "ink_ms" in step):
+        rows = [step for step in steps if "ink_ms" in step and step_key(step["cmd"]) == key]
+        ink = [row["ink_ms"] for row in rows]
+        summary[key] = {
+            "n": len(rows),
+            "p50": percentile(ink, 0.5),
+            "p90": percentile(ink, 0.9),
+            "max": max(ink),
+            "handled_p50": percentile([row["handled_ms"] for row in rows], 0.5),
+            "round_trip_p50": percentile([row["round_trip_ms"] for row in rows], 0.5),
+        }
+    return summary
+
+
+def counter_deltas(before, after):
+    """Growth of the cumulative counters between two "counters" replies."""
+    deltas = {}
+    for group in COUNTER_GROUPS + ["energy"]:
+        old, new = before.get(group, {}), after.get(group, {})
+        if group == "energy":
+            rows = {name: {key: value - old.get(name, {}).get(key, 0) for key, value in row.items()}
+                    for name, row in new.items()}
+            deltas[group] = {name: row for name, row in rows.items() if row.get("count")}
+        else:
+            deltas[group] = {key: value - old.get(key, 0) for key, value in new.items()
+                             if isinstance(value, (int, float)) and key not in ("max_ms", "snapshot_bytes")}
+    return deltas
+
+
+def print_summary(summary, title):
+    print(title)
+    print(f"  {'step':30} {'n':>5} {'p50':>7} {'p90':>7} {'max':>7} {'cpu p50':>8} {'rtt p50':>8}  (ms)")
+    for key, row in summary.items():
+        print(f"  {key:30} {row['n']:5} {row['p50']:7} {row['p90']:7} {row['max']:7} "
+              f"{row['handled_p50']:8} {row['round_trip_p50']:8}")
+
+
+class Device:
+    """CTL replies from the firmware's serial console; other log lines are skipped."""
+
+    def __init__(self, port, baud, timeout, log):
+        import serial  # pyserial, only needed for run
+        self.port = serial.Serial(port, baud, timeout=0.1)
+        self.timeout = timeout
+        self.log = log
+        self.pending = b""
+
+    def command(self, text):
+        """Send "ctl <text>" and return its JSON reply with the host round trip."""
+        start = time.monotonic()
+        self.port.write(("ctl " + text + "\n").encode())
+        deadline = start + self.timeout
+        while time.monotonic() < deadline:
+            if b"\n" in self.pending:
+                line, self.pending = self.pending.split(b"\n", 1)
+                line = line.decode(errors="replace").rstrip("\r")
+                if self.log:
+                    self.log.write(line + "\n")
+                if "CTL " in line:
+                    reply = json.loads(line[line.index("CTL ") + 4:])
+                    reply["round_trip_ms"] = round((time.monotonic() - start) * 1000)
+                    return reply
+                continue
+            self.pending += self.port.read(max(1, self.port.in_waiting))
+        raise ControlError(f"no reply to \"{text}\" within {self.timeout} s (is the firmware current?)")
+
+
+def check_expect(text, reply):
+    """Failed key=value pairs of an expect line against the last reply's state."""
+    state = (reply or {}).get("state", {})
+    failed = []
+    for pair in text.split()[1:]:
+        key, _, value = pair.partition("=")
+        actual = state.get(key)
+        if str(actual).lower() != value.lower():
+            failed.append(f"{key}={actual} (expected {value})")
+    return failed
+
+
+def run(options):
+    steps = parse_scenario(options.scenario)
+    log = open(options.log, "w", encoding="utf-8") if options.log else None
+    device = Device(options.port, options.baud, options.timeout, log)
+    results = {"scenario": str(options.scenario), "port": options.port, "runs": options.repeat, "steps": []}
+    failures = 0
+    try:
+        hello = device.command("ping")
+        if not hello.get("ok") or hello.get("version") != PROTOCOL_VERSION:
+            raise ControlError(f"device speaks control protocol {hello.get('version')}, this tool {PROTOCOL_VERSION}")
+        # Latency percentiles cannot be subtracted, so they start over here
+        device.command("reset")
+        results["state_before"] = device.command("state").get("state", {})
+        results["counters_before"] = device.command("counters")
+        started = time.monotonic()
+        for number in range(options.repeat):
+            last = None
+            for line, text in steps:
+                words = text.split()
+                if words[0] == "sleep":
+                    time.sleep(int(words[1]) / 1000.0)
+                    continue
+                if words[0] == "expect":
+                    failed = check_expect(text, last)
+                    if failed:
+                        failures += 1
+                        print(f"run {number + 1}, line {line}: {', '.join(failed)}", file=sys.stderr)
+                    continue
+                reply = device.command(text)
+                reply["run"] = number + 1
+                reply["line"] = line
+                if not reply.get("ok"):
+                    failures += 1
+                    print(f"run {number + 1}, line {line}: {text}: {reply.get('error')}", file=sys.stderr)
+                if words[0] not in ("counters", "state", "ping", "reset"):
+                    results["steps"].append(reply)
+                last = reply
+            print(f"run {number + 1}/{options.repeat}: {len(steps)} lines")
+        results["elapsed_s"] = round(time.monotonic() - started, 3)
+        results["counters_after"] = device.command("counters")
+    except ControlError as error:
+        print(f"error: {error}", file=sys.stderr)
+        return 2
+    finally:
+        if log:
+            log.close()
+
+    results["summary"] = summarize(results["steps"])
+    results["deltas"] = counter_deltas(results["counters_before"], results["counters_after"])
+    if options.output:
+        Path(options.output).write_text(json.dumps(results, indent=2) + "\n", encoding="utf-8")
+
+    print_summary(results["summary"], f"{options.scenario} on {options.port}, {results['elapsed_s']} s")
+    memory = results["counters_after"].get("memory", {})
+    print(f"  memory: heap {memory.get('heap_free', 0) // 1024} KB free (min {memory.get('heap_min', 0) // 1024}), "
+          f"psram {memory.get('psram_free', 0) // 1024} KB free (min {memory.get('psram_min', 0) // 1024}); "
+          f"longest loop {results['counters_after'].get('loop', {}).get('max_ms')} ms")
+    arenas = results["counters_after"].get("json", {})
+    if arenas:
+        print("  json arenas: " + ", ".join(f"{name} {row['used'] // 1024}/{row['reserved'] // 1024} KB "
+                                            f"(high water {row['high_water'] // 1024})"
+                                            for name, row in arenas.items()))
+    for group in COUNTER_GROUPS:
+        values = ", ".join(f"{key} +{value}" for key, value in results["deltas"][group].items() if value)
+        if values:
+            print(f"  {group}: {values}")
+    print(f"{failures} failure(s)")
+    return 1 if failures else 0
+
+
+def compare(options):
+    base = json.loads(Path(options.baseline).read_text(encoding="utf-8"))["summary"]
+    new = json.loads(Path(options.run).read_text(encoding="utf-8"))["summary"]
+    regressions = 0
+    print(f"  {'step':30} {'metric':6} {'base':>7} {'new':>7} {'change':>8}")
+    for key in base:
+        if key not in new:
+            continue
+        for metric in ("p50", "p90"):
+            old_ms, new_ms = base[key][metric], new[key][metric]
+            change = (new_ms - old_ms) * 100.0 / old_ms if old_ms else 0.0
+            regressed = change > options.threshold and new_ms - old_ms > options.min_ms
+            regressions += regressed
+            flag = "  REGRESSION" if regressed else ""
+            print(f"  {key:30} {metric:6} {old_ms:7} {new_ms:7} {change:+7.1f}%{flag}")
+    missing = sorted(set(base) ^ set(new))
+    if missing:
+        print(f"  only in one run: {', '.join(missing)}")
+    print(f"{regressions} regression(s)")
+    return 1 if regressions else 0
+
+
+class SimulatedDevice:
+    """The firmware's page flow with made-up timings. Touches are mapped to
+    what they do on each page (swipes page or flip, a two-finger tap cycles
+    the language, a long-press leaves a card); taps are recognized but change
+    nothing, since the simulator has no page layouts."""
+
+    TIMES = {"page": (40, 900), "grid_page": (60, 450), "card": (120, 700), "language": (30, 350)}
+
+    def __init__(self, cards, categories, languages, scale, seed):
+        self.cards = cards            # (id, category, languages) in index order
+        self.categories = categories
+        self.languages = languages
+        self.scale = scale
+        self.random = random.Random(seed)
+        self.stack = []
+        self.ui = {"page": "MENU", "random": False, "category": "", "category_page": 0, "grid_page": 0,
+                   "grid_pages": 1, "card": 0, "language": languages[0]}
+        self.counters = {"loop": {"count": 0, "max_ms": 0}, "sd": {"opens": 0, "bytes_read": 0},
+                         "thumbnails": {"hits": 0, "misses": 0}, "router": {"snapshots": 0, "restores": 0},
+                         "energy": {}, "latency": {}}
+        self.started = time.monotonic()
+
+    def visible(self):
+        return [i for i, card in enumerate(self.cards) if not self.ui["category"] or card[1] == self.ui["category"]]
+
+    def state(self):
+        state = dict(self.ui, collection="/simulated", total_cards=len(self.cards),
+                     filter=f"category={self.ui['category']}" if self.ui["category"] else "all cards",
+                     filtered_cards=len(self.visible()), slideshow=False)
+        state["card_id"] = self.cards[self.ui["card"]][0] if self.cards else ""
+        return state
+
+    def work(self, kind):
+        """Pretend to draw: returns (handled_ms, ink_ms) and waits scale * ink_ms."""
+        handled, refresh = self.TIMES[kind]
+        handled = int(handled * self.random.uniform(0.8, 1.3))
+        ink = handled + int(refresh * self.random.uniform(0.9, 1.1))
+        time.sleep(ink * self.scale / 1000.0)
+        energy = self.counters["energy"].setdefault(kind, {"count": 0, "active_ms": 0, "refresh_ms": 0})
+        energy["count"] += 1
+        energy["active_ms"] += handled
+        energy["refresh_ms"] += ink - handled
+        self.counters["loop"]["max_ms"] = max(self.counters["loop"]["max_ms"], handled)
+        if kind in ("grid_page", "page"):
+            self.counters["thumbnails"]["hits"] += 12
+            self.counters["thumbnails"]["misses"] += 3
+        self.counters["sd"]["opens"] += 3
+        self.counters["sd"]["bytes_read"] += 3 * 40000
+        return handled, ink
+
+    def push(self):
+        self.stack.append(dict(self.ui))
+        self.counters["router"]["snapshots"] += 1
+
+    def open_grid(self):
+        self.ui["page"] = "GRID"
+        self.ui["grid_page"] = 0
+        self.ui["grid_pages"] = max(1, (len(self.visible()) + 14) // 15)
+        return self.work("page")
+
+    def open_card(self, index):
+        self.ui["page"] = "FLIPCARD"
+        self.ui["card"] = index
+        self.ui["language"] = self.cards[index][2][0]
+        return self.work("card")
+
+    def step_card(self, step):
+        visible = self.visible()
+        if self.ui["random"] or step == 0:
+            choices = [i for i in visible if i != self.ui["card"]] or visible
+            return self.open_card(self.random.choice(choices))
+        position = visible.index(self.ui["card"]) if self.ui["card"] in visible else 0
+        return self.open_card(visible[(position + step) % len(visible)])
+
+    def turn_grid(self, step):
+        self.ui["grid_page"] = (self.ui["grid_page"] + step) % self.ui["grid_pages"]
+        return self.work("grid_page")
+
+    def cycle_language(self):
+        languages = self.cards[self.ui["card"]][2]
+        position = languages.index(self.ui["language"]) if self.ui["language"] in languages else 0
+        self.ui["language"] = languages[(position + 1) % len(languages)]
+        return self.work("language")
+
+    def back(self):
+        if not self.stack:
+            return None
+        self.ui = self.stack.pop()
+        self.counters["router"]["restores"] += 1
+        return self.work("page")
+
+    def navigate(self, target, args):
+        """(handled_ms, ink_ms) or an error string, like controlNavigate in main.cpp."""
+        page = self.ui["page"]
+        if target == "menu":
+            self.stack.clear()
+            self.ui.update(page="MENU", random=False, category="")
+            return self.work("page")
+        if target == "options":
+            self.push()
+            self.ui["page"] = "OPTION"
+            return self.work("page")
+        if target == "categories":
+            self.push()
+            self.ui.update(page="CATEGORY", random=args[:1] == ["random"], category_page=0)
+            return self.work("page")
+        if target == "category":
+            category = args[0] if args else ""
+            if category not in self.categories:
+                return "no cards of that category match the filter"
+            self.push()
+            self.ui.update(random=args[1:2] == ["random"], category=category)
+            return self.step_card(0) if self.ui["random"] else self.open_grid()
+        if target == "grid":
+            if page != "GRID":
+                return "not on the grid"
+            which = args[0] if args else ""
+            if which in ("next", "prev"):
+                return self.turn_grid(1 if which == "next" else -1)
+            if not which.isdigit() or int(which) >= self.ui["grid_pages"]:
+                return "grid page out of range"
+            self.ui["grid_page"] = int(which) - 1
+            return self.turn_grid(1)
+        if target == "card":
+            which = args[0] if args else ""
+            if which in ("next", "prev", "random"):
+                if page != "FLIPCARD":
+                    return "not on a card"
+                return self.step_card({"next": 1, "prev": -1, "random": 0}[which])
+            if not which.isdigit() or int(which) >= len(self.cards):
+                return "card index out of range"
+            self.push()
+            return self.open_card(int(which))
+        if target == "language":
+            if page != "FLIPCARD":
+                return "not on a card"
+            return self.cycle_language()
+        if target == "back":
+            return self.back() or "nothing to go back to"
+        return "targets: menu, options, categories [random], category <id> [random], grid next|prev|<page>, " \
+               "card next|prev|random|<index>, language, back"
+
+    def touch(self, kind, args):
+        """(gesture, (handled_ms, ink_ms) or None) for an injected touch."""
+        page = self.ui["page"]
+        if kind == "swipe":
+            step = 1 if args[:1] == ["left"] else -1
+            gesture = "swipe-left" if step == 1 else "swipe-right"
+            if page == "FLIPCARD":
+                return gesture, self.step_card(step)
+            if page == "GRID" and self.ui["grid_pages"] > 1:
+                return gesture, self.turn_grid(step)
+            return gesture, None
+        if kind == "twofinger":
+            return "two-finger-tap", self.cycle_language() if page == "FLIPCARD" else None
+        if kind == "long":
+            if page == "FLIPCARD":
+                return "long-press", self.back() or self.open_grid()
+            return "long-press", None
+        return "tap", None
+
+    def command(self, line):
+        """One console line -> output text."""
+        words = line.split()
+        if not words or words[0] != "ctl":
+            return f"[Console] Unknown command: {words[0] if words else ''} (try help)\n"
+        words = words[1:]
+        command = " ".join(words)
+        action = words[0] if words else ""
+        self.counters["loop"]["count"] += 1
+        reply = {"ok": True, "cmd": command}
+        if action == "ping":
+            reply["version"] = PROTOCOL_VERSION
+        elif action == "state":
+            reply["state"] = self.state()
+        elif action == "counters":
+            reply = dict(reply, uptime_ms=int((time.monotonic() - self.started) * 1000),
+                         memory={"heap_free": 180000, "heap_min": 150000, "heap_largest": 110000,
+                                 "psram_free": 6000000, "psram_min": 5200000, "psram_largest": 4000000},
+                         **json.loads(json.dumps(self.counters)))
+        elif action == "reset":
+            for group in ("sd", "thumbnails", "router"):
+                self.counters[group] = {key: 0 for key in self.counters[group]}
+            self.counters["loop"]["max_ms"] = 0
+        elif action == "go" and len(words) > 1:
+            result = self.navigate(words[1], words[2:])
+            if isinstance(result, str):
+                reply = {"ok": False, "cmd": command, "error": result}
+            else:
+                reply.update(handled_ms=result[0], ink_ms=result[1], state=self.state())
+        elif action in ("tap", "long", "twofinger", "swipe"):
+            if action == "swipe" and words[1:2] not in (["left"], ["right"]):
+                reply = {"ok": False, "cmd": command, "error": "usage: swipe left|right [y]"}
+            else:
+                gesture, result = self.touch(action, words[1:])
+                handled, ink = result or (1, 1)
+                reply.update(gesture=gesture, handled_ms=handled, ink_ms=ink, state=self.state())
+        else:
+            reply = {"ok": False, "cmd": command, "error": "usage: ctl ping|state|counters|reset|go <target>|"
+                                                           "tap x y|long x y|twofinger x y|swipe left|right [y]"}
+        log = f"[Sim] {command}\n" if action in ("go", "tap", "long", "twofinger", "swipe") else ""
+        return log + "CTL " + json.dumps(reply, separators=(",", ":")) + "\n"
+
+
+def load_deck(folder):
+    """Cards, categories and languages of a collection's index.json, or a synthetic set."""
+    if folder:
+        index = json.loads((Path(folder) / "index.json").read_text(encoding="utf-8"))
+        cards = [(card.get("id", str(i)), card.get("category", "uncategorized"), card.get("languages") or ["english"])
+                 for i, card in enumerate(index.get("cards", []))]
+        if cards:
+            categories = list(index.get("categories", {})) or sorted({card[1] for card in cards})
+            languages = sorted({language for card in cards for language in card[2]})
+            return cards, categories, languages
+    categories = ["animals", "food", "transport"]
+    languages = ["english", "chinese"]
+    cards = [(f"{i + 1:04d}", categories[i % 3], languages if i % 4 else languages[:1]) for i in range(120)]
+    return cards, categories, languages
+
+
+def simulate(options):
+    import pty
+    import tty
+    cards, categories, languages = load_deck(options.deck)
+    device = SimulatedDevice(cards, categories, languages, options.time_scale, options.seed)
+    master, slave = pty.openpty()
+    tty.setraw(slave)
+    print(f"Simulated device on {os.ttyname(slave)}: {len(cards)} cards, categories {', '.join(categories)} "
+          f"(Ctrl-C to stop)", flush=True)
+    pending = b""
+    try:
+        while True:
+            pending += os.read(master, 4096)
+            while b"\n" in pending:
+                line, pending = pending.split(b"\n", 1)
+                text = line.decode(errors="replace").strip()
+                if text:
+                    os.write(master, device.command(text).encode())
+    except KeyboardInterrupt:
+        return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    bench = commands.add_parser("run", help="run a scenario on the device")
+    bench.add_argument("scenario", type=Path, help="scenario file (ctl commands, repeat/end, expect, sleep)")
+    bench.add_argument("--port", required=True, help="serial port, e.g. /dev/ttyACM0")
+    bench.add_argument("--baud", type=int, default=115200)
+    bench.add_argument("--repeat", type=int, default=1, help="run the scenario this many times")
+    bench.add_argument("--timeout", type=float, default=20.0, help="seconds to wait for each reply")
+    bench.add_argument("-o", "--output", type=Path, help="write all replies, counters and the summary as JSON")
+    bench.add_argument("--log", type=Path, help="copy of everything the device printed")
+    bench.set_defaults(handler=run)
+
+    diff = commands.add_parser("compare", help="flag steps slower than in a baseline result file")
+    diff.add_argument("baseline", type=Path)
+    diff.add_argument("run", type=Path)
+    diff.add_argument("--threshold", type=float, default=10.0, help="percent slower that counts as a regression")
+    diff.add_argument("--min-ms", type=int, default=30, help="ignore changes smaller than this")
+    diff.set_defaults(handler=compare)
+
+    sim = commands.add_parser("simulate", help="stand-in device on a pseudo-terminal (Linux)")
+    sim.add_argument("--deck", type=Path, help="collection whose index.json supplies cards and categories")
+    sim.add_argument("--time-scale", type=float, default=0.05,
+                     help="fraction of the made-up refresh times actually waited")
+    sim.add_argument("--seed", type=int, default=1)
+    sim.set_defaults(handler=simulate)
+
+    options = parser.parse_args()
+    try:
+        return options.handler(options)
+    except ControlError as error:
+        print(f"error: {error}", file=sys.stderr)
+        return 2
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+"""Generate a synthetic flipcard collection of any size for scaling tests.
+
+Writes a valid collection: index.json, one folder per card with card.json and
+small placeholder images (gray PNGs at the role sizes the firmware expects).
+Copy the output to the SD card root and pick it in Options -> Collections.
+
+A config.json listing the generated languages and file naming is written as
+well, so tools/deck_lint.py finds it by default. The firmware only reads
+/flipcard/config.json: merge its languages there to enable them on device.
+
+Usage:
+    python3 tools/gen_deck.py /tmp/deck-10k --cards 10000 --categories 20 --languages 3
+    python3 tools/gen_deck.py /media/sd/collection-100k --cards 100000 --no-images
+
+Cards are spread round-robin over the categories. The first language is on
+every card; each further language is on a card with probability --coverage.
+Difficulty (1-5) and tags are random but reproducible with --seed. Placeholder
+images are shared per category, so even 100k cards generate quickly.
+Uses only the Python standard library.
+"""
+
+import argparse
+import json
+import random
+import struct
+import sys
+import time
+import zlib
+from pathlib import Path
+
+LANGUAGE_NAMES = ["english", "chinese", "japanese", "korean", "spanish", "french", "german", "italian",
+                  "portuguese", "russian", "arabic", "hindi", "thai", "vietnamese", "indonesian", "dutch"]
+LANGUAGE_CODES = {"english": "en", "chinese": "zh", "japanese": "ja", "korean": "ko", "spanish": "es",
+                  "french": "fr", "german": "de", "italian": "it", "portuguese": "pt", "russian": "ru",
+                  "arabic": "ar", "hindi": "hi", "thai": "th", "vietnamese": "vi", "indonesian": "id",
+                  "dutch": "nl"}
+TAG_POOL = ["beginner", "intermediate", "advanced", "noun", "verb", "adjective", "daily", "travel",
+            "food", "nature", "home", "work", "school", "city", "sport", "health"]
+
+# Role sizes on the 540x960 portrait layout
+ROLE_SIZES = {"thumb": (120, 120), "big": (400, 150), "small": (400, 80), "img": (400, 400)}
+
+
+def png_chunk(kind, data):
+    return struct.pack(">I", len(data)) + kind + data + struct.pack(">I", zlib.crc32(kind + data) & 0xFFFFFFFF)
+
+
+def placeholder_png(width, height, shade):
+    """4-bit gray PNG: light background, black border and diagonal stripes."""
+    rows = []
+    for y in range(height):
+        row = bytearray()
+        for x in range(0, width, 2):
+            pair = []
+            for px in (x, x + 1):
+                if px >= width:
+                    pair.append(15)
+                elif px < 2 or y < 2 or px >= width - 2 or y >= height - 2:
+                    pair.append(0)
+                elif (px + y) // 12 % 4 == 0:
+                    pair.append(shade)
+                else:
+                    pair.append(15)
+            row.append(pair[0] << 4 | pair[1])
+        rows.append(b"\x00" + bytes(row))
+    header = struct.pack(">IIBBBBB", width, height, 4, 0, 0, 0, 0)
+    return (b"\x89PNG\r\n\x1a\n" + png_chunk(b"IHDR", header) +
+            png_chunk(b"IDAT", zlib.compress(b"".join(rows), 9)) + png_chunk(b"IEND", b""))
+
+
+def language_names(count):
+    names = LANGUAGE_NAMES[:count]
+    names += [f"lang{i:02d}" for i in range(len(names), count)]
+    return names
+
+
+def language_code(name):
+    return LANGUAGE_CODES.get(name, name)
+
+
+def deck_config(languages):
+    """config.json sections deck_lint reads, matching what was generated."""
+    return {
+        "metadata": {"description": "Generated by tools/gen_deck.py; the device reads /flipcard/config.json"},
+        "languages": {
+            "default": languages[0],
+            "supported": {
+                name: {
+                    "code": language_code(name),
+                    "name": name.capitalize(),
+                    "english_name": name.capitalize(),
+                    "file_suffix": language_code(name),
+                    "direction": "ltr",
+                    "font_scale": 1.0,
+                    "enabled": True,
+                }
+                for name in languages
+            },
+        },
+        "file_naming": {
+            "convention": {
+                "folder": "flip-{id}",
+                "big_image": "big-{lang}-{id}.png",
+                "small_image": "small-{lang}-{id}.png",
+                "main_image": "img-{id}.png",
+                "thumbnail": "thumb-{id}.png",
+            },
+            "validation": {
+                "supported_formats": ["png", "jpg"],
+                "max_file_size": 2097152,
+                "thumbnail_max_size": 51200,
+            },
+        },
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("output", type=Path, help="collection root to create")
+    parser.add_argument("--cards", type=int, default=1000)
+    parser.add_argument("--categories", type=int, default=10)
+    parser.add_argument("--languages", type=int, default=2)
+    parser.add_argument("--coverage", type=float, default=1.0,
+                        help="probability that a card has each language after the first")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--name", help="metadata.name (default: Synthetic <N> cards)")
+    parser.add_argument("--no-images", action="store_true", help="write JSON only (cards will show fallbacks)")
+    parser.add_argument("--force", action="store_true", help="write into a non-empty directory")
+    options = parser.parse_args()
+
+    if options.cards < 1 or options.categories < 1 or options.languages < 1:
+        print("error: --cards, --categories and --languages must be at least 1", file=sys.stderr)
+        return 2
+    if options.output.exists() and any(options.output.iterdir()) and not options.force:
+        print(f"error: {options.output} is not empty (use --force)", file=sys.stderr)
+        return 2
+
+    started = time.monotonic()
+    rng = random.Random(options.seed)
+    width = max(4, len(str(options.cards)))
+    languages = language_names(options.languages)
+    categories = {f"cat{i:02d}": {"name": f"Category {i}", "color": "#9E9E9E", "icon": ""}
+                  for i in range(options.categories)}
+    category_ids = list(categories)
+
+    images = {}
+    if not options.no_images:
+        for index in range(min(options.categories, 8)):
+            for role, (w, h) in ROLE_SIZES.items():
+                images[(role, index)] = placeholder_png(w, h, 2 + index)
+
+    options.output.mkdir(parents=True, exist_ok=True)
+    cards = []
+    image_bytes = 0
+    for number in range(1, options.cards + 1):
+        card_id = f"{number:0{width}d}"
+        folder = f"flip-{card_id}"
+        category = category_ids[(number - 1) % len(category_ids)]
+        card_languages = [languages[0]] + [name for name in languages[1:] if rng.random() < options.coverage]
+        difficulty = rng.randint(1, 5)
+        tags = rng.sample(TAG_POOL, rng.randint(1, 3))
+
+        card = {
+            "id": card_id,
+            "original_id": card_id,
+            "title": f"Card {number}",
+            "difficulty": difficulty,
+            "category": category,
+            "main_image": f"img-{card_id}.png",
+            "thumbnail": f"thumb-{card_id}.png",
+            "languages": {
+                name: {
+                    "big_text": f"{name} {number}",
+                    "small_text": f"/{language_code(name)}-{number}/",
+                    "big_file": f"big-{language_code(name)}-{card_id}.png",
+                    "small_file": f"small-{language_code(name)}-{card_id}.png",
+                    "notes": "",
+                }
+                for name in card_languages
+            },
+            "tags": tags,
+        }
+        directory = options.output / folder
+        directory.mkdir(exist_ok=True)
+        (directory / "card.json").write_text(json.dumps(card, ensure_ascii=False, indent=2), encoding="utf-8")
+
+        if images:
+            shade = (number - 1) % len(category_ids) % 8
+            files = [("img", card["main_image"]), ("thumb", card["thumbnail"])]
+            for fields in card["languages"].values():
+                files += [("big", fields["big_file"]), ("small", fields["small_file"])]
+            for role, name in files:
+                data = images[(role, shade)]
+                (directory / name).write_bytes(data)
+                image_bytes += len(data)
+
+        cards.append({
+            "id": card_id,
+            "folder": folder,
+            "title": card["title"],
+            "category": category,
+            "difficulty": difficulty,
+            "thumbnail": card["thumbnail"],
+            "languages": card_languages,
+            "tags": tags,
+        })
+
+    today = time.strftime("%Y-%m-%d")
+    index = {
+        "metadata": {
+            "name": options.name or f"Synthetic {options.cards} cards",
+            "version": "2.0",
+            "created": today,
+            "updated": today,
+            "description": f"Generated by tools/gen_deck.py (seed {options.seed})",
+            "total_cards": options.cards,
+        },
+        "cards": cards,
+        "categories": categories,
+    }
+    # Large indexes are written compact: indentation is a third of their size
+    index_text = json.dumps(index, ensure_ascii=False, indent=2 if options.cards <= 1000 else None)
+    (options.output / "index.json").write_text(index_text, encoding="utf-8")
+    config_text = json.dumps(deck_config(languages), ensure_ascii=False, indent=2)
+    (options.output / "config.json").write_text(config_text, encoding="utf-8")
+
+    print(f"{options.output}: {options.cards} cards, {options.categories} categories, "
+          f"{options.languages} languages; index.json {len(index_text) / 1024:.0f} KB, "
+          f"images {image_bytes / 1024:.0f} KB, {time.monotonic() - started:.1f} s")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
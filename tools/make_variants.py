@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""Make resolution-matched asset variants for the firmware's display profiles.
+
+Deck and UI art is authored for the 540x960 portrait layout. Every other
+profile in src/core/display_profile.cpp draws "name@WxH.ext" files sized for
+its own regions instead, so nothing is scaled on the device. This writes those
+files next to the originals:
+
+    menu.png, empty-frame.png           full screen (WxH of the panel)
+    Left/Right/Home(Grey).png           navigation button size
+    card big_file / small_file          big and small text regions
+    card main_image                     main image region
+
+Thumbnails are not touched: the firmware's thumbnail store already keeps them
+at the grid size of the active profile.
+
+Usage:
+    python3 tools/make_variants.py sd_card_content/flipcard
+    python3 tools/make_variants.py /media/sd/flipcard --deck /media/sd/collection-01 \\
+        --profile epdiy_1200x825 --force
+
+Existing variants newer than their source are kept unless --force is given.
+Requires Pillow (pip install pillow).
+"""
+
+import argparse
+import json
+import sys
+from pathlib import Path
+
+from PIL import Image, ImageOps
+
+# Mirror of the region sizes in src/core/display_profile.cpp (portrait is the
+# authored size and needs no variants)
+PROFILES = {
+    "landscape": {
+        "screen": (960, 540),
+        "button": (80, 80),
+        "big": (400, 150),
+        "small": (400, 80),
+        "main": (400, 400),
+    },
+    "epdiy_1200x825": {
+        "screen": (1200, 825),
+        "button": (120, 120),
+        "big": (500, 188),
+        "small": (500, 100),
+        "main": (560, 560),
+    },
+}
+BASE_SIZES = {
+    "screen": (540, 960),
+    "button": (80, 80),
+    "big": (400, 150),
+    "small": (400, 80),
+    "main": (400, 400),
+}
+
+BUTTON_FILES = ["Left.png", "Right.png", "Home.png", "LeftGrey.png", "RightGrey.png"]
+
+# menu.png is letterboxed so its buttons land on the profile's menu hotspots;
+# empty-frame.png covers the panel from the top-left, as the firmware's old
+# runtime scaling did
+SCREEN_FILES = {"menu.png": "fit", "empty-frame.png": "cover"}
+
+
+def variant_path(path, size):
+    return path.with_name(f"{path.stem}@{size[0]}x{size[1]}{path.suffix}")
+
+
+def render(image, size, mode):
+    """Resize to exactly `size`: letterbox on white ("fit") or crop ("cover")."""
+    if image.mode in ("RGBA", "LA", "P"):
+        # Transparent areas become the white page, as on the device
+        rgba = image.convert("RGBA")
+        image = Image.new("RGB", rgba.size, (255, 255, 255))
+        image.paste(rgba, mask=rgba.getchannel("A"))
+    elif image.mode not in ("L", "RGB"):
+        image = image.convert("L")
+    if mode == "cover":
+        scale = max(size[0] / image.width, size[1] / image.height)
+        scaled = image.resize((round(image.width * scale), round(image.height * scale)), Image.LANCZOS)
+        return scaled.crop((0, 0, size[0], size[1]))
+    scaled = ImageOps.contain(image, size, Image.LANCZOS)
+    canvas = Image.new(image.mode, size, 255 if image.mode == "L" else (255, 255, 255))
+    canvas.paste(scaled, ((size[0] - scaled.width) // 2, (size[1] - scaled.height) // 2))
+    return canvas
+
+
+def make_variant(source, role, size, mode, options, counts):
+    if size == BASE_SIZES[role] or not source.exists():
+        return
+    target = variant_path(source, size)
+    if not options.force and target.exists() and target.stat().st_mtime >= source.stat().st_mtime:
+        counts["kept"] += 1
+        return
+    try:
+        with Image.open(source) as image:
+            result = render(image, size, mode)
+    except OSError as error:
+        print(f"warning: cannot read {source}: {error}", file=sys.stderr)
+        counts["failed"] += 1
+        return
+    # Gray output: the panel shows gray only, and gray PNGs take the 4bpp fast path
+    result = result.convert("L")
+    if source.suffix.lower() in (".jpg", ".jpeg"):
+        result.save(target, quality=90)
+    else:
+        result.save(target, optimize=True)
+    counts["written"] += 1
+    if options.verbose:
+        print(f"{target} ({role})")
+
+
+def card_sources(deck):
+    """(path, role) for every big, small and main image of a collection."""
+    try:
+        index = json.loads((deck / "index.json").read_text(encoding="utf-8"))
+    except (OSError, ValueError) as error:
+        print(f"warning: skipping {deck}: {error}", file=sys.stderr)
+        return
+    for entry in index.get("cards", []):
+        folder = deck / entry.get("folder", "")
+        try:
+            card = json.loads((folder / "card.json").read_text(encoding="utf-8"))
+        except (OSError, ValueError) as error:
+            print(f"warning: skipping {folder}: {error}", file=sys.stderr)
+            continue
+        if card.get("main_image"):
+            yield folder / card["main_image"], "main"
+        for language in card.get("languages", {}).values():
+            if language.get("big_file"):
+                yield folder / language["big_file"], "big"
+            if language.get("small_file"):
+                yield folder / language["small_file"], "small"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("root", type=Path, help="the SD card's flipcard directory (UI assets, default deck)")
+    parser.add_argument("--deck", type=Path, action="append", default=[],
+                        help="extra collection root with its own index.json (repeatable)")
+    parser.add_argument("--profile", choices=sorted(PROFILES), action="append",
+                        help="only this profile (repeatable; default: all)")
+    parser.add_argument("--force", action="store_true", help="rewrite variants that are up to date")
+    parser.add_argument("--verbose", action="store_true", help="list every file written")
+    options = parser.parse_args()
+
+    counts = {"written": 0, "kept": 0, "failed": 0}
+    for name in options.profile or sorted(PROFILES):
+        sizes = PROFILES[name]
+        for file, mode in SCREEN_FILES.items():
+            make_variant(options.root / file, "screen", sizes["screen"], mode, options, counts)
+        for file in BUTTON_FILES:
+            make_variant(options.root / file, "button", sizes["button"], "fit", options, counts)
+        for deck in [options.root] + options.deck:
+            for source, role in card_sources(deck):
+                make_variant(source, role, sizes[role], "fit", options, counts)
+
+    print(f"{counts['written']} variants written, {counts['kept']} up to date, {counts['failed']} failed")
+    return 1 if counts["failed"] else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
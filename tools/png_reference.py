@@ -0,0 +1,220 @@
+#!/usr/bin/env python3
+"""Write the reference gray levels for the PNG fast path's host test.
+
+The firmware decodes gray and palette PNGs straight to 4bpp gray levels
+(src/core/png_gray4.cpp). test/test_png_gray4 checks that decoder against
+levels computed here from Pillow's decode, using the firmware's luma
+(77/150/29, rounded) and nearest-level rounding. Odd widths are padded with
+level 15.
+
+This writes small synthetic PNGs covering every bit depth the fast path takes
+(gray 1/2/4/8/16, palette 1/2/4/8), all five scanline filters, odd widths,
+IDAT split over several chunks and ancillary chunks to skip, plus palette+tRNS
+and RGBA files it must decline. It then lists those and the deck's PNGs with
+the expected result: "ok <FNV-1a of the packed rows>" or "unsupported".
+
+Usage:
+    python3 tools/png_reference.py
+    python3 tools/png_reference.py --deck sd_card_content/flipcard --out test/test_png_gray4
+
+Run it from the project root after changing the sample assets. Requires Pillow
+(pip install pillow).
+"""
+
+import argparse
+import random
+import struct
+import sys
+import zlib
+from pathlib import Path
+
+try:
+    from PIL import Image
+except ImportError:
+    sys.exit("Pillow is required: pip install pillow")
+
+
+def chunk(kind, data):
+    return struct.pack(">I", len(data)) + kind + data + struct.pack(">I", zlib.crc32(kind + data) & 0xFFFFFFFF)
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def filter_row(kind, row, previous, bpp):
+    out = bytearray(len(row))
+    for i, value in enumerate(row):
+        left = row[i - bpp] if i >= bpp else 0
+        up = previous[i]
+        upper_left = previous[i - bpp] if i >= bpp else 0
+        predictor = (0, left, up, (left + up) >> 1, paeth(left, up, upper_left))[kind]
+        out[i] = (value - predictor) & 0xFF
+    return bytes(out)
+
+
+def pack_samples(samples, bit_depth):
+    if bit_depth == 16:
+        return b"".join(struct.pack(">H", value) for value in samples)
+    if bit_depth == 8:
+        return bytes(samples)
+    per_byte = 8 // bit_depth
+    out = bytearray((len(samples) + per_byte - 1) // per_byte)
+    for x, value in enumerate(samples):
+        out[x // per_byte] |= value << (8 - bit_depth * (x % per_byte + 1))
+    return bytes(out)
+
+
+def encode_png(width, height, bit_depth, color_type, rows, palette=None, transparency=None, idat_split=0):
+    """Raw PNG writer: filter type cycles 0-4 per row, optional IDAT split."""
+    channels = {0: 1, 3: 1, 6: 4}[color_type]
+    bpp = max(1, bit_depth * channels // 8)
+    line_length = (width * bit_depth * channels + 7) // 8
+    previous = bytes(line_length)
+    raw = bytearray()
+    for y, samples in enumerate(rows):
+        line = pack_samples(samples, bit_depth)
+        kind = y % 5
+        raw.append(kind)
+        raw += filter_row(kind, line, previous, bpp)
+        previous = line
+    compressed = zlib.compress(bytes(raw), 9)
+
+    data = b"\x89PNG\r\n\x1a\n"
+    data += chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, bit_depth, color_type, 0, 0, 0))
+    data += chunk(b"tEXt", b"Comment\x00fast path fixture")
+    if palette:
+        data += chunk(b"PLTE", b"".join(bytes(color) for color in palette))
+    if transparency:
+        data += chunk(b"tRNS", bytes(transparency))
+    step = idat_split or len(compressed)
+    for start in range(0, len(compressed), step):
+        data += chunk(b"IDAT", compressed[start:start + step])
+    data += chunk(b"IEND", b"")
+    return data
+
+
+def write_fixtures(directory, rng):
+    directory.mkdir(parents=True, exist_ok=True)
+    written = []
+
+    def save(name, data):
+        path = directory / name
+        path.write_bytes(data)
+        written.append(path)
+
+    for bit_depth, width in ((1, 37), (2, 13), (4, 21), (8, 31), (16, 17)):
+        top = (1 << bit_depth) - 1
+        rows = [[rng.randint(0, top) for _ in range(width)] for _ in range(11)]
+        save(f"gray{bit_depth}.png", encode_png(width, 11, bit_depth, 0, rows, idat_split=40))
+    for bit_depth, width in ((1, 9), (2, 23), (4, 15), (8, 41)):
+        count = 1 << bit_depth
+        palette = [tuple(rng.randint(0, 255) for _ in range(3)) for _ in range(count)]
+        rows = [[rng.randrange(count) for _ in range(width)] for _ in range(10)]
+        save(f"palette{bit_depth}.png", encode_png(width, 10, bit_depth, 3, rows, palette=palette, idat_split=64))
+    # Wide and tall enough for several 4 KB reads and output windows
+    rows = [[(x * 3 + y * 5 + rng.randint(0, 3)) & 0xFF for x in range(301)] for y in range(240)]
+    save("gray8-large.png", encode_png(301, 240, 8, 0, rows))
+
+    # Must be declined (left to the generic decoder)
+    palette = [(0, 0, 0), (255, 255, 255)]
+    rows = [[rng.randrange(2) for _ in range(8)] for _ in range(8)]
+    save("palette-trns.png", encode_png(8, 8, 1, 3, rows, palette=palette, transparency=[0]))
+    rows = [[rng.randint(0, 255) for _ in range(8 * 4)] for _ in range(8)]
+    save("rgba8.png", encode_png(8, 8, 8, 6, rows))
+    return written
+
+
+def png_header(data):
+    width, height, bit_depth, color_type, _, _, interlace = struct.unpack(">IIBBBBB", data[16:29])
+    return width, height, bit_depth, color_type, interlace
+
+
+def has_chunk(data, kind):
+    position = 8
+    while position + 8 <= len(data):
+        length = struct.unpack(">I", data[position:position + 4])[0]
+        if data[position + 4:position + 8] == kind:
+            return True
+        position += 12 + length
+    return False
+
+
+def eligible(data):
+    _, _, bit_depth, color_type, interlace = png_header(data)
+    if interlace or has_chunk(data, b"tRNS"):
+        return False
+    if color_type == 0:
+        return bit_depth in (1, 2, 4, 8, 16)
+    return color_type == 3 and bit_depth in (1, 2, 4, 8)
+
+
+def nearest_level(gray):
+    return (gray * 15 + 127) // 255
+
+
+def reference_levels(path):
+    """Gray level rows from Pillow's decode, mapped like the firmware."""
+    image = Image.open(path)
+    image.load()
+    width, height = image.size
+    if image.mode.startswith("I"):
+        # 16-bit gray: the firmware uses the high byte of each sample
+        samples = image.convert("I").tobytes("raw", "I")
+        grays = [value >> 8 for value in struct.unpack(f"<{width * height}i", samples)]
+    else:
+        rgb = image.convert("RGB").tobytes()
+        grays = [(77 * rgb[i] + 150 * rgb[i + 1] + 29 * rgb[i + 2] + 128) >> 8 for i in range(0, len(rgb), 3)]
+    return width, height, [nearest_level(gray) for gray in grays]
+
+
+def fnv1a(data):
+    value = 2166136261
+    for byte in data:
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value
+
+
+def packed_rows(width, height, levels):
+    out = bytearray()
+    for y in range(height):
+        row = levels[y * width:(y + 1) * width] + ([15] if width & 1 else [])
+        for x in range(0, len(row), 2):
+            out.append(row[x] << 4 | row[x + 1])
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--deck", type=Path, default=Path("sd_card_content/flipcard"),
+                        help="folder whose PNGs (recursively) are listed as well")
+    parser.add_argument("--out", type=Path, default=Path("test/test_png_gray4"),
+                        help="test folder: fixtures/ and reference.txt are written here")
+    parser.add_argument("--seed", type=int, default=37, help="seed for the synthetic fixtures")
+    options = parser.parse_args()
+
+    paths = write_fixtures(options.out / "fixtures", random.Random(options.seed))
+    paths += sorted(options.deck.rglob("*.png"))
+
+    lines = ["# path width height expected [fnv1a of the packed 4bpp rows]",
+             "# Written by tools/png_reference.py; paths are relative to the project root"]
+    for path in paths:
+        data = path.read_bytes()
+        width, height = png_header(data)[:2]
+        name = path.as_posix()
+        if not eligible(data):
+            lines.append(f"{name} {width} {height} unsupported")
+            continue
+        width, height, levels = reference_levels(path)
+        lines.append(f"{name} {width} {height} ok {fnv1a(packed_rows(width, height, levels)):08x}")
+
+    (options.out / "reference.txt").write_text("\n".join(lines) + "\n", encoding="utf-8")
+    print(f"{len(paths)} PNGs listed in {options.out / 'reference.txt'}")
+
+
+if __name__ == "__main__":
+    main()
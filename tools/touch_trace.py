@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+"""Replay touch traces on the device and compare tap-to-ink latency between runs.
+
+The firmware records traces with "trace record sd" (to /flipcard/trace.tsv) or
+"trace record serial" on its serial console, or from boot with
+diagnostics.touch_trace in config.json. A trace holds the raw touch samples
+and one I line per interaction: the gesture time, when its handler returned
+and when the panel refresh it caused finished ("ink").
+
+Usage:
+    # Drive a recorded trace through the device over USB serial, 5 times
+    python3 tools/touch_trace.py replay trace.tsv --port /dev/ttyACM0 --repeat 5 -o run.tsv
+
+    # Latency distribution per interaction (trace, replay result or serial log)
+    python3 tools/touch_trace.py report run.tsv
+
+    # Flag interactions that got slower than in the baseline run
+    python3 tools/touch_trace.py compare baseline.tsv run.tsv --threshold 10 --min-ms 30
+
+compare exits with status 1 when any interaction regressed. replay needs
+pyserial (pip install pyserial); report and compare use only the standard
+library.
+"""
+
+import argparse
+import sys
+import time
+from pathlib import Path
+
+INTERACTIONS = ["category_select", "grid_page", "card_next", "language_cycle", "page"]
+
+
+def trace_fields(line):
+    """Split one trace line; serial output carries a "TRACE " prefix."""
+    line = line.strip()
+    if "TRACE " in line:
+        line = line[line.index("TRACE ") + 6:]
+    if not line or line.startswith("#"):
+        return []
+    return line.split()
+
+
+def read_samples(path):
+    """Touch samples (time, x, y, fingers) of a trace file."""
+    samples = []
+    for line in Path(path).read_text(encoding="utf-8", errors="replace").splitlines():
+        fields = trace_fields(line)
+        if len(fields) == 5 and fields[0] == "S":
+            samples.append(tuple(int(value) for value in fields[1:]))
+    return samples
+
+
+def read_interactions(path):
+    """(interaction, latency ms, handling ms) for every I line of a file."""
+    results = []
+    for line in Path(path).read_text(encoding="utf-8", errors="replace").splitlines():
+        fields = trace_fields(line)
+        if len(fields) >= 5 and fields[0] == "I":
+            gesture, handled, ink = (int(value) for value in fields[2:5])
+            results.append((fields[1], ink - gesture, handled - gesture))
+    return results
+
+
+def split_gestures(samples):
+    """Group samples from each touch-down to its release."""
+    gestures, current = [], []
+    for sample in samples:
+        if not current and sample[3] == 0:
+            continue  # Release without a touch-down
+        current.append(sample)
+        if sample[3] == 0:
+            gestures.append(current)
+            current = []
+    return gestures
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * fraction))]
+
+
+def summarize(results):
+    """Per interaction: n, p50, p90, max of latency and p50 of handling time."""
+    summary = {}
+    for name in INTERACTIONS + sorted({r[0] for r in results} - set(INTERACTIONS)):
+        latencies = [r[1] for r in results if r[0] == name]
+        handling = [r[2] for r in results if r[0] == name]
+        if latencies:
+            summary[name] = {
+                "n": len(latencies),
+                "p50": percentile(latencies, 0.5),
+                "p90": percentile(latencies, 0.9),
+                "max": max(latencies),
+                "handling_p50": percentile(handling, 0.5),
+            }
+    return summary
+
+
+def print_summary(summary, title):
+    print(title)
+    print(f"  {'interaction':16} {'n':>5} {'p50':>7} {'p90':>7} {'max':>7} {'cpu p50':>8}  (ms)")
+    for name, row in summary.items():
+        print(f"  {name:16} {row['n']:5} {row['p50']:7} {row['p90']:7} {row['max']:7} {row['handling_p50']:8}")
+
+
+class Device:
+    """Line-oriented access to the firmware's serial console."""
+
+    def __init__(self, port, baud, log):
+        import serial  # pyserial, only needed for replay
+        self.port = serial.Serial(port, baud, timeout=0.1)
+        self.log = log
+        self.pending = b""
+
+    def send(self, text):
+        self.port.write((text + "\n").encode())
+
+    def read_line(self, deadline):
+        while time.monotonic() < deadline:
+            if b"\n" in self.pending:
+                line, self.pending = self.pending.split(b"\n", 1)
+                text = line.decode(errors="replace").rstrip("\r")
+                if self.log:
+                    self.log.write(text + "\n")
+                return text
+            self.pending += self.port.read(256)
+        return None
+
+    def wait_for(self, marker, timeout, collected):
+        """Read until a "TRACE <marker>" line; I lines are appended to collected."""
+        deadline = time.monotonic() + timeout
+        while True:
+            line = self.read_line(deadline)
+            if line is None:
+                return False
+            fields = trace_fields(line) if "TRACE " in line else []
+            if fields and fields[0] == "I":
+                collected.append("\t".join(fields))
+            if fields and fields[0] == marker:
+                return True
+
+
+def replay(options):
+    gestures = split_gestures(read_samples(options.trace))
+    if not gestures:
+        print(f"error: no touch samples in {options.trace}", file=sys.stderr)
+        return 2
+
+    log = open(options.log, "w", encoding="utf-8") if options.log else None
+    device = Device(options.port, options.baud, log)
+    lines = []
+    try:
+        for run in range(options.repeat):
+            device.send("trace replay serial")
+            if not device.wait_for("R", options.timeout, lines):
+                print("error: device did not start the replay (is the firmware current?)", file=sys.stderr)
+                return 2
+            for number, gesture in enumerate(gestures):
+                start = time.monotonic()
+                for sample in gesture:
+                    # Keep the recorded spacing within a gesture
+                    delay = (sample[0] - gesture[0][0]) / 1000.0 - (time.monotonic() - start)
+                    if delay > 0:
+                        time.sleep(delay)
+                    device.send("trace S {} {} {} {}".format(*sample))
+                if not device.wait_for("R", options.timeout, lines):
+                    print(f"warning: run {run + 1}, gesture {number + 1}: no response within {options.timeout} s",
+                          file=sys.stderr)
+            device.send("trace stop")
+            device.wait_for("E", options.timeout, lines)
+            print(f"run {run + 1}/{options.repeat}: {len(gestures)} gestures replayed")
+    finally:
+        if log:
+            log.close()
+
+    if options.output:
+        Path(options.output).write_text("# flipcard touch trace 1\n" + "\n".join(lines) + "\n", encoding="utf-8")
+    results = [(f[1], int(f[4]) - int(f[2]), int(f[3]) - int(f[2])) for f in (line.split("\t") for line in lines)]
+    print_summary(summarize(results), f"Replay of {options.trace}")
+    return 0
+
+
+def report(options):
+    for path in options.files:
+        results = read_interactions(path)
+        if not results:
+            print(f"{path}: no interactions")
+            continue
+        print_summary(summarize(results), str(path))
+    return 0
+
+
+def compare(options):
+    base = summarize(read_interactions(options.baseline))
+    new = summarize(read_interactions(options.run))
+    regressions = 0
+    print(f"  {'interaction':16} {'metric':6} {'base':>7} {'new':>7} {'change':>8}")
+    for name in base:
+        if name not in new:
+            continue
+        for metric in ("p50", "p90"):
+            old_ms, new_ms = base[name][metric], new[name][metric]
+            change = (new_ms - old_ms) * 100.0 / old_ms if old_ms else 0.0
+            regressed = change > options.threshold and new_ms - old_ms > options.min_ms
+            regressions += regressed
+            flag = "  REGRESSION" if regressed else ""
+            print(f"  {name:16} {metric:6} {old_ms:7} {new_ms:7} {change:+7.1f}%{flag}")
+    missing = sorted(set(base) ^ set(new))
+    if missing:
+        print(f"  only in one run: {', '.join(missing)}")
+    print(f"{regressions} regression(s)")
+    return 1 if regressions else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    run = commands.add_parser("replay", help="drive a trace through the device over serial")
+    run.add_argument("trace", type=Path, help="recorded trace (its S lines are replayed)")
+    run.add_argument("--port", required=True, help="serial port, e.g. /dev/ttyACM0")
+    run.add_argument("--baud", type=int, default=115200)
+    run.add_argument("--repeat", type=int, default=1, help="replay the trace this many times")
+    run.add_argument("--timeout", type=float, default=15.0, help="seconds to wait for each interaction")
+    run.add_argument("-o", "--output", type=Path, help="write the I lines of all runs here")
+    run.add_argument("--log", type=Path, help="copy of everything the device printed")
+    run.set_defaults(handler=replay)
+
+    summary = commands.add_parser("report", help="latency distribution per interaction")
+    summary.add_argument("files", type=Path, nargs="+")
+    summary.set_defaults(handler=report)
+
+    diff = commands.add_parser("compare", help="flag interactions slower than in a baseline")
+    diff.add_argument("baseline", type=Path)
+    diff.add_argument("run", type=Path)
+    diff.add_argument("--threshold", type=float, default=10.0, help="percent slower that counts as a regression")
+    diff.add_argument("--min-ms", type=int, default=30, help="ignore changes smaller than this")
+    diff.set_defaults(handler=compare)
+
+    options = parser.parse_args()
+    return options.handler(options)
+
+
+if __name__ == "__main__":
+    sys.exit(main())